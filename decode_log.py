@@ -0,0 +1,155 @@
+# -*- coding: utf-8 -*-
+"""Renders ESPuino's binary log-history (http://<espuino>/log?binary) on the host.
+
+Usage:
+    python decode_log.py http://espuino.local/log?binary
+    python decode_log.py dump.bin [--level 3]
+
+The record-format is described at Log_DumpHistory() in src/Log.cpp.
+"""
+
+import argparse
+import re
+import struct
+import sys
+import urllib.request
+
+LEVEL_NAMES = {1: "E", 2: "N", 3: "I", 4: "D"}
+FLAG_NO_PREFIX = 0x01
+FLAG_NO_NEWLINE = 0x02
+FLAG_TRUNCATED = 0x04
+TEXT_ID = 0xFFFF
+
+# flags, width, precision, length-modifier, conversion
+SPEC = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t)?([diuoxXcfFeEgGaAspn%])")
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, fmt):
+        values = struct.unpack_from("<" + fmt, self.data, self.pos)
+        self.pos += struct.calcsize("<" + fmt)
+        return values if len(values) > 1 else values[0]
+
+    def bytes(self, n):
+        value = self.data[self.pos : self.pos + n]
+        self.pos += n
+        return value
+
+    def at_end(self):
+        return self.pos >= len(self.data)
+
+
+def read_argument(reader):
+    kind = chr(reader.take("B"))
+    if kind == "s":
+        length = reader.take("H")
+        return reader.bytes(length).decode("utf-8", "replace")
+    size = reader.take("B")
+    raw = reader.bytes(size)
+    if kind == "d":
+        return struct.unpack("<d", raw)[0]
+    return int.from_bytes(raw, "little", signed=(kind == "i")), size
+
+
+def render(fmt, args, truncated):
+    """printf-rendering with the arguments in the order they were stored; missing ones end the message"""
+    out = []
+    pos = 0
+    args = list(args)
+    for match in SPEC.finditer(fmt):
+        out.append(fmt[pos : match.start()])
+        pos = match.end()
+        flags, width, precision, _, conversion = match.groups()
+        if conversion == "%":
+            out.append("%")
+            continue
+        try:
+            if width == "*":
+                width = str(args.pop(0)[0])
+                if width.startswith("-"):
+                    flags, width = flags + "-", width[1:]
+            if precision == "*":
+                precision = str(args.pop(0)[0])
+            value = args.pop(0)
+        except IndexError:
+            return "".join(out) + "...", True
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+        if isinstance(value, tuple):
+            number, size = value
+            if conversion == "p":
+                out.append((spec + "s") % hex(number))
+                continue
+            if conversion in "uoxX" and number < 0:
+                number &= (1 << (8 * size)) - 1
+            if conversion == "c":
+                out.append((spec + "c") % chr(number & 0xFF))
+                continue
+            out.append((spec + ("d" if conversion in "iu" else conversion)) % number)
+        else:
+            out.append((spec + conversion) % value)
+            if truncated and not args:
+                return "".join(out) + "...", True  # the string was cut
+    out.append(fmt[pos:])
+    return "".join(out), False
+
+
+def decode(data, min_level):
+    if data[:4] != b"ESPL":
+        raise ValueError("not an ESPuino log-dump")
+    reader = Reader(data)
+    reader.pos = 4
+    version = reader.take("B")
+    if version != 1:
+        raise ValueError(f"unsupported version {version}")
+    formats = {}
+    lines = []
+    while not reader.at_end():
+        record = chr(reader.take("B"))
+        if record == "F":
+            format_id, length = reader.take("HH")
+            formats[format_id] = reader.bytes(length).decode("utf-8", "replace")
+            continue
+        if record != "E":
+            raise ValueError(f"unknown record {record!r} at {reader.pos - 1}")
+        timestamp, level, flags, format_id = reader.take("IBBH")
+        args = []
+        while reader.data[reader.pos] != 0:
+            args.append(read_argument(reader))
+        reader.pos += 1
+        if format_id == TEXT_ID:
+            message, cut = args[0] if args else "", False
+        else:
+            message, cut = render(formats[format_id], args, flags & FLAG_TRUNCATED)
+        if flags & FLAG_TRUNCATED and not cut:
+            message += "..."
+        if level > min_level:
+            continue
+        if not flags & FLAG_NO_PREFIX:
+            message = f"{LEVEL_NAMES.get(level, ' ')} [{timestamp}] {message}"
+        if not flags & FLAG_NO_NEWLINE:
+            message += "\n"
+        lines.append(message)
+    return "".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="URL of /log?binary or a file containing its output")
+    parser.add_argument("--level", type=int, default=4, help="highest loglevel to show (1=error ... 4=debug)")
+    options = parser.parse_args()
+
+    if options.source.startswith(("http://", "https://")):
+        with urllib.request.urlopen(options.source, timeout=10) as response:
+            data = response.read()
+    else:
+        with open(options.source, "rb") as file:
+            data = file.read()
+    sys.stdout.write(decode(data, options.level))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,258 @@
+# -*- coding: utf-8 -*-
+"""Builds the voice-prompt pack for offline announcements (see src/PromptPack.h).
+
+One WAV-file per prompt, the file-name (without .wav) is the prompt's name, e.g.
+    prompts/de/it_is.wav, prompts/de/oclock.wav, prompts/de/0.wav ... prompts/de/120.wav
+
+    python prompt_pack.py build prompts/de de.pak --lang de
+    python prompt_pack.py list de.pak
+    python prompt_pack.py render de.pak test.wav it_is 7 oclock 45
+
+Copy the pack to /.prompts/<de|en|fr>.pak on the SD-card. "render" assembles a sentence the same
+way the firmware does, so it can be checked on the computer.
+Only the Python standard-library is needed.
+"""
+
+import argparse
+import struct
+import sys
+import wave
+from pathlib import Path
+
+# --- CONFIGURATION ---
+MAGIC = b"EPPK"
+VERSION = 1
+CODEC_PCM16 = 0
+CODEC_IMA_ADPCM = 1
+NAME_LENGTH = 20
+HEADER_FORMAT = "<4sBBHIHH"  # magic, version, codec, gap (ms), sample-rate, count, reserved
+ENTRY_FORMAT = "<20sIIhBB"  # name, offset, frames, ADPCM predictor, ADPCM step-index, reserved
+MARGIN_MS = 5  # kept around the audible part when trimming silence
+
+# prompts used by the firmware (src/Announcement.cpp)
+REQUIRED_COMMON = ["it_is", "oclock", "point", "battery", "percent", "sleep_timer", "sleep_timer_off", "minutes"]
+REQUIRED_NUMBERS = range(0, 121)
+REQUIRED_EN = ["oh", "am", "pm"]
+
+ADPCM_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+ADPCM_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+    1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767]
+
+
+# --- AUDIO ---
+
+def read_wav(path, rate):
+    """Reads a 16 bit PCM-WAV as mono samples with the given sample-rate."""
+    with wave.open(str(path), "rb") as wav:
+        if wav.getsampwidth() != 2:
+            raise ValueError(f"{path}: only 16 bit PCM is supported")
+        channels = wav.getnchannels()
+        src_rate = wav.getframerate()
+        raw = wav.readframes(wav.getnframes())
+    samples = struct.unpack(f"<{len(raw) // 2}h", raw)
+    mono = [sum(samples[i:i + channels]) // channels for i in range(0, len(samples), channels)]
+    return resample(mono, src_rate, rate)
+
+
+def resample(samples, src_rate, dst_rate):
+    """Linear interpolation; good enough for speech that's (ideally) recorded at the target-rate anyway."""
+    if src_rate == dst_rate or len(samples) < 2:
+        return list(samples)
+    frames = (len(samples) - 1) * dst_rate // src_rate + 1
+    out = []
+    for i in range(frames):
+        pos = i * src_rate / dst_rate
+        j = int(pos)
+        frac = pos - j
+        s1 = samples[min(j + 1, len(samples) - 1)]
+        out.append(int(round(samples[j] + (s1 - samples[j]) * frac)))
+    return out
+
+
+def trim_silence(samples, rate, threshold_db):
+    """Cuts leading/trailing silence, so the firmware's word-gap alone defines the rhythm."""
+    threshold = 32768 * 10 ** (threshold_db / 20.0)
+    loud = [i for i, s in enumerate(samples) if abs(s) > threshold]
+    if not loud:
+        return []
+    margin = rate * MARGIN_MS // 1000
+    return samples[max(0, loud[0] - margin):loud[-1] + margin + 1]
+
+
+def write_wav(path, samples, rate):
+    with wave.open(str(path), "wb") as wav:
+        wav.setnchannels(1)
+        wav.setsampwidth(2)
+        wav.setframerate(rate)
+        wav.writeframes(struct.pack(f"<{len(samples)}h", *samples))
+
+
+# --- IMA-ADPCM (has to match PromptPack_AdpcmDecodeNibble()) ---
+
+def adpcm_decode_nibble(state, nibble):
+    step = ADPCM_STEP_TABLE[state[1]]
+    diff = step >> 3
+    if nibble & 4:
+        diff += step
+    if nibble & 2:
+        diff += step >> 1
+    if nibble & 1:
+        diff += step >> 2
+    state[0] = max(-32768, min(32767, state[0] - diff if nibble & 8 else state[0] + diff))
+    state[1] = max(0, min(88, state[1] + ADPCM_INDEX_TABLE[nibble]))
+    return state[0]
+
+
+def adpcm_encode(samples):
+    """Returns (predictor, step-index, data). Every snippet starts with its own state, so it decodes on its own."""
+    if not samples:
+        return 0, 0, b""
+    # start with a step-size that fits the beginning of the snippet
+    start_diff = max(abs(b - a) for a, b in zip(samples[:17], samples[1:17])) if len(samples) > 1 else 0
+    index = next((i for i, step in enumerate(ADPCM_STEP_TABLE) if step >= start_diff), 88)
+    state = [samples[0], index]
+    start = (state[0], state[1])
+    nibbles = []
+    for sample in samples:
+        diff = sample - state[0]
+        step = ADPCM_STEP_TABLE[state[1]]
+        nibble = 8 if diff < 0 else 0
+        diff = abs(diff)
+        for bit in (4, 2, 1):
+            if diff >= step:
+                nibble |= bit
+                diff -= step
+            step >>= 1
+        adpcm_decode_nibble(state, nibble)
+        nibbles.append(nibble)
+    if len(nibbles) & 1:
+        nibbles.append(0)
+    data = bytes(nibbles[i] | (nibbles[i + 1] << 4) for i in range(0, len(nibbles), 2))
+    return start[0], start[1], data
+
+
+def adpcm_decode(predictor, index, data, frames):
+    state = [predictor, index]
+    out = []
+    for i in range(frames):
+        byte = data[i >> 1]
+        out.append(adpcm_decode_nibble(state, (byte >> 4) if i & 1 else (byte & 0x0F)))
+    return out
+
+
+# --- PACK ---
+
+def build(wav_dir, out_path, rate, codec, gap_ms, trim_db, lang):
+    prompts = {}
+    for path in sorted(Path(wav_dir).glob("*.wav")):
+        name = path.stem
+        if len(name.encode("ascii")) > NAME_LENGTH:
+            raise ValueError(f"{path}: name is longer than {NAME_LENGTH} characters")
+        samples = trim_silence(read_wav(path, rate), rate, trim_db)
+        if not samples:
+            print(f"warning: {path} is silent, skipped")
+            continue
+        prompts[name] = samples
+
+    required = REQUIRED_COMMON + [str(n) for n in REQUIRED_NUMBERS] + (REQUIRED_EN if lang == "en" else [])
+    missing = [name for name in required if name not in prompts]
+    if missing:
+        print(f"warning: missing prompts (the firmware falls back to online speech): {', '.join(missing)}")
+
+    # index is sorted bytewise, the firmware does a binary search with strncmp()
+    names = sorted(prompts, key=lambda n: n.encode("ascii"))
+    offset = struct.calcsize(HEADER_FORMAT) + len(names) * struct.calcsize(ENTRY_FORMAT)
+    index = b""
+    data = b""
+    for name in names:
+        samples = prompts[name]
+        if codec == CODEC_IMA_ADPCM:
+            predictor, step_index, blob = adpcm_encode(samples)
+        else:
+            predictor, step_index, blob = 0, 0, struct.pack(f"<{len(samples)}h", *samples)
+        index += struct.pack(ENTRY_FORMAT, name.encode("ascii"), offset + len(data), len(samples), predictor, step_index, 0)
+        data += blob
+
+    header = struct.pack(HEADER_FORMAT, MAGIC, VERSION, codec, gap_ms, rate, len(names), 0)
+    Path(out_path).write_bytes(header + index + data)
+    print(f"{out_path}: {len(names)} prompts, {rate} Hz, {'ADPCM' if codec else 'PCM'}, {(len(header) + len(index) + len(data)) // 1024} kB")
+
+
+def load(pak_path):
+    blob = Path(pak_path).read_bytes()
+    magic, version, codec, gap_ms, rate, count, _ = struct.unpack_from(HEADER_FORMAT, blob)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError(f"{pak_path}: not a prompt pack (version {VERSION})")
+    entries = {}
+    pos = struct.calcsize(HEADER_FORMAT)
+    for _ in range(count):
+        name, offset, frames, predictor, step_index, _ = struct.unpack_from(ENTRY_FORMAT, blob, pos)
+        entries[name.rstrip(b"\0").decode("ascii")] = (offset, frames, predictor, step_index)
+        pos += struct.calcsize(ENTRY_FORMAT)
+    return blob, codec, gap_ms, rate, entries
+
+
+def decode(blob, codec, entry):
+    offset, frames, predictor, step_index = entry
+    if codec == CODEC_IMA_ADPCM:
+        return adpcm_decode(predictor, step_index, blob[offset:offset + (frames + 1) // 2], frames)
+    return list(struct.unpack_from(f"<{frames}h", blob, offset))
+
+
+def render(pak_path, out_path, names):
+    """Sequencing as in Announcement_Render(): snippets back to back, separated by exactly the word-gap."""
+    blob, codec, gap_ms, rate, entries = load(pak_path)
+    gap = [0] * (rate * gap_ms // 1000)
+    samples = []
+    for i, name in enumerate(names):
+        if name not in entries:
+            raise ValueError(f"prompt '{name}' is not in {pak_path}")
+        if i:
+            samples += gap
+        samples += decode(blob, codec, entries[name])
+    write_wav(out_path, samples, rate)
+    print(f"{out_path}: {len(samples)} frames ({len(samples) * 1000 // rate} ms)")
+
+
+def list_pack(pak_path):
+    _, codec, gap_ms, rate, entries = load(pak_path)
+    print(f"{len(entries)} prompts, {rate} Hz, {'ADPCM' if codec else 'PCM'}, word-gap {gap_ms} ms")
+    for name, (_, frames, _, _) in entries.items():
+        print(f"  {name:{NAME_LENGTH}} {frames * 1000 // rate:5} ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESPuino voice-prompt pack")
+    sub = parser.add_subparsers(dest="command", required=True)
+    p_build = sub.add_parser("build", help="build a pack from a directory of WAV-files")
+    p_build.add_argument("wav_dir")
+    p_build.add_argument("pak")
+    p_build.add_argument("--rate", type=int, default=16000, help="sample-rate of the pack (default: 16000)")
+    p_build.add_argument("--codec", choices=["pcm", "adpcm"], default="adpcm", help="adpcm needs a quarter of the space")
+    p_build.add_argument("--gap-ms", type=int, default=60, help="pause between two prompts (default: 60)")
+    p_build.add_argument("--trim-db", type=float, default=-45.0, help="silence-threshold for trimming (default: -45)")
+    p_build.add_argument("--lang", choices=["de", "en", "fr"], help="check for the prompts this language needs")
+    p_list = sub.add_parser("list", help="show the content of a pack")
+    p_list.add_argument("pak")
+    p_render = sub.add_parser("render", help="assemble a sentence to a WAV-file")
+    p_render.add_argument("pak")
+    p_render.add_argument("wav")
+    p_render.add_argument("names", nargs="+")
+    args = parser.parse_args()
+
+    if args.command == "build":
+        if not 0 < args.rate < 65536:
+            sys.exit("rate has to be below 65536 Hz")
+        codec = CODEC_IMA_ADPCM if args.codec == "adpcm" else CODEC_PCM16
+        build(args.wav_dir, args.pak, args.rate, codec, args.gap_ms, args.trim_db, args.lang)
+    elif args.command == "list":
+        list_pack(args.pak)
+    else:
+        render(args.pak, args.wav, args.names)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,292 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Announcement.h"
+
+#include "Log.h"
+#include "MemX.h"
+#include "PromptPack.h"
+#include "SdCard.h"
+
+#include <algorithm>
+#include <atomic>
+
+constexpr uint8_t announcementMaxSnippets = 24u; // per sentence
+constexpr uint8_t announcementMaxSentenceSec = 10u;
+constexpr int32_t announcementUnityGainQ15 = 32768;
+constexpr int32_t announcementDuckGainQ15 = 8231; // -12 dB
+constexpr uint32_t announcementRampMs = 30u; // prompt starts once the music is ducked, so this is part of the latency
+
+// Sequence of snippets being composed
+static int16_t Announcement_Snippets[announcementMaxSnippets];
+static uint8_t Announcement_SnippetCount = 0;
+static bool Announcement_SnippetMissing = false;
+
+// Rendered sentence. Only written by the audioplayer-task while the mixer is idle.
+static int16_t *Announcement_Sentence = nullptr;
+static uint32_t Announcement_SentenceCapacity = 0; // frames
+static uint32_t Announcement_SentenceFrames = 0;
+static uint32_t Announcement_SampleRate = 0;
+
+enum class AnnouncementState : uint8_t {
+	Idle = 0,
+	Playing,
+	Releasing // prompt is over, music ramps back to full level
+};
+static std::atomic<AnnouncementState> Announcement_State = AnnouncementState::Idle;
+
+// Mixer-state, only used from the audio-lib's task
+static int32_t Announcement_DuckGain = announcementUnityGainQ15;
+static uint32_t Announcement_Pos = 0;
+static uint32_t Announcement_Frac = 0; // Q16
+
+void Announcement_Init(void) {
+	PromptPack_Init();
+}
+
+// A new sentence can only be composed while nothing is mixed
+static bool Announcement_Begin(void) {
+	if (!PromptPack_IsAvailable() || Announcement_State.load() != AnnouncementState::Idle) {
+		return false;
+	}
+	Announcement_SnippetCount = 0;
+	Announcement_SnippetMissing = false;
+	return true;
+}
+
+static void Announcement_Add(const char *name) {
+	const int16_t snippet = PromptPack_Find(name);
+	if (snippet == promptPackInvalid || Announcement_SnippetCount >= announcementMaxSnippets) {
+		Log_Printf(LOGLEVEL_DEBUG, "Announcement: prompt '%s' is missing", name);
+		Announcement_SnippetMissing = true;
+		return;
+	}
+	Announcement_Snippets[Announcement_SnippetCount++] = snippet;
+}
+
+static void Announcement_AddNumber(const uint16_t number) {
+	char name[6];
+	snprintf(name, sizeof(name), "%u", number);
+	Announcement_Add(name);
+}
+
+static bool Announcement_Reserve(const uint32_t frames) {
+	if (frames <= Announcement_SentenceCapacity) {
+		return true;
+	}
+	if (frames > PromptPack_GetSampleRate() * announcementMaxSentenceSec) {
+		Log_Println("Announcement: sentence too long", LOGLEVEL_ERROR);
+		return false;
+	}
+	free(Announcement_Sentence);
+	Announcement_Sentence = (int16_t *) x_malloc(frames * sizeof(int16_t));
+	Announcement_SentenceCapacity = Announcement_Sentence ? frames : 0;
+	return Announcement_Sentence != nullptr;
+}
+
+// Sequencer: decodes the snippets back to back, separated by exactly the word-gap of the pack
+static bool Announcement_Render(void) {
+	if (Announcement_SnippetMissing || !Announcement_SnippetCount) {
+		return false;
+	}
+	const uint32_t gapFrames = PromptPack_GetSampleRate() * PromptPack_GetGapMs() / 1000u;
+	uint32_t frames = gapFrames * (Announcement_SnippetCount - 1);
+	for (uint8_t i = 0; i < Announcement_SnippetCount; i++) {
+		frames += PromptPack_GetFrames(Announcement_Snippets[i]);
+	}
+	if (!Announcement_Reserve(frames)) {
+		return false;
+	}
+
+	uint32_t pos = 0;
+	for (uint8_t i = 0; i < Announcement_SnippetCount; i++) {
+		if (i) {
+			memset(&Announcement_Sentence[pos], 0, gapFrames * sizeof(int16_t));
+			pos += gapFrames;
+		}
+		const uint32_t decoded = PromptPack_Decode(Announcement_Snippets[i], &Announcement_Sentence[pos]);
+		if (decoded != PromptPack_GetFrames(Announcement_Snippets[i])) {
+			Log_Println("Announcement: reading prompt failed", LOGLEVEL_ERROR);
+			return false;
+		}
+		pos += decoded;
+	}
+	Announcement_SentenceFrames = pos;
+	Announcement_SampleRate = PromptPack_GetSampleRate();
+	return true;
+}
+
+// Prompts: "0".."9", "point"
+bool Announcement_ComposeIpAddress(const char *ip) {
+	if (!Announcement_Begin()) {
+		return false;
+	}
+	for (const char *c = ip; *c; c++) {
+		if (*c == '.') {
+			Announcement_Add("point");
+		} else {
+			Announcement_AddNumber(*c - '0');
+		}
+	}
+	return Announcement_Render();
+}
+
+// Prompts: "it_is", "0".."59", "oclock" (DE/FR), "oh", "am", "pm" (EN)
+bool Announcement_ComposeTime(const uint8_t hour, const uint8_t minute) {
+	if (!Announcement_Begin()) {
+		return false;
+	}
+	Announcement_Add("it_is");
+#if (LANGUAGE == EN)
+	Announcement_AddNumber((hour % 12) ? (hour % 12) : 12);
+	if (minute == 0) {
+		Announcement_Add("oclock");
+	} else {
+		if (minute < 10) {
+			Announcement_Add("oh");
+		}
+		Announcement_AddNumber(minute);
+	}
+	Announcement_Add(hour < 12 ? "am" : "pm");
+#else
+	// "Es ist 7 Uhr 45" / "Il est 7 heures 45"
+	Announcement_AddNumber(hour);
+	Announcement_Add("oclock");
+	if (minute) {
+		Announcement_AddNumber(minute);
+	}
+#endif
+	return Announcement_Render();
+}
+
+// Prompts: "battery", "0".."100", "percent"
+bool Announcement_ComposeBatteryLevel(const uint8_t percent) {
+	if (!Announcement_Begin()) {
+		return false;
+	}
+	Announcement_Add("battery");
+	Announcement_AddNumber(percent);
+	Announcement_Add("percent");
+	return Announcement_Render();
+}
+
+// Prompts: "sleep_timer", "0".."120", "minutes", "sleep_timer_off"
+bool Announcement_ComposeSleepTimer(const uint8_t minutesLeft) {
+	if (!Announcement_Begin()) {
+		return false;
+	}
+	if (minutesLeft) {
+		Announcement_Add("sleep_timer");
+		Announcement_AddNumber(minutesLeft);
+		Announcement_Add("minutes");
+	} else {
+		Announcement_Add("sleep_timer_off");
+	}
+	return Announcement_Render();
+}
+
+// Writes the composed sentence as WAV-file, so it can be played by the player if there's nothing to mix into
+bool Announcement_WriteWav(const char *path) {
+	if (!Announcement_SentenceFrames || Announcement_State.load() != AnnouncementState::Idle) {
+		return false;
+	}
+	File file = gFSystem.open(path, FILE_WRITE);
+	if (!file) {
+		return false;
+	}
+	const uint32_t dataSize = Announcement_SentenceFrames * sizeof(int16_t);
+	const uint32_t riffSize = 36u + dataSize;
+	const uint32_t fmtSize = 16u;
+	const uint16_t format = 1u; // PCM
+	const uint16_t channels = 1u;
+	const uint32_t byteRate = Announcement_SampleRate * sizeof(int16_t);
+	const uint16_t blockAlign = sizeof(int16_t);
+	const uint16_t bits = 16u;
+	uint8_t header[44];
+	memcpy(&header[0], "RIFF", 4);
+	memcpy(&header[4], &riffSize, 4);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	memcpy(&header[16], &fmtSize, 4);
+	memcpy(&header[20], &format, 2);
+	memcpy(&header[22], &channels, 2);
+	memcpy(&header[24], &Announcement_SampleRate, 4);
+	memcpy(&header[28], &byteRate, 4);
+	memcpy(&header[32], &blockAlign, 2);
+	memcpy(&header[34], &bits, 2);
+	memcpy(&header[36], "data", 4);
+	memcpy(&header[40], &dataSize, 4);
+	const bool success = (file.write(header, sizeof(header)) == sizeof(header)) && (file.write((const uint8_t *) Announcement_Sentence, dataSize) == dataSize);
+	file.close();
+	return success;
+}
+
+// Hands the composed sentence over to the mixer. It's played with the next buffer the audio-lib outputs.
+bool Announcement_Start(void) {
+	if (!Announcement_SentenceFrames || Announcement_State.load() != AnnouncementState::Idle) {
+		return false;
+	}
+	Announcement_Pos = 0;
+	Announcement_Frac = 0;
+	Announcement_State.store(AnnouncementState::Playing);
+	Log_Printf(LOGLEVEL_DEBUG, "Announcement: mixing %" PRIu32 " ms", Announcement_SentenceFrames * 1000u / Announcement_SampleRate);
+	return true;
+}
+
+// Drops the current announcement (e.g. if playback stopped and the mixer isn't called anymore)
+void Announcement_Cancel(void) {
+	Announcement_State.store(AnnouncementState::Idle);
+}
+
+bool Announcement_IsActive(void) {
+	return Announcement_State.load() != AnnouncementState::Idle;
+}
+
+// Called by the audio-lib for every decoded buffer (interleaved 32 bit stereo, 16 bit in the upper half).
+// Ducks the music and adds the prompt (linearly interpolated to the output-rate). Costs nothing if idle.
+void Announcement_Mix(int32_t *buff, const int16_t frames, const uint32_t sampleRate, const uint16_t promptGainQ15) {
+	const AnnouncementState state = Announcement_State.load();
+	if ((state == AnnouncementState::Idle && Announcement_DuckGain == announcementUnityGainQ15) || !sampleRate) {
+		return;
+	}
+
+	const bool playing = (state == AnnouncementState::Playing);
+	const int32_t target = playing ? announcementDuckGainQ15 : announcementUnityGainQ15;
+	const int32_t rampStep = std::max<int32_t>(1, (announcementUnityGainQ15 - announcementDuckGainQ15) * 1000 / static_cast<int32_t>(announcementRampMs * sampleRate));
+	const uint32_t step = (Announcement_SampleRate << 16) / sampleRate; // Q16 clip-frames per output-frame
+	const uint32_t last = Announcement_SentenceFrames - 1;
+	const int16_t *pcm = Announcement_Sentence;
+	int32_t gain = Announcement_DuckGain;
+	uint32_t pos = Announcement_Pos;
+	uint32_t frac = Announcement_Frac;
+	bool finished = false;
+
+	for (int16_t i = 0; i < frames; i++) {
+		if (gain != target) {
+			gain = (gain > target) ? std::max(gain - rampStep, target) : std::min(gain + rampStep, target);
+		}
+		int32_t prompt = 0;
+		if (playing && gain == target && !finished) {
+			const int32_t s0 = pcm[pos];
+			const int32_t s1 = pcm[std::min(pos + 1, last)];
+			prompt = ((s0 + (((s1 - s0) * static_cast<int32_t>(frac >> 1)) >> 15)) * promptGainQ15) >> 15;
+			frac += step;
+			pos += frac >> 16;
+			frac &= 0xFFFFu;
+			finished = (pos > last);
+		}
+		for (uint8_t ch = 0; ch < 2; ch++) {
+			const int32_t music = ((buff[i * 2 + ch] >> 16) * gain) >> 15;
+			const int32_t mixed = std::clamp<int32_t>(music + prompt, INT16_MIN, INT16_MAX);
+			buff[i * 2 + ch] = static_cast<int32_t>(static_cast<uint32_t>(mixed) << 16);
+		}
+	}
+
+	Announcement_DuckGain = gain;
+	Announcement_Pos = pos;
+	Announcement_Frac = frac;
+	if (finished) {
+		Announcement_State.store(AnnouncementState::Releasing);
+	} else if (state == AnnouncementState::Releasing && gain == announcementUnityGainQ15) {
+		Announcement_State.store(AnnouncementState::Idle);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Voice-announcements that are mixed into the running playback: the music is ducked instead of stopped.
+// Sentences are assembled from the snippets of the voice-prompt pack (see PromptPack.h).
+
+void Announcement_Init(void);
+bool Announcement_ComposeIpAddress(const char *ip);
+bool Announcement_ComposeTime(const uint8_t hour, const uint8_t minute);
+bool Announcement_ComposeBatteryLevel(const uint8_t percent);
+bool Announcement_ComposeSleepTimer(const uint8_t minutesLeft);
+bool Announcement_WriteWav(const char *path);
+bool Announcement_Start(void);
+void Announcement_Cancel(void);
+bool Announcement_IsActive(void);
+void Announcement_Mix(int32_t *buff, const int16_t frames, const uint32_t sampleRate, const uint16_t promptGainQ15);
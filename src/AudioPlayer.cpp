@@ -3,22 +3,35 @@
 
 #include "AudioPlayer.h"
 
+#include "Announcement.h"
 #include "Audio.h"
+#include "Battery.h"
 #include "Bluetooth.h"
-#include "Cmd.h"
+#include "CommandBus.h"
 #include "Common.h"
 #include "EnumUtils.h"
+#include "Equalizer.h"
+#include "HeapProfiler.h"
 #include "Led.h"
 #include "Log.h"
+#include "Loudness.h"
 #include "MemX.h"
+#include "Metrics.h"
 #include "Mqtt.h"
+#include "PlayPosJournal.h"
 #include "Port.h"
-#include "Queues.h"
+#include "Resampler.h"
 #include "Rfid.h"
 #include "RotaryEncoder.h"
+#include "SampleFormat.h"
+#include "Scheduler.h"
 #include "SdCard.h"
+#include "SeekIndex.h"
+#include "SettingsRegistry.h"
 #include "System.h"
-#include "VolumeCurveLut.h"
+#include "TapTrace.h"
+#include "TrackFade.h"
+#include "VolumeGain.h"
 #include "Web.h"
 #include "Wlan.h"
 #include "main.h"
@@ -49,7 +62,7 @@ void AudioPlayer_AddSeekOffset(const int16_t seconds) {
 static std::atomic<bool> AudioPlayer_SeekPreviewActive {false};
 static std::atomic<uint8_t> AudioPlayer_SeekPreviewTargetPercent {0};
 static double AudioPlayer_SeekPreviewTargetExact = 0.0; // full precision; only ever touched by the loop() task
-static uint32_t AudioPlayer_SeekPreviewLastInputMs = 0; // only ever touched by the loop() task
+static uint32_t AudioPlayer_SeekPreviewLastInputMs = 0; // only ever written by the loop() task (audio-task reads it)
 // Cached once per gesture (in Start()), not re-read from NVS on every AudioPlayer_Loop() iteration/detent:
 // the idle-commit check below runs on every single loop() cycle for as long as a gesture is held, and a
 // NVS getUShort/getUChar still costs a mutex lock + key lookup each time even though it's RAM-cached.
@@ -81,8 +94,7 @@ void AudioPlayer_SeekPreviewCommit(void) {
 	if (!AudioPlayer_SeekPreviewActive.load(std::memory_order_relaxed)) {
 		return;
 	}
-	gPlayProperties.currentRelPos = AudioPlayer_SeekPreviewTargetPercent.load(std::memory_order_relaxed);
-	gPlayProperties.seekmode = SEEK_POS_PERCENT;
+	AudioPlayer_SeekToPercent(AudioPlayer_SeekPreviewTargetPercent.load(std::memory_order_relaxed));
 	AudioPlayer_SeekPreviewActive.store(false, std::memory_order_relaxed);
 }
 
@@ -108,6 +120,14 @@ static uint8_t AudioPlayer_MaxVolumeSpeaker = AUDIOPLAYER_VOLUME_MAX;
 static uint8_t AudioPlayer_MinVolume = AUDIOPLAYER_VOLUME_MIN;
 static uint8_t AudioPlayer_InitVolume = AUDIOPLAYER_VOLUME_INIT;
 
+// Precomputed gain per volume-step (curve and maxVolume folded in); rebuilt whenever one of them changes.
+// Only the audio-task writes it (other tasks just request a rebuild), double-buffered for the readers in other tasks.
+static volumeGain_t AudioPlayer_VolumeGainTable[2][AUDIOPLAYER_VOLUME_MAX + 1];
+static std::atomic<uint8_t> AudioPlayer_VolumeGainTableActive = 0;
+static std::atomic<bool> AudioPlayer_VolumeGainTableStale {false};
+static float AudioPlayer_ReplayGainDb = 0.0f; // loudness-normalisation of the current track, folded into the gain-table
+static float AudioPlayer_ReplayGainMaxDb = 0.0f; // headroom of its peak: the level isn't raised beyond
+
 // current playtime
 uint32_t AudioPlayer_CurrentTime = 0;
 uint32_t AudioPlayer_FileDuration = 0;
@@ -152,15 +172,196 @@ constexpr uint32_t playbackTimeout = 2000;
 uint32_t playbackTimeoutStart = millis();
 uint8_t currentVolume;
 BaseType_t trackQStatus = pdFAIL;
-uint8_t trackCommand = NO_ACTION;
+static uint8_t trackCommand = NO_ACTION; // only touched by the audio-task, set via AudioPlayer_SetTrackControl()
 bool audioReturnCode;
 uint32_t AudioPlayer_LastPlaytimeStatsTimestamp = 0u;
 static uint32_t AudioPlayer_resumeSeekPendingSecs = 0; // deferred resume-seek target (seconds); 0 = none pending (declared early: used by the audio_info evt_bitrate callback above AudioPlayer_Loop)
-Playlist *newPlayList = nullptr;
-bool newPlayListAvailable = false;
 
-static bool AudioPlayer_UploadActive = false;
-static bool AudioPlayer_WasPausedBeforeUpload = false; // remember pre-upload pause state
+// Audio-task: runs AudioPlayer_Loop() (and by this audio->loop(), which refills the decoder's input-buffer)
+// decoupled from Arduino's loop(), so slow handlers there (NVS, JSON, directory-walks) can't starve decoding.
+// It's woken up by new commands or once the input-buffer needs to be refilled.
+constexpr uint32_t audioTaskStackSize = 8192u;
+constexpr UBaseType_t audioTaskPriority = 3u; // above loop() (1), RFID (2)
+constexpr uint32_t audioTaskMaxRefillPeriod = 20u; // ms; also the latency for state-changes that don't come as a command
+static TaskHandle_t AudioPlayer_TaskHandle = nullptr;
+static std::atomic<bool> AudioPlayer_TaskStopRequested {false};
+
+// statistics of the audio-task (only written by the audio-task)
+static uint32_t AudioPlayer_TaskLoopTimeAvgUs = 0;
+static uint32_t AudioPlayer_TaskLoopTimeMaxUs = 0;
+static uint32_t AudioPlayer_TaskJitterAvgUs = 0;
+static uint32_t AudioPlayer_TaskJitterMaxUs = 0;
+static uint32_t AudioPlayer_TaskDeadlineMisses = 0;
+static uint32_t AudioPlayer_DecoderBitRate = 0; // copies for /metrics, the lib isn't called from other tasks
+static uint32_t AudioPlayer_DecoderSampleRate = 0;
+static std::atomic<uint32_t> AudioPlayer_CommandsDropped {0};
+
+// Commands for the audio-task. There are several producers (loop(), web, MQTT, ...) but only one consumer
+// (audio-task), so a bounded lock-free MPSC-queue (sequence-number per slot) is used: nobody ever blocks or
+// enters a critical section, the producer just gets false if the queue is full.
+enum class AudioCommandType : uint8_t {
+	TrackControl = 0,
+	Volume,
+	NewPlaylist,
+	SeekPercent,
+	Upload // 1: suspend playback for an upload, 0: upload done
+};
+
+// A new playlist and everything that belongs to it. It's applied by the audio-task when it picks up the playlist,
+// so the running track never sees a mix of the old and the new settings.
+typedef struct {
+	Playlist *playlist;
+	uint32_t startAtFilePos;
+	uint16_t trackNumber;
+	uint8_t playMode;
+	uint8_t playUntilTrackNumber;
+	bool repeatCurrentTrack;
+	bool repeatPlaylist;
+	bool sleepAfterCurrentTrack;
+	bool sleepAfterPlaylist;
+	bool saveLastPlayPosition;
+	char rfidTag[cardIdStringSize]; // card the play-position is saved for
+} audioPlaylistStart_t;
+
+typedef struct {
+	AudioCommandType type;
+	uint32_t value;
+	audioPlaylistStart_t playlist; // NewPlaylist only
+} audioCommand_t;
+
+constexpr uint32_t audioCommandQueueSize = 16u; // has to be a power of 2
+static struct {
+	std::atomic<uint32_t> seq;
+	audioCommand_t command;
+} AudioPlayer_CommandQueue[audioCommandQueueSize];
+static std::atomic<uint32_t> AudioPlayer_CommandEnqueuePos {0};
+static uint32_t AudioPlayer_CommandDequeuePos = 0; // only touched by the audio-task
+
+static void AudioPlayer_CommandQueueInit(void) {
+	for (uint32_t i = 0; i < audioCommandQueueSize; i++) {
+		AudioPlayer_CommandQueue[i].seq.store(i, std::memory_order_relaxed);
+	}
+	AudioPlayer_CommandEnqueuePos.store(0, std::memory_order_relaxed);
+	AudioPlayer_CommandDequeuePos = 0;
+}
+
+static bool AudioPlayer_PushCommand(const AudioCommandType type, const uint32_t value, const audioPlaylistStart_t *playlist = nullptr) {
+	uint32_t pos = AudioPlayer_CommandEnqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		auto &slot = AudioPlayer_CommandQueue[pos & (audioCommandQueueSize - 1)];
+		const int32_t diff = static_cast<int32_t>(slot.seq.load(std::memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (AudioPlayer_CommandEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.command.type = type;
+				slot.command.value = value;
+				if (playlist) {
+					slot.command.playlist = *playlist;
+				}
+				slot.seq.store(pos + 1, std::memory_order_release);
+				break;
+			}
+		} else if (diff < 0) {
+			AudioPlayer_CommandsDropped++;
+			Log_Println("Audio-task: command-queue is full", LOGLEVEL_ERROR);
+			return false;
+		} else {
+			pos = AudioPlayer_CommandEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+	if (AudioPlayer_TaskHandle) {
+		xTaskNotifyGive(AudioPlayer_TaskHandle);
+	}
+	return true;
+}
+
+static bool AudioPlayer_PopCommand(audioCommand_t *command) {
+	auto &slot = AudioPlayer_CommandQueue[AudioPlayer_CommandDequeuePos & (audioCommandQueueSize - 1)];
+	if (static_cast<int32_t>(slot.seq.load(std::memory_order_acquire) - (AudioPlayer_CommandDequeuePos + 1)) < 0) {
+		return false; // empty
+	}
+	*command = slot.command;
+	slot.seq.store(AudioPlayer_CommandDequeuePos + audioCommandQueueSize, std::memory_order_release);
+	AudioPlayer_CommandDequeuePos++;
+	return true;
+}
+
+static audioPlaylistStart_t newPlayList = {}; // only touched by the audio-task, set via command-queue
+static bool newPlayListAvailable = false;
+static std::atomic<bool> AudioPlayer_PlaylistBusy {false}; // a playlist is being created (shown by the LEDs)
+
+// Play-positions to be saved in NVS. Writing NVS takes several ms (and stalls the flash-cache), so the audio-task
+// only queues them and loop() writes them.
+typedef struct {
+	char rfidTag[cardIdStringSize];
+	uint32_t playPosition;
+	uint16_t trackLastPlayed;
+	uint8_t playMode;
+} playPosWrite_t;
+
+constexpr uint8_t playPosWriteQueueSize = 8u;
+static QueueHandle_t AudioPlayer_PlayPosWriteQueue = nullptr;
+
+static std::atomic<bool> AudioPlayer_UploadRequested {false}; // set by the web-task, dedups nested calls
+static std::atomic<bool> AudioPlayer_UploadActive {false}; // set by the audio-task once playback is suspended
+static bool AudioPlayer_WasPausedBeforeUpload = false; // remember pre-upload pause state (audio-task only)
+static bool AudioPlayer_AnnouncementMixed = false; // current announcement is mixed into the track (instead of replacing it)
+
+// Track-transitions (preload/crossfade): while the tail of a track plays, the next one is checked and its header is
+// parsed; it's started as soon as the lib reports EOF instead of with the next regular refill. That shortens the gap,
+// but doesn't remove it: the lib has only one decoder, so the next file is opened and decoded only after EOF and
+// tracks can't overlap. Crossfade fades the tail out and the next track in (see TrackFade.h).
+enum class TrackTransition : uint8_t {
+	Normal = 0,
+	Preload,
+	Crossfade
+};
+constexpr uint32_t trackPrepareLeadSec = 5u; // prepare the next track this long before the current one ends
+static_assert(trackFadeMaxMs <= trackPrepareLeadSec * 1000u, "fade-out has to start after the next track is prepared");
+constexpr uint32_t trackGapMaxUs = 10000000u; // longer pauses aren't a transition (e.g. playlist was stopped)
+
+typedef struct {
+	uint32_t frames; // decoded frames of the whole track (0: unknown)
+	uint16_t encoderDelay; // from the LAME-tag (MP3)
+	uint16_t encoderPadding;
+} trackHeaderInfo_t;
+
+static std::atomic<int32_t> AudioPlayer_PreparedTrackNumber {-1}; // next track is prepared (and will be faded to)
+static trackHeaderInfo_t AudioPlayer_PreparedTrackInfo;
+static bool AudioPlayer_TrackFramesExact = false; // taken from the header, not estimated from the duration
+static std::atomic<uint32_t> AudioPlayer_TrackFrames {0}; // expected frames of the current track (0: unknown)
+static std::atomic<uint32_t> AudioPlayer_TrackFramesOut {0}; // frames passed to audio_process_i2s() for the current track
+static std::atomic<bool> AudioPlayer_FadeInPending {false};
+static std::atomic<bool> AudioPlayer_TransitionPending {false}; // EOF seen, waiting for the first buffer of the next track
+
+// only used from audio_process_i2s()
+static uint32_t AudioPlayer_LastOutputUs = 0;
+static uint32_t AudioPlayer_LastOutputDurationUs = 0;
+static int32_t AudioPlayer_FadeGainQ15 = trackFadeUnityQ15;
+
+// gap-statistics (only written from audio_process_i2s())
+static uint32_t AudioPlayer_TransitionCount = 0;
+static uint32_t AudioPlayer_TransitionGapLastUs = 0;
+static uint32_t AudioPlayer_TransitionGapAvgUs = 0;
+static uint32_t AudioPlayer_TransitionGapMaxUs = 0;
+
+// Seeks via the seek-index (see SeekIndex.h). A resume jumps once the lib has started decoding the track; until
+// then the output is muted, so the beginning of the track isn't heard.
+static uint32_t AudioPlayer_ResumeFilePos = 0; // 0: no resume via seek-index pending
+static std::atomic<bool> AudioPlayer_SeekMute {false};
+static std::atomic<bool> AudioPlayer_SeekPending {false}; // seek was done, waiting for the first buffer after it
+static uint32_t AudioPlayer_SeekStartUs = 0;
+static std::atomic<bool> AudioPlayer_SeekIndexedPending {false}; // indexed seek, the output-position is set with the first buffer
+static uint32_t AudioPlayer_SeekTargetMs = 0;
+static uint32_t AudioPlayer_SeekFrameSample = 0; // decoded-sample position of the frame that was jumped to
+
+// seek-statistics
+static uint32_t AudioPlayer_SeekCount = 0;
+static uint32_t AudioPlayer_SeekIndexedCount = 0;
+static uint32_t AudioPlayer_SeekLatencyLastUs = 0;
+static uint32_t AudioPlayer_SeekLatencyAvgUs = 0;
+static uint32_t AudioPlayer_SeekLatencyMaxUs = 0;
+static uint32_t AudioPlayer_SeekErrorLastUs = 0;
+static uint32_t AudioPlayer_SeekErrorMaxUs = 0;
 static bool gResetOldRfidOnIdle = false; // release the "don't accept same rfid twice"-lock on next idle-state
 
 // Remember an RFID-tag whose webstream could not be started because WiFi is not (yet) connected, so it can
@@ -182,38 +383,52 @@ void AudioPlayer_ArmRfidResetOnIdle(void) {
 }
 
 static void AudioPlayer_HeadphoneVolumeManager(void);
+static void AudioPlayer_Task(void *parameter);
+static void AudioPlayer_OnSettingChanged(const SettingId id, const uint32_t value);
 static std::optional<Playlist *> AudioPlayer_ReturnPlaylistFromWebstream(const char *_webUrl);
 static bool AudioPlayer_ArrSortHelper_strcmp(const char *a, const char *b);
 static bool AudioPlayer_ArrSortHelper_strnatcmp(const char *a, const char *b);
 static bool AudioPlayer_ArrSortHelper_strnatcasecmp(const char *a, const char *b);
 static void AudioPlayer_SortPlaylist(Playlist *playlist);
 static void AudioPlayer_RandomizePlaylist(Playlist *playlist);
+static void AudioPlayer_SavePlayPosition(const char *_rfidCardId, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed);
+static void AudioPlayer_WritePlayPositions(void);
 static size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed);
+static size_t AudioPlayer_NvsRfidWrite(const char *_rfidCardId, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed);
+static void AudioPlayer_CompactPlayPosJournal(void);
 static void AudioPlayer_ClearCover(void);
 static void audio_id3image(File &file, const size_t pos, const size_t size);
 static void audio_oggimage(File &file, std::vector<uint32_t> v);
 
+// Called by the web-task: playback is suspended by the audio-task (the audio-object is only touched there)
 void AudioPlayer_NotifyUploadStart(void) {
-	if (AudioPlayer_UploadActive) {
+	if (AudioPlayer_UploadRequested.exchange(true)) {
 		return; // already suspended – ignore nested calls
 	}
-	AudioPlayer_UploadActive = true;
-	if (!gPlayProperties.pausePlay && gPlayProperties.playMode != NO_PLAYLIST && gPlayProperties.playMode != BUSY) {
-		AudioPlayer_WasPausedBeforeUpload = false;
-		audio->pauseResume();
-	} else {
-		AudioPlayer_WasPausedBeforeUpload = true; // was already paused / idle
-	}
+	AudioPlayer_PushCommand(AudioCommandType::Upload, 1u);
 }
 
 void AudioPlayer_NotifyUploadEnd(void) {
-	if (!AudioPlayer_UploadActive) {
+	if (!AudioPlayer_UploadRequested.exchange(false)) {
+		return;
+	}
+	AudioPlayer_PushCommand(AudioCommandType::Upload, 0u);
+}
+
+// Suspends (or resumes) playback for an upload, without touching the pause-state of the player
+static void AudioPlayer_SuspendForUpload(const bool suspend) {
+	if (suspend == AudioPlayer_UploadActive) {
 		return;
 	}
-	if (!AudioPlayer_WasPausedBeforeUpload) {
+	if (suspend) {
+		AudioPlayer_WasPausedBeforeUpload = gPlayProperties.pausePlay || gPlayProperties.playMode == NO_PLAYLIST || gPlayProperties.playMode == BUSY;
+		if (!AudioPlayer_WasPausedBeforeUpload) {
+			audio->pauseResume();
+		}
+	} else if (!AudioPlayer_WasPausedBeforeUpload) {
 		audio->pauseResume();
 	}
-	AudioPlayer_UploadActive = false;
+	AudioPlayer_UploadActive = suspend;
 }
 
 void Audio_InfoCallback(Audio::msg_t m) {
@@ -230,6 +445,12 @@ void Audio_InfoCallback(Audio::msg_t m) {
 			Log_Printf(LOGLEVEL_INFO, "end of file:  %s", m.msg);
 			gPlayProperties.trackFinished = true;
 			gPlayProperties.currentSpeechActive = false;
+			AudioPlayer_TransitionPending = true;
+			if (AudioPlayer_PreparedTrackNumber >= 0 && AudioPlayer_TaskHandle) {
+				// next track is ready: don't wait for the next refill to start it
+				AudioPlayer_FadeInPending = (SettingsRegistry_Get(SettingId::TrackTransition) == static_cast<uint8_t>(TrackTransition::Crossfade));
+				xTaskNotifyGive(AudioPlayer_TaskHandle);
+			}
 			break;
 		}
 		case Audio::evt_bitrate: {
@@ -345,49 +566,84 @@ void Audio_InfoCallback(Audio::msg_t m) {
 	}
 }
 
-float Audio_GetVolume(float t) {
-	uint8_t curve_type = gPrefsSettings.getUChar("volumeCurve", 0);
+// (Re)builds the gain-table for the current volume-curve, maxVolume and ReplayGain (audio-task only)
+static void AudioPlayer_BuildVolumeGainTable(void) {
+	const uint8_t inactive = AudioPlayer_VolumeGainTableActive.load() ^ 1u;
+	VolumeGain_BuildTable(AudioPlayer_VolumeGainTable[inactive], AUDIOPLAYER_VOLUME_MAX, SettingsRegistry_Get(SettingId::VolumeCurve), AudioPlayer_MaxVolume, AudioPlayer_ReplayGainDb, AudioPlayer_ReplayGainMaxDb);
+	AudioPlayer_VolumeGainTableActive.store(inactive);
+}
 
-	// 1. Safety Checks
-	if (curve_type >= VOL_LUT_CURVES) {
-		curve_type = VOL_CURVE_PERCEPTUAL;
-	}
-	if (t <= 0.0f) {
-		return pgm_read_float(&(VOLUME_TABLE[curve_type][0]));
+// Rebuild of the gain-table from any task: it's done by the audio-task, before it processes its next command.
+// Until the task is running (init) nobody else reads the table, so it's built right away.
+static void AudioPlayer_RequestVolumeGainTable(void) {
+	if (!AudioPlayer_TaskHandle) {
+		AudioPlayer_BuildVolumeGainTable();
+		return;
 	}
+	AudioPlayer_VolumeGainTableStale.store(true);
+	xTaskNotifyGive(AudioPlayer_TaskHandle);
+}
 
-	// 2. Calculate indices
-	float index_f = t * (VOL_LUT_STEPS - 1);
-	int index = (int) index_f;
-
-	// Safety clamp for the edge case where index_f is exactly 63.0
-	if (index >= VOL_LUT_STEPS - 1) {
-		return pgm_read_float(&(VOLUME_TABLE[curve_type][VOL_LUT_STEPS - 1]));
+// Takes over the gain of the current track for the configured ReplayGain-mode (audio-task only)
+static void AudioPlayer_ApplyReplayGain(const bool rebuild) {
+	const ReplayGainMode mode = static_cast<ReplayGainMode>(SettingsRegistry_Get(SettingId::ReplayGain));
+	const float gainDb = Loudness_GetGainDb(mode);
+	const float maxDb = -Loudness_GetPeakDb(mode);
+	if (rebuild || gainDb != AudioPlayer_ReplayGainDb || maxDb != AudioPlayer_ReplayGainMaxDb) {
+		AudioPlayer_ReplayGainDb = gainDb;
+		AudioPlayer_ReplayGainMaxDb = maxDb;
+		AudioPlayer_BuildVolumeGainTable();
 	}
+}
 
-	float fraction = index_f - (float) index;
+// Returns the linear gain (Q15) of a volume-step, above unity (32768) with a positive ReplayGain
+uint32_t AudioPlayer_GetVolumeGainQ15(uint8_t step) {
+	return AudioPlayer_VolumeGainTable[AudioPlayer_VolumeGainTableActive.load()][std::min<uint8_t>(step, AUDIOPLAYER_VOLUME_MAX)].gainQ15;
+}
 
-	// 3. Interpolate
-	float val1 = pgm_read_float(&(VOLUME_TABLE[curve_type][index]));
-	float val2 = pgm_read_float(&(VOLUME_TABLE[curve_type][index + 1]));
+// Volume-curve callback of the audio-lib (called from the audio-task): only a table-lookup
+float Audio_GetVolume(float t) {
+	return VolumeGain_Interpolate(AudioPlayer_VolumeGainTable[AudioPlayer_VolumeGainTableActive.load()], AUDIOPLAYER_VOLUME_MAX, t);
+}
 
-	return val1 + (val2 - val1) * fraction;
+static void AudioPlayer_RegisterMetrics(void) {
+	Metrics_Register("audio_underruns_total", MetricType::Counter, "Input-buffer of the decoder ran dry while playing", &AudioPlayer_TaskDeadlineMisses);
+	Metrics_Register("audio_commands_dropped_total", MetricType::Counter, "Commands for the audio-task dropped as the queue was full", &AudioPlayer_CommandsDropped);
+	Metrics_Register("audio_transitions_total", MetricType::Counter, "Measured transitions between tracks", &AudioPlayer_TransitionCount);
+	Metrics_Register("audio_seeks_total", MetricType::Counter, "Seeks and resumes", &AudioPlayer_SeekCount);
+	Metrics_Register("audio_decoder_bitrate_bps", MetricType::Gauge, "Bitrate of the current track (0 if stopped)", &AudioPlayer_DecoderBitRate);
+	Metrics_Register("audio_decoder_sample_rate_hz", MetricType::Gauge, "Sample-rate of the current track (0 if stopped)", &AudioPlayer_DecoderSampleRate);
+	Metrics_Register("audio_task_loop_seconds", MetricType::Gauge, "Time per run of the audio-task", [](metricsWriter_t &out) {
+		Metrics_Sample(out, AudioPlayer_TaskLoopTimeAvgUs / 1000000.0, "stat", "avg");
+		Metrics_Sample(out, AudioPlayer_TaskLoopTimeMaxUs / 1000000.0, "stat", "max");
+	});
+	Metrics_Register("audio_task_jitter_seconds", MetricType::Gauge, "How late the audio-task woke up", [](metricsWriter_t &out) {
+		Metrics_Sample(out, AudioPlayer_TaskJitterAvgUs / 1000000.0, "stat", "avg");
+		Metrics_Sample(out, AudioPlayer_TaskJitterMaxUs / 1000000.0, "stat", "max");
+	});
+	Metrics_Register("audio_play_seconds_total", MetricType::Counter, "Playtime of all boots", [](metricsWriter_t &out) {
+		Metrics_Sample(out, AudioPlayer_GetPlayTimeAllTime() / 1000.0);
+	});
 }
 
 void AudioPlayer_Init(void) {
 	// create audio object
-	audio = new AudioCustom();
+	{
+		HEAP_PROFILER_SCOPE("audio");
+		audio = new AudioCustom();
+	}
 
 	// load playtime total from NVS
 	playTimeSecTotal = gPrefsSettings.getULong("playTimeTotal", 0);
+	AudioPlayer_RegisterMetrics();
 
 	uint8_t playListSortModeValue = gPrefsSettings.getUChar("PLSortMode", EnumUtils::underlying_value(AudioPlayer_PlaylistSortMode));
 	AudioPlayer_PlaylistSortMode = EnumUtils::to_enum<playlistSortMode>(playListSortModeValue);
 
 	uint32_t nvsInitialVolume;
-	if (!gPrefsSettings.getBool("recoverVolBoot", false)) {
-		// Get initial volume from NVS
-		nvsInitialVolume = gPrefsSettings.getUInt("initVolume", 0);
+	if (!SettingsRegistry_GetBool(SettingId::RecoverVolumeOnBoot)) {
+		// Get initial volume
+		nvsInitialVolume = SettingsRegistry_Get(SettingId::InitVolume);
 	} else {
 		// Get volume used at last shutdown
 		nvsInitialVolume = gPrefsSettings.getUInt("previousVolume", 999);
@@ -399,25 +655,14 @@ void AudioPlayer_Init(void) {
 		}
 	}
 
-	if (nvsInitialVolume) {
-		AudioPlayer_SetInitVolume(nvsInitialVolume);
-		Log_Printf(LOGLEVEL_INFO, restoredInitialLoudnessFromNvs, nvsInitialVolume);
-	} else {
-		gPrefsSettings.putUInt("initVolume", AudioPlayer_GetInitVolume());
-		Log_Println(wroteInitialLoudnessToNvs, LOGLEVEL_ERROR);
-	}
+	AudioPlayer_SetInitVolume(nvsInitialVolume);
+	Log_Printf(LOGLEVEL_INFO, restoredInitialLoudnessFromNvs, nvsInitialVolume);
 
-	// Get maximum volume for speaker from NVS
-	uint32_t nvsMaxVolumeSpeaker = gPrefsSettings.getUInt("maxVolumeSp", 0);
-	if (nvsMaxVolumeSpeaker) {
-		AudioPlayer_SetMaxVolumeSpeaker(nvsMaxVolumeSpeaker);
-		AudioPlayer_SetMaxVolume(nvsMaxVolumeSpeaker);
-		Log_Printf(LOGLEVEL_INFO, restoredMaxLoudnessForSpeakerFromNvs, nvsMaxVolumeSpeaker);
-	} else {
-		// Set max volume to max per default. Can be adjusted later via webinterface.
-		gPrefsSettings.putUInt("maxVolumeSp", 21);
-		Log_Println(wroteMaxLoudnessForSpeakerToNvs, LOGLEVEL_ERROR);
-	}
+	// Get maximum volume for speaker (can be adjusted later via webinterface)
+	const uint32_t nvsMaxVolumeSpeaker = SettingsRegistry_Get(SettingId::MaxVolumeSpeaker);
+	AudioPlayer_SetMaxVolumeSpeaker(nvsMaxVolumeSpeaker);
+	AudioPlayer_SetMaxVolume(nvsMaxVolumeSpeaker);
+	Log_Printf(LOGLEVEL_INFO, restoredMaxLoudnessForSpeakerFromNvs, nvsMaxVolumeSpeaker);
 
 #ifdef HEADPHONE_ADJUST_ENABLE
 	#if (HP_DETECT >= 0 && HP_DETECT <= MAX_GPIO)
@@ -425,16 +670,9 @@ void AudioPlayer_Init(void) {
 	#endif
 	AudioPlayer_HeadphoneLastDetectionState = Audio_Detect_Mode_HP(Port_Read(HP_DETECT));
 
-	// Get maximum volume for headphone from NVS
-	uint32_t nvsAudioPlayer_MaxVolumeHeadphone = gPrefsSettings.getUInt("maxVolumeHp", 0);
-	if (nvsAudioPlayer_MaxVolumeHeadphone) {
-		AudioPlayer_MaxVolumeHeadphone = nvsAudioPlayer_MaxVolumeHeadphone;
-		Log_Printf(LOGLEVEL_INFO, restoredMaxLoudnessForHeadphoneFromNvs, nvsAudioPlayer_MaxVolumeHeadphone);
-	} else {
-		// Set max volume to max per default. Can be adjusted later via webinterface.
-		gPrefsSettings.putUInt("maxVolumeHp", 21);
-		Log_Println(wroteMaxLoudnessForHeadphoneToNvs, LOGLEVEL_ERROR);
-	}
+	// Get maximum volume for headphone (can be adjusted later via webinterface)
+	AudioPlayer_MaxVolumeHeadphone = SettingsRegistry_Get(SettingId::MaxVolumeHeadphone);
+	Log_Printf(LOGLEVEL_INFO, restoredMaxLoudnessForHeadphoneFromNvs, AudioPlayer_MaxVolumeHeadphone);
 #endif
 	// Adjust volume depending on headphone is connected and volume-adjustment is enabled
 	AudioPlayer_SetupVolumeAndAmps();
@@ -443,39 +681,32 @@ void AudioPlayer_Init(void) {
 	gPlayProperties = {};
 	gPlayProperties.playlistFinished = true;
 	gPlayProperties.jumpToFolderTrack = -1;
-	gPlayProperties.gainLowPass = 0;
-	gPlayProperties.gainBandPass = 0;
-	gPlayProperties.gainHighPass = 0;
 
 	// clear title and cover image
 	gPlayProperties.title[0] = '\0';
 	gPlayProperties.coverFilePos = 0;
 	AudioPlayer_StationLogoUrl = "";
 	gPlayProperties.playlist = allocatePlaylist();
-	gPlayProperties.SavePlayPosRfidChange = gPrefsSettings.getBool("savePosRfidChge", false); // SAVE_PLAYPOS_WHEN_RFID_CHANGE
-	gPlayProperties.savePosIntervalSecs = gPrefsSettings.getUShort("savePosIntv", 0); // SAVE_PLAYPOS_INTERVAL (periodic checkpoint, 0 = off)
-	gPlayProperties.pauseOnMinVolume = gPrefsSettings.getBool("pauseOnMinVol", false); // PAUSE_ON_MIN_VOLUME
-#ifdef PAUSE_WHEN_RFID_REMOVED
-	gPlayProperties.pauseIfRfidRemoved = gPrefsSettings.getBool("pauseRfidRem", true);
-#else
-	gPlayProperties.pauseIfRfidRemoved = gPrefsSettings.getBool("pauseRfidRem", false);
-#endif
-#ifdef DONT_ACCEPT_SAME_RFID_TWICE
-	gPlayProperties.dontAcceptRfidTwice = gPrefsSettings.getBool("dAccRfidTwice", true);
-#else
-	gPlayProperties.dontAcceptRfidTwice = gPrefsSettings.getBool("dAccRfidTwice", false);
-#endif
-#ifdef RESUME_ON_SAME_RFID
-	gPlayProperties.resumeOnSameRfid = gPrefsSettings.getBool("p2pSameRfid", true);
-#else
-	gPlayProperties.resumeOnSameRfid = gPrefsSettings.getBool("p2pSameRfid", false);
-#endif
+	gPlayProperties.SavePlayPosRfidChange = SettingsRegistry_GetBool(SettingId::SavePosRfidChange); // SAVE_PLAYPOS_WHEN_RFID_CHANGE
+	gPlayProperties.savePosIntervalSecs = SettingsRegistry_Get(SettingId::SavePosInterval); // SAVE_PLAYPOS_INTERVAL (periodic checkpoint, 0 = off)
+	// A checkpoint from the journal that didn't make it into NVS before the last reset has to be there before the first card is looked up
+	PlayPosJournal_Init();
+	AudioPlayer_CompactPlayPosJournal();
+	gPlayProperties.pauseOnMinVolume = SettingsRegistry_GetBool(SettingId::PauseOnMinVolume); // PAUSE_ON_MIN_VOLUME
+	gPlayProperties.pauseIfRfidRemoved = SettingsRegistry_GetBool(SettingId::PauseIfRfidRemoved); // PAUSE_WHEN_RFID_REMOVED
+	gPlayProperties.dontAcceptRfidTwice = SettingsRegistry_GetBool(SettingId::DontAcceptRfidTwice); // DONT_ACCEPT_SAME_RFID_TWICE
+	gPlayProperties.resumeOnSameRfid = SettingsRegistry_GetBool(SettingId::ResumeOnSameRfid); // RESUME_ON_SAME_RFID
 	if (gPlayProperties.pauseIfRfidRemoved) {
 		// ignore feature silently if PAUSE_WHEN_RFID_REMOVED is active
 		Log_Println("pauseIfRfidRemoved is enabled -> deactivate dontAcceptRfidTwice", LOGLEVEL_NOTICE);
 		gPlayProperties.dontAcceptRfidTwice = false;
 	}
 
+	// Apply changes of these settings (e.g. via webinterface) without reboot
+	for (const SettingId id : {SettingId::MaxVolumeSpeaker, SettingId::MaxVolumeHeadphone, SettingId::PlayMono, SettingId::SavePosRfidChange, SettingId::SavePosInterval, SettingId::PauseIfRfidRemoved, SettingId::DontAcceptRfidTwice, SettingId::ResumeOnSameRfid, SettingId::PauseOnMinVolume, SettingId::VolumeCurve, SettingId::ReplayGain}) {
+		SettingsRegistry_Subscribe(id, AudioPlayer_OnSettingChanged);
+	}
+
 #ifdef I2S_COMM_FMT_LSB_ENABLE
 	audio->setI2SCommFMT_LSB(true);
 #endif
@@ -483,7 +714,6 @@ void AudioPlayer_Init(void) {
 	AudioPlayer_CurrentVolume = AudioPlayer_GetInitVolume();
 	// DMA-settings must be adjusted before setting the pinout
 	if (System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) {
-		audio->setOutputSampleRate(Audio::OutputSR_t::SR_44100);
 		audio->settings.DMA_FRAME_NUM = 192; // not too high, to safe some SRAM
 	} else if (System_GetOperationMode() == OPMODE_BLUETOOTH_SINK) {
 		audio->settings.DMA_FRAME_NUM = 192; // not too high, to safe some SRAM
@@ -496,13 +726,25 @@ void AudioPlayer_Init(void) {
 	audio->setVolumeCurve(Audio_GetVolume);
 	audio->setVolume(AudioPlayer_CurrentVolume);
 	audio->forceMono(gPlayProperties.currentPlayMono);
-	audio->setTone(
-		gPrefsSettings.getChar("gainLowPass", 0),
-		gPrefsSettings.getChar("gainBandPass", 0),
-		gPrefsSettings.getChar("gainHighPass", 0));
+	Equalizer_Init(); // tone-control of the lib stays flat, our equalizer runs in audio_process_i2s()
 
 	audio->setAudioTaskCore(1);
 	audio->audio_info_callback = Audio_InfoCallback;
+
+	AudioPlayer_CommandQueueInit();
+	if (!AudioPlayer_PlayPosWriteQueue) {
+		AudioPlayer_PlayPosWriteQueue = xQueueCreate(playPosWriteQueueSize, sizeof(playPosWrite_t));
+	}
+	AudioPlayer_TaskStopRequested = false;
+	xTaskCreatePinnedToCore(
+		AudioPlayer_Task, /* Function to implement the task */
+		"AudioPlayer", /* Name of the task */
+		audioTaskStackSize, /* Stack size in words */
+		NULL, /* Task input parameter */
+		audioTaskPriority, /* Priority of the task */
+		&AudioPlayer_TaskHandle, /* Task handle. */
+		1 /* Core where the task should run */
+	);
 }
 
 void AudioPlayer_Exit(void) {
@@ -511,10 +753,25 @@ void AudioPlayer_Exit(void) {
 	playTimeSecTotal += playTimeSecSinceStart;
 	gPrefsSettings.putULong("playTimeTotal", playTimeSecTotal);
 	// Make sure last playposition for audiobook is saved when playback is active while shutdown was initiated
-	if (gPrefsSettings.getBool("savePosShutdown", false) && !gPlayProperties.pausePlay && (gPlayProperties.playMode == AUDIOBOOK || gPlayProperties.playMode == AUDIOBOOK_LOOP || gPlayProperties.playMode == AUDIOBOOK_RECURSIVE)) {
+	if (SettingsRegistry_GetBool(SettingId::SavePosShutdown) && !gPlayProperties.pausePlay && (gPlayProperties.playMode == AUDIOBOOK || gPlayProperties.playMode == AUDIOBOOK_LOOP || gPlayProperties.playMode == AUDIOBOOK_RECURSIVE)) {
 		AudioPlayer_SetTrackControl(PAUSEPLAY);
-		// Call the loop explicitely to make sure that PAUSE is set (because this saves the current playpos)
-		AudioPlayer_Loop();
+		// Wait for the audio-task to set PAUSE (because this saves the current playpos)
+		for (uint8_t i = 0; i < 50u && !gPlayProperties.pausePlay; i++) {
+			vTaskDelay(portTICK_PERIOD_MS * 10u);
+		}
+	}
+	// stop the audio-task before the audio-object is gone
+	AudioPlayer_TaskStopRequested = true;
+	for (uint8_t i = 0; i < 50u && AudioPlayer_TaskHandle; i++) {
+		xTaskNotifyGive(AudioPlayer_TaskHandle);
+		vTaskDelay(portTICK_PERIOD_MS * 10u);
+	}
+	AudioPlayer_WritePlayPositions();
+	AudioPlayer_CompactPlayPosJournal();
+	if (AudioPlayer_TaskHandle) {
+		// still inside the audio-lib (e.g. a stalled stream): it's better to leak the audio-object than to pull it away
+		Log_Println("Audio-task didn't stop, audio-object is kept", LOGLEVEL_ERROR);
+		return;
 	}
 	delete audio;
 	audio = nullptr;
@@ -523,8 +780,11 @@ void AudioPlayer_Exit(void) {
 static uint32_t lastPlayingTimestamp = 0;
 static uint32_t AudioPlayer_lastCheckpointTimestamp = 0; // millis() of the last periodic play-position checkpoint
 static uint32_t AudioPlayer_lastCheckpointPos = 0; // last checkpointed play-position (seconds) for dedup
+static uint32_t AudioPlayer_lastJournalTimestamp = 0; // millis() of the last play-position appended to the journal
+constexpr uint32_t playPosJournalInterval = 5000; // journal-appends are cheap, so they're much more frequent than NVS-checkpoints
 
 void AudioPlayer_Cyclic(void) {
+	AudioPlayer_WritePlayPositions();
 	if (AudioPlayer_UploadActive) {
 		return;
 	}
@@ -542,21 +802,130 @@ void AudioPlayer_Cyclic(void) {
 		// disappears mid-file, so playback restarts from the start of that file on resume. Gated on
 		// audiobook mode (saveLastPlayPosition) plus a minimum file length, so short/split tracks --
 		// which already checkpoint at every track boundary -- don't needlessly wear the NVS flash.
+		// The position is appended to the play-position journal every few seconds (see PlayPosJournal.cpp).
+		// With the "ppjournal"-partition that survives a loss of power, so NVS is only written at the
+		// usual points and by the compaction after a reboot. Without it (old partition-table) the journal
+		// is in RTC-memory, which covers resets, panics and watchdog-reboots only - then NVS is still
+		// checkpointed every savePosIntv.
 		constexpr uint32_t checkpointMinDurationSecs = 300; // below 5 min, per-track boundary saves suffice
-		if (gPlayProperties.savePosIntervalSecs > 0 && gPlayProperties.saveLastPlayPosition && !gPlayProperties.isWebstream
-			&& audio != nullptr && audio->getAudioFileDuration() >= checkpointMinDurationSecs
-			&& (millis() - AudioPlayer_lastCheckpointTimestamp >= (uint32_t) gPlayProperties.savePosIntervalSecs * 1000)) {
-			uint32_t checkpointPos = audio->getAudioCurrentTime();
-			if (checkpointPos != AudioPlayer_lastCheckpointPos) { // dedup: skip if position hasn't advanced (e.g. stalled)
-				AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, checkpointPos, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
-				AudioPlayer_lastCheckpointPos = checkpointPos;
+		if (gPlayProperties.savePosIntervalSecs > 0 && gPlayProperties.saveLastPlayPosition && !gPlayProperties.isWebstream && audio != nullptr) {
+			const bool nvsCheckpointDue = !PlayPosJournal_IsDurable() && AudioPlayer_GetFileDuration() >= checkpointMinDurationSecs
+				&& (millis() - AudioPlayer_lastCheckpointTimestamp >= (uint32_t) gPlayProperties.savePosIntervalSecs * 1000);
+			if (nvsCheckpointDue || millis() - AudioPlayer_lastJournalTimestamp >= playPosJournalInterval) {
+				const uint32_t checkpointPos = AudioPlayer_GetCurrentTime();
+				if (checkpointPos != AudioPlayer_lastCheckpointPos) { // dedup: skip if position hasn't advanced (e.g. stalled)
+					PlayPosJournal_Append(gPlayProperties.playRfidTag, checkpointPos, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+					AudioPlayer_lastCheckpointPos = checkpointPos;
+				}
+				AudioPlayer_lastJournalTimestamp = millis();
 			}
-			AudioPlayer_lastCheckpointTimestamp = millis();
+			if (nvsCheckpointDue) {
+				AudioPlayer_CompactPlayPosJournal(); // nothing is written if the position didn't advance since the last NVS-write
+				AudioPlayer_lastCheckpointTimestamp = millis();
+			}
+		}
+	}
+
+	// Actual loop stuff runs in AudioPlayer_Task()
+}
+
+// Applies all queued commands. A track-command is processed by AudioPlayer_Loop(), so further commands
+// are left in the queue until that's done (keeps the order and doesn't overwrite a pending track-command).
+// During an upload AudioPlayer_Loop() doesn't run: everything is taken from the queue, so the end of the
+// upload isn't stuck behind a track-command, and only the newest track-command is kept.
+static void AudioPlayer_ProcessCommands(void) {
+	if (AudioPlayer_VolumeGainTableStale.exchange(false)) {
+		AudioPlayer_ApplyReplayGain(true);
+	}
+
+	audioCommand_t command;
+	while ((trackCommand == NO_ACTION || AudioPlayer_UploadActive) && AudioPlayer_PopCommand(&command)) {
+		switch (command.type) {
+			case AudioCommandType::TrackControl:
+				trackCommand = command.value;
+				break;
+			case AudioCommandType::Upload:
+				AudioPlayer_SuspendForUpload(command.value != 0u);
+				break;
+			case AudioCommandType::Volume:
+				audio->setVolume(command.value);
+				break;
+			case AudioCommandType::NewPlaylist:
+				if (newPlayListAvailable) {
+					freePlaylist(newPlayList.playlist); // superseded before it was started
+				}
+				newPlayList = command.playlist;
+				newPlayListAvailable = true;
+				break;
+			case AudioCommandType::SeekPercent:
+				gPlayProperties.currentRelPos = command.value;
+				gPlayProperties.seekmode = SEEK_POS_PERCENT;
+				break;
+		}
+	}
+}
+
+// Time until the input-buffer of the decoder should be refilled: a quarter of the time it takes to play what's
+// buffered, so a single late wakeup doesn't make it run dry
+static uint32_t AudioPlayer_NextRefillPeriodMs(void) {
+	const uint32_t bitRate = audio->getBitRate();
+	if (!audio->isRunning() || bitRate == 0) {
+		return audioTaskMaxRefillPeriod;
+	}
+	const uint32_t bufferedMs = static_cast<uint64_t>(audio->inBufferFilled()) * 8000u / bitRate;
+	return std::clamp<uint32_t>(bufferedMs / 4u, 1u, audioTaskMaxRefillPeriod);
+}
+
+static void AudioPlayer_Task(void *parameter) {
+	uint32_t plannedWakeupUs = micros();
+	uint32_t lastInBufferFilled = 0;
+
+	while (!AudioPlayer_TaskStopRequested) {
+		const uint32_t wakeupUs = micros();
+		// Jitter: how late we're compared to the planned refill (an early wakeup because of a command doesn't count)
+		const int32_t lateUs = static_cast<int32_t>(wakeupUs - plannedWakeupUs);
+		if (lateUs > 0) {
+			AudioPlayer_TaskJitterMaxUs = std::max<uint32_t>(AudioPlayer_TaskJitterMaxUs, lateUs);
+			AudioPlayer_TaskJitterAvgUs += (static_cast<int32_t>(lateUs) - static_cast<int32_t>(AudioPlayer_TaskJitterAvgUs)) / 16;
+		}
+
+		AudioPlayer_ProcessCommands();
+		if (!AudioPlayer_UploadActive) {
+			// Deadline missed: the input-buffer ran dry while there was still something to read
+			const uint32_t inBufferFilled = audio->inBufferFilled();
+			if (inBufferFilled == 0 && lastInBufferFilled > 0 && audio->isRunning() && !gPlayProperties.pausePlay && (gPlayProperties.isWebstream || AudioPlayer_CurrentTime + 1 < AudioPlayer_FileDuration)) {
+				AudioPlayer_TaskDeadlineMisses++;
+			}
+			lastInBufferFilled = inBufferFilled;
+
+			AudioPlayer_Loop();
+
+			const bool running = audio->isRunning();
+			AudioPlayer_DecoderBitRate = running ? audio->getBitRate() : 0u;
+			AudioPlayer_DecoderSampleRate = running ? audio->getSampleRate() : 0u;
 		}
+
+		const uint32_t loopTimeUs = micros() - wakeupUs;
+		AudioPlayer_TaskLoopTimeMaxUs = std::max(AudioPlayer_TaskLoopTimeMaxUs, loopTimeUs);
+		AudioPlayer_TaskLoopTimeAvgUs += (static_cast<int32_t>(loopTimeUs) - static_cast<int32_t>(AudioPlayer_TaskLoopTimeAvgUs)) / 16;
+
+		const uint32_t periodMs = AudioPlayer_UploadActive ? audioTaskMaxRefillPeriod : AudioPlayer_NextRefillPeriodMs();
+		plannedWakeupUs = micros() + periodMs * 1000u;
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(periodMs));
 	}
 
-	// Actual loop stuff
-	AudioPlayer_Loop();
+	AudioPlayer_TaskHandle = nullptr;
+	vTaskDelete(NULL);
+}
+
+// Runtime-statistics of the audio-task (exposed via /debug)
+void AudioPlayer_GetTaskStats(audioTaskStats_t *stats) {
+	stats->loopTimeAvgUs = AudioPlayer_TaskLoopTimeAvgUs;
+	stats->loopTimeMaxUs = AudioPlayer_TaskLoopTimeMaxUs;
+	stats->jitterAvgUs = AudioPlayer_TaskJitterAvgUs;
+	stats->jitterMaxUs = AudioPlayer_TaskJitterMaxUs;
+	stats->deadlineMisses = AudioPlayer_TaskDeadlineMisses;
+	stats->commandsDropped = AudioPlayer_CommandsDropped;
 }
 
 // Wrapper-function to reverse detection of connected headphones.
@@ -597,6 +966,7 @@ uint8_t AudioPlayer_GetMaxVolume(void) {
 
 void AudioPlayer_SetMaxVolume(uint8_t value) {
 	AudioPlayer_MaxVolume = value;
+	AudioPlayer_RequestVolumeGainTable();
 }
 
 uint8_t AudioPlayer_GetMaxVolumeSpeaker(void) {
@@ -656,14 +1026,61 @@ void Audio_setTitle(const char *format, ...) {
 #endif
 }
 
+// Applies changed settings (e.g. from the webinterface) without reboot
+void AudioPlayer_OnSettingChanged(const SettingId id, const uint32_t value) {
+	switch (id) {
+		case SettingId::MaxVolumeSpeaker:
+			AudioPlayer_MaxVolumeSpeaker = value;
+			if (!AudioPlayer_IsHeadphoneModeActive()) {
+				AudioPlayer_SetMaxVolume(value);
+			}
+			break;
+		case SettingId::MaxVolumeHeadphone:
+#ifdef HEADPHONE_ADJUST_ENABLE
+			AudioPlayer_MaxVolumeHeadphone = value;
+			if (AudioPlayer_IsHeadphoneModeActive()) {
+				AudioPlayer_SetMaxVolume(value);
+			}
+#endif
+			break;
+		case SettingId::PlayMono:
+			gPlayProperties.newPlayMono = value && !AudioPlayer_IsHeadphoneModeActive(); // always stereo for headphones!
+			break;
+		case SettingId::SavePosRfidChange:
+			gPlayProperties.SavePlayPosRfidChange = value;
+			break;
+		case SettingId::SavePosInterval:
+			gPlayProperties.savePosIntervalSecs = value;
+			break;
+		case SettingId::PauseIfRfidRemoved:
+		case SettingId::DontAcceptRfidTwice:
+			gPlayProperties.pauseIfRfidRemoved = SettingsRegistry_GetBool(SettingId::PauseIfRfidRemoved);
+			// ignore dontAcceptRfidTwice silently if pauseIfRfidRemoved is active
+			gPlayProperties.dontAcceptRfidTwice = !gPlayProperties.pauseIfRfidRemoved && SettingsRegistry_GetBool(SettingId::DontAcceptRfidTwice);
+			break;
+		case SettingId::ResumeOnSameRfid:
+			gPlayProperties.resumeOnSameRfid = value;
+			break;
+		case SettingId::PauseOnMinVolume:
+			gPlayProperties.pauseOnMinVolume = value;
+			break;
+		case SettingId::VolumeCurve:
+		case SettingId::ReplayGain:
+			AudioPlayer_RequestVolumeGainTable();
+			break;
+		default:
+			break;
+	}
+}
+
 // Set maxVolume depending on headphone-adjustment is enabled and headphone is/is not connected
 // Enable/disable PA/HP-amps initially
 void AudioPlayer_SetupVolumeAndAmps(void) {
-	gPlayProperties.currentPlayMono = gPrefsSettings.getBool("playMono", false);
-	gPlayProperties.newPlayMono = gPrefsSettings.getBool("playMono", false);
+	gPlayProperties.currentPlayMono = SettingsRegistry_GetBool(SettingId::PlayMono);
+	gPlayProperties.newPlayMono = SettingsRegistry_GetBool(SettingId::PlayMono);
 
 #ifndef HEADPHONE_ADJUST_ENABLE
-	AudioPlayer_MaxVolume = AudioPlayer_MaxVolumeSpeaker;
+	AudioPlayer_SetMaxVolume(AudioPlayer_MaxVolumeSpeaker);
 	// If automatic HP-detection is not used, we enabled both (PA / HP) if defined
 	#ifdef GPIO_PA_EN
 	Port_Write(GPIO_PA_EN, true, true);
@@ -674,7 +1091,7 @@ void AudioPlayer_SetupVolumeAndAmps(void) {
 #else
 
 	if (!AudioPlayer_IsHeadphoneModeActive()) {
-		AudioPlayer_MaxVolume = AudioPlayer_MaxVolumeSpeaker; // 1 if headphone is not connected
+		AudioPlayer_SetMaxVolume(AudioPlayer_MaxVolumeSpeaker); // 1 if headphone is not connected
 	#ifdef GPIO_PA_EN
 		Port_Write(GPIO_PA_EN, true, true);
 	#endif
@@ -682,7 +1099,7 @@ void AudioPlayer_SetupVolumeAndAmps(void) {
 		Port_Write(GPIO_HP_EN, false, true);
 	#endif
 	} else {
-		AudioPlayer_MaxVolume = AudioPlayer_MaxVolumeHeadphone; // 0 if headphone is connected (put to GND)
+		AudioPlayer_SetMaxVolume(AudioPlayer_MaxVolumeHeadphone); // 0 if headphone is connected (put to GND)
 		gPlayProperties.newPlayMono = false; // always stereo for headphones!
 
 	#ifdef GPIO_PA_EN
@@ -703,8 +1120,8 @@ void AudioPlayer_HeadphoneVolumeManager(void) {
 
 	if (AudioPlayer_HeadphoneLastDetectionState != currentHeadPhoneDetectionState && (millis() - AudioPlayer_HeadphoneLastDetectionTimestamp >= headphoneLastDetectionDebounce)) {
 		if (!AudioPlayer_IsHeadphoneModeActive()) {
-			AudioPlayer_MaxVolume = AudioPlayer_MaxVolumeSpeaker;
-			gPlayProperties.newPlayMono = gPrefsSettings.getBool("playMono", false);
+			AudioPlayer_SetMaxVolume(AudioPlayer_MaxVolumeSpeaker);
+			gPlayProperties.newPlayMono = SettingsRegistry_GetBool(SettingId::PlayMono);
 
 	#ifdef GPIO_PA_EN
 			Port_Write(GPIO_PA_EN, true, false);
@@ -713,7 +1130,7 @@ void AudioPlayer_HeadphoneVolumeManager(void) {
 			Port_Write(GPIO_HP_EN, false, false);
 	#endif
 		} else {
-			AudioPlayer_MaxVolume = AudioPlayer_MaxVolumeHeadphone;
+			AudioPlayer_SetMaxVolume(AudioPlayer_MaxVolumeHeadphone);
 			gPlayProperties.newPlayMono = false; // Always stereo for headphones
 			if (AudioPlayer_GetCurrentVolume() > AudioPlayer_MaxVolume) {
 				AudioPlayer_SetVolume(AudioPlayer_MaxVolume); // Lower volume for headphone if headphone's maxvolume is exceeded by volume set in speaker-mode
@@ -733,8 +1150,306 @@ void AudioPlayer_HeadphoneVolumeManager(void) {
 #endif
 }
 
+#ifdef BATTERY_MEASURE_ENABLE
+static uint8_t AudioPlayer_GetBatteryPercent(void) {
+	return static_cast<uint8_t>(Battery_EstimateLevel() * 100.0f + 0.5f);
+}
+#endif
+
+constexpr const char *announcementFile = "/.prompts/announcement.wav"; // rendered announcement if nothing is playing
+
+// Builds the sentence from the voice-prompt pack; false if prompts are missing
+static bool AudioPlayer_ComposeAnnouncement(const uint8_t tellMode) {
+	switch (tellMode) {
+		case TTS_IP_ADDRESS:
+			return Announcement_ComposeIpAddress(Wlan_GetIpAddress().c_str());
+
+		case TTS_CURRENT_TIME: {
+			struct tm timeinfo;
+			return getLocalTime(&timeinfo, 0) && Announcement_ComposeTime(timeinfo.tm_hour, timeinfo.tm_min);
+		}
+
+#ifdef BATTERY_MEASURE_ENABLE
+		case TTS_BATTERY_LEVEL:
+			return Announcement_ComposeBatteryLevel(AudioPlayer_GetBatteryPercent());
+#endif
+
+		case TTS_SLEEP_TIMER:
+			return Announcement_ComposeSleepTimer(System_GetSleepTimerMinutesLeft());
+
+		default:
+			return false;
+	}
+}
+
+// Fallback without voice-prompts: online-speech replaces the current track, which is resumed afterwards
+static bool AudioPlayer_SpeakAnnouncement(const uint8_t tellMode) {
+	static char speechBuff[64];
+
+	switch (tellMode) {
+		case TTS_IP_ADDRESS: {
+			String ipText = Wlan_GetIpAddress();
+			// make IP as text (replace thousand separator with locale text)
+			switch (LANGUAGE) {
+				case DE:
+					ipText.replace(".", "Punkt");
+					return audio->connecttospeech(ipText.c_str(), "de");
+				case FR:
+					ipText.replace(".", "point");
+					return audio->connecttospeech(ipText.c_str(), "fr");
+				default:
+					ipText.replace(".", "point");
+					return audio->connecttospeech(ipText.c_str(), "en");
+			}
+		}
+
+		case TTS_CURRENT_TIME: {
+			struct tm timeinfo;
+			getLocalTime(&timeinfo);
+#if (LANGUAGE == DE)
+			snprintf(speechBuff, sizeof(speechBuff), "Es ist %02d:%02d Uhr", timeinfo.tm_hour, timeinfo.tm_min);
+			return audio->connecttospeech(speechBuff, "de");
+#else
+			if (timeinfo.tm_hour > 12) {
+				snprintf(speechBuff, sizeof(speechBuff), "It is %02d:%02d PM", timeinfo.tm_hour - 12, timeinfo.tm_min);
+			} else {
+				snprintf(speechBuff, sizeof(speechBuff), "It is %02d:%02d AM", timeinfo.tm_hour, timeinfo.tm_min);
+			}
+			return audio->connecttospeech(speechBuff, "en");
+#endif
+		}
+
+#ifdef BATTERY_MEASURE_ENABLE
+		case TTS_BATTERY_LEVEL:
+			switch (LANGUAGE) {
+				case DE:
+					snprintf(speechBuff, sizeof(speechBuff), "Akku %u Prozent", AudioPlayer_GetBatteryPercent());
+					return audio->connecttospeech(speechBuff, "de");
+				case FR:
+					snprintf(speechBuff, sizeof(speechBuff), "Batterie %u pour cent", AudioPlayer_GetBatteryPercent());
+					return audio->connecttospeech(speechBuff, "fr");
+				default:
+					snprintf(speechBuff, sizeof(speechBuff), "Battery %u percent", AudioPlayer_GetBatteryPercent());
+					return audio->connecttospeech(speechBuff, "en");
+			}
+#endif
+
+		case TTS_SLEEP_TIMER: {
+			const uint8_t minutesLeft = System_GetSleepTimerMinutesLeft();
+			switch (LANGUAGE) {
+				case DE:
+					if (minutesLeft) {
+						snprintf(speechBuff, sizeof(speechBuff), "Schlaf-Timer %u Minuten", minutesLeft);
+					} else {
+						snprintf(speechBuff, sizeof(speechBuff), "Schlaf-Timer aus");
+					}
+					return audio->connecttospeech(speechBuff, "de");
+				case FR:
+					if (minutesLeft) {
+						snprintf(speechBuff, sizeof(speechBuff), "Minuterie de sommeil %u minutes", minutesLeft);
+					} else {
+						snprintf(speechBuff, sizeof(speechBuff), "Minuterie de sommeil désactivée");
+					}
+					return audio->connecttospeech(speechBuff, "fr");
+				default:
+					if (minutesLeft) {
+						snprintf(speechBuff, sizeof(speechBuff), "Sleep timer %u minutes", minutesLeft);
+					} else {
+						snprintf(speechBuff, sizeof(speechBuff), "Sleep timer off");
+					}
+					return audio->connecttospeech(speechBuff, "en");
+			}
+		}
+
+		default:
+			return false;
+	}
+}
+
+static uint32_t AudioPlayer_ReadBigEndian32(const uint8_t *src) {
+	return (static_cast<uint32_t>(src[0]) << 24) | (static_cast<uint32_t>(src[1]) << 16) | (static_cast<uint32_t>(src[2]) << 8) | src[3];
+}
+
+// Reads the frame-count of a MP3 from its Xing-/Info-header and encoder-delay/-padding from the LAME-tag.
+// Returns false for other formats or MP3 without Xing-header; then the duration reported by the lib is used.
+static bool AudioPlayer_ParseTrackHeader(const char *path, trackHeaderInfo_t *info) {
+	*info = {};
+	File file = gFSystem.open(path, FILE_READ);
+	if (!file) {
+		return false;
+	}
+	uint8_t buf[192]; // first frame up to the end of the LAME-tag
+	uint32_t offset = 0;
+	if (file.read(buf, 10) == 10 && !memcmp(buf, "ID3", 3)) {
+		// skip ID3v2-tag (synchsafe size, optional footer)
+		offset = 10u + ((buf[6] & 0x7F) << 21 | (buf[7] & 0x7F) << 14 | (buf[8] & 0x7F) << 7 | (buf[9] & 0x7F)) + ((buf[5] & 0x10) ? 10u : 0u);
+	}
+	const bool readOk = file.seek(offset) && (file.read(buf, sizeof(buf)) == sizeof(buf));
+	file.close();
+	// frame-sync and layer III
+	if (!readOk || buf[0] != 0xFF || (buf[1] & 0xE0) != 0xE0 || ((buf[1] >> 1) & 0x03) != 0x01) {
+		return false;
+	}
+	const bool mpeg1 = (((buf[1] >> 3) & 0x03) == 0x03);
+	const bool mono = (((buf[3] >> 6) & 0x03) == 0x03);
+	const uint8_t *xing = &buf[4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17))]; // behind the side-info
+	if (memcmp(xing, "Xing", 4) && memcmp(xing, "Info", 4)) {
+		return false;
+	}
+	const uint32_t flags = AudioPlayer_ReadBigEndian32(&xing[4]);
+	if (!(flags & 0x01)) { // no frame-count
+		return false;
+	}
+	info->frames = AudioPlayer_ReadBigEndian32(&xing[8]) * (mpeg1 ? 1152u : 576u);
+
+	// LAME-tag follows the optional fields (frames, bytes, TOC, quality)
+	const uint8_t *lame = &xing[8 + 4 + ((flags & 0x02) ? 4 : 0) + ((flags & 0x04) ? 100 : 0) + ((flags & 0x08) ? 4 : 0)];
+	if (lame + 24 <= buf + sizeof(buf) && (!memcmp(lame, "LAME", 4) || !memcmp(lame, "Lavc", 4) || !memcmp(lame, "Lavf", 4))) {
+		info->encoderDelay = (lame[21] << 4) | (lame[22] >> 4);
+		info->encoderPadding = ((lame[22] & 0x0F) << 8) | lame[23];
+	}
+	return true;
+}
+
+// Track that is played after the current one ends on its own; -1 if there's none (or it's a webstream)
+static int32_t AudioPlayer_GetNextTrackNumber(void) {
+	if (gPlayProperties.playlist == nullptr || gPlayProperties.playMode == NO_PLAYLIST || gPlayProperties.playMode == BUSY || gPlayProperties.sleepAfterCurrentTrack) {
+		return -1;
+	}
+	int32_t next = gPlayProperties.currentTrackNumber;
+	if (!gPlayProperties.repeatCurrentTrack) {
+		next++;
+		if (gPlayProperties.playUntilTrackNumber > 0 && next >= static_cast<int32_t>(gPlayProperties.playUntilTrackNumber)) {
+			return -1;
+		}
+		if (next >= static_cast<int32_t>(gPlayProperties.playlist->size())) {
+			if (!gPlayProperties.repeatPlaylist) {
+				return -1;
+			}
+			next = 0;
+		}
+	}
+	if (!strncmp("http", gPlayProperties.playlist->at(next), 4)) {
+		return -1;
+	}
+	return next;
+}
+
+// Runs during the last seconds of a track: checks the next one and pre-parses its header, so starting it
+// on EOF is nothing but opening the file
+static void AudioPlayer_PrepareNextTrack(void) {
+	if (SettingsRegistry_Get(SettingId::TrackTransition) == static_cast<uint8_t>(TrackTransition::Normal) || AudioPlayer_PreparedTrackNumber >= 0) {
+		return;
+	}
+	if (gPlayProperties.isWebstream || gPlayProperties.pausePlay || !audio->isRunning() || !AudioPlayer_FileDuration || AudioPlayer_CurrentTime + trackPrepareLeadSec < AudioPlayer_FileDuration) {
+		return;
+	}
+	const int32_t next = AudioPlayer_GetNextTrackNumber();
+	if (next < 0 || !gFSystem.exists(gPlayProperties.playlist->at(next))) {
+		return;
+	}
+	const char *path = gPlayProperties.playlist->at(next);
+	if (AudioPlayer_ParseTrackHeader(path, &AudioPlayer_PreparedTrackInfo)) {
+		Log_Printf(LOGLEVEL_DEBUG, "Next track prepared: %s (%" PRIu32 " frames, encoder-delay %u, padding %u)", path, AudioPlayer_PreparedTrackInfo.frames, AudioPlayer_PreparedTrackInfo.encoderDelay, AudioPlayer_PreparedTrackInfo.encoderPadding);
+	} else {
+		Log_Printf(LOGLEVEL_DEBUG, "Next track prepared: %s", path);
+	}
+	AudioPlayer_PreparedTrackNumber = next;
+}
+
+// A track was started: take over what was prepared for it (or parse it now) and restart the frame-counter
+static void AudioPlayer_OnTrackStarted(void) {
+	trackHeaderInfo_t info = {};
+	if (!gPlayProperties.isWebstream) {
+		if (static_cast<int32_t>(gPlayProperties.currentTrackNumber) == AudioPlayer_PreparedTrackNumber) {
+			info = AudioPlayer_PreparedTrackInfo;
+		} else if (SettingsRegistry_Get(SettingId::TrackTransition) != static_cast<uint8_t>(TrackTransition::Normal)) {
+			AudioPlayer_ParseTrackHeader(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), &info);
+		}
+	}
+	AudioPlayer_PreparedTrackNumber = -1;
+	if (!gPlayProperties.isWebstream) {
+		SeekIndex_Request(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber));
+	}
+	AudioPlayer_TrackFramesExact = (info.frames > 0);
+	AudioPlayer_TrackFrames = info.frames;
+	AudioPlayer_TrackFramesOut = 0;
+}
+
+// Keeps the output-position in sync with the lib (seeks) and estimates the track-length if the header didn't tell
+static void AudioPlayer_SyncTrackPosition(void) {
+	const uint32_t sampleRate = audio->getSampleRate();
+	if (!sampleRate || gPlayProperties.isWebstream || !audio->isRunning()) {
+		return;
+	}
+	const uint32_t libFrames = AudioPlayer_CurrentTime * sampleRate;
+	const uint32_t framesOut = AudioPlayer_TrackFramesOut;
+	if (framesOut + 2u * sampleRate < libFrames || libFrames + 2u * sampleRate < framesOut) {
+		AudioPlayer_TrackFramesOut = libFrames;
+	}
+	if (!AudioPlayer_TrackFramesExact) {
+		AudioPlayer_TrackFrames = AudioPlayer_FileDuration * sampleRate;
+	}
+
+	static uint32_t loggedTransitions = 0;
+	if (loggedTransitions != AudioPlayer_TransitionCount) {
+		loggedTransitions = AudioPlayer_TransitionCount;
+		Log_Printf(LOGLEVEL_DEBUG, "Track-transition: gap %.1f ms", AudioPlayer_TransitionGapLastUs / 1000.0f);
+	}
+}
+
+// Statistics of the gaps between two tracks (exposed via /debug)
+void AudioPlayer_GetTransitionStats(transitionStats_t *stats) {
+	stats->count = AudioPlayer_TransitionCount;
+	stats->lastGapUs = AudioPlayer_TransitionGapLastUs;
+	stats->avgGapUs = AudioPlayer_TransitionGapAvgUs;
+	stats->maxGapUs = AudioPlayer_TransitionGapMaxUs;
+}
+
+// A seek was started; latency is taken with the first buffer after it (see AudioPlayer_ProcessSeek())
+static void AudioPlayer_SeekStarted(const uint32_t startUs, const bool indexed, const uint32_t targetMs, const uint32_t frameSample) {
+	AudioPlayer_SeekCount++;
+	if (indexed) {
+		AudioPlayer_SeekIndexedCount++;
+		AudioPlayer_SeekTargetMs = targetMs;
+		AudioPlayer_SeekFrameSample = frameSample;
+	}
+	AudioPlayer_SeekIndexedPending = indexed;
+	AudioPlayer_SeekStartUs = startUs;
+	AudioPlayer_SeekPending = true;
+}
+
+// Jumps to the exact frame via the seek-index. False if the track has no index (yet); then the lib has to estimate.
+static bool AudioPlayer_SeekIndexed(const uint32_t seconds) {
+	const uint32_t startUs = micros();
+	uint32_t filePos;
+	uint32_t frameSample;
+	if (gPlayProperties.isWebstream || gPlayProperties.playlist == nullptr || !audio->isRunning()) {
+		return false;
+	}
+	if (!SeekIndex_Lookup(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), seconds * 1000u, &filePos, &frameSample) || !audio->setFilePos(filePos)) {
+		return false;
+	}
+	AudioPlayer_SeekStarted(startUs, true, seconds * 1000u, frameSample);
+	return true;
+}
+
+// Statistics of seek and resume (exposed via /debug)
+void AudioPlayer_GetSeekStats(seekStats_t *stats) {
+	stats->count = AudioPlayer_SeekCount;
+	stats->indexed = AudioPlayer_SeekIndexedCount;
+	stats->lastLatencyUs = AudioPlayer_SeekLatencyLastUs;
+	stats->avgLatencyUs = AudioPlayer_SeekLatencyAvgUs;
+	stats->maxLatencyUs = AudioPlayer_SeekLatencyMaxUs;
+	stats->lastErrorUs = AudioPlayer_SeekErrorLastUs;
+	stats->maxErrorUs = AudioPlayer_SeekErrorMaxUs;
+}
+
 // Function to play music as task
 void AudioPlayer_Loop() {
+	// Equalizer-coefficients follow the sample-rate and the output (speaker or headphone)
+	Equalizer_Update(audio->getSampleRate(), AudioPlayer_IsHeadphoneModeActive() ? EqualizerProfile::Headphone : EqualizerProfile::Speaker);
+
 	// Update playtime stats every 250 ms
 	if ((millis() - AudioPlayer_LastPlaytimeStatsTimestamp) > 250) {
 		AudioPlayer_LastPlaytimeStatsTimestamp = millis();
@@ -743,6 +1458,9 @@ void AudioPlayer_Loop() {
 		AudioPlayer_FileDuration = audio->getAudioFileDuration();
 		// Calculate relative position in file (for trackprogress neopixel & web-ui)
 		gPlayProperties.audioFileDuration = AudioPlayer_FileDuration;
+		AudioPlayer_SyncTrackPosition();
+		AudioPlayer_PrepareNextTrack();
+		Loudness_Cyclic(!audio->isRunning() || gPlayProperties.pausePlay);
 		if (!gPlayProperties.playlistFinished && AudioPlayer_FileDuration > 0) {
 			// for local files and web files with known size
 			if (!gPlayProperties.pausePlay && (gPlayProperties.seekmode != SEEK_POS_PERCENT)) { // To progress necessary when paused
@@ -761,17 +1479,32 @@ void AudioPlayer_Loop() {
 	if (newPlayListAvailable || gPlayProperties.trackFinished || trackCommand != NO_ACTION) {
 		if (newPlayListAvailable) {
 			newPlayListAvailable = false;
+			TapTrace_Mark(TraceStage::Pickup);
 			audio->stopSong();
 
 			// destroy the old playlist and assign the new one
 			freePlaylist(gPlayProperties.playlist);
-			gPlayProperties.playlist = newPlayList;
+			gPlayProperties.playlist = newPlayList.playlist;
+			gPlayProperties.playMode = newPlayList.playMode;
+			gPlayProperties.startAtFilePos = newPlayList.startAtFilePos;
+			gPlayProperties.currentTrackNumber = newPlayList.trackNumber;
+			gPlayProperties.repeatCurrentTrack = newPlayList.repeatCurrentTrack;
+			gPlayProperties.repeatPlaylist = newPlayList.repeatPlaylist;
+			gPlayProperties.sleepAfterCurrentTrack = newPlayList.sleepAfterCurrentTrack;
+			gPlayProperties.sleepAfterPlaylist = newPlayList.sleepAfterPlaylist;
+			gPlayProperties.saveLastPlayPosition = newPlayList.saveLastPlayPosition;
+			gPlayProperties.playUntilTrackNumber = newPlayList.playUntilTrackNumber;
+			AudioPlayer_PlaylistBusy = false;
 			Log_Printf(LOGLEVEL_NOTICE, newPlaylistReceived, gPlayProperties.playlist->size());
 			Log_Printf(LOGLEVEL_DEBUG, "Free heap: %u", ESP.getFreeHeap());
 			playbackTimeoutStart = millis();
 			gPlayProperties.pausePlay = false;
 			gPlayProperties.trackFinished = false;
 			gPlayProperties.playlistFinished = false;
+			AudioPlayer_PreparedTrackNumber = -1;
+			AudioPlayer_TransitionPending = false;
+			AudioPlayer_ResumeFilePos = 0;
+			AudioPlayer_SeekMute = false;
 #ifdef MQTT_ENABLE
 			publishMqtt(topicPausePlay, "play", false);
 			publishMqtt(topicPlaymode, static_cast<uint32_t>(gPlayProperties.playMode), false);
@@ -780,12 +1513,13 @@ void AudioPlayer_Loop() {
 
 			// If we're in audiobook-mode and apply a modification-card, we don't
 			// want to save lastPlayPosition for the mod-card but for the card that holds the playlist
-			if (strlen(gCurrentRfidTagId) > 0) {
-				strncpy(gPlayProperties.playRfidTag, gCurrentRfidTagId, sizeof(gPlayProperties.playRfidTag) / sizeof(gPlayProperties.playRfidTag[0]));
+			if (strlen(newPlayList.rfidTag) > 0) {
+				strncpy(gPlayProperties.playRfidTag, newPlayList.rfidTag, sizeof(gPlayProperties.playRfidTag) / sizeof(gPlayProperties.playRfidTag[0]));
 			}
 		}
 		if (gPlayProperties.trackFinished) {
 			gPlayProperties.trackFinished = false;
+			Loudness_TrackFinished(AudioPlayer_FileDuration);
 			if (gPlayProperties.playMode == NO_PLAYLIST || gPlayProperties.playlist == nullptr) {
 				gPlayProperties.playlistFinished = true;
 				return;
@@ -793,7 +1527,7 @@ void AudioPlayer_Loop() {
 			if (gPlayProperties.saveLastPlayPosition) { // Don't save for AUDIOBOOK_LOOP because not necessary
 				if (gPlayProperties.currentTrackNumber + 1 < gPlayProperties.playlist->size()) {
 					// Only save if there's another track, otherwise it will be saved at end of playlist anyway
-					AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber + 1);
+					AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber + 1);
 				}
 			}
 			if (gPlayProperties.sleepAfterCurrentTrack) { // Go to sleep if "sleep after track" was requested
@@ -811,12 +1545,10 @@ void AudioPlayer_Loop() {
 		}
 
 		if (gPlayProperties.playlistFinished && trackCommand != NO_ACTION) {
-			if (gPlayProperties.playMode != BUSY) { // Prevents from staying in mode BUSY forever when error occured (e.g. directory empty that should be played)
-				Log_Println(noPlaymodeChangeIfIdle, LOGLEVEL_NOTICE);
-				trackCommand = NO_ACTION;
-				System_IndicateError();
-				return;
-			}
+			Log_Println(noPlaymodeChangeIfIdle, LOGLEVEL_NOTICE);
+			trackCommand = NO_ACTION;
+			System_IndicateError();
+			return;
 		}
 		/* Check if track-control was called
 		   (stop, start, next track, prev. track, last track, first track...) */
@@ -851,7 +1583,7 @@ void AudioPlayer_Loop() {
 				}
 				if (gPlayProperties.saveLastPlayPosition && !gPlayProperties.pausePlay) {
 					Log_Printf(LOGLEVEL_INFO, trackPausedAtPos, audio->getAudioCurrentTime(), audio->getAudioFileDuration());
-					AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, audio->getAudioCurrentTime(), gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+					AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, audio->getAudioCurrentTime(), gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 				}
 				gPlayProperties.pausePlay = !gPlayProperties.pausePlay;
 
@@ -882,7 +1614,7 @@ void AudioPlayer_Loop() {
 						gPlayProperties.currentTrackNumber++;
 					}
 					if (gPlayProperties.saveLastPlayPosition) {
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+						AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 						Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
 					}
 					Log_Println(cmndNextTrack, LOGLEVEL_INFO);
@@ -934,7 +1666,7 @@ void AudioPlayer_Loop() {
 						}
 
 						if (gPlayProperties.saveLastPlayPosition) {
-							AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+							AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 							Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
 						}
 
@@ -944,7 +1676,7 @@ void AudioPlayer_Loop() {
 						}
 					} else {
 						if (gPlayProperties.saveLastPlayPosition) {
-							AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+							AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 						}
 						audio->stopSong();
 						Led_Indicate(LedIndicatorType::Rewind);
@@ -972,7 +1704,7 @@ void AudioPlayer_Loop() {
 				}
 				gPlayProperties.currentTrackNumber = 0;
 				if (gPlayProperties.saveLastPlayPosition) {
-					AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+					AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 					Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
 				}
 				Log_Println(cmndFirstTrack, LOGLEVEL_INFO);
@@ -993,7 +1725,7 @@ void AudioPlayer_Loop() {
 				if (gPlayProperties.currentTrackNumber + 1 < gPlayProperties.playlist->size()) {
 					gPlayProperties.currentTrackNumber = gPlayProperties.playlist->size() - 1;
 					if (gPlayProperties.saveLastPlayPosition) {
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+						AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 						Log_Println(trackStartAudiobook, LOGLEVEL_INFO);
 					}
 					Log_Println(cmndLastTrack, LOGLEVEL_INFO);
@@ -1018,7 +1750,7 @@ void AudioPlayer_Loop() {
 					gPlayProperties.currentTrackNumber = gPlayProperties.jumpToFolderTrack;
 					gPlayProperties.jumpToFolderTrack = -1;
 					if (gPlayProperties.saveLastPlayPosition) {
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+						AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 					}
 				} else {
 					Log_Println(lastFolderAlreadyActive, LOGLEVEL_NOTICE);
@@ -1039,7 +1771,7 @@ void AudioPlayer_Loop() {
 					gPlayProperties.currentTrackNumber = gPlayProperties.jumpToFolderTrack;
 					gPlayProperties.jumpToFolderTrack = -1;
 					if (gPlayProperties.saveLastPlayPosition) {
-						AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+						AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 					}
 				} else {
 					System_IndicateError();
@@ -1059,7 +1791,7 @@ void AudioPlayer_Loop() {
 
 		if (gPlayProperties.playUntilTrackNumber == gPlayProperties.currentTrackNumber && gPlayProperties.playUntilTrackNumber > 0) {
 			if (gPlayProperties.saveLastPlayPosition) {
-				AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, 0);
+				AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, 0);
 			}
 			gPlayProperties.playlistFinished = true;
 			gPlayProperties.playMode = NO_PLAYLIST;
@@ -1072,7 +1804,7 @@ void AudioPlayer_Loop() {
 			if (!gPlayProperties.repeatPlaylist) {
 				if (gPlayProperties.saveLastPlayPosition) {
 					// Set back to first track
-					AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, 0);
+					AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, 0);
 				}
 				gPlayProperties.playlistFinished = true;
 				gPlayProperties.playMode = NO_PLAYLIST;
@@ -1096,7 +1828,7 @@ void AudioPlayer_Loop() {
 				Log_Println(repeatPlaylistDueToPlaymode, LOGLEVEL_NOTICE);
 				gPlayProperties.currentTrackNumber = 0;
 				if (gPlayProperties.saveLastPlayPosition) {
-					AudioPlayer_NvsRfidWriteWrapper(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
+					AudioPlayer_SavePlayPosition(gPlayProperties.playRfidTag, 0, gPlayProperties.playMode, gPlayProperties.currentTrackNumber);
 				}
 			}
 		}
@@ -1108,6 +1840,11 @@ void AudioPlayer_Loop() {
 		}
 		gPlayProperties.currentRelPos = 0;
 		audioReturnCode = false;
+		TapTrace_Mark(TraceStage::Open);
+
+		// Gain has to be known before the first buffer is played
+		Loudness_TrackStarted(gPlayProperties.isWebstream ? nullptr : gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), static_cast<ReplayGainMode>(SettingsRegistry_Get(SettingId::ReplayGain)));
+		AudioPlayer_ApplyReplayGain(false);
 
 		if (gPlayProperties.playMode == WEBSTREAM || (gPlayProperties.playMode == LOCAL_M3U && gPlayProperties.isWebstream)) { // Webstream
 			audioReturnCode = audio->connecttohost(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber));
@@ -1121,7 +1858,17 @@ void AudioPlayer_Loop() {
 			} else {
 				int32_t fileStartTime = -1;
 				AudioPlayer_resumeSeekPendingSecs = 0; // default: no deferred seek for this track
-				if (gPlayProperties.startAtFilePos > 0) {
+				AudioPlayer_ResumeFilePos = 0;
+				AudioPlayer_SeekMute = false;
+				uint32_t frameSample;
+				if (gPlayProperties.startAtFilePos > 0 && SeekIndex_Lookup(gPlayProperties.playlist->at(gPlayProperties.currentTrackNumber), gPlayProperties.startAtFilePos * 1000u, &AudioPlayer_ResumeFilePos, &frameSample)) {
+					// Track is indexed: jump to the exact frame as soon as decoding has started (see below)
+					AudioPlayer_SeekStarted(micros(), true, gPlayProperties.startAtFilePos * 1000u, frameSample);
+					AudioPlayer_SeekPending = false; // latency counts from the jump on
+					AudioPlayer_SeekMute = true;
+					Log_Printf(LOGLEVEL_NOTICE, trackStartatPos, gPlayProperties.startAtFilePos);
+					gPlayProperties.startAtFilePos = 0;
+				} else if (gPlayProperties.startAtFilePos > 0) {
 					fileStartTime = gPlayProperties.startAtFilePos;
 					// Also arm a deferred seek: ESP32-audioI2S only honors this connecttoFS() start
 					// position for files whose Xing/VBR header sets m_nominal_bitrate. Headerless CBR
@@ -1137,6 +1884,7 @@ void AudioPlayer_Loop() {
 				// consider track as finished, when audio lib call was not successful
 			}
 		}
+		TapTrace_Mark(TraceStage::Opened);
 
 		if (!audioReturnCode) {
 			System_IndicateError();
@@ -1154,6 +1902,7 @@ void AudioPlayer_Loop() {
 			AudioPlayer_lastCheckpointTimestamp = millis();
 			AudioPlayer_lastCheckpointPos = 0;
 			AudioPlayer_SeekPreviewCancel(); // a preview from the previous track must never commit onto this one
+			AudioPlayer_OnTrackStarted();
 			if (gPlayProperties.currentTrackNumber) {
 				Led_Indicate(LedIndicatorType::PlaylistProgress);
 			}
@@ -1177,11 +1926,32 @@ void AudioPlayer_Loop() {
 	// consumed once per iteration, so rapid repeats were lost).
 	const int16_t seekOffset = AudioPlayer_PendingSeekSeconds.exchange(0, std::memory_order_relaxed);
 	if (seekOffset != 0) {
-		if (audio->setTimeOffset(seekOffset)) {
+		const uint32_t seekStartUs = micros();
+		const int32_t target = static_cast<int32_t>(audio->getAudioCurrentTime()) + seekOffset;
+		bool seekOk = (target >= 0) && (static_cast<uint32_t>(target) < audio->getAudioFileDuration()) && AudioPlayer_SeekIndexed(target);
+		if (!seekOk && audio->setTimeOffset(seekOffset)) {
+			AudioPlayer_SeekStarted(seekStartUs, false, 0, 0);
+			seekOk = true;
+		}
+		if (seekOk) {
 			Log_Printf(LOGLEVEL_NOTICE, (seekOffset > 0) ? secondsJumpForward : secondsJumpBackward, abs(seekOffset));
 		}
 	}
 
+	// Resume via seek-index: the lib knows where the audio-data starts once it has decoded the first frame
+	if (AudioPlayer_ResumeFilePos && AudioPlayer_TrackFramesOut > 0) {
+		const uint32_t filePos = AudioPlayer_ResumeFilePos;
+		AudioPlayer_ResumeFilePos = 0;
+		if (!audio->setFilePos(filePos)) {
+			Log_Println("Resume: seek via index failed", LOGLEVEL_ERROR);
+			AudioPlayer_SeekIndexedPending = false;
+			AudioPlayer_SeekMute = false;
+		} else {
+			AudioPlayer_SeekStartUs = micros();
+			AudioPlayer_SeekPending = true;
+		}
+	}
+
 	// Seek-preview (CMD_SEEK_PREVIEW rotary gesture): commit once the encoder has been idle for the
 	// configured delay. A release-triggered commit happens directly from RotaryEncoder.cpp instead of
 	// waiting for this -- this is only the "held but stopped turning" case.
@@ -1194,8 +1964,14 @@ void AudioPlayer_Loop() {
 	// Handle seekmodes
 	if (gPlayProperties.seekmode != SEEK_NORMAL) {
 		if ((gPlayProperties.seekmode == SEEK_POS_PERCENT) && (gPlayProperties.currentRelPos > 0) && (gPlayProperties.currentRelPos < 100)) {
+			const uint32_t seekStartUs = micros();
 			uint32_t newFileTime = uint32_t((gPlayProperties.currentRelPos / 100.0f) * audio->getAudioFileDuration());
-			if (audio->setAudioPlayTime(newFileTime)) {
+			bool seekOk = AudioPlayer_SeekIndexed(newFileTime);
+			if (!seekOk && audio->setAudioPlayTime(newFileTime)) {
+				AudioPlayer_SeekStarted(seekStartUs, false, 0, 0);
+				seekOk = true;
+			}
+			if (seekOk) {
 				Log_Printf(LOGLEVEL_NOTICE, JumpToPosition, newFileTime, audio->getAudioFileDuration());
 			} else {
 				System_IndicateError();
@@ -1204,50 +1980,35 @@ void AudioPlayer_Loop() {
 		gPlayProperties.seekmode = SEEK_NORMAL;
 	}
 
-	// Handle IP-announcement
-	if (gPlayProperties.tellMode == TTS_IP_ADDRESS) {
+	// Handle announcements: from the voice-prompt pack if available, online-speech otherwise
+	if (gPlayProperties.tellMode != TTS_NONE) {
+		const uint8_t tellMode = gPlayProperties.tellMode;
 		gPlayProperties.tellMode = TTS_NONE;
-		String ipText = Wlan_GetIpAddress();
 		bool speechOk;
-		// make IP as text (replace thousand separator with locale text)
-		switch (LANGUAGE) {
-			case DE:
-				ipText.replace(".", "Punkt");
-				speechOk = audio->connecttospeech(ipText.c_str(), "de");
-				break;
-			case FR:
-				ipText.replace(".", "point");
-				speechOk = audio->connecttospeech(ipText.c_str(), "fr");
-				break;
-			default:
-				ipText.replace(".", "point");
-				speechOk = audio->connecttospeech(ipText.c_str(), "en");
+		if (AudioPlayer_ComposeAnnouncement(tellMode)) {
+			// Offline-prompts: mixed into the running track or, if there's nothing to mix into, played as file
+			if (audio->isRunning()) {
+				speechOk = AudioPlayer_AnnouncementMixed = Announcement_Start();
+			} else {
+				speechOk = Announcement_WriteWav(announcementFile) && audio->connecttoFS(gFSystem, announcementFile);
+			}
+		} else {
+			speechOk = AudioPlayer_SpeakAnnouncement(tellMode);
 		}
 		if (!speechOk) {
+			gPlayProperties.currentSpeechActive = false;
 			System_IndicateError();
 		}
 	}
-
-	// Handle time-announcement
-	if (gPlayProperties.tellMode == TTS_CURRENT_TIME) {
-		gPlayProperties.tellMode = TTS_NONE;
-		struct tm timeinfo;
-		getLocalTime(&timeinfo);
-		static char timeStringBuff[64];
-		bool speechOk;
-#if (LANGUAGE == DE)
-		snprintf(timeStringBuff, sizeof(timeStringBuff), "Es ist %02d:%02d Uhr", timeinfo.tm_hour, timeinfo.tm_min);
-		speechOk = audio->connecttospeech(timeStringBuff, "de");
-#else
-		if (timeinfo.tm_hour > 12) {
-			snprintf(timeStringBuff, sizeof(timeStringBuff), "It is %02d:%02d PM", timeinfo.tm_hour - 12, timeinfo.tm_min);
-		} else {
-			snprintf(timeStringBuff, sizeof(timeStringBuff), "It is %02d:%02d AM", timeinfo.tm_hour, timeinfo.tm_min);
+	if (AudioPlayer_AnnouncementMixed) {
+		if (!audio->isRunning()) {
+			Announcement_Cancel(); // paused or stopped: the mixer isn't called anymore
 		}
-		speechOk = audio->connecttospeech(timeStringBuff, "en");
-#endif
-		if (!speechOk) {
-			System_IndicateError();
+		if (!Announcement_IsActive()) {
+			// track kept playing, so there's nothing to resume
+			AudioPlayer_AnnouncementMixed = false;
+			gPlayProperties.currentSpeechActive = false;
+			gPlayProperties.lastSpeechActive = false;
 		}
 	}
 
@@ -1255,7 +2016,7 @@ void AudioPlayer_Loop() {
 	if (!gPlayProperties.currentSpeechActive && gPlayProperties.lastSpeechActive) {
 		gPlayProperties.lastSpeechActive = false;
 		if (gPlayProperties.playMode != NO_PLAYLIST) {
-			xQueueSend(gRfidCardQueue, gPlayProperties.playRfidTag, 0); // Re-inject previous RFID-ID in order to continue playback
+			CommandBus_PostRfidCard(gPlayProperties.playRfidTag, CommandSource::System); // Re-inject previous RFID-ID in order to continue playback
 		}
 	}
 
@@ -1268,7 +2029,6 @@ void AudioPlayer_Loop() {
 		} else {
 			Log_Println(newPlayModeStereo, LOGLEVEL_NOTICE);
 		}
-		audio->setTone(gPlayProperties.gainLowPass, gPlayProperties.gainBandPass, gPlayProperties.gainHighPass);
 	}
 
 	audio->loop(); // Call audio-loop function to process incoming data
@@ -1348,7 +2108,7 @@ void AudioPlayer_SetVolume(const int32_t _newVolume) {
 		AudioPlayer_SetCurrentVolume(_volume);
 
 		Log_Printf(LOGLEVEL_INFO, newLoudnessReceived, _volume);
-		audio->setVolume(_volume);
+		AudioPlayer_PushCommand(AudioCommandType::Volume, _volume);
 		Web_SendWebsocketData(0, WebsocketCodeType::Volume);
 #ifdef MQTT_ENABLE
 		publishMqtt(topicLoudness, static_cast<uint32_t>(_volume), false);
@@ -1359,24 +2119,29 @@ void AudioPlayer_SetVolume(const int32_t _newVolume) {
 
 // Adds equalizer settings low, band and high pass and readjusts the equalizer
 void AudioPlayer_SetEqualizer(const int8_t gainLowPass, const int8_t gainBandPass, const int8_t gainHighPass) {
-	audio->setTone(gainLowPass, gainBandPass, gainHighPass);
+	Equalizer_SetTone(gainLowPass, gainBandPass, gainHighPass);
+}
+
+// True while a playlist is generated and not yet picked up by the audio-task
+bool AudioPlayer_IsPlaylistBusy(void) {
+	return AudioPlayer_PlaylistBusy;
 }
 
 // Pauses playback if playback is active and volume is changes from minVolume+1 to minVolume (usually 0)
 void AudioPlayer_PauseOnMinVolume(const uint8_t oldVolume, const uint8_t newVolume) {
 	if (gPlayProperties.pauseOnMinVolume) {
-		if (gPlayProperties.playMode == BUSY || gPlayProperties.playMode == NO_PLAYLIST) {
+		if (AudioPlayer_PlaylistBusy || gPlayProperties.playMode == NO_PLAYLIST) {
 			return;
 		}
 
 		if (!gPlayProperties.pausePlay) { // Volume changes from 1 to 0
 			if (oldVolume == AudioPlayer_GetMinVolume() + 1 && newVolume == AudioPlayer_GetMinVolume()) {
-				Cmd_Action(CMD_PLAYPAUSE);
+				CommandBus_PostAction(CMD_PLAYPAUSE, CommandSource::System);
 			}
 		}
 		if (gPlayProperties.pausePlay) { // Volume changes from 0 to 1
 			if (oldVolume == AudioPlayer_GetMinVolume() && newVolume > AudioPlayer_GetMinVolume()) {
-				Cmd_Action(CMD_PLAYPAUSE);
+				CommandBus_PostAction(CMD_PLAYPAUSE, CommandSource::System);
 			}
 		}
 	}
@@ -1385,20 +2150,27 @@ void AudioPlayer_PauseOnMinVolume(const uint8_t oldVolume, const uint8_t newVolu
 // Receives de-serialized RFID-data (from NVS) and dispatches playlists for the given
 // playmode to the track-queue.
 void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPos, const uint32_t _playMode, const uint16_t _trackLastPlayed) {
+	TapTrace_Mark(TraceStage::Playlist);
 	// Make sure last playposition for audiobook is saved when new RFID-tag is applied
 	if (gPlayProperties.SavePlayPosRfidChange && !gPlayProperties.pausePlay && (gPlayProperties.playMode == AUDIOBOOK || gPlayProperties.playMode == AUDIOBOOK_LOOP || gPlayProperties.playMode == AUDIOBOOK_RECURSIVE)) {
 		AudioPlayer_SetTrackControl(PAUSEPLAY);
-		while (!gPlayProperties.pausePlay) { // Make sure to wait until playback is paused in order to be sure that playposition saved in NVS
-			AudioPlayer_Loop();
-			vTaskDelay(portTICK_PERIOD_MS * 100u);
+		// Wait for the audio-task to set PAUSE (because this saves the current playpos), but not forever (e.g. the task is stuck in a stalled stream)
+		for (uint8_t i = 0; i < 50u && !gPlayProperties.pausePlay; i++) {
+			vTaskDelay(portTICK_PERIOD_MS * 10u);
+		}
+		if (!gPlayProperties.pausePlay) {
+			Log_Println("Audio-task didn't pause in time, play-position of the previous card might not be saved", LOGLEVEL_ERROR);
 		}
+		AudioPlayer_WritePlayPositions();
 	}
 
-	gPlayProperties.startAtFilePos = _lastPlayPos;
-	gPlayProperties.currentTrackNumber = _trackLastPlayed;
+	audioPlaylistStart_t start = {};
+	start.startAtFilePos = _lastPlayPos;
+	start.trackNumber = _trackLastPlayed;
 	std::optional<Playlist *> musicFiles;
 	String folderPath = _itemToPlay;
 
+	HEAP_PROFILER_SCOPE("playlist");
 	if (_playMode != WEBSTREAM) {
 		if (_playMode == RANDOM_SUBDIRECTORY_OF_DIRECTORY || _playMode == RANDOM_SUBDIRECTORY_OF_DIRECTORY_ALL_TRACKS_OF_DIR_RANDOM) {
 			folderPath = SdCard_pickRandomSubdirectory(_itemToPlay);
@@ -1430,32 +2202,20 @@ void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPo
 		return;
 	}
 
-	gPlayProperties.playMode = BUSY; // Show @Neopixel, if uC is busy with creating playlist
+	AudioPlayer_PlaylistBusy = true; // Show @Neopixel, if uC is busy with creating playlist
 	Playlist *list = musicFiles.value();
 	if (!list->size()) {
 		Log_Println(noMp3FilesInDir, LOGLEVEL_NOTICE);
 		System_IndicateError();
-		if (!gPlayProperties.pausePlay) {
+		if (gPlayProperties.playMode != NO_PLAYLIST) {
 			AudioPlayer_SetTrackControl(STOP);
-			while (!gPlayProperties.pausePlay) {
-				AudioPlayer_Loop();
-				vTaskDelay(portTICK_PERIOD_MS * 10u);
-			}
 		}
 
-		gPlayProperties.playMode = NO_PLAYLIST;
+		AudioPlayer_PlaylistBusy = false;
 		freePlaylist(list);
 		return;
 	}
 
-	// Set some default-values
-	gPlayProperties.repeatCurrentTrack = false;
-	gPlayProperties.repeatPlaylist = false;
-	gPlayProperties.sleepAfterCurrentTrack = false;
-	gPlayProperties.sleepAfterPlaylist = false;
-	gPlayProperties.saveLastPlayPosition = false;
-	gPlayProperties.playUntilTrackNumber = 0;
-
 	// Store last RFID-tag to NVS
 	gPrefsSettings.putString("lastRfid", gCurrentRfidTagId);
 
@@ -1468,15 +2228,15 @@ void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPo
 		}
 
 		case SINGLE_TRACK_LOOP: {
-			gPlayProperties.repeatCurrentTrack = true;
-			gPlayProperties.repeatPlaylist = true;
+			start.repeatCurrentTrack = true;
+			start.repeatPlaylist = true;
 			Log_Println(modeSingleTrackLoop, LOGLEVEL_NOTICE);
 			break;
 		}
 
 		case SINGLE_TRACK_OF_DIR_RANDOM: {
-			gPlayProperties.sleepAfterCurrentTrack = true;
-			gPlayProperties.playUntilTrackNumber = 0;
+			start.sleepAfterCurrentTrack = true;
+			start.playUntilTrackNumber = 0;
 			Led_SetNightmode(true);
 			Log_Println(modeSingleTrackRandom, LOGLEVEL_NOTICE);
 			AudioPlayer_RandomizePlaylist(list);
@@ -1490,22 +2250,22 @@ void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPo
 		}
 
 		case AUDIOBOOK: { // Tracks need to be sorted!
-			gPlayProperties.saveLastPlayPosition = true;
+			start.saveLastPlayPosition = true;
 			Log_Println(modeSingleAudiobook, LOGLEVEL_NOTICE);
 			AudioPlayer_SortPlaylist(list);
 			break;
 		}
 
 		case AUDIOBOOK_LOOP: { // Tracks need to be sorted!
-			gPlayProperties.repeatPlaylist = true;
-			gPlayProperties.saveLastPlayPosition = true;
+			start.repeatPlaylist = true;
+			start.saveLastPlayPosition = true;
 			Log_Println(modeSingleAudiobookLoop, LOGLEVEL_NOTICE);
 			AudioPlayer_SortPlaylist(list);
 			break;
 		}
 
 		case AUDIOBOOK_RECURSIVE: { // Tracks need to be sorted!
-			gPlayProperties.saveLastPlayPosition = true;
+			start.saveLastPlayPosition = true;
 			Log_Println(modeAudiobookRecursive, LOGLEVEL_NOTICE);
 			AudioPlayer_SortPlaylist(list);
 			break;
@@ -1538,14 +2298,14 @@ void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPo
 		}
 
 		case ALL_TRACKS_OF_DIR_SORTED_LOOP: {
-			gPlayProperties.repeatPlaylist = true;
+			start.repeatPlaylist = true;
 			Log_Println(modeAllTrackAlphSortedLoop, LOGLEVEL_NOTICE);
 			AudioPlayer_SortPlaylist(list);
 			break;
 		}
 
 		case ALL_TRACKS_OF_DIR_RANDOM_LOOP: {
-			gPlayProperties.repeatPlaylist = true;
+			start.repeatPlaylist = true;
 			Log_Println(modeAllTrackRandomLoop, LOGLEVEL_NOTICE);
 			AudioPlayer_RandomizePlaylist(list);
 			break;
@@ -1568,26 +2328,75 @@ void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPo
 		}
 
 		default:
-			Log_Printf(LOGLEVEL_ERROR, modeInvalid, gPlayProperties.playMode);
+			Log_Printf(LOGLEVEL_ERROR, modeInvalid, _playMode);
 			error = true;
 	}
 
 	if (!error) {
-		gPlayProperties.playMode = _playMode;
-		newPlayListAvailable = true;
-		newPlayList = list;
-		return;
+		start.playlist = list;
+		start.playMode = _playMode;
+		strncpy(start.rfidTag, gCurrentRfidTagId, sizeof(start.rfidTag) - 1);
+		TapTrace_Mark(TraceStage::PlaylistReady);
+		if (AudioPlayer_PushCommand(AudioCommandType::NewPlaylist, 0, &start)) {
+			return;
+		}
+		error = true;
 	}
 
 	// we had an error, blink and destroy playlist
-	gPlayProperties.playMode = NO_PLAYLIST;
+	AudioPlayer_PlaylistBusy = false;
 	System_IndicateError();
 	freePlaylist(list);
 }
 
+// Saves the play-position of a card from the audio-task: queued for loop() (see AudioPlayer_WritePlayPositions())
+void AudioPlayer_SavePlayPosition(const char *_rfidCardId, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed) {
+	playPosWrite_t entry;
+	strncpy(entry.rfidTag, _rfidCardId, sizeof(entry.rfidTag) - 1);
+	entry.rfidTag[sizeof(entry.rfidTag) - 1] = '\0';
+	entry.playPosition = _playPosition;
+	entry.trackLastPlayed = _trackLastPlayed;
+	entry.playMode = _playMode;
+	if (xQueueSend(AudioPlayer_PlayPosWriteQueue, &entry, 0) != pdTRUE) {
+		Log_Printf(LOGLEVEL_ERROR, "Audio-task: play-position of %s not saved, queue is full", entry.rfidTag);
+		return;
+	}
+	Scheduler_Signal(LoopHandler::AudioPlayer);
+}
+
+// Writes the play-positions queued by the audio-task into NVS (loop-task)
+void AudioPlayer_WritePlayPositions(void) {
+	playPosWrite_t entry;
+	while (AudioPlayer_PlayPosWriteQueue && xQueueReceive(AudioPlayer_PlayPosWriteQueue, &entry, 0) == pdTRUE) {
+		AudioPlayer_NvsRfidWriteWrapper(entry.rfidTag, entry.playPosition, entry.playMode, entry.trackLastPlayed);
+	}
+}
+
 /* Wraps putString for writing settings into NVS for RFID-cards.
    Returns number of characters written. */
 size_t AudioPlayer_NvsRfidWriteWrapper(const char *_rfidCardId, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed) {
+	// A pending journal-checkpoint of another card has to reach NVS first; one of the same card is superseded by this write
+	PlayPosJournalEntry pending;
+	if (PlayPosJournal_GetPending(&pending) && strncmp(pending.rfidTag, _rfidCardId, cardIdStringSize) != 0) {
+		AudioPlayer_NvsRfidWrite(pending.rfidTag, pending.playPosition, pending.playMode, pending.trackLastPlayed);
+	}
+	const size_t written = AudioPlayer_NvsRfidWrite(_rfidCardId, _playPosition, _playMode, _trackLastPlayed);
+	PlayPosJournal_MarkCompacted();
+	return written;
+}
+
+// Writes the newest checkpoint of the play-position journal into NVS (if there's one pending)
+void AudioPlayer_CompactPlayPosJournal(void) {
+	PlayPosJournalEntry pending;
+	if (!PlayPosJournal_GetPending(&pending)) {
+		return;
+	}
+	Log_Printf(LOGLEVEL_INFO, playPosJournalCompacted, pending.rfidTag, pending.trackLastPlayed, pending.playPosition);
+	AudioPlayer_NvsRfidWrite(pending.rfidTag, pending.playPosition, pending.playMode, pending.trackLastPlayed);
+	PlayPosJournal_MarkCompacted();
+}
+
+size_t AudioPlayer_NvsRfidWrite(const char *_rfidCardId, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed) {
 	if (_playMode == NO_PLAYLIST) {
 		// writing back to NVS with NO_PLAYLIST seems to be a bug - Todo: Find the cause here
 		Log_Printf(LOGLEVEL_ERROR, modeInvalid, _playMode);
@@ -1643,7 +2452,12 @@ std::optional<Playlist *> AudioPlayer_ReturnPlaylistFromWebstream(const char *_w
 
 // Adds new control-command to control-queue
 void AudioPlayer_SetTrackControl(const uint8_t new_trackCommand) {
-	trackCommand = new_trackCommand;
+	AudioPlayer_PushCommand(AudioCommandType::TrackControl, new_trackCommand);
+}
+
+// Jumps to a relative position (0..100%) of the current track
+void AudioPlayer_SeekToPercent(const uint8_t percent) {
+	AudioPlayer_PushCommand(AudioCommandType::SeekPercent, percent);
 }
 
 // Knuth-Fisher-Yates-algorithm to randomize playlist
@@ -1787,15 +2601,100 @@ void audio_oggimage(File &file, std::vector<uint32_t> v) {
 }
 
 // record audiodata or send via BT
+constexpr size_t resamplerBlockFrames = 512u; // output-frames per resampler-run
+
+// Called for every buffer of the audio-lib: measures the gap at track-transitions and applies the crossfade
+static void AudioPlayer_ProcessTransition(int32_t *buff, const int16_t frames, const uint32_t sampleRate) {
+	const uint32_t nowUs = micros();
+	if (AudioPlayer_TransitionPending.exchange(false)) {
+		// first buffer after EOF: time since the previous buffer has been played out
+		const int32_t gapUs = static_cast<int32_t>(nowUs - AudioPlayer_LastOutputUs - AudioPlayer_LastOutputDurationUs);
+		if (gapUs < static_cast<int32_t>(trackGapMaxUs)) {
+			AudioPlayer_TransitionGapLastUs = std::max<int32_t>(gapUs, 0);
+			AudioPlayer_TransitionGapMaxUs = std::max(AudioPlayer_TransitionGapMaxUs, AudioPlayer_TransitionGapLastUs);
+			AudioPlayer_TransitionGapAvgUs = AudioPlayer_TransitionCount ? AudioPlayer_TransitionGapAvgUs + (static_cast<int32_t>(AudioPlayer_TransitionGapLastUs) - static_cast<int32_t>(AudioPlayer_TransitionGapAvgUs)) / 8 : AudioPlayer_TransitionGapLastUs;
+			AudioPlayer_TransitionCount++;
+		}
+	}
+	AudioPlayer_LastOutputUs = nowUs;
+	AudioPlayer_LastOutputDurationUs = sampleRate ? static_cast<uint64_t>(frames) * 1000000u / sampleRate : 0;
+	const uint32_t framesOut = AudioPlayer_TrackFramesOut.fetch_add(frames) + frames;
+
+	int32_t target = trackFadeUnityQ15;
+	if (sampleRate && SettingsRegistry_Get(SettingId::TrackTransition) == static_cast<uint8_t>(TrackTransition::Crossfade)) {
+		const uint32_t fadeFrames = TrackFade_GetFrames(SettingsRegistry_Get(SettingId::CrossfadeMs), sampleRate);
+		if (AudioPlayer_FadeInPending && framesOut >= fadeFrames) {
+			AudioPlayer_FadeInPending = false;
+		}
+		// fade out only if there's a next track to fade to
+		target = TrackFade_GetGain(framesOut, AudioPlayer_TrackFrames, fadeFrames, AudioPlayer_PreparedTrackNumber >= 0, AudioPlayer_FadeInPending);
+	}
+	if (target == trackFadeUnityQ15 && AudioPlayer_FadeGainQ15 == trackFadeUnityQ15) {
+		return;
+	}
+	TrackFade_Apply(buff, frames, AudioPlayer_FadeGainQ15, target);
+	AudioPlayer_FadeGainQ15 = target;
+}
+
+// Called for every buffer of the audio-lib: seek-latency ends with the first buffer after a seek. After an indexed
+// seek the output-counter continues at the decoded-sample position of the frame, the error is the distance of the
+// target to where the output continues.
+static void AudioPlayer_ProcessSeek(int32_t *buff, const int16_t frames, const uint32_t sampleRate) {
+	if (AudioPlayer_SeekPending.exchange(false)) {
+		if (AudioPlayer_SeekIndexedPending.exchange(false) && sampleRate) {
+			AudioPlayer_TrackFramesOut = AudioPlayer_SeekFrameSample;
+			const int64_t errorUs = static_cast<int64_t>(AudioPlayer_SeekTargetMs) * 1000 - static_cast<int64_t>(AudioPlayer_SeekFrameSample) * 1000000 / sampleRate;
+			AudioPlayer_SeekErrorLastUs = std::min<int64_t>(std::abs(errorUs), UINT32_MAX);
+			AudioPlayer_SeekErrorMaxUs = std::max(AudioPlayer_SeekErrorMaxUs, AudioPlayer_SeekErrorLastUs);
+		}
+		AudioPlayer_SeekLatencyLastUs = micros() - AudioPlayer_SeekStartUs;
+		AudioPlayer_SeekLatencyMaxUs = std::max(AudioPlayer_SeekLatencyMaxUs, AudioPlayer_SeekLatencyLastUs);
+		AudioPlayer_SeekLatencyAvgUs = (AudioPlayer_SeekCount > 1) ? AudioPlayer_SeekLatencyAvgUs + (static_cast<int32_t>(AudioPlayer_SeekLatencyLastUs) - static_cast<int32_t>(AudioPlayer_SeekLatencyAvgUs)) / 8 : AudioPlayer_SeekLatencyLastUs;
+		AudioPlayer_SeekMute = false; // resume has jumped
+		return;
+	}
+	if (AudioPlayer_SeekMute) {
+		memset(buff, 0, frames * 2 * sizeof(int32_t));
+	}
+}
+
 void audio_process_i2s(int32_t *outBuff, int16_t validSamples, bool *continueI2S) {
+	// The lib has applied the volume up to 0 dB, a positive ReplayGain is added after measuring the loudness
+	const uint32_t gainQ15 = AudioPlayer_GetVolumeGainQ15(AudioPlayer_GetCurrentVolume());
+	const uint16_t libGainQ15 = std::min(gainQ15, volumeGainUnityQ15);
+	AudioPlayer_ProcessSeek(outBuff, validSamples, audio->getSampleRate());
+	Loudness_Analyse(outBuff, validSamples, audio->getSampleRate(), libGainQ15);
+	VolumeGain_ApplyBoost(outBuff, validSamples, gainQ15);
+	AudioPlayer_ProcessTransition(outBuff, validSamples, audio->getSampleRate());
+
+	// Overlay voice-announcements after the fade (so they stay audible), so they reach I2S and Bluetooth.
+	// The prompt gets the gain the lib has applied to outBuff (without the boost of ReplayGain).
+	Announcement_Mix(outBuff, validSamples, audio->getSampleRate(), libGainQ15);
+
+	// Equalizer last, so speaker- or headphone-correction applies to announcements as well
+	if (!Equalizer_Process(outBuff, validSamples, audio->getSampleRate()) && AudioPlayer_TaskHandle) {
+		xTaskNotifyGive(AudioPlayer_TaskHandle); // new sample-rate: the audio-task calculates the coefficients
+	}
+	TapTrace_Mark(TraceStage::Sound);
+
 	if ((System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) && Bluetooth_Device_Connected()) {
 		// do downsamling to 16bit and send via BT
+		SampleFormat_PackStereo32To16(outBuff, validSamples);
 		int16_t *outBuff16 = reinterpret_cast<int16_t *>(outBuff);
-		for (int16_t i = 0; i < validSamples * 2; i++) {
-			outBuff16[i] = outBuff16[i * 2 + 1];
-		}
 
-		Bluetooth_Source_SendAudioData(outBuff16, validSamples);
+		// A2DP needs 44.1 kHz: convert everything else with our own resampler
+		Resampler_SetInputRate(audio->getSampleRate());
+		if (!Resampler_IsActive()) {
+			Bluetooth_Source_SendAudioData(outBuff16, validSamples);
+		} else {
+			static int16_t resampled[resamplerBlockFrames * 2];
+			const size_t chunk = Resampler_GetMaxInputFrames(resamplerBlockFrames);
+			for (size_t done = 0; done < (size_t) validSamples; done += chunk) {
+				const size_t frames = std::min(chunk, validSamples - done);
+				const size_t resampledFrames = Resampler_Process(&outBuff16[done * 2], frames, resampled, resamplerBlockFrames);
+				Bluetooth_Source_SendAudioData(resampled, resampledFrames);
+			}
+		}
 		*continueI2S = false;
 		return;
 	}
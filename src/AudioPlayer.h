@@ -40,7 +40,7 @@ typedef struct { // Bit field
 	bool newPlayMono			 : 1; // true if mono; false if stereo (helper)
 	bool currentPlayMono		 : 1; // true if mono; false if stereo
 	bool isWebstream			 : 1; // Indicates if track currenty played is a webstream
-	uint8_t tellMode			 : 2; // Tell mode for text to speech announcments
+	uint8_t tellMode			 : 3; // Tell mode for text to speech announcments
 	bool currentSpeechActive	 : 1; // If speech-play is active
 	bool lastSpeechActive		 : 1; // If speech-play was active
 	bool SavePlayPosRfidChange	 : 1; // Save last play-position
@@ -49,9 +49,6 @@ typedef struct { // Bit field
 	bool dontAcceptRfidTwice	 : 1; // RFID-reader doesn't accept the same RFID-tag twice in a row (unless it's a modification-card or RFID-tag is unknown in NVS). Flag will be ignored silently if PAUSE_WHEN_RFID_REMOVED is active. (https://forum.espuino.de/t/neues-feature-dont-accept-same-rfid-twice/1247)
 	bool resumeOnSameRfid		 : 1; // If pause is active and same RFID is put on again, playback continues (only effective if dontAcceptRfidTwice is enabled)
 	int16_t jumpToFolderTrack = -1; // track to jump to
-	int8_t gainLowPass = 0; // Low Pass for EQ Control
-	int8_t gainBandPass = 0; // Band Pass for EQ Control
-	int8_t gainHighPass = 0; // High Pass for EQ Control
 	size_t coverFilePos; // current cover file position
 	size_t coverFileSize; // current cover file size
 	size_t audioFileDuration; // file duration of current audio file (in seconds)
@@ -60,6 +57,32 @@ typedef struct { // Bit field
 
 extern playProps gPlayProperties;
 
+typedef struct {
+	uint32_t loopTimeAvgUs; // time per run of the audio-task (refill + control-logic)
+	uint32_t loopTimeMaxUs;
+	uint32_t jitterAvgUs; // how late the audio-task woke up compared to its planned refill
+	uint32_t jitterMaxUs;
+	uint32_t deadlineMisses; // input-buffer ran dry while playing
+	uint32_t commandsDropped; // command-queue was full
+} audioTaskStats_t;
+
+typedef struct {
+	uint32_t count; // measured track-transitions
+	uint32_t lastGapUs; // silence between the end of a track and the start of the next one
+	uint32_t avgGapUs;
+	uint32_t maxGapUs;
+} transitionStats_t;
+
+typedef struct {
+	uint32_t count; // seeks and resumes
+	uint32_t indexed; // of them done via the seek-index
+	uint32_t lastLatencyUs; // from the request until the first buffer at the new position
+	uint32_t avgLatencyUs;
+	uint32_t maxLatencyUs;
+	uint32_t lastErrorUs; // target vs. decoded-sample position the output continues at (indexed seeks only)
+	uint32_t maxErrorUs;
+} seekStats_t;
+
 void AudioPlayer_NotifyUploadStart(void);
 void AudioPlayer_NotifyUploadEnd(void);
 
@@ -67,11 +90,15 @@ void AudioPlayer_Init(void);
 void AudioPlayer_Exit(void);
 void AudioPlayer_Cyclic(void);
 void AudioPlayer_Loop(void);
+void AudioPlayer_GetTaskStats(audioTaskStats_t *stats);
+void AudioPlayer_GetTransitionStats(transitionStats_t *stats);
+void AudioPlayer_GetSeekStats(seekStats_t *stats);
 uint8_t AudioPlayer_GetRepeatMode(void);
 void AudioPlayer_SetVolume(const int32_t _newVolume);
 void AudioPlayer_SetEqualizer(const int8_t gainLowPass, const int8_t gainBandPass, const int8_t gainHighPass);
 void AudioPlayer_SetPlaylist(const char *_itemToPlay, const uint32_t _lastPlayPos, const uint32_t _playMode, const uint16_t _trackLastPlayed);
 void AudioPlayer_SetTrackControl(const uint8_t trackCommand);
+void AudioPlayer_SeekToPercent(const uint8_t percent);
 // Queue a relative seek. Accumulates, so one call per rotary detent scrubs proportionally.
 void AudioPlayer_AddSeekOffset(const int16_t seconds);
 // Seek-preview (CMD_SEEK_PREVIEW rotary gesture): moves a not-yet-committed target position instead of
@@ -81,6 +108,7 @@ void AudioPlayer_SeekPreviewAdjust(const int32_t detents);
 void AudioPlayer_SeekPreviewCommit(void);
 void AudioPlayer_SeekPreviewCancel(void);
 bool AudioPlayer_IsSeekPreviewActive(void);
+bool AudioPlayer_IsPlaylistBusy(void);
 uint8_t AudioPlayer_GetSeekPreviewTargetPercent(void);
 // Arm the "don't accept same RFID twice"-lock to be released on the next idle-state. Called when a tag is
 // accepted, independent of whether playback actually starts, so a tag whose first track fails immediately
@@ -95,6 +123,7 @@ uint8_t AudioPlayer_GetCurrentVolume(void);
 void AudioPlayer_SetCurrentVolume(uint8_t value);
 uint8_t AudioPlayer_GetMaxVolume(void);
 void AudioPlayer_SetMaxVolume(uint8_t value);
+uint32_t AudioPlayer_GetVolumeGainQ15(uint8_t step);
 uint8_t AudioPlayer_GetMaxVolumeSpeaker(void);
 void AudioPlayer_SetMaxVolumeSpeaker(uint8_t value);
 uint8_t AudioPlayer_GetMinVolume(void);
@@ -37,6 +37,7 @@ void Battery_Init(void) {
 		// and also any blinking lights or sounds. The goal is to just stay off.
 		// Additionally, LPCD will not be enabled. This is intentional to avoid battery drain.
 		delay(200);
+		Log_Flush();
 		esp_deep_sleep_start();
 	}
 	#endif
@@ -3,9 +3,14 @@
 
 #include "Bluetooth.h"
 
+#include "CommandBus.h"
 #include "Common.h"
+#include "HeapProfiler.h"
 #include "Log.h"
+#include "Metrics.h"
+#include "Mqtt.h"
 #include "RotaryEncoder.h"
+#include "SettingsRegistry.h"
 #include "System.h"
 #include "Web.h"
 #include "esp_bt_main.h"
@@ -37,6 +42,29 @@ static constexpr uint32_t SCAN_TIMEOUT_MS = 13000u;
 static constexpr uint32_t SCAN_TIMEOUT_GUARD_MS = 2000u;
 static constexpr size_t AUDIO_SOURCE_RINGBUFFER_SIZE = 262144; // 256KB
 
+// Jitter-buffer of the A2DP-source: instead of filling the ringbuffer completely, the producer (audio-task) is
+// paced to keep a target fill-level. This level adapts to the jitter actually seen: every underrun raises it
+// by one step, a longer period without getting close to empty lowers it again by one step.
+static constexpr size_t sourceBytesPerMs = 44100u * 2u * sizeof(int16_t) / 1000u; // A2DP-source always runs 44.1kHz/16bit/stereo
+static constexpr size_t sourceTargetFillMin = 60u * sourceBytesPerMs;
+static constexpr size_t sourceTargetFillMax = 1000u * sourceBytesPerMs;
+static constexpr size_t sourceTargetFillStep = 40u * sourceBytesPerMs;
+static constexpr uint32_t sourceTargetShrinkInterval = 10000u; // ms without underrun (and a comfortable low-water mark) before shrinking
+static constexpr uint32_t sourceDemandTimeoutMs = 50u; // upper bound for the producer to wait for the consumer
+static constexpr uint32_t sourceStatsPublishInterval = 60000u;
+	#ifdef MQTT_ENABLE
+static constexpr char topicBtSourceStats[] = "bt_source_stats"; // State: JSON with jitter-buffer counters of the A2DP-source
+	#endif
+
+static std::atomic<size_t> sourceTargetFill = sourceTargetFillMin * 2;
+static std::atomic<bool> sourcePriming = true; // (re)fill up to the target before handing out audio
+static size_t sourceLowWater = SIZE_MAX; // lowest fill-level seen by the consumer in the current shrink-interval
+static uint32_t sourceLowWaterTimestamp = 0;
+static std::atomic<uint32_t> sourceUnderruns = 0;
+static std::atomic<uint32_t> sourceOverruns = 0;
+static std::atomic<uint32_t> sourcePaddedFrames = 0;
+static SemaphoreHandle_t sourceDemand = nullptr; // given by the consumer once there's room below the high-water mark
+
 BluetoothA2DPSink *a2dp_sink;
 BluetoothA2DPSource *a2dp_source;
 std::vector<ScannedBluetoothDevice> scannedDevices;
@@ -99,6 +127,39 @@ static void Bluetooth_Source_FlushRingbuffer(void) {
 	while ((item = static_cast<uint8_t *>(xRingbufferReceiveUpTo(audioSourceRingBuffer, &bytesRead, 0, SIZE_MAX))) != nullptr) {
 		vRingbufferReturnItem(audioSourceRingBuffer, item);
 	}
+	sourcePriming = true;
+}
+
+static size_t Bluetooth_Source_GetFillLevel(void) {
+	size_t bytesWaiting = 0;
+	vRingbufferGetInfo(audioSourceRingBuffer, NULL, NULL, NULL, NULL, &bytesWaiting);
+	return bytesWaiting;
+}
+
+// The producer may fill up to 1.5x the target, that leaves room for the decoder's burstiness
+static size_t Bluetooth_Source_GetHighWater(void) {
+	const size_t target = sourceTargetFill;
+	return std::min(target + target / 2, AUDIO_SOURCE_RINGBUFFER_SIZE - 4096u);
+}
+
+// Called by the consumer for every request: adapts the target fill-level
+static void Bluetooth_Source_AdaptTargetFill(const size_t fillLevel, const bool underrun) {
+	const uint32_t now = millis();
+	if (underrun) {
+		sourceTargetFill = std::min(sourceTargetFill + sourceTargetFillStep, sourceTargetFillMax);
+		sourceLowWater = SIZE_MAX;
+		sourceLowWaterTimestamp = now;
+		return;
+	}
+	sourceLowWater = std::min(sourceLowWater, fillLevel);
+	if (now - sourceLowWaterTimestamp >= sourceTargetShrinkInterval) {
+		// never got below half of the target => a smaller buffer (and less latency) will do
+		if (sourceLowWater > sourceTargetFill / 2) {
+			sourceTargetFill = std::max(sourceTargetFill - sourceTargetFillStep, sourceTargetFillMin);
+		}
+		sourceLowWater = SIZE_MAX;
+		sourceLowWaterTimestamp = now;
+	}
 }
 #endif
 
@@ -165,6 +226,7 @@ static void gap_callback_interceptor(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_
 			device.name[ESP_BT_GAP_MAX_BDNAME_LEN] = '\0';
 			memcpy(device.address, bda, ESP_BD_ADDR_LEN);
 			device.rssi = rssi;
+			HEAP_PROFILER_SCOPE("btScan");
 			scannedDevices.push_back(device);
 
 			// Actively request the remote name for devices that arrived without one
@@ -305,15 +367,15 @@ void button_handler(uint8_t id, bool isReleased) {
 			case 70:
 			case 68:
 				Log_Printf(LOGLEVEL_DEBUG, "Bluetooth button id %u (pause/resume) is released.", id);
-				AudioPlayer_SetTrackControl(PAUSEPLAY);
+				CommandBus_PostTrackControl(PAUSEPLAY, CommandSource::Bluetooth);
 				break;
 			case 75:
 				Log_Printf(LOGLEVEL_DEBUG, "Bluetooth button id %u (next track) is released.", id);
-				AudioPlayer_SetTrackControl(NEXTTRACK);
+				CommandBus_PostTrackControl(NEXTTRACK, CommandSource::Bluetooth);
 				break;
 			case 76:
 				Log_Printf(LOGLEVEL_DEBUG, "Bluetooth button id %u (previous track) is released.", id);
-				AudioPlayer_SetTrackControl(PREVIOUSTRACK);
+				CommandBus_PostTrackControl(PREVIOUSTRACK, CommandSource::Bluetooth);
 				break;
 			default:
 				Log_Printf(LOGLEVEL_DEBUG, "Unknown bluetooth button id %u is released.", id);
@@ -361,19 +423,39 @@ int32_t get_data_channels(Frame *frame, int32_t channel_len) {
 	}
 
 	const size_t bytes_per_frame = 2 * sizeof(int16_t); // ch1 + ch2, 16-bit each
+	static_assert(sizeof(Frame) == 2 * sizeof(int16_t), "Frame doesn't match the interleaved layout of the ringbuffer");
 	const size_t bytes_needed = (size_t) channel_len * bytes_per_frame;
 
 	// --- Gate on actual data available, before touching the buffer ---
 	// uxItemsWaiting is the number of bytes currently queued for a
 	// no-split ring buffer. If there isn't a full frame's worth sitting
 	// there, bail out to silence instead of blocking / partially filling.
-	size_t bytes_waiting = 0;
-	vRingbufferGetInfo(audioSourceRingBuffer, NULL, NULL, NULL, NULL, &bytes_waiting);
+	// While (re)priming the jitter-buffer, silence is sent until the target level is reached.
+	const size_t bytes_waiting = Bluetooth_Source_GetFillLevel();
+
+	if (sourcePriming) {
+		if (bytes_waiting < sourceTargetFill) {
+			memset(frame, 0, channel_len * sizeof(Frame));
+			sourcePaddedFrames += channel_len;
+			xSemaphoreGive(sourceDemand);
+			return channel_len;
+		}
+		sourcePriming = false;
+	}
 
 	if (bytes_waiting < bytes_needed) {
 		memset(frame, 0, channel_len * sizeof(Frame));
+		if (!gPlayProperties.pausePlay && !gPlayProperties.playlistFinished) {
+			// ran dry while playing (not because playback was paused/stopped)
+			sourceUnderruns++;
+			Bluetooth_Source_AdaptTargetFill(bytes_waiting, true);
+			sourcePriming = true;
+		}
+		sourcePaddedFrames += channel_len;
+		xSemaphoreGive(sourceDemand);
 		return channel_len;
 	}
+	Bluetooth_Source_AdaptTargetFill(bytes_waiting - bytes_needed, false);
 
 	// --- Pull the data, handling one possible wrap-around ---
 	// A no-split buffer returns at most the contiguous run up to the
@@ -395,13 +477,9 @@ int32_t get_data_channels(Frame *frame, int32_t channel_len) {
 			break; // shouldn't happen given the pre-check, but stay safe
 		}
 
+		// ringbuffer holds interleaved ch1/ch2 just like Frame => copy in one go
 		int32_t chunk_samples = sampleSize / bytes_per_frame;
-		int16_t *raw_samples = (int16_t *) sampleBuff;
-
-		for (int32_t i = 0; i < chunk_samples; ++i) {
-			frame[samples_received + i].channel1 = raw_samples[i * 2];
-			frame[samples_received + i].channel2 = raw_samples[i * 2 + 1];
-		}
+		memcpy(&frame[samples_received], sampleBuff, chunk_samples * bytes_per_frame);
 
 		samples_received += chunk_samples;
 		vRingbufferReturnItem(audioSourceRingBuffer, (void *) sampleBuff);
@@ -414,8 +492,13 @@ int32_t get_data_channels(Frame *frame, int32_t channel_len) {
 
 	if (samples_received < channel_len) {
 		memset(&frame[samples_received], 0, (channel_len - samples_received) * sizeof(Frame));
+		sourcePaddedFrames += channel_len - samples_received;
 	}
 
+	// wake up the producer once there's room again
+	if (Bluetooth_Source_GetFillLevel() < Bluetooth_Source_GetHighWater()) {
+		xSemaphoreGive(sourceDemand);
+	}
 	return channel_len;
 }
 #endif
@@ -469,7 +552,7 @@ void Bluetooth_VolumeChanged(int _newVolume) {
 	uint8_t _volume = mapRounded(_newVolume, BLUETOOTH_A2DP_VOLUME_MIN, BLUETOOTH_A2DP_VOLUME_MAX, AUDIOPLAYER_VOLUME_MIN, AUDIOPLAYER_VOLUME_MAX);
 	if (AudioPlayer_GetCurrentVolume() != _volume) {
 		Log_Printf(LOGLEVEL_INFO, "Bluetooth => volume changed:  %d !", _volume);
-		AudioPlayer_SetVolume(_volume);
+		CommandBus_PostVolume(_volume, CommandSource::Bluetooth);
 	}
 #endif
 }
@@ -644,6 +727,9 @@ std::vector<ScannedBluetoothDevice> Bluetooth_GetScannedDevices() {
 void Bluetooth_Init(void) {
 #ifdef BLUETOOTH_ENABLE
 	bluetoothSourceConnected = false;
+	Metrics_Register("bt_source_underruns_total", MetricType::Counter, "Jitter-buffer of the A2DP-source ran dry while playing", &sourceUnderruns);
+	Metrics_Register("bt_source_overruns_total", MetricType::Counter, "Jitter-buffer of the A2DP-source was full", &sourceOverruns);
+	Metrics_Register("bt_source_padded_frames_total", MetricType::Counter, "Frames of the A2DP-source filled up with silence", &sourcePaddedFrames);
 	if (System_GetOperationMode() == OPMODE_BLUETOOTH_SINK) {
 		a2dp_sink = new BluetoothA2DPSink();
 	#if (defined(ESP_ARDUINO_VERSION_MAJOR) && (ESP_ARDUINO_VERSION_MAJOR >= 3))
@@ -668,7 +754,7 @@ void Bluetooth_Init(void) {
 	#endif
 		a2dp_sink->set_rssi_callback(rssi);
 		a2dp_sink->activate_pin_code(false);
-		if (gPrefsSettings.getBool("playMono", false)) {
+		if (SettingsRegistry_GetBool(SettingId::PlayMono)) {
 			a2dp_sink->set_mono_downmix(true);
 		}
 		a2dp_sink->set_auto_reconnect(true);
@@ -810,6 +896,18 @@ void Bluetooth_Cyclic(void) {
 		if (a2dp_source->get_audio_state() == ESP_A2D_AUDIO_STATE_STARTED) {
 			System_UpdateActivityTimer();
 		}
+	#ifdef MQTT_ENABLE
+		static uint32_t lastStatsPublishTimestamp = 0;
+		if (bluetoothSourceConnected && (millis() - lastStatsPublishTimestamp >= sourceStatsPublishInterval)) {
+			lastStatsPublishTimestamp = millis();
+			bluetoothSourceStats_t stats;
+			Bluetooth_Source_GetStats(&stats);
+			char payload[128];
+			snprintf(payload, sizeof(payload), "{\"underruns\":%" PRIu32 ",\"overruns\":%" PRIu32 ",\"paddedFrames\":%" PRIu32 ",\"fillMs\":%" PRIu32 ",\"targetMs\":%" PRIu32 "}",
+				stats.underruns, stats.overruns, stats.paddedFrames, stats.fillMs, stats.targetMs);
+			publishMqtt(topicBtSourceStats, payload, false);
+		}
+	#endif
 		if (scanInProgress) {
 			uint32_t elapsed = millis() - scanStartTimestamp;
 			if (elapsed > SCAN_TIMEOUT_MS + SCAN_TIMEOUT_GUARD_MS) {
@@ -876,10 +974,25 @@ uint8_t Bluetooth_GetCurrentVolume() {
 	return 0;
 }
 
+// Counters of the A2DP-source jitter-buffer (since boot)
+void Bluetooth_Source_GetStats(bluetoothSourceStats_t *stats) {
+	memset(stats, 0, sizeof(bluetoothSourceStats_t));
+#ifdef BLUETOOTH_ENABLE
+	stats->underruns = sourceUnderruns;
+	stats->overruns = sourceOverruns;
+	stats->paddedFrames = sourcePaddedFrames;
+	stats->targetMs = sourceTargetFill / sourceBytesPerMs;
+	stats->fillMs = audioSourceRingBuffer ? Bluetooth_Source_GetFillLevel() / sourceBytesPerMs : 0;
+#endif
+}
+
 bool Bluetooth_Source_SendAudioData(int16_t *outBuff, int16_t validSamples) {
 #ifdef BLUETOOTH_ENABLE
 	if ((System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) && (a2dp_source) && bluetoothSourceConnected && (validSamples > 0)) {
 		if (audioSourceRingBuffer == nullptr) {
+			if (sourceDemand == nullptr) {
+				sourceDemand = xSemaphoreCreateBinary(); // has to exist before the consumer sees the ringbuffer
+			}
 			StaticRingbuffer_t *bufferStruct = (StaticRingbuffer_t *) heap_caps_malloc(sizeof(StaticRingbuffer_t), MALLOC_CAP_SPIRAM);
 			uint8_t *bufferStorage = (uint8_t *) heap_caps_malloc(AUDIO_SOURCE_RINGBUFFER_SIZE, MALLOC_CAP_SPIRAM);
 
@@ -893,8 +1006,16 @@ bool Bluetooth_Source_SendAudioData(int16_t *outBuff, int16_t validSamples) {
 			}
 		}
 
-		const TickType_t sendTimeout = pdMS_TO_TICKS(50); // Reduced timeout for non-blocking feel
-		return (pdTRUE == xRingbufferSend(audioSourceRingBuffer, outBuff, validSamples * 2 * sizeof(int16_t), sendTimeout));
+		// Pacing: above the high-water mark wait until the consumer took data (instead of blocking for a fixed time)
+		const size_t bytes = validSamples * 2 * sizeof(int16_t);
+		if (Bluetooth_Source_GetFillLevel() + bytes > Bluetooth_Source_GetHighWater()) {
+			xSemaphoreTake(sourceDemand, pdMS_TO_TICKS(sourceDemandTimeoutMs));
+		}
+		if (pdTRUE != xRingbufferSend(audioSourceRingBuffer, outBuff, bytes, 0)) {
+			sourceOverruns++;
+			return false;
+		}
+		return true;
 	} else {
 		return false;
 	}
@@ -30,7 +30,16 @@ void Bluetooth_PreviousTrack(void);
 void Bluetooth_SetVolume(const int32_t _newVolume);
 uint8_t Bluetooth_GetCurrentVolume();
 
+typedef struct {
+	uint32_t underruns; // consumer ran dry while playing
+	uint32_t overruns; // producer couldn't get rid of its data
+	uint32_t paddedFrames; // frames filled up with silence (underruns + priming)
+	uint32_t fillMs; // current fill-level of the jitter-buffer
+	uint32_t targetMs; // current target fill-level
+} bluetoothSourceStats_t;
+
 bool Bluetooth_Source_SendAudioData(int16_t *outBuff, int16_t validSamples);
+void Bluetooth_Source_GetStats(bluetoothSourceStats_t *stats);
 bool Bluetooth_Device_Connected();
 
 #ifdef BLUETOOTH_ENABLE
@@ -3,13 +3,12 @@
 
 #include "Button.h"
 
-#include "Cmd.h"
+#include "CommandBus.h"
 #include "Log.h"
 #include "Port.h"
+#include "Scheduler.h"
 #include "System.h"
 
-#include <atomic>
-
 bool gButtonInitComplete = false;
 
 // Only enable those buttons that are not disabled (99 or >115)
@@ -51,18 +50,11 @@ EXT_RAM_BSS_ATTR t_button gButtons[7]; // next + prev + pplay + rotEnc + button4
 uint8_t gShutdownButton = 99; // Helper used for Neopixel: stores button-number of shutdown-button
 uint16_t gLongPressTime = 0;
 
-#ifdef PORT_EXPANDER_ENABLE
-extern bool Port_AllowReadFromPortExpander;
-#endif
-
-static std::atomic<SemaphoreHandle_t> Button_TimerSemaphore;
+// Buttons are read when a pin changes (interrupt) and polled only while one is held or still pending
+// (long-press, volume-repeat, debouncing)
+constexpr uint32_t buttonPollIntervalMs = 10u;
 
-hw_timer_t *Button_Timer = NULL;
-#if (defined(ESP_ARDUINO_VERSION_MAJOR) && (ESP_ARDUINO_VERSION_MAJOR < 3))
-static void IRAM_ATTR onTimer();
-#else
-static void onTimer();
-#endif
+static void IRAM_ATTR Button_PinISR(void);
 static void Button_DoButtonActions(void);
 
 void Button_Init() {
@@ -132,17 +124,24 @@ void Button_Init() {
 	}
 #endif
 
-	// Create 1000Hz-HW-Timer (currently only used for buttons)
-	Button_TimerSemaphore = xSemaphoreCreateBinary();
-#if (defined(ESP_ARDUINO_VERSION_MAJOR) && (ESP_ARDUINO_VERSION_MAJOR >= 3))
-	Button_Timer = timerBegin(1000000); // Prescaler: CPU-clock in MHz
-	timerAttachInterrupt(Button_Timer, &onTimer);
-	timerAlarm(Button_Timer, 10000, true, 0); // 100 Hz
-#else
-	Button_Timer = timerBegin(0, 240, true); // Prescaler: CPU-clock in MHz
-	timerAttachInterrupt(Button_Timer, &onTimer, true);
-	timerAlarmWrite(Button_Timer, 10000, true); // 100 Hz
-	timerAlarmEnable(Button_Timer);
+	// Every edge of a button wakes the main-loop (buttons at the port-expander via its interrupt-pin)
+#ifdef BUTTON_0_ENABLE
+	attachInterrupt(digitalPinToInterrupt(NEXT_BUTTON), Button_PinISR, CHANGE);
+#endif
+#ifdef BUTTON_1_ENABLE
+	attachInterrupt(digitalPinToInterrupt(PREVIOUS_BUTTON), Button_PinISR, CHANGE);
+#endif
+#ifdef BUTTON_2_ENABLE
+	attachInterrupt(digitalPinToInterrupt(PAUSEPLAY_BUTTON), Button_PinISR, CHANGE);
+#endif
+#ifdef BUTTON_3_ENABLE
+	attachInterrupt(digitalPinToInterrupt(ROTARYENCODER_BUTTON), Button_PinISR, CHANGE);
+#endif
+#ifdef BUTTON_4_ENABLE
+	attachInterrupt(digitalPinToInterrupt(BUTTON_4), Button_PinISR, CHANGE);
+#endif
+#ifdef BUTTON_5_ENABLE
+	attachInterrupt(digitalPinToInterrupt(BUTTON_5), Button_PinISR, CHANGE);
 #endif
 }
 
@@ -190,12 +189,18 @@ static void Button_UpdateState(t_button &btn, unsigned long currentTimestamp) {
 	btn.lastState = btn.currentState;
 }
 
-// If timer-semaphore is set, read buttons (unless controls are locked)
-void Button_Cyclic() {
-	if (xSemaphoreTake(Button_TimerSemaphore, 0) != pdTRUE) {
-		return;
+// True while the action of a pressed button isn't done yet (long-press, volume-repeat, release of a modifier)
+static bool Button_IsBusy(void) {
+	for (uint8_t i = 0; i < sizeof(gButtons) / sizeof(gButtons[0]); i++) {
+		if (gButtons[i].isPressed) {
+			return true;
+		}
 	}
+	return false;
+}
 
+// Read buttons when a pin changed or while one is busy (unless controls are locked)
+void Button_Cyclic() {
 	unsigned long currentTimestamp = millis();
 
 #ifdef PORT_EXPANDER_ENABLE
@@ -203,17 +208,25 @@ void Button_Cyclic() {
 #endif
 
 	if (System_AreControlsLocked()) {
+		Scheduler_SetPeriod(LoopHandler::Button, Port_NeedsPolling() ? buttonPollIntervalMs : 0u);
 		return;
 	}
 
 	Button_ReadAllStates();
 
+	bool stateChanged = false;
 	for (uint8_t i = 0; i < sizeof(gButtons) / sizeof(gButtons[0]); i++) {
+		stateChanged |= (gButtons[i].currentState != gButtons[i].lastState);
 		Button_UpdateState(gButtons[i], currentTimestamp);
 	}
+	if (stateChanged) {
+		Scheduler_Signal(LoopHandler::RotaryEncoder); // a held modifier might have changed
+	}
 
 	gButtonInitComplete = true;
 	Button_DoButtonActions();
+
+	Scheduler_SetPeriod(LoopHandler::Button, (Button_IsBusy() || Port_NeedsPolling()) ? buttonPollIntervalMs : 0u);
 }
 
 // Multi-button combination configuration: {btn1, btn2, prefsKey, defaultCmd}
@@ -249,7 +262,7 @@ static bool Button_HandleMultiButtonPress(void) {
 		if (gButtons[combo.btn1].isPressed && gButtons[combo.btn2].isPressed) {
 			gButtons[combo.btn1].isPressed = false;
 			gButtons[combo.btn2].isPressed = false;
-			Cmd_Action(gPrefsSettings.getUChar(combo.prefsKey, combo.defaultCmd));
+			CommandBus_PostAction(gPrefsSettings.getUChar(combo.prefsKey, combo.defaultCmd), CommandSource::Button);
 			return true;
 		}
 	}
@@ -303,11 +316,11 @@ static void Button_HandleSinglePress(uint8_t i, unsigned long currentTimestamp)
 		bool const wasShortPress = releaseDuration < intervalToLongPress;
 
 		if (wasShortPress) {
-			Cmd_Action(Cmd_Short);
+			CommandBus_PostAction(Cmd_Short, CommandSource::Button);
 		} else if (Cmd_Long == CMD_SLEEPMODE || isRotaryModifier) {
 			// Sleep-mode only triggers on release to prevent immediate wake-up; modifier buttons defer for
 			// the reason above.
-			Cmd_Action(Cmd_Long);
+			CommandBus_PostAction(Cmd_Long, CommandSource::Button);
 		}
 
 		gButtons[i].isPressed = false;
@@ -325,7 +338,7 @@ static void Button_HandleSinglePress(uint8_t i, unsigned long currentTimestamp)
 		}
 		uint16_t remainder = pressDuration % intervalToLongPress;
 		if (remainder < gLongPressTime) {
-			Cmd_Action(Cmd_Long);
+			CommandBus_PostAction(Cmd_Long, CommandSource::Button);
 		}
 		gLongPressTime = remainder;
 		return;
@@ -334,7 +347,7 @@ static void Button_HandleSinglePress(uint8_t i, unsigned long currentTimestamp)
 	// Handle other long-press actions (except sleep mode which triggers on release)
 	if (Cmd_Long != CMD_SLEEPMODE && pressDuration > intervalToLongPress) {
 		gButtons[i].isPressed = false;
-		Cmd_Action(Cmd_Long);
+		CommandBus_PostAction(Cmd_Long, CommandSource::Button);
 	}
 }
 
@@ -451,10 +464,6 @@ void Button_DoButtonActions(void) {
 	}
 }
 
-#if (defined(ESP_ARDUINO_VERSION_MAJOR) && (ESP_ARDUINO_VERSION_MAJOR < 3))
-void IRAM_ATTR onTimer() {
-#else
-void onTimer() {
-#endif
-	xSemaphoreGiveFromISR(Button_TimerSemaphore, NULL);
+void IRAM_ATTR Button_PinISR(void) {
+	Scheduler_SignalFromISR(LoopHandler::Button);
 }
@@ -6,11 +6,11 @@
 #include "AudioPlayer.h"
 #include "Battery.h"
 #include "Bluetooth.h"
+#include "CommandBus.h"
 #include "Ftp.h"
 #include "Led.h"
 #include "Log.h"
 #include "Mqtt.h"
-#include "Queues.h"
 #include "System.h"
 #include "Wlan.h"
 
@@ -32,6 +32,15 @@ static void Cmd_HandleSleepAction(bool enable, const char *enLogMsg, const char
 	}
 }
 
+// Changes the volume of the active output (speaker/headphone or the Bluetooth-sink) by the given number of steps
+void Cmd_ChangeVolume(const int32_t steps) {
+	if ((OPMODE_NORMAL == System_GetOperationMode()) || (OPMODE_BLUETOOTH_SOURCE == System_GetOperationMode())) {
+		AudioPlayer_SetVolume(AudioPlayer_GetCurrentVolume() + steps);
+	} else {
+		Bluetooth_SetVolume(Bluetooth_GetCurrentVolume() + steps);
+	}
+}
+
 void Cmd_Action(const uint16_t mod) {
 	switch (mod) {
 		case CMD_LOCK_BUTTONS_MOD: { // Locks/unlocks all buttons
@@ -281,6 +290,24 @@ void Cmd_Action(const uint16_t mod) {
 			break;
 		}
 
+		case CMD_TELL_BATTERY_LEVEL: {
+#ifdef BATTERY_MEASURE_ENABLE
+			gPlayProperties.tellMode = TTS_BATTERY_LEVEL;
+			gPlayProperties.currentSpeechActive = true;
+			gPlayProperties.lastSpeechActive = true;
+			System_IndicateOk();
+#endif
+			break;
+		}
+
+		case CMD_TELL_SLEEP_TIMER: {
+			gPlayProperties.tellMode = TTS_SLEEP_TIMER;
+			gPlayProperties.currentSpeechActive = true;
+			gPlayProperties.lastSpeechActive = true;
+			System_IndicateOk();
+			break;
+		}
+
 		case CMD_PLAYPAUSE: {
 			if ((OPMODE_NORMAL == System_GetOperationMode()) || (OPMODE_BLUETOOTH_SOURCE == System_GetOperationMode())) {
 				AudioPlayer_SetTrackControl(PAUSEPLAY);
@@ -334,20 +361,12 @@ void Cmd_Action(const uint16_t mod) {
 		}
 
 		case CMD_VOLUMEUP: {
-			if ((OPMODE_NORMAL == System_GetOperationMode()) || (OPMODE_BLUETOOTH_SOURCE == System_GetOperationMode())) {
-				AudioPlayer_SetVolume(AudioPlayer_GetCurrentVolume() + 1);
-			} else {
-				Bluetooth_SetVolume(Bluetooth_GetCurrentVolume() + 1);
-			}
+			Cmd_ChangeVolume(1);
 			break;
 		}
 
 		case CMD_VOLUMEDOWN: {
-			if ((OPMODE_NORMAL == System_GetOperationMode()) || (OPMODE_BLUETOOTH_SOURCE == System_GetOperationMode())) {
-				AudioPlayer_SetVolume(AudioPlayer_GetCurrentVolume() - 1);
-			} else {
-				Bluetooth_SetVolume(Bluetooth_GetCurrentVolume() - 1);
-			}
+			Cmd_ChangeVolume(-1);
 			break;
 		}
 
@@ -409,52 +428,52 @@ void Cmd_Action(const uint16_t mod) {
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_01: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_01, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_01, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_02: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_02, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_02, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_03: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_03, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_03, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_04: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_04, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_04, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_05: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_05, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_05, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_06: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_06, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_06, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_07: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_07, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_07, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_08: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_08, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_08, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_09: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_09, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_09, CommandSource::System);
 			break;
 		}
 
 		case CMD_VIRTUAL_RFID_CARD_10: {
-			xQueueSend(gRfidCardQueue, VIRTUAL_RFID_CARD_10, 0);
+			CommandBus_PostRfidCard(VIRTUAL_RFID_CARD_10, CommandSource::System);
 			break;
 		}
 
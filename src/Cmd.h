@@ -1,3 +1,4 @@
 #pragma once
 
 void Cmd_Action(const uint16_t mod);
+void Cmd_ChangeVolume(const int32_t steps);
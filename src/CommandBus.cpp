@@ -0,0 +1,318 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "CommandBus.h"
+
+#include "AudioPlayer.h"
+#include "Cmd.h"
+#include "Log.h"
+#include "Rfid.h"
+#include "Scheduler.h"
+#include "TapTrace.h"
+#include "values.h"
+
+#include <algorithm>
+#include <atomic>
+
+constexpr uint32_t commandBusQueueSize = 16u; // per priority; has to be a power of 2
+constexpr uint8_t commandBusMaxPerPass = 8u; // further commands are dispatched with the next pass of the main-loop
+constexpr uint8_t commandBusPriorities = static_cast<uint8_t>(CommandPriority::Count);
+constexpr uint8_t commandBusSources = static_cast<uint8_t>(CommandSource::Count);
+
+constexpr const char *commandBusPriorityNames[] = {"high", "normal", "low"};
+constexpr const char *commandBusSourceNames[] = {"rfid", "button", "rotaryEncoder", "irReceiver", "web", "mqtt", "bluetooth", "system"};
+static_assert(sizeof(commandBusPriorityNames) / sizeof(commandBusPriorityNames[0]) == commandBusPriorities, "a name per priority");
+static_assert(sizeof(commandBusSourceNames) / sizeof(commandBusSourceNames[0]) == commandBusSources, "a name per source");
+
+enum class CommandType : uint8_t {
+	Action = 0, // Cmd_Action()
+	TrackControl, // AudioPlayer_SetTrackControl()
+	RfidCard // Rfid_PreferenceLookupHandler()
+};
+
+typedef struct {
+	CommandType type;
+	CommandSource source;
+	uint16_t value;
+	uint32_t timestampUs; // time of posting
+	char cardId[cardIdStringSize];
+} command_t;
+
+// Bounded MPSC-queue with a sequence-number per slot (same scheme as the command-queue of the audio-task)
+typedef struct {
+	struct {
+		std::atomic<uint32_t> seq;
+		command_t command;
+	} slots[commandBusQueueSize];
+	std::atomic<uint32_t> enqueuePos;
+	std::atomic<uint32_t> dequeuePos; // only written by the consumer
+} commandQueue_t;
+
+typedef struct {
+	std::atomic<uint32_t> posted;
+	std::atomic<uint32_t> dropped; // queue was full
+	std::atomic<uint32_t> coalesced; // merged into a pending command
+	std::atomic<uint32_t> highWater; // max. commands waiting
+	uint32_t dispatched; // the rest is only written by the consumer
+	uint32_t latencyAvgUs; // post -> dispatch
+	uint32_t latencyMaxUs;
+} commandBusStats_t;
+
+static commandQueue_t CommandBus_Queues[commandBusPriorities];
+static commandBusStats_t CommandBus_Stats[commandBusPriorities];
+static std::atomic<uint32_t> CommandBus_PostedBySource[commandBusSources];
+
+// Coalesced volume-changes (counted as normal priority)
+static std::atomic<int32_t> CommandBus_VolumeSteps {0};
+static std::atomic<uint32_t> CommandBus_VolumeStepsUs {0};
+static std::atomic<int16_t> CommandBus_Volume {-1}; // -1: none pending
+static std::atomic<uint32_t> CommandBus_VolumeUs {0};
+
+void CommandBus_Init(void) {
+	for (commandQueue_t &queue : CommandBus_Queues) {
+		for (uint32_t i = 0; i < commandBusQueueSize; i++) {
+			queue.slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+		queue.enqueuePos.store(0, std::memory_order_relaxed);
+		queue.dequeuePos.store(0, std::memory_order_relaxed);
+	}
+}
+
+static CommandPriority CommandBus_GetPriority(const command_t &command) {
+	if (command.type == CommandType::RfidCard) {
+		return CommandPriority::High;
+	}
+	if (command.type == CommandType::TrackControl) {
+		return (command.value == STOP || command.value == PAUSEPLAY) ? CommandPriority::High : CommandPriority::Normal;
+	}
+	switch (command.value) {
+		case CMD_STOP:
+		case CMD_PLAYPAUSE:
+		case CMD_SLEEPMODE:
+			return CommandPriority::High;
+
+		case CMD_TOGGLE_WIFI_STATUS:
+		case CMD_ENABLE_FTP_SERVER:
+		case CMD_TELL_IP_ADDRESS:
+		case CMD_TELL_CURRENT_TIME:
+		case CMD_TELL_BATTERY_LEVEL:
+		case CMD_TELL_SLEEP_TIMER:
+		case CMD_MEASUREBATTERY:
+		case CMD_RESTARTSYSTEM:
+			return CommandPriority::Low;
+
+		default:
+			return CommandPriority::Normal;
+	}
+}
+
+static inline void CommandBus_UpdateHighWater(std::atomic<uint32_t> &highWater, const uint32_t waiting) {
+	uint32_t current = highWater.load(std::memory_order_relaxed);
+	while (waiting > current && !highWater.compare_exchange_weak(current, waiting, std::memory_order_relaxed)) {
+	}
+}
+
+static bool CommandBus_Push(command_t command) {
+	const uint8_t priority = static_cast<uint8_t>(CommandBus_GetPriority(command));
+	commandQueue_t &queue = CommandBus_Queues[priority];
+	commandBusStats_t &stats = CommandBus_Stats[priority];
+	command.timestampUs = micros();
+
+	uint32_t pos = queue.enqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		auto &slot = queue.slots[pos & (commandBusQueueSize - 1)];
+		const int32_t diff = static_cast<int32_t>(slot.seq.load(std::memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (queue.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.command = command;
+				slot.seq.store(pos + 1, std::memory_order_release);
+				break;
+			}
+		} else if (diff < 0) {
+			stats.dropped++;
+			Log_Printf(LOGLEVEL_ERROR, "CommandBus: %s-queue is full, command from %s dropped", commandBusPriorityNames[priority], commandBusSourceNames[static_cast<uint8_t>(command.source)]);
+			return false;
+		} else {
+			pos = queue.enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+	stats.posted++;
+	CommandBus_PostedBySource[static_cast<uint8_t>(command.source)]++;
+	// the consumer's position isn't synchronized, so this is an upper bound
+	const uint32_t waiting = std::min(pos + 1 - queue.dequeuePos.load(std::memory_order_relaxed), commandBusQueueSize);
+	CommandBus_UpdateHighWater(stats.highWater, waiting);
+	Scheduler_Signal(LoopHandler::CommandBus);
+	return true;
+}
+
+static bool CommandBus_Pop(commandQueue_t &queue, command_t *command) {
+	const uint32_t pos = queue.dequeuePos.load(std::memory_order_relaxed);
+	auto &slot = queue.slots[pos & (commandBusQueueSize - 1)];
+	if (static_cast<int32_t>(slot.seq.load(std::memory_order_acquire) - (pos + 1)) < 0) {
+		return false; // empty
+	}
+	*command = slot.command;
+	slot.seq.store(pos + commandBusQueueSize, std::memory_order_release);
+	queue.dequeuePos.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+bool CommandBus_PostAction(const uint16_t cmd, const CommandSource source) {
+	// Volume-steps from several sources (or a fast rotary-encoder) are merged into one change
+	if (cmd == CMD_VOLUMEUP || cmd == CMD_VOLUMEDOWN) {
+		CommandBus_PostVolumeStep((cmd == CMD_VOLUMEUP) ? 1 : -1, source);
+		return true;
+	}
+	command_t command = {};
+	command.type = CommandType::Action;
+	command.source = source;
+	command.value = cmd;
+	return CommandBus_Push(command);
+}
+
+bool CommandBus_PostTrackControl(const uint8_t trackCommand, const CommandSource source) {
+	command_t command = {};
+	command.type = CommandType::TrackControl;
+	command.source = source;
+	command.value = trackCommand;
+	return CommandBus_Push(command);
+}
+
+bool CommandBus_PostRfidCard(const char *cardId, const CommandSource source) {
+	command_t command = {};
+	command.type = CommandType::RfidCard;
+	command.source = source;
+	strncpy(command.cardId, cardId, cardIdStringSize - 1);
+	TapTrace_CardPosted(command.cardId);
+	return CommandBus_Push(command);
+}
+
+void CommandBus_PostVolumeStep(const int32_t steps, const CommandSource source) {
+	if (!steps) {
+		return;
+	}
+	commandBusStats_t &stats = CommandBus_Stats[static_cast<uint8_t>(CommandPriority::Normal)];
+	if (CommandBus_VolumeSteps.fetch_add(steps, std::memory_order_acq_rel)) {
+		stats.coalesced++;
+	} else {
+		CommandBus_VolumeStepsUs.store(micros(), std::memory_order_relaxed);
+	}
+	stats.posted++;
+	CommandBus_PostedBySource[static_cast<uint8_t>(source)]++;
+	Scheduler_Signal(LoopHandler::CommandBus);
+}
+
+void CommandBus_PostVolume(const uint8_t volume, const CommandSource source) {
+	commandBusStats_t &stats = CommandBus_Stats[static_cast<uint8_t>(CommandPriority::Normal)];
+	// Steps posted before are older than the absolute volume and would be applied on top of it
+	if (CommandBus_VolumeSteps.exchange(0, std::memory_order_acq_rel)) {
+		stats.coalesced++;
+	}
+	CommandBus_VolumeUs.store(micros(), std::memory_order_relaxed);
+	if (CommandBus_Volume.exchange(volume, std::memory_order_acq_rel) >= 0) {
+		stats.coalesced++;
+	}
+	stats.posted++;
+	CommandBus_PostedBySource[static_cast<uint8_t>(source)]++;
+	Scheduler_Signal(LoopHandler::CommandBus);
+}
+
+static void CommandBus_RecordLatency(const CommandPriority priority, const uint32_t timestampUs) {
+	commandBusStats_t &stats = CommandBus_Stats[static_cast<uint8_t>(priority)];
+	const uint32_t latencyUs = micros() - timestampUs;
+	stats.latencyAvgUs = stats.dispatched ? stats.latencyAvgUs + (static_cast<int32_t>(latencyUs) - static_cast<int32_t>(stats.latencyAvgUs)) / 16 : latencyUs;
+	stats.latencyMaxUs = std::max(stats.latencyMaxUs, latencyUs);
+	stats.dispatched++;
+}
+
+static void CommandBus_Dispatch(const command_t &command) {
+	switch (command.type) {
+		case CommandType::Action:
+			Cmd_Action(command.value);
+			break;
+		case CommandType::TrackControl:
+			AudioPlayer_SetTrackControl(command.value);
+			break;
+		case CommandType::RfidCard:
+			Rfid_PreferenceLookupHandler(command.cardId);
+			break;
+	}
+}
+
+// Applies pending volume-changes; an absolute volume first, so steps posted after it are relative to it
+static bool CommandBus_DispatchVolume(void) {
+	bool dispatched = false;
+	const int16_t volume = CommandBus_Volume.exchange(-1, std::memory_order_acq_rel);
+	if (volume >= 0) {
+		CommandBus_RecordLatency(CommandPriority::Normal, CommandBus_VolumeUs.load(std::memory_order_relaxed));
+		AudioPlayer_SetVolume(volume);
+		dispatched = true;
+	}
+	const uint32_t stepsUs = CommandBus_VolumeStepsUs.load(std::memory_order_relaxed);
+	const int32_t steps = CommandBus_VolumeSteps.exchange(0, std::memory_order_acq_rel);
+	if (steps) {
+		CommandBus_RecordLatency(CommandPriority::Normal, stepsUs);
+		Cmd_ChangeVolume(steps);
+		dispatched = true;
+	}
+	return dispatched;
+}
+
+static uint8_t CommandBus_DispatchQueue(const CommandPriority priority, const uint8_t budget, command_t &lastCard) {
+	commandQueue_t &queue = CommandBus_Queues[static_cast<uint8_t>(priority)];
+	uint8_t handled = 0;
+	command_t command;
+	while (handled < budget && CommandBus_Pop(queue, &command)) {
+		CommandBus_RecordLatency(priority, command.timestampUs);
+		handled++;
+		// The same card again (e.g. from the reader and via MQTT) within one pass is only looked up once
+		if (command.type == CommandType::RfidCard) {
+			if (lastCard.type == CommandType::RfidCard && !strncmp(lastCard.cardId, command.cardId, cardIdStringSize)) {
+				CommandBus_Stats[static_cast<uint8_t>(priority)].coalesced++;
+				continue;
+			}
+			lastCard = command;
+		}
+		CommandBus_Dispatch(command);
+	}
+	return handled;
+}
+
+// Consumer: runs in the main-loop (signalled by every post). High priority first, then the coalesced
+// volume-changes, normal and low priority.
+void CommandBus_Cyclic(void) {
+	command_t lastCard = {};
+	lastCard.type = CommandType::Action;
+	uint8_t handled = CommandBus_DispatchQueue(CommandPriority::High, commandBusMaxPerPass, lastCard);
+	if (handled < commandBusMaxPerPass && CommandBus_DispatchVolume()) {
+		handled++;
+	}
+	for (const CommandPriority priority : {CommandPriority::Normal, CommandPriority::Low}) {
+		if (handled < commandBusMaxPerPass) {
+			handled += CommandBus_DispatchQueue(priority, commandBusMaxPerPass - handled, lastCard);
+		}
+	}
+	if (handled >= commandBusMaxPerPass) {
+		// Budget of this pass is used up: let the other handlers run and continue with the next pass
+		Scheduler_Signal(LoopHandler::CommandBus);
+	}
+}
+
+void CommandBus_ToJSON(JsonObject obj) {
+	JsonObject prioritiesObj = obj["priorities"].to<JsonObject>();
+	for (uint8_t i = 0; i < commandBusPriorities; i++) {
+		const commandBusStats_t &stats = CommandBus_Stats[i];
+		JsonObject priorityObj = prioritiesObj[commandBusPriorityNames[i]].to<JsonObject>();
+		priorityObj["posted"] = stats.posted.load(std::memory_order_relaxed);
+		priorityObj["dispatched"] = stats.dispatched;
+		priorityObj["dropped"] = stats.dropped.load(std::memory_order_relaxed);
+		priorityObj["coalesced"] = stats.coalesced.load(std::memory_order_relaxed);
+		priorityObj["highWater"] = stats.highWater.load(std::memory_order_relaxed);
+		priorityObj["avgLatencyUs"] = stats.latencyAvgUs;
+		priorityObj["maxLatencyUs"] = stats.latencyMaxUs;
+	}
+	JsonObject sourcesObj = obj["sources"].to<JsonObject>();
+	for (uint8_t i = 0; i < commandBusSources; i++) {
+		sourcesObj[commandBusSourceNames[i]] = CommandBus_PostedBySource[i].load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+
+// Command-bus: every input-source (RFID-readers, buttons, rotary-encoder, IR, web, MQTT, Bluetooth-AVRC, ...) posts its
+// commands here instead of calling Cmd_Action() from its own task. Producers never block: there's a bounded lock-free
+// MPSC-queue per priority and the main-loop (the only consumer) dispatches them, high priority first. Volume-changes
+// aren't queued but coalesced (steps are summed up, an absolute volume replaces the previous one and the steps before it).
+
+enum class CommandSource : uint8_t {
+	Rfid = 0,
+	Button,
+	RotaryEncoder,
+	IrReceiver,
+	Web,
+	Mqtt,
+	Bluetooth,
+	System,
+	Count
+};
+
+enum class CommandPriority : uint8_t {
+	High = 0, // RFID-cards, stop, play/pause, sleep
+	Normal,
+	Low, // announcements and maintenance (WiFi, FTP, battery, restart)
+	Count
+};
+
+void CommandBus_Init(void);
+bool CommandBus_PostAction(const uint16_t cmd, const CommandSource source);
+bool CommandBus_PostTrackControl(const uint8_t trackCommand, const CommandSource source);
+bool CommandBus_PostRfidCard(const char *cardId, const CommandSource source);
+void CommandBus_PostVolumeStep(const int32_t steps, const CommandSource source);
+void CommandBus_PostVolume(const uint8_t volume, const CommandSource source);
+void CommandBus_Cyclic(void);
+void CommandBus_ToJSON(JsonObject obj);
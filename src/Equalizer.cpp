@@ -0,0 +1,412 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Equalizer.h"
+
+#include "Log.h"
+#include "System.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+constexpr uint8_t equalizerToneBands = 3u;
+constexpr uint8_t equalizerMaxStages = equalizerToneBands + equalizerMaxBands;
+constexpr uint16_t equalizerMinFreqHz = 20u;
+constexpr uint16_t equalizerMaxFreqHz = 20000u;
+constexpr float equalizerMaxFreqRatio = 0.45f; // of the sample-rate
+constexpr uint16_t equalizerMinQ100 = 10u;
+constexpr uint16_t equalizerMaxQ100 = 1000u;
+constexpr uint8_t equalizerResponsePoints = 96u; // to find the maximum boost of the cascade
+constexpr const char *equalizerNvsKeys[] = {"eqSpeaker", "eqHeadphone"};
+
+// Tone-control of the webinterface, same frequencies as the audio-lib used
+constexpr equalizerBand_t equalizerToneTemplate[equalizerToneBands] = {
+	{500u, 0, 71u, EqualizerBandType::LowShelf, 0u},
+	{3000u, 0, 71u, EqualizerBandType::Peak, 0u},
+	{6000u, 0, 71u, EqualizerBandType::HighShelf, 0u}};
+
+static_assert(sizeof(equalizerBand_t) == 8, "layout of the NVS-blob");
+
+// Coefficients of a biquad: b0..b2 and the negated a1, a2 with (31 - shift) fractional bits. The shift is chosen per
+// biquad, so the sum of |coefficients| fits and the 64 bit accumulator can't overflow.
+typedef struct {
+	int32_t b0, b1, b2, a1, a2;
+	uint8_t shift;
+} equalizerStage_t;
+
+typedef struct {
+	uint32_t sampleRate;
+	uint32_t generation;
+	uint8_t stages;
+	EqualizerProfile profile;
+	float preampDb;
+	int32_t preampQ31; // linear, also applied while the sample-rate doesn't match
+	equalizerStage_t stage[equalizerMaxStages];
+} equalizerCoeffs_t;
+
+// Direct form I: history of in- and output per channel
+typedef struct {
+	int32_t x1, x2, y1, y2;
+	int32_t fraction; // error-feedback
+} equalizerState_t;
+
+// Configuration (written by the webserver, read by the audio-task)
+static portMUX_TYPE Equalizer_ConfigMux = portMUX_INITIALIZER_UNLOCKED;
+static equalizerBand_t Equalizer_Tone[equalizerToneBands];
+static equalizerBand_t Equalizer_Bands[2][equalizerMaxBands];
+static uint8_t Equalizer_BandCount[2] = {0u, 0u};
+static std::atomic<bool> Equalizer_ConfigChanged {true};
+
+// Coefficients: built into the inactive set by the audio-task, then switched over (like the volume gain-table).
+// The audio-lib's task tells which set it uses, so the inactive one isn't written while a buffer is still filtered with it.
+static equalizerCoeffs_t Equalizer_Coeffs[2];
+static std::atomic<uint8_t> Equalizer_CoeffsActive {0u};
+static std::atomic<bool> Equalizer_Processing {false};
+static std::atomic<uint32_t> Equalizer_GenerationSeen {0u};
+static uint32_t Equalizer_Rebuilds = 0u;
+
+// Filter-state (only touched by the audio-lib's task)
+static equalizerState_t Equalizer_State[equalizerMaxStages][2];
+static uint32_t Equalizer_StateGeneration = 0u;
+static uint8_t Equalizer_StateStages = 0u;
+static uint32_t Equalizer_CyclesPerFrame = 0u;
+
+static void Equalizer_ClampBand(equalizerBand_t &band) {
+	band.freqHz = std::clamp(band.freqHz, equalizerMinFreqHz, equalizerMaxFreqHz);
+	band.gainCb = std::clamp<int16_t>(band.gainCb, -equalizerMaxGainCb, equalizerMaxGainCb);
+	band.q100 = std::clamp(band.q100, equalizerMinQ100, equalizerMaxQ100);
+	if (static_cast<uint8_t>(band.type) > static_cast<uint8_t>(EqualizerBandType::HighPass)) {
+		band.type = EqualizerBandType::Peak;
+	}
+	band.reserved = 0u;
+}
+
+void Equalizer_Init(void) {
+	for (uint8_t i = 0; i < equalizerToneBands; i++) {
+		Equalizer_Tone[i] = equalizerToneTemplate[i];
+	}
+	Equalizer_SetTone(gPrefsSettings.getChar("gainLowPass", 0), gPrefsSettings.getChar("gainBandPass", 0), gPrefsSettings.getChar("gainHighPass", 0));
+
+	for (uint8_t profile = 0; profile < 2; profile++) {
+		const size_t size = gPrefsSettings.getBytesLength(equalizerNvsKeys[profile]);
+		if (!size || (size % sizeof(equalizerBand_t)) || size > sizeof(Equalizer_Bands[profile])) {
+			continue;
+		}
+		gPrefsSettings.getBytes(equalizerNvsKeys[profile], Equalizer_Bands[profile], size);
+		Equalizer_BandCount[profile] = size / sizeof(equalizerBand_t);
+		for (uint8_t i = 0; i < Equalizer_BandCount[profile]; i++) {
+			Equalizer_ClampBand(Equalizer_Bands[profile][i]);
+		}
+		Log_Printf(LOGLEVEL_INFO, "Equalizer: %u bands for %s", Equalizer_BandCount[profile], profile ? "headphone" : "speaker");
+	}
+}
+
+// Tone-control (lows, mids, highs in dB); applies to both profiles
+void Equalizer_SetTone(const int8_t gainLowDb, const int8_t gainMidDb, const int8_t gainHighDb) {
+	portENTER_CRITICAL(&Equalizer_ConfigMux);
+	Equalizer_Tone[0].gainCb = gainLowDb * 10;
+	Equalizer_Tone[1].gainCb = gainMidDb * 10;
+	Equalizer_Tone[2].gainCb = gainHighDb * 10;
+	for (equalizerBand_t &band : Equalizer_Tone) {
+		Equalizer_ClampBand(band);
+	}
+	portEXIT_CRITICAL(&Equalizer_ConfigMux);
+	Equalizer_ConfigChanged = true;
+}
+
+// Replaces the bands of a profile and stores them in NVS
+bool Equalizer_SetBands(const EqualizerProfile profile, const equalizerBand_t *bands, const uint8_t count) {
+	const uint8_t p = static_cast<uint8_t>(profile);
+	if (p > 1 || count > equalizerMaxBands) {
+		return false;
+	}
+	equalizerBand_t clamped[equalizerMaxBands];
+	for (uint8_t i = 0; i < count; i++) {
+		clamped[i] = bands[i];
+		Equalizer_ClampBand(clamped[i]);
+	}
+	portENTER_CRITICAL(&Equalizer_ConfigMux);
+	memcpy(Equalizer_Bands[p], clamped, count * sizeof(equalizerBand_t));
+	Equalizer_BandCount[p] = count;
+	portEXIT_CRITICAL(&Equalizer_ConfigMux);
+	Equalizer_ConfigChanged = true;
+
+	if (!count) {
+		return !gPrefsSettings.isKey(equalizerNvsKeys[p]) || gPrefsSettings.remove(equalizerNvsKeys[p]);
+	}
+	return gPrefsSettings.putBytes(equalizerNvsKeys[p], clamped, count * sizeof(equalizerBand_t)) == count * sizeof(equalizerBand_t);
+}
+
+// Copies the bands of a profile; returns their number
+uint8_t Equalizer_GetBands(const EqualizerProfile profile, equalizerBand_t *bands) {
+	const uint8_t p = static_cast<uint8_t>(profile);
+	if (p > 1) {
+		return 0u;
+	}
+	portENTER_CRITICAL(&Equalizer_ConfigMux);
+	const uint8_t count = Equalizer_BandCount[p];
+	memcpy(bands, Equalizer_Bands[p], count * sizeof(equalizerBand_t));
+	portEXIT_CRITICAL(&Equalizer_ConfigMux);
+	return count;
+}
+
+// Biquad of a band (RBJ audio-EQ-cookbook), normalized to a0 = 1: {b0, b1, b2, a1, a2}.
+// Returns false if the band doesn't change anything.
+static bool Equalizer_DesignBand(const equalizerBand_t &band, const uint32_t sampleRate, double *c) {
+	const double freq = std::min<double>(band.freqHz, equalizerMaxFreqRatio * sampleRate);
+	const bool isFilter = (band.type == EqualizerBandType::LowPass) || (band.type == EqualizerBandType::HighPass);
+	if ((!isFilter && !band.gainCb) || (band.type == EqualizerBandType::LowPass && freq < band.freqHz)) {
+		return false;
+	}
+	const double w0 = 2.0 * M_PI * freq / sampleRate;
+	const double cosW0 = cos(w0);
+	const double alpha = sin(w0) / (2.0 * band.q100 / 100.0);
+	const double a = pow(10.0, band.gainCb / 400.0);
+	const double sq = 2.0 * sqrt(a) * alpha;
+	double b0, b1, b2, a0, a1, a2;
+
+	switch (band.type) {
+		case EqualizerBandType::LowShelf:
+			b0 = a * ((a + 1) - (a - 1) * cosW0 + sq);
+			b1 = 2 * a * ((a - 1) - (a + 1) * cosW0);
+			b2 = a * ((a + 1) - (a - 1) * cosW0 - sq);
+			a0 = (a + 1) + (a - 1) * cosW0 + sq;
+			a1 = -2 * ((a - 1) + (a + 1) * cosW0);
+			a2 = (a + 1) + (a - 1) * cosW0 - sq;
+			break;
+		case EqualizerBandType::HighShelf:
+			b0 = a * ((a + 1) + (a - 1) * cosW0 + sq);
+			b1 = -2 * a * ((a - 1) + (a + 1) * cosW0);
+			b2 = a * ((a + 1) + (a - 1) * cosW0 - sq);
+			a0 = (a + 1) - (a - 1) * cosW0 + sq;
+			a1 = 2 * ((a - 1) - (a + 1) * cosW0);
+			a2 = (a + 1) - (a - 1) * cosW0 - sq;
+			break;
+		case EqualizerBandType::LowPass:
+			b0 = b2 = (1 - cosW0) / 2;
+			b1 = 1 - cosW0;
+			a0 = 1 + alpha;
+			a1 = -2 * cosW0;
+			a2 = 1 - alpha;
+			break;
+		case EqualizerBandType::HighPass:
+			b0 = b2 = (1 + cosW0) / 2;
+			b1 = -(1 + cosW0);
+			a0 = 1 + alpha;
+			a1 = -2 * cosW0;
+			a2 = 1 - alpha;
+			break;
+		default: // Peak
+			b0 = 1 + alpha * a;
+			b1 = -2 * cosW0;
+			b2 = 1 - alpha * a;
+			a0 = 1 + alpha / a;
+			a1 = -2 * cosW0;
+			a2 = 1 - alpha / a;
+			break;
+	}
+	c[0] = b0 / a0;
+	c[1] = b1 / a0;
+	c[2] = b2 / a0;
+	c[3] = a1 / a0;
+	c[4] = a2 / a0;
+	return true;
+}
+
+// Magnitude of the whole cascade at w (radians per sample)
+static double Equalizer_Magnitude(double (*c)[5], const uint8_t stages, const double w) {
+	const double cos1 = cos(w), sin1 = sin(w), cos2 = cos(2 * w), sin2 = sin(2 * w);
+	double magnitude = 1.0;
+	for (uint8_t s = 0; s < stages; s++) {
+		const double numRe = c[s][0] + c[s][1] * cos1 + c[s][2] * cos2;
+		const double numIm = -c[s][1] * sin1 - c[s][2] * sin2;
+		const double denRe = 1.0 + c[s][3] * cos1 + c[s][4] * cos2;
+		const double denIm = -c[s][3] * sin1 - c[s][4] * sin2;
+		magnitude *= sqrt((numRe * numRe + numIm * numIm) / (denRe * denRe + denIm * denIm));
+	}
+	return magnitude;
+}
+
+static void Equalizer_Quantize(const double *c, equalizerStage_t &stage) {
+	const double sum = fabs(c[0]) + fabs(c[1]) + fabs(c[2]) + fabs(c[3]) + fabs(c[4]);
+	const double max = std::max({fabs(c[0]), fabs(c[1]), fabs(c[2]), fabs(c[3]), fabs(c[4])});
+	uint8_t intBits = 1u;
+	while (intBits < 6u && (sum >= (double) (1u << (intBits + 1)) || max >= (double) (1u << intBits))) {
+		intBits++;
+	}
+	stage.shift = 31u - intBits;
+	const double scale = (double) (1ul << stage.shift);
+	stage.b0 = lround(c[0] * scale);
+	stage.b1 = lround(c[1] * scale);
+	stage.b2 = lround(c[2] * scale);
+	stage.a1 = lround(-c[3] * scale);
+	stage.a2 = lround(-c[4] * scale);
+}
+
+static void Equalizer_Build(const uint32_t sampleRate, const EqualizerProfile profile) {
+	equalizerBand_t bands[equalizerMaxStages];
+	portENTER_CRITICAL(&Equalizer_ConfigMux);
+	memcpy(bands, Equalizer_Tone, sizeof(Equalizer_Tone));
+	const uint8_t count = equalizerToneBands + Equalizer_BandCount[static_cast<uint8_t>(profile)];
+	memcpy(&bands[equalizerToneBands], Equalizer_Bands[static_cast<uint8_t>(profile)], Equalizer_BandCount[static_cast<uint8_t>(profile)] * sizeof(equalizerBand_t));
+	portEXIT_CRITICAL(&Equalizer_ConfigMux);
+
+	double c[equalizerMaxStages][5];
+	uint8_t stages = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		stages += Equalizer_DesignBand(bands[i], sampleRate, c[stages]);
+	}
+	uint8_t toneStages = 0;
+	for (uint8_t i = 0; i < equalizerToneBands; i++) {
+		toneStages += (bands[i].gainCb != 0);
+	}
+
+	// Boosts of the profile's bands would clip at high volume: lower the level by the maximum of the response (folded
+	// into the first biquad). The plain tone-control keeps its level, as the tone-control of the audio-lib did.
+	double maxMagnitude = 1.0;
+	for (uint8_t i = 0; stages > toneStages && i < equalizerResponsePoints; i++) {
+		const double freq = equalizerMinFreqHz * pow(equalizerMaxFreqRatio * sampleRate / equalizerMinFreqHz, (double) i / (equalizerResponsePoints - 1));
+		maxMagnitude = std::max(maxMagnitude, Equalizer_Magnitude(c, stages, 2.0 * M_PI * freq / sampleRate));
+	}
+	for (uint8_t i = 0; stages && i < 3; i++) {
+		c[0][i] /= maxMagnitude;
+	}
+
+	const uint8_t inactive = Equalizer_CoeffsActive.load() ^ 1u;
+	const uint32_t activeGeneration = Equalizer_Coeffs[inactive ^ 1u].generation;
+	while (Equalizer_Processing.load() && Equalizer_GenerationSeen.load() != activeGeneration) {
+		vTaskDelay(1); // a buffer loaded before the last switch is still filtered with the inactive set
+	}
+	equalizerCoeffs_t &coeffs = Equalizer_Coeffs[inactive];
+	for (uint8_t s = 0; s < stages; s++) {
+		Equalizer_Quantize(c[s], coeffs.stage[s]);
+	}
+	coeffs.stages = stages;
+	coeffs.sampleRate = sampleRate;
+	coeffs.profile = profile;
+	coeffs.preampDb = -20.0f * log10f(maxMagnitude);
+	coeffs.preampQ31 = lround(INT32_MAX / maxMagnitude);
+	coeffs.generation = activeGeneration + 1u;
+	Equalizer_CoeffsActive.store(inactive);
+	Equalizer_Rebuilds++;
+}
+
+// Called by the audio-task: rebuilds the coefficients if settings, profile or sample-rate have changed
+void Equalizer_Update(const uint32_t sampleRate, const EqualizerProfile profile) {
+	if (!sampleRate) {
+		return;
+	}
+	const equalizerCoeffs_t &coeffs = Equalizer_Coeffs[Equalizer_CoeffsActive.load()];
+	if (Equalizer_ConfigChanged.exchange(false) || coeffs.sampleRate != sampleRate || coeffs.profile != profile) {
+		Equalizer_Build(sampleRate, profile);
+		const equalizerCoeffs_t &built = Equalizer_Coeffs[Equalizer_CoeffsActive.load()];
+		Log_Printf(LOGLEVEL_DEBUG, "Equalizer: %u biquads for %s at %" PRIu32 " Hz, preamp %.1f dB", built.stages, (profile == EqualizerProfile::Headphone) ? "headphone" : "speaker", sampleRate, built.preampDb);
+	}
+}
+
+static inline int32_t Equalizer_Saturate(const int64_t value) {
+	return (value > INT32_MAX) ? INT32_MAX : ((value < INT32_MIN) ? INT32_MIN : static_cast<int32_t>(value));
+}
+
+// One biquad over the whole buffer, so its coefficients stay in registers. The bits shifted out are fed back with the
+// next sample (first-order error-feedback), so low biquads don't end up in limit-cycles after the music stopped.
+static void Equalizer_ProcessStage(const equalizerStage_t &stage, equalizerState_t *state, int32_t *buff, const int16_t frames) {
+	const int64_t fractionMask = (1ll << stage.shift) - 1;
+	for (uint8_t ch = 0; ch < 2; ch++) {
+		int32_t x1 = state[ch].x1, x2 = state[ch].x2, y1 = state[ch].y1, y2 = state[ch].y2;
+		int64_t fraction = state[ch].fraction;
+		int32_t *sample = &buff[ch];
+		for (int16_t i = 0; i < frames; i++, sample += 2) {
+			const int32_t x0 = *sample;
+			int64_t acc = fraction;
+			acc += (int64_t) stage.b0 * x0;
+			acc += (int64_t) stage.b1 * x1;
+			acc += (int64_t) stage.b2 * x2;
+			acc += (int64_t) stage.a1 * y1;
+			acc += (int64_t) stage.a2 * y2;
+			fraction = acc & fractionMask;
+			const int32_t y0 = Equalizer_Saturate(acc >> stage.shift);
+			x2 = x1;
+			x1 = x0;
+			y2 = y1;
+			y1 = y0;
+			*sample = y0;
+		}
+		state[ch] = {x1, x2, y1, y2, static_cast<int32_t>(fraction)};
+	}
+}
+
+// Preamp only, while the coefficients don't match the sample-rate: the level doesn't jump up until they do
+static void Equalizer_ApplyPreamp(const equalizerCoeffs_t &coeffs, int32_t *buff, const int16_t frames) {
+	if (!coeffs.stages || coeffs.preampDb >= 0.0f) {
+		return;
+	}
+	for (int16_t i = 0; i < 2 * frames; i++) {
+		buff[i] = static_cast<int32_t>((static_cast<int64_t>(buff[i]) * coeffs.preampQ31) >> 31);
+	}
+}
+
+static bool Equalizer_Filter(const equalizerCoeffs_t &coeffs, int32_t *buff, const int16_t frames, const uint32_t sampleRate) {
+	if (coeffs.generation != Equalizer_StateGeneration) {
+		// Direct form I keeps signals only, so a switch of coefficients needs no reset; just newly used biquads start from silence
+		for (uint8_t s = Equalizer_StateStages; s < coeffs.stages; s++) {
+			memset(Equalizer_State[s], 0, sizeof(Equalizer_State[s]));
+		}
+		Equalizer_StateGeneration = coeffs.generation;
+		Equalizer_StateStages = coeffs.stages;
+	}
+	if (coeffs.sampleRate != sampleRate) {
+		Equalizer_ApplyPreamp(coeffs, buff, frames);
+		return !sampleRate;
+	}
+	if (!coeffs.stages || frames <= 0) {
+		return true;
+	}
+
+	const uint32_t start = ESP.getCycleCount();
+	for (uint8_t s = 0; s < coeffs.stages; s++) {
+		Equalizer_ProcessStage(coeffs.stage[s], Equalizer_State[s], buff, frames);
+	}
+	const uint32_t cyclesPerFrame = (ESP.getCycleCount() - start) / frames;
+	Equalizer_CyclesPerFrame += (static_cast<int32_t>(cyclesPerFrame) - static_cast<int32_t>(Equalizer_CyclesPerFrame)) / 16;
+	return true;
+}
+
+// Called for every buffer of the audio-lib (interleaved stereo, Q31). Returns false if the coefficients don't match
+// the sample-rate (yet); only the preamp is applied then and the audio-task has to call Equalizer_Update().
+bool Equalizer_Process(int32_t *buff, const int16_t frames, const uint32_t sampleRate) {
+	Equalizer_Processing.store(true);
+	const equalizerCoeffs_t &coeffs = Equalizer_Coeffs[Equalizer_CoeffsActive.load()];
+	Equalizer_GenerationSeen.store(coeffs.generation);
+	const bool matching = Equalizer_Filter(coeffs, buff, frames, sampleRate);
+	Equalizer_Processing.store(false);
+	return matching;
+}
+
+void Equalizer_GetStats(equalizerStats_t *stats) {
+	const equalizerCoeffs_t &coeffs = Equalizer_Coeffs[Equalizer_CoeffsActive.load()];
+	stats->profile = coeffs.profile;
+	stats->stages = coeffs.stages;
+	stats->sampleRate = coeffs.sampleRate;
+	stats->preampDb = coeffs.preampDb;
+	stats->cyclesPerFrame = coeffs.stages ? Equalizer_CyclesPerFrame : 0u;
+	stats->rebuilds = Equalizer_Rebuilds;
+}
+
+static constexpr const char *equalizerBandTypeNames[] = {"peak", "lowShelf", "highShelf", "lowPass", "highPass"};
+
+const char *Equalizer_BandTypeToString(const EqualizerBandType type) {
+	const uint8_t t = static_cast<uint8_t>(type);
+	return (t < sizeof(equalizerBandTypeNames) / sizeof(equalizerBandTypeNames[0])) ? equalizerBandTypeNames[t] : equalizerBandTypeNames[0];
+}
+
+bool Equalizer_BandTypeFromString(const char *str, EqualizerBandType *type) {
+	for (uint8_t t = 0; str && t < sizeof(equalizerBandTypeNames) / sizeof(equalizerBandTypeNames[0]); t++) {
+		if (!strcmp(str, equalizerBandTypeNames[t])) {
+			*type = static_cast<EqualizerBandType>(t);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parametric equalizer: cascaded biquads in fixed-point (Q31 samples, 64 bit accumulator). There's a profile for the
+// speaker and one for headphones (wired or Bluetooth) with up to 8 bands each, plus the tone-control (lows, mids, highs)
+// of the webinterface. Coefficients are calculated by the audio-task whenever settings, profile or sample-rate change;
+// the audio-lib's task only runs the filters.
+
+constexpr uint8_t equalizerMaxBands = 8u;
+constexpr int16_t equalizerMaxGainCb = 120; // +-12 dB
+
+enum class EqualizerBandType : uint8_t {
+	Peak = 0,
+	LowShelf,
+	HighShelf,
+	LowPass,
+	HighPass
+};
+
+enum class EqualizerProfile : uint8_t {
+	Speaker = 0,
+	Headphone
+};
+
+// Stored as-is in NVS
+typedef struct {
+	uint16_t freqHz;
+	int16_t gainCb; // centi-bel (0.1 dB); ignored by low- and high-pass
+	uint16_t q100; // quality * 100
+	EqualizerBandType type;
+	uint8_t reserved;
+} equalizerBand_t;
+
+typedef struct {
+	EqualizerProfile profile;
+	uint8_t stages; // active biquads (flat bands are skipped)
+	uint32_t sampleRate;
+	float preampDb; // headroom for boosts
+	uint32_t cyclesPerFrame; // average (both channels)
+	uint32_t rebuilds;
+} equalizerStats_t;
+
+void Equalizer_Init(void);
+void Equalizer_SetTone(const int8_t gainLowDb, const int8_t gainMidDb, const int8_t gainHighDb);
+bool Equalizer_SetBands(const EqualizerProfile profile, const equalizerBand_t *bands, const uint8_t count);
+uint8_t Equalizer_GetBands(const EqualizerProfile profile, equalizerBand_t *bands);
+void Equalizer_Update(const uint32_t sampleRate, const EqualizerProfile profile);
+bool Equalizer_Process(int32_t *buff, const int16_t frames, const uint32_t sampleRate);
+void Equalizer_GetStats(equalizerStats_t *stats);
+const char *Equalizer_BandTypeToString(const EqualizerBandType type);
+bool Equalizer_BandTypeFromString(const char *str, EqualizerBandType *type);
@@ -6,6 +6,7 @@
 #include "Log.h"
 #include "MemX.h"
 #include "SdCard.h"
+#include "Scheduler.h"
 #include "System.h"
 #include "Wlan.h"
 
@@ -65,6 +66,7 @@ void Ftp_Exit(void) {
 void Ftp_Cyclic(void) {
 #ifdef FTP_ENABLE
 	ftpManager();
+	Scheduler_SetPeriod(LoopHandler::Ftp, (ftpEnableLastStatus && ftpEnableCurrentStatus) ? 5u : 500u); // transfers need frequent handle()-calls
 
 	if (WL_CONNECTED == WiFi.status()) {
 		if (ftpEnableLastStatus && ftpEnableCurrentStatus) {
@@ -0,0 +1,413 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "HeapProfiler.h"
+
+#ifdef HEAP_PROFILER_ENABLE
+	#include "Log.h"
+
+	#include <algorithm>
+	#include <esp_debug_helpers.h>
+	#include <esp_heap_caps.h>
+	#include <esp_private/cache_utils.h>
+
+constexpr uint8_t heapProfilerSlotBits = 11u;
+constexpr uint16_t heapProfilerSlots = 1u << heapProfilerSlotBits; // live allocations that can be tracked (12 bytes each)
+constexpr uint16_t heapProfilerMaxLoad = heapProfilerSlots / 4u * 3u; // keeps the probe-sequences short
+constexpr uint8_t heapProfilerTags = 32u;
+constexpr uint8_t heapProfilerTasks = 32u;
+constexpr uint8_t heapProfilerNameSize = 16u; // like configMAX_TASK_NAME_LEN
+constexpr uint8_t heapProfilerOtherTag = 0u; // used once all tags are taken
+constexpr uint8_t heapProfilerNoScope = 0xffu;
+constexpr uint32_t heapProfilerMaxSize = 0x00ffffffu; // size is stored in 24 bits
+constexpr uint8_t heapProfilerLifetimes = 7u;
+constexpr uint8_t heapProfilerSamples = 60u;
+constexpr uint32_t heapProfilerSampleIntervalMs = 10000u;
+constexpr uint32_t heapProfilerLogIntervalMs = 60000u;
+constexpr uint8_t heapProfilerBacktraceDepth = 12u;
+constexpr uint32_t heapProfilerInternalCaps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+constexpr uint32_t heapProfilerPsramCaps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+
+// Lifetime-buckets of freed allocations: < 1 ms, < 10 ms, ... , >= 1 min (DRAM: read by the heap-hooks)
+static DRAM_ATTR const uint32_t heapProfilerLifetimeLimitsMs[heapProfilerLifetimes - 1u] = {1u, 10u, 100u, 1000u, 10000u, 60000u};
+
+typedef struct {
+	const void *ptr; // nullptr: unused
+	uint32_t sizeTag; // size << 8 | tag
+	uint32_t timestampMs;
+} heapProfilerSlot_t;
+
+typedef struct {
+	char name[heapProfilerNameSize];
+	uint32_t liveBytes;
+	uint32_t liveCount;
+	uint32_t peakBytes;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t lifetimes[heapProfilerLifetimes];
+} heapProfilerTag_t;
+
+typedef struct {
+	TaskHandle_t task;
+	uint8_t tag; // name of the task
+	uint8_t scope; // set by HEAP_PROFILER_SCOPE()
+} heapProfilerTask_t;
+
+typedef struct {
+	uint32_t uptimeS;
+	uint32_t internalFree;
+	uint32_t internalLargest;
+	uint32_t psramFree;
+	uint32_t psramLargest;
+} heapProfilerSample_t;
+
+typedef struct {
+	uint32_t count;
+	uint32_t size;
+	uint32_t caps;
+	uint32_t timestampMs;
+	uint8_t tag;
+} heapProfilerFailed_t;
+
+// Everything the hooks touch is in internal RAM and guarded by HeapProfiler_Mux (the hooks run in the allocating task)
+static heapProfilerSlot_t HeapProfiler_Slots[heapProfilerSlots];
+static heapProfilerTag_t HeapProfiler_Tags[heapProfilerTags];
+static heapProfilerTask_t HeapProfiler_TaskTags[heapProfilerTasks];
+static uint8_t HeapProfiler_TagCount = 0u;
+static uint8_t HeapProfiler_TaskCount = 0u;
+static uint16_t HeapProfiler_Used = 0u;
+static uint32_t HeapProfiler_Untracked = 0u; // allocations while the table was full
+static heapProfilerFailed_t HeapProfiler_Failed;
+static portMUX_TYPE HeapProfiler_Mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool HeapProfiler_Active = false;
+
+// Only written by the loop-task; /debug/heap reads without locking (a torn value is fine for diagnostics)
+static heapProfilerSample_t HeapProfiler_Samples[heapProfilerSamples];
+static uint32_t HeapProfiler_SampleCount = 0u;
+static uint32_t HeapProfiler_LastSampleTimestamp = 0u;
+static uint32_t HeapProfiler_LastLogTimestamp = 0u;
+
+// No library-calls in here: the hooks are placed in IRAM like the heap itself. The FreeRTOS-functions they need
+// (tick-count, current task and its name) are in flash (CONFIG_FREERTOS_PLACE_FUNCTIONS_INTO_FLASH), so they are
+// only called while the cache is enabled.
+static IRAM_ATTR bool HeapProfiler_NameEquals(const char *a, const char *b) {
+	for (uint8_t i = 0; i < heapProfilerNameSize - 1u; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+		if (!a[i]) {
+			return true;
+		}
+	}
+	return true;
+}
+
+// Returns the tag with this name, adds it if it's new (call with HeapProfiler_Mux held)
+static IRAM_ATTR uint8_t HeapProfiler_GetTag(const char *name) {
+	for (uint8_t i = 0; i < HeapProfiler_TagCount; i++) {
+		if (HeapProfiler_NameEquals(HeapProfiler_Tags[i].name, name)) {
+			return i;
+		}
+	}
+	if (HeapProfiler_TagCount >= heapProfilerTags) {
+		return heapProfilerOtherTag;
+	}
+	heapProfilerTag_t &tag = HeapProfiler_Tags[HeapProfiler_TagCount];
+	uint8_t i = 0;
+	for (; i < heapProfilerNameSize - 1u && name[i]; i++) {
+		tag.name[i] = name[i];
+	}
+	tag.name[i] = '\0';
+	return HeapProfiler_TagCount++;
+}
+
+// Entry of the current task; a new task (or a new one with the handle of a deleted one) gets the tag of its name
+static IRAM_ATTR heapProfilerTask_t *HeapProfiler_GetTask(void) {
+	const TaskHandle_t handle = xTaskGetCurrentTaskHandle();
+	const char *name = pcTaskGetName(handle);
+	heapProfilerTask_t *task = nullptr;
+	for (uint8_t i = 0; i < HeapProfiler_TaskCount; i++) {
+		if (HeapProfiler_TaskTags[i].task == handle) {
+			task = &HeapProfiler_TaskTags[i];
+			if (HeapProfiler_NameEquals(HeapProfiler_Tags[task->tag].name, name)) {
+				return task;
+			}
+			break;
+		}
+	}
+	if (!task) {
+		if (HeapProfiler_TaskCount >= heapProfilerTasks) {
+			return nullptr;
+		}
+		task = &HeapProfiler_TaskTags[HeapProfiler_TaskCount++];
+	}
+	*task = {handle, HeapProfiler_GetTag(name), heapProfilerNoScope};
+	return task;
+}
+
+static IRAM_ATTR uint8_t HeapProfiler_GetCurrentTag(void) {
+	const heapProfilerTask_t *task = HeapProfiler_GetTask();
+	if (!task) {
+		return heapProfilerOtherTag;
+	}
+	return (task->scope != heapProfilerNoScope) ? task->scope : task->tag;
+}
+
+static IRAM_ATTR uint16_t HeapProfiler_Hash(const void *ptr) {
+	return ((static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)) >> 2) * 2654435761u) >> (32u - heapProfilerSlotBits);
+}
+
+	#ifdef CONFIG_HEAP_USE_HOOKS
+// Called by ESP-IDF after every successful allocation
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t /* caps */) {
+	if (!HeapProfiler_Active || !ptr) {
+		return;
+	}
+	if (!spi_flash_cache_enabled()) {
+		// allocation from IRAM-code during a flash-operation: not attributed, a later free doesn't find it
+		portENTER_CRITICAL_SAFE(&HeapProfiler_Mux);
+		HeapProfiler_Untracked++;
+		portEXIT_CRITICAL_SAFE(&HeapProfiler_Mux);
+		return;
+	}
+	const uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+	portENTER_CRITICAL_SAFE(&HeapProfiler_Mux);
+	const uint8_t tagId = HeapProfiler_GetCurrentTag();
+	heapProfilerTag_t &tag = HeapProfiler_Tags[tagId];
+	tag.allocs++;
+	if (HeapProfiler_Used < heapProfilerMaxLoad) {
+		const uint32_t trackedSize = (size < heapProfilerMaxSize) ? size : heapProfilerMaxSize;
+		uint16_t i = HeapProfiler_Hash(ptr);
+		while (HeapProfiler_Slots[i].ptr) {
+			i = (i + 1u) & (heapProfilerSlots - 1u);
+		}
+		HeapProfiler_Slots[i] = {ptr, (trackedSize << 8) | tagId, now};
+		HeapProfiler_Used++;
+		tag.liveBytes += trackedSize;
+		tag.liveCount++;
+		if (tag.liveBytes > tag.peakBytes) {
+			tag.peakBytes = tag.liveBytes;
+		}
+	} else {
+		HeapProfiler_Untracked++;
+	}
+	portEXIT_CRITICAL_SAFE(&HeapProfiler_Mux);
+}
+
+// Called by ESP-IDF before every free; allocations that aren't in the table (made before HeapProfiler_Init() or while
+// it was full) are ignored
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void *ptr) {
+	if (!HeapProfiler_Active || !ptr) {
+		return;
+	}
+	// the block is removed from the table in any case (its address can be reused), the lifetime needs the cache
+	const bool cacheEnabled = spi_flash_cache_enabled();
+	const uint32_t now = cacheEnabled ? xTaskGetTickCount() * portTICK_PERIOD_MS : 0u;
+	portENTER_CRITICAL_SAFE(&HeapProfiler_Mux);
+	uint16_t hole = HeapProfiler_Hash(ptr);
+	while (HeapProfiler_Slots[hole].ptr && HeapProfiler_Slots[hole].ptr != ptr) {
+		hole = (hole + 1u) & (heapProfilerSlots - 1u);
+	}
+	if (HeapProfiler_Slots[hole].ptr) {
+		const heapProfilerSlot_t &slot = HeapProfiler_Slots[hole];
+		heapProfilerTag_t &tag = HeapProfiler_Tags[slot.sizeTag & 0xffu];
+		tag.liveBytes -= slot.sizeTag >> 8;
+		tag.liveCount--;
+		tag.frees++;
+		if (cacheEnabled) {
+			const uint32_t lifetimeMs = now - slot.timestampMs;
+			uint8_t bucket = 0;
+			while (bucket < heapProfilerLifetimes - 1u && lifetimeMs >= heapProfilerLifetimeLimitsMs[bucket]) {
+				bucket++;
+			}
+			tag.lifetimes[bucket]++;
+		}
+
+		// linear probing without tombstones: move following entries back into the hole unless that's before their home
+		uint16_t next = (hole + 1u) & (heapProfilerSlots - 1u);
+		while (HeapProfiler_Slots[next].ptr) {
+			const uint16_t home = HeapProfiler_Hash(HeapProfiler_Slots[next].ptr);
+			if (((next - home) & (heapProfilerSlots - 1u)) >= ((next - hole) & (heapProfilerSlots - 1u))) {
+				HeapProfiler_Slots[hole] = HeapProfiler_Slots[next];
+				hole = next;
+			}
+			next = (next + 1u) & (heapProfilerSlots - 1u);
+		}
+		HeapProfiler_Slots[hole].ptr = nullptr;
+		HeapProfiler_Used--;
+	}
+	portEXIT_CRITICAL_SAFE(&HeapProfiler_Mux);
+}
+	#endif
+
+// Called by ESP-IDF if an allocation failed (in the allocating task): logs who wanted how much, and from where
+static void HeapProfiler_AllocFailed(size_t size, uint32_t caps, const char *functionName) {
+	portENTER_CRITICAL_SAFE(&HeapProfiler_Mux);
+	const uint8_t tag = HeapProfiler_GetCurrentTag();
+	HeapProfiler_Failed.count++;
+	HeapProfiler_Failed.size = size;
+	HeapProfiler_Failed.caps = caps;
+	HeapProfiler_Failed.timestampMs = millis();
+	HeapProfiler_Failed.tag = tag;
+	portEXIT_CRITICAL_SAFE(&HeapProfiler_Mux);
+
+	Log_Printf(LOGLEVEL_ERROR, "HeapProfiler: %s() of %u bytes (caps 0x%" PRIx32 ") failed in %s; largest free block: %u bytes internal, %u bytes PSRAM", functionName, size, caps, HeapProfiler_Tags[tag].name, heap_caps_get_largest_free_block(heapProfilerInternalCaps), heap_caps_get_largest_free_block(heapProfilerPsramCaps));
+	esp_backtrace_print(heapProfilerBacktraceDepth); // decoded by the monitor-filter esp32_exception_decoder
+}
+
+void HeapProfiler_Init(void) {
+	strcpy(HeapProfiler_Tags[heapProfilerOtherTag].name, "other");
+	HeapProfiler_TagCount = 1u;
+	heap_caps_register_failed_alloc_callback(HeapProfiler_AllocFailed);
+	#ifdef CONFIG_HEAP_USE_HOOKS
+	HeapProfiler_Active = true;
+	#else
+	Log_Println("HeapProfiler: CONFIG_HEAP_USE_HOOKS is not set, allocations are not tracked", LOGLEVEL_ERROR);
+	#endif
+}
+
+uint8_t HeapProfiler_EnterScope(const char *tag) {
+	uint8_t previous = heapProfilerNoScope;
+	portENTER_CRITICAL_SAFE(&HeapProfiler_Mux);
+	heapProfilerTask_t *task = HeapProfiler_GetTask();
+	if (task) {
+		previous = task->scope;
+		task->scope = HeapProfiler_GetTag(tag);
+	}
+	portEXIT_CRITICAL_SAFE(&HeapProfiler_Mux);
+	return previous;
+}
+
+void HeapProfiler_LeaveScope(const uint8_t previous) {
+	portENTER_CRITICAL_SAFE(&HeapProfiler_Mux);
+	heapProfilerTask_t *task = HeapProfiler_GetTask();
+	if (task) {
+		task->scope = previous;
+	}
+	portEXIT_CRITICAL_SAFE(&HeapProfiler_Mux);
+}
+
+static void HeapProfiler_GetTagStats(const uint8_t id, heapProfilerTag_t &tag) {
+	portENTER_CRITICAL(&HeapProfiler_Mux);
+	tag = HeapProfiler_Tags[id];
+	portEXIT_CRITICAL(&HeapProfiler_Mux);
+}
+
+static uint8_t HeapProfiler_Fragmentation(const uint32_t freeBytes, const uint32_t largest) {
+	return freeBytes ? 100u - (uint64_t) largest * 100u / freeBytes : 0u;
+}
+
+// One line with free memory, largest blocks and the three tags with the most live bytes
+static void HeapProfiler_LogSummary(const heapProfilerSample_t &sample) {
+	uint8_t top[3] = {heapProfilerOtherTag, heapProfilerOtherTag, heapProfilerOtherTag};
+	uint32_t topBytes[3] = {0u, 0u, 0u};
+	heapProfilerTag_t tag;
+	for (uint8_t i = 0; i < HeapProfiler_TagCount; i++) {
+		HeapProfiler_GetTagStats(i, tag);
+		for (uint8_t j = 0; j < 3u; j++) {
+			if (tag.liveBytes > topBytes[j]) {
+				std::copy_backward(top + j, top + 2, top + 3);
+				std::copy_backward(topBytes + j, topBytes + 2, topBytes + 3);
+				top[j] = i;
+				topBytes[j] = tag.liveBytes;
+				break;
+			}
+		}
+	}
+	Log_Printf(LOGLEVEL_INFO, "HeapProfiler: internal %" PRIu32 " bytes free (largest block %" PRIu32 ", %u%% fragmented), PSRAM %" PRIu32 " bytes free (largest block %" PRIu32 "); top: %s %" PRIu32 ", %s %" PRIu32 ", %s %" PRIu32 " bytes", sample.internalFree, sample.internalLargest, HeapProfiler_Fragmentation(sample.internalFree, sample.internalLargest), sample.psramFree, sample.psramLargest, HeapProfiler_Tags[top[0]].name, topBytes[0], HeapProfiler_Tags[top[1]].name, topBytes[1], HeapProfiler_Tags[top[2]].name, topBytes[2]);
+}
+
+// Samples free memory and the largest free blocks (called by System_Cyclic())
+void HeapProfiler_Cyclic(void) {
+	const uint32_t now = millis();
+	if (now - HeapProfiler_LastSampleTimestamp < heapProfilerSampleIntervalMs) {
+		return;
+	}
+	HeapProfiler_LastSampleTimestamp = now;
+	heapProfilerSample_t &sample = HeapProfiler_Samples[HeapProfiler_SampleCount % heapProfilerSamples];
+	sample.uptimeS = now / 1000u;
+	sample.internalFree = heap_caps_get_free_size(heapProfilerInternalCaps);
+	sample.internalLargest = heap_caps_get_largest_free_block(heapProfilerInternalCaps);
+	sample.psramFree = heap_caps_get_free_size(heapProfilerPsramCaps);
+	sample.psramLargest = heap_caps_get_largest_free_block(heapProfilerPsramCaps);
+	HeapProfiler_SampleCount++;
+
+	if (now - HeapProfiler_LastLogTimestamp >= heapProfilerLogIntervalMs) {
+		HeapProfiler_LastLogTimestamp = now;
+		HeapProfiler_LogSummary(sample);
+	}
+}
+
+static void HeapProfiler_RegionToJSON(JsonObject obj, const uint32_t caps) {
+	const uint32_t freeBytes = heap_caps_get_free_size(caps);
+	const uint32_t largest = heap_caps_get_largest_free_block(caps);
+	obj["size"] = heap_caps_get_total_size(caps);
+	obj["free"] = freeBytes;
+	obj["minFree"] = heap_caps_get_minimum_free_size(caps);
+	obj["largestBlock"] = largest;
+	obj["fragmentation"] = HeapProfiler_Fragmentation(freeBytes, largest);
+}
+
+// Snapshot for /debug/heap
+void HeapProfiler_ToJSON(JsonObject obj) {
+	HeapProfiler_RegionToJSON(obj["internal"].to<JsonObject>(), heapProfilerInternalCaps);
+	if (psramFound()) {
+		HeapProfiler_RegionToJSON(obj["psram"].to<JsonObject>(), heapProfilerPsramCaps);
+	}
+
+	portENTER_CRITICAL(&HeapProfiler_Mux);
+	const uint16_t used = HeapProfiler_Used;
+	const uint32_t untracked = HeapProfiler_Untracked;
+	const heapProfilerFailed_t failed = HeapProfiler_Failed;
+	const uint8_t tagCount = HeapProfiler_TagCount;
+	portEXIT_CRITICAL(&HeapProfiler_Mux);
+	obj["active"] = static_cast<bool>(HeapProfiler_Active);
+	obj["tracked"] = used;
+	obj["trackedMax"] = heapProfilerMaxLoad;
+	obj["untracked"] = untracked;
+	JsonObject failedObj = obj["failed"].to<JsonObject>();
+	failedObj["count"] = failed.count;
+	if (failed.count) {
+		failedObj["size"] = failed.size;
+		failedObj["caps"] = failed.caps;
+		failedObj["tag"] = HeapProfiler_Tags[failed.tag].name;
+		failedObj["timestampMs"] = failed.timestampMs;
+	}
+
+	// per tag (task-name or scope); lifetimes of the freed allocations, bucket n is below lifetimeLimitsMs[n]
+	JsonArray limitsArr = obj["lifetimeLimitsMs"].to<JsonArray>();
+	for (const uint32_t limit : heapProfilerLifetimeLimitsMs) {
+		limitsArr.add(limit);
+	}
+	JsonArray tagsArr = obj["tags"].to<JsonArray>();
+	heapProfilerTag_t tag;
+	for (uint8_t i = 0; i < tagCount; i++) {
+		HeapProfiler_GetTagStats(i, tag);
+		JsonObject tagObj = tagsArr.add<JsonObject>();
+		tagObj["name"] = tag.name;
+		tagObj["liveBytes"] = tag.liveBytes;
+		tagObj["liveCount"] = tag.liveCount;
+		tagObj["peakBytes"] = tag.peakBytes;
+		tagObj["allocs"] = tag.allocs;
+		tagObj["frees"] = tag.frees;
+		JsonArray lifetimesArr = tagObj["lifetimes"].to<JsonArray>();
+		for (const uint32_t count : tag.lifetimes) {
+			lifetimesArr.add(count);
+		}
+	}
+
+	// oldest sample first: [uptime (s), internal free, internal largest block, PSRAM free, PSRAM largest block]
+	JsonArray samplesArr = obj["samples"].to<JsonArray>();
+	const uint32_t count = std::min<uint32_t>(HeapProfiler_SampleCount, heapProfilerSamples);
+	for (uint32_t i = HeapProfiler_SampleCount - count; i < HeapProfiler_SampleCount; i++) {
+		const heapProfilerSample_t &sample = HeapProfiler_Samples[i % heapProfilerSamples];
+		JsonArray sampleArr = samplesArr.add<JsonArray>();
+		sampleArr.add(sample.uptimeS);
+		sampleArr.add(sample.internalFree);
+		sampleArr.add(sample.internalLargest);
+		sampleArr.add(sample.psramFree);
+		sampleArr.add(sample.psramLargest);
+	}
+}
+
+#endif
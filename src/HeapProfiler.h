@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+
+// Allocation-profiler: every allocation (malloc, new, heap_caps_*, ArduinoJson, String, ...) is attributed to a tag
+// via the heap-hooks of ESP-IDF (CONFIG_HEAP_USE_HOOKS). The tag is the name of the allocating task, or a module-name
+// set with HEAP_PROFILER_SCOPE() for a block of code. Per tag: live bytes and allocations, peak, counters and a
+// histogram of the lifetime of freed allocations. Free memory and the largest free block of internal RAM and PSRAM
+// are sampled every 10 s. Failed allocations are logged with tag, size and a backtrace.
+// Results in /debug/heap and once a minute in the log. Compiled out completely unless HEAP_PROFILER_ENABLE is set.
+
+#ifdef HEAP_PROFILER_ENABLE
+uint8_t HeapProfiler_EnterScope(const char *tag);
+void HeapProfiler_LeaveScope(const uint8_t previous);
+
+// Attributes the allocations of the current task to "tag" until the end of the block
+class HeapProfilerScope {
+public:
+	explicit HeapProfilerScope(const char *tag)
+		: previous(HeapProfiler_EnterScope(tag)) { }
+	~HeapProfilerScope() {
+		HeapProfiler_LeaveScope(previous);
+	}
+	HeapProfilerScope(const HeapProfilerScope &) = delete;
+	HeapProfilerScope &operator=(const HeapProfilerScope &) = delete;
+
+private:
+	const uint8_t previous;
+};
+
+	#define HEAP_PROFILER_SCOPE(tag) HeapProfilerScope heapProfilerScope(tag)
+
+void HeapProfiler_Init(void);
+void HeapProfiler_Cyclic(void);
+void HeapProfiler_ToJSON(JsonObject obj);
+#else
+	#define HEAP_PROFILER_SCOPE(tag) \
+		do {                         \
+		} while (0)
+#endif
@@ -4,7 +4,7 @@
 #include "IrReceiver.h"
 
 #include "AudioPlayer.h"
-#include "Cmd.h"
+#include "CommandBus.h"
 #include "Log.h"
 #include "Queues.h"
 #include "System.h"
@@ -44,42 +44,42 @@ void IrReceiver_Cyclic() {
 		switch (IrReceiver.decodedIRData.command) {
 			case RC_PLAY: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_PLAYPAUSE);
+					CommandBus_PostAction(CMD_PLAYPAUSE, CommandSource::IrReceiver);
 					Log_Println("RC: Play", LOGLEVEL_NOTICE);
 				}
 				break;
 			}
 			case RC_PAUSE: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_PLAYPAUSE);
+					CommandBus_PostAction(CMD_PLAYPAUSE, CommandSource::IrReceiver);
 					Log_Println("RC: Pause", LOGLEVEL_NOTICE);
 				}
 				break;
 			}
 			case RC_NEXT: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_NEXTTRACK);
+					CommandBus_PostAction(CMD_NEXTTRACK, CommandSource::IrReceiver);
 					Log_Println("RC: Next", LOGLEVEL_NOTICE);
 				}
 				break;
 			}
 			case RC_PREVIOUS: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_PREVTRACK);
+					CommandBus_PostAction(CMD_PREVTRACK, CommandSource::IrReceiver);
 					Log_Println("RC: Previous", LOGLEVEL_NOTICE);
 				}
 				break;
 			}
 			case RC_FIRST: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_FIRSTTRACK);
+					CommandBus_PostAction(CMD_FIRSTTRACK, CommandSource::IrReceiver);
 					Log_Println("RC: First", LOGLEVEL_NOTICE);
 				}
 				break;
 			}
 			case RC_LAST: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_LASTTRACK);
+					CommandBus_PostAction(CMD_LASTTRACK, CommandSource::IrReceiver);
 					Log_Println("RC: Last", LOGLEVEL_NOTICE);
 				}
 				break;
@@ -99,7 +99,7 @@ void IrReceiver_Cyclic() {
 			}
 			case RC_BLUETOOTH: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_TOGGLE_BLUETOOTH_SINK_MODE);
+					CommandBus_PostAction(CMD_TOGGLE_BLUETOOTH_SINK_MODE, CommandSource::IrReceiver);
 					Log_Println("RC: Bluetooth sink", LOGLEVEL_NOTICE);
 				}
 				break;
@@ -107,7 +107,7 @@ void IrReceiver_Cyclic() {
 			// +++ todo: bluetooth source mode +++
 			case RC_FTP: {
 				if (rcActionOk) {
-					Cmd_Action(CMD_ENABLE_FTP_SERVER);
+					CommandBus_PostAction(CMD_ENABLE_FTP_SERVER, CommandSource::IrReceiver);
 					Log_Println("RC: FTP", LOGLEVEL_NOTICE);
 				}
 				break;
@@ -120,12 +120,12 @@ void IrReceiver_Cyclic() {
 				break;
 			}
 			case RC_VOL_DOWN: {
-				Cmd_Action(CMD_VOLUMEDOWN);
+				CommandBus_PostAction(CMD_VOLUMEDOWN, CommandSource::IrReceiver);
 				Log_Println("RC: Volume down", LOGLEVEL_NOTICE);
 				break;
 			}
 			case RC_VOL_UP: {
-				Cmd_Action(CMD_VOLUMEUP);
+				CommandBus_PostAction(CMD_VOLUMEUP, CommandSource::IrReceiver);
 				Log_Println("RC: Volume up", LOGLEVEL_NOTICE);
 				break;
 			}
@@ -3,18 +3,489 @@
 
 #include "Log.h"
 
-#include "LogRingBuffer.h"
+#include "LogSd.h"
 #include "MemX.h"
 
-static LogRingBuffer *Log_RingBuffer = NULL;
+#include <algorithm>
+#include <atomic>
+#include <esp_memory_utils.h>
+#include <esp_system.h>
+
+constexpr uint8_t logEntryArgsSize = 116u; // raw arguments (or copied text) per entry; the entry is 128 bytes
+constexpr uint32_t logQueueSizeDram = 16u; // entries waiting for the log-task (power of 2)
+constexpr uint32_t logQueueSizePsram = 128u;
+constexpr uint32_t logHistorySizeDram = 64u; // entries kept for /log (8 kB)
+constexpr uint32_t logHistorySizePsram = 256u;
+constexpr size_t logLineSize = 256u; // rendered line; longer ones are cut
+constexpr uint32_t logTaskStackSize = 4096u; // snprintf() of doubles needs some stack
+constexpr UBaseType_t logTaskPriority = 1u;
+constexpr uint32_t logTaskPeriodMs = 20u;
+constexpr uint32_t logErrorWaitMs = 5u; // max. time an error waits for the log-task before it's queued
+constexpr uint8_t logLevels = LOGLEVEL_DEBUG + 1u;
+static_assert(!(logQueueSizeDram & (logQueueSizeDram - 1u)) && !(logQueueSizePsram & (logQueueSizePsram - 1u)), "queue-sizes must be a power of 2");
+
+enum : uint8_t {
+	logFlagNoPrefix = 0x01, // neither loglevel nor timestamp
+	logFlagNoNewline = 0x02,
+	logFlagTruncated = 0x04, // arguments didn't fit into the entry
+	logFlagText = 0x08, // format is plain text (no conversions); if it's NULL, the text is stored in args
+};
+
+enum : uint8_t {
+	logStringPointer = 0, // %s: pointer into flash follows
+	logStringInline, // %s: length (1 byte) and the characters follow
+};
+
+typedef struct {
+	const char *format;
+	uint32_t timestampMs;
+	uint8_t level;
+	uint8_t flags;
+	uint8_t argsLen;
+	uint8_t args[logEntryArgsSize];
+} logEntry_t;
+
+enum class LogArg : uint8_t {
+	None = 0, // "%%"
+	Int,
+	Long,
+	LongLong,
+	SizeT,
+	Double,
+	String,
+	Pointer,
+	Invalid // unsupported conversion (%n, %Lf, ...): the rest of the format is taken as text
+};
+
+typedef struct {
+	uint8_t length; // of the whole conversion-spec, including '%'
+	uint8_t stars; // '*' for width and/or precision, each takes an int
+	LogArg arg;
+} logSpec_t;
+
+typedef struct {
+	uint32_t count;
+	uint64_t cycles;
+} logStats_t;
+
+uint8_t gLogLevel = SERIAL_LOGLEVEL;
+
+// Multi-producer/single-consumer queue (same scheme as the audio-commands): a producer claims a slot by
+// advancing Log_QueueHead and publishes it via the slot's sequence. The sequences stay in internal RAM as
+// atomics don't work on PSRAM (ESP32), the entries are allocated in PSRAM if available.
+static logEntry_t *Log_Queue = nullptr;
+static std::atomic<uint32_t> *Log_QueueSeq = nullptr;
+static uint32_t Log_QueueSize = 0u;
+static std::atomic<uint32_t> Log_QueueHead {0u};
+static std::atomic<uint32_t> Log_QueueTail {0u}; // only written by the consumer
+static SemaphoreHandle_t Log_ConsumerMutex = nullptr; // log-task vs. Log_Flush()
+static TaskHandle_t Log_TaskHandle = nullptr;
+
+static logEntry_t *Log_History = nullptr;
+static uint32_t Log_HistorySize = 0u;
+static uint32_t Log_HistoryCount = 0u; // entries written since boot
+static portMUX_TYPE Log_HistoryMux = portMUX_INITIALIZER_UNLOCKED;
+
+static portMUX_TYPE Log_StatsMux = portMUX_INITIALIZER_UNLOCKED;
+static logStats_t Log_Stats[logLevels];
+static std::atomic<uint32_t> Log_Dropped {0u};
+static uint32_t Log_DroppedReported = 0u;
+static uint32_t Log_HighWater = 0u;
+
+static void Log_Task(void *parameter);
 
 void Log_Init(void) {
 	Serial.begin(115200);
-	Log_RingBuffer = new LogRingBuffer();
+#ifdef LOG_SD_ENABLE
+	LogSd_Init();
+#endif
+
+	const bool psram = psramFound();
+	Log_QueueSize = psram ? logQueueSizePsram : logQueueSizeDram;
+	Log_HistorySize = psram ? logHistorySizePsram : logHistorySizeDram;
+	Log_QueueSeq = static_cast<std::atomic<uint32_t> *>(heap_caps_malloc(Log_QueueSize * sizeof(std::atomic<uint32_t>), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+	logEntry_t *queue = reinterpret_cast<logEntry_t *>(x_calloc(Log_QueueSize, sizeof(logEntry_t)));
+	Log_History = reinterpret_cast<logEntry_t *>(x_calloc(Log_HistorySize, sizeof(logEntry_t)));
+	Log_ConsumerMutex = xSemaphoreCreateMutex();
+	if (!Log_QueueSeq || !queue || !Log_History || !Log_ConsumerMutex) {
+		Serial.println(unableToAllocateMem); // logging stays synchronous
+		return;
+	}
+	for (uint32_t i = 0; i < Log_QueueSize; i++) {
+		new (&Log_QueueSeq[i]) std::atomic<uint32_t>(i);
+	}
+	xTaskCreatePinnedToCore(
+		Log_Task, /* Function to implement the task */
+		"Log", /* Name of the task */
+		logTaskStackSize, /* Stack size in words */
+		NULL, /* Task input parameter */
+		logTaskPriority, /* Priority of the task */
+		&Log_TaskHandle, /* Task handle. */
+		0 /* Core where the task should run */
+	);
+	Log_Queue = queue; // from now on entries are queued
+	esp_register_shutdown_handler(Log_Flush); // esp_restart() from anywhere
+}
+
+void Log_SetLevel(const uint8_t level) {
+	gLogLevel = level;
+}
+
+// Parses the conversion-spec that starts at p ('%')
+static void Log_ParseSpec(const char *p, logSpec_t &spec) {
+	const char *s = p + 1;
+	spec.stars = 0;
+	while (*s && strchr("-+ #0", *s)) {
+		s++;
+	}
+	if (*s == '*') {
+		spec.stars++;
+		s++;
+	}
+	while (isdigit(static_cast<unsigned char>(*s))) {
+		s++;
+	}
+	if (*s == '.') {
+		s++;
+		if (*s == '*') {
+			spec.stars++;
+			s++;
+		}
+		while (isdigit(static_cast<unsigned char>(*s))) {
+			s++;
+		}
+	}
+	LogArg integer = LogArg::Int;
+	if (*s == 'h') {
+		s += (s[1] == 'h') ? 2 : 1;
+	} else if (*s == 'l') {
+		integer = (s[1] == 'l') ? LogArg::LongLong : LogArg::Long;
+		s += (s[1] == 'l') ? 2 : 1;
+	} else if (*s == 'j') {
+		integer = LogArg::LongLong;
+		s++;
+	} else if (*s == 'z' || *s == 't') {
+		integer = LogArg::SizeT;
+		s++;
+	}
+	switch (*s) {
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+		case 'c':
+			spec.arg = integer;
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			spec.arg = LogArg::Double;
+			break;
+		case 's':
+			spec.arg = LogArg::String;
+			break;
+		case 'p':
+			spec.arg = LogArg::Pointer;
+			break;
+		case '%':
+			spec.arg = (s == p + 1) ? LogArg::None : LogArg::Invalid;
+			break;
+		default:
+			spec.arg = LogArg::Invalid;
+			break;
+	}
+	const size_t length = s - p + (*s ? 1 : 0);
+	spec.length = std::min<size_t>(length, UINT8_MAX);
+	if (length > 24u) {
+		spec.arg = LogArg::Invalid; // won't fit into the spec-buffer when rendering
+	}
+}
+
+static bool Log_Put(logEntry_t &entry, const void *value, const size_t size) {
+	if (entry.argsLen + size > logEntryArgsSize) {
+		entry.flags |= logFlagTruncated;
+		return false;
+	}
+	memcpy(entry.args + entry.argsLen, value, size);
+	entry.argsLen += size;
+	return true;
+}
+
+static bool Log_PutString(logEntry_t &entry, const char *str) {
+	if (!str) {
+		str = "(null)";
+	}
+	if (esp_ptr_in_drom(str)) {
+		const uint8_t tag = logStringPointer;
+		return (entry.argsLen + 1u + sizeof(str) <= logEntryArgsSize) && Log_Put(entry, &tag, 1u) && Log_Put(entry, &str, sizeof(str));
+	}
+	if (entry.argsLen + 2u > logEntryArgsSize) {
+		entry.flags |= logFlagTruncated;
+		return false;
+	}
+	const size_t length = strlen(str);
+	const uint8_t copied = std::min<size_t>(length, logEntryArgsSize - entry.argsLen - 2u);
+	entry.args[entry.argsLen++] = logStringInline;
+	entry.args[entry.argsLen++] = copied;
+	memcpy(entry.args + entry.argsLen, str, copied);
+	entry.argsLen += copied;
+	if (copied < length) {
+		entry.flags |= logFlagTruncated;
+		return false;
+	}
+	return true;
+}
+
+// Stores the arguments in their binary representation, driven by the conversions of the format
+static void Log_Encode(logEntry_t &entry, const char *format, va_list args) {
+	for (const char *p = strchr(format, '%'); p; p = strchr(p, '%')) {
+		logSpec_t spec;
+		Log_ParseSpec(p, spec);
+		p += spec.length;
+		if (spec.arg == LogArg::Invalid) {
+			return;
+		}
+		bool stored = true;
+		for (uint8_t i = 0; i < spec.stars && stored; i++) {
+			const int star = va_arg(args, int);
+			stored = Log_Put(entry, &star, sizeof(star));
+		}
+		switch (spec.arg) {
+			case LogArg::Int: {
+				const int value = va_arg(args, int);
+				stored = stored && Log_Put(entry, &value, sizeof(value));
+				break;
+			}
+			case LogArg::Long: {
+				const long value = va_arg(args, long);
+				stored = stored && Log_Put(entry, &value, sizeof(value));
+				break;
+			}
+			case LogArg::LongLong: {
+				const long long value = va_arg(args, long long);
+				stored = stored && Log_Put(entry, &value, sizeof(value));
+				break;
+			}
+			case LogArg::SizeT: {
+				const size_t value = va_arg(args, size_t);
+				stored = stored && Log_Put(entry, &value, sizeof(value));
+				break;
+			}
+			case LogArg::Double: {
+				const double value = va_arg(args, double);
+				stored = stored && Log_Put(entry, &value, sizeof(value));
+				break;
+			}
+			case LogArg::String: {
+				const char *value = va_arg(args, const char *);
+				stored = stored && Log_PutString(entry, value);
+				break;
+			}
+			case LogArg::Pointer: {
+				const void *value = va_arg(args, void *);
+				stored = stored && Log_Put(entry, &value, sizeof(value));
+				break;
+			}
+			default:
+				break;
+		}
+		if (!stored) {
+			return;
+		}
+	}
+}
+
+// Reads the next argument of an entry (false if it was cut off)
+static bool Log_Take(const logEntry_t &entry, size_t &offset, void *value, const size_t size) {
+	if (offset + size > entry.argsLen) {
+		return false;
+	}
+	memcpy(value, entry.args + offset, size);
+	offset += size;
+	return true;
+}
+
+static bool Log_TakeString(const logEntry_t &entry, size_t &offset, const char *&str, size_t &length) {
+	uint8_t tag;
+	if (!Log_Take(entry, offset, &tag, 1u)) {
+		return false;
+	}
+	if (tag == logStringPointer) {
+		if (!Log_Take(entry, offset, &str, sizeof(str))) {
+			return false;
+		}
+		length = strlen(str);
+		return true;
+	}
+	uint8_t copied;
+	if (!Log_Take(entry, offset, &copied, 1u) || offset + copied > entry.argsLen) {
+		return false;
+	}
+	str = reinterpret_cast<const char *>(entry.args + offset);
+	length = copied;
+	offset += copied;
+	return true;
+}
+
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t pos;
+} logWriter_t;
+
+static void Log_Append(logWriter_t &out, const char *str, const size_t length) {
+	const size_t n = std::min(length, out.size - 1u - out.pos);
+	memcpy(out.buf + out.pos, str, n);
+	out.pos += n;
+	out.buf[out.pos] = '\0';
+}
+
+static void Log_Advance(logWriter_t &out, const int written) {
+	if (written > 0) {
+		out.pos += std::min<size_t>(written, out.size - 1u - out.pos);
+	}
+}
+
+template <typename T>
+static void Log_RenderValue(logWriter_t &out, const char *spec, const int *stars, const uint8_t starCount, const T value) {
+	const size_t space = out.size - out.pos;
+	int written;
+	if (starCount == 2u) {
+		written = snprintf(out.buf + out.pos, space, spec, stars[0], stars[1], value);
+	} else if (starCount == 1u) {
+		written = snprintf(out.buf + out.pos, space, spec, stars[0], value);
+	} else {
+		written = snprintf(out.buf + out.pos, space, spec, value);
+	}
+	Log_Advance(out, written);
+}
+
+// Renders the message of an entry (without prefix and newline). Returns false if arguments were missing.
+static bool Log_RenderMessage(const logEntry_t &entry, logWriter_t &out) {
+	if (entry.flags & logFlagText) {
+		if (entry.format) {
+			Log_Append(out, entry.format, strlen(entry.format));
+		} else {
+			Log_Append(out, reinterpret_cast<const char *>(entry.args), entry.argsLen);
+		}
+		return !(entry.flags & logFlagTruncated);
+	}
+
+	const char *p = entry.format;
+	size_t offset = 0;
+	for (const char *next = strchr(p, '%'); next; next = strchr(p, '%')) {
+		Log_Append(out, p, next - p);
+		logSpec_t spec;
+		Log_ParseSpec(next, spec);
+		p = next + spec.length;
+		if (spec.arg == LogArg::None) {
+			Log_Append(out, "%", 1u);
+			continue;
+		}
+		if (spec.arg == LogArg::Invalid) {
+			p = next;
+			break;
+		}
+		char specBuf[25];
+		memcpy(specBuf, next, spec.length);
+		specBuf[spec.length] = '\0';
+		int stars[2];
+		for (uint8_t i = 0; i < spec.stars; i++) {
+			if (!Log_Take(entry, offset, &stars[i], sizeof(int))) {
+				return false;
+			}
+		}
+		switch (spec.arg) {
+			case LogArg::Int: {
+				int value;
+				if (!Log_Take(entry, offset, &value, sizeof(value))) {
+					return false;
+				}
+				Log_RenderValue(out, specBuf, stars, spec.stars, value);
+				break;
+			}
+			case LogArg::Long: {
+				long value;
+				if (!Log_Take(entry, offset, &value, sizeof(value))) {
+					return false;
+				}
+				Log_RenderValue(out, specBuf, stars, spec.stars, value);
+				break;
+			}
+			case LogArg::LongLong: {
+				long long value;
+				if (!Log_Take(entry, offset, &value, sizeof(value))) {
+					return false;
+				}
+				Log_RenderValue(out, specBuf, stars, spec.stars, value);
+				break;
+			}
+			case LogArg::SizeT: {
+				size_t value;
+				if (!Log_Take(entry, offset, &value, sizeof(value))) {
+					return false;
+				}
+				Log_RenderValue(out, specBuf, stars, spec.stars, value);
+				break;
+			}
+			case LogArg::Double: {
+				double value;
+				if (!Log_Take(entry, offset, &value, sizeof(value))) {
+					return false;
+				}
+				Log_RenderValue(out, specBuf, stars, spec.stars, value);
+				break;
+			}
+			case LogArg::String: {
+				const char *str;
+				size_t length;
+				if (!Log_TakeString(entry, offset, str, length)) {
+					return false;
+				}
+				if (strchr(specBuf, '.') || spec.stars) {
+					// precision given by the caller: render a terminated copy
+					char copy[logEntryArgsSize + 1];
+					const size_t n = std::min(length, sizeof(copy) - 1u);
+					memcpy(copy, str, n);
+					copy[n] = '\0';
+					Log_RenderValue(out, specBuf, stars, spec.stars, static_cast<const char *>(copy));
+				} else {
+					// inline copies aren't terminated: limit by precision
+					char stringSpec[sizeof(specBuf) + 2u];
+					snprintf(stringSpec, sizeof(stringSpec), "%.*s.*s", static_cast<int>(spec.length - 1u), specBuf);
+					const int precision[1] = {static_cast<int>(length)};
+					Log_RenderValue(out, stringSpec, precision, 1u, str);
+				}
+				if ((entry.flags & logFlagTruncated) && offset == entry.argsLen) {
+					return false; // the string was cut
+				}
+				break;
+			}
+			case LogArg::Pointer: {
+				void *value;
+				if (!Log_Take(entry, offset, &value, sizeof(value))) {
+					return false;
+				}
+				Log_RenderValue(out, specBuf, stars, spec.stars, value);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	Log_Append(out, p, strlen(p));
+	return !(entry.flags & logFlagTruncated);
 }
 
-String getLoglevel(const uint8_t logLevel) {
-	switch (logLevel) {
+static const char *Log_LevelName(const uint8_t level) {
+	switch (level) {
 		case LOGLEVEL_ERROR:
 			return "E";
 		case LOGLEVEL_NOTICE:
@@ -28,60 +499,415 @@ String getLoglevel(const uint8_t logLevel) {
 	}
 }
 
-/* Wrapper-function for serial-logging (with newline)
-   _logBuffer: char* to log
-   _minLogLevel: loglevel configured for this message.
-   If (SERIAL_LOGLEVEL <= _minLogLevel) message will be logged
-*/
-void Log_Println(const char *_logBuffer, const uint8_t _minLogLevel) {
-	if (SERIAL_LOGLEVEL >= _minLogLevel) {
-		uint32_t ctime = millis();
-		const String sLogLevel = getLoglevel(_minLogLevel);
-		Serial.printf("%s [%" PRIu32 "] ", sLogLevel.c_str(), ctime);
-		Serial.println(_logBuffer);
-		Log_RingBuffer->printf("%s [%" PRIu32 "] ", sLogLevel.c_str(), ctime);
-		Log_RingBuffer->println(_logBuffer);
-	}
-}
-
-/* Wrapper-function for serial-logging (without newline) */
-void Log_Print(const char *_logBuffer, const uint8_t _minLogLevel, bool printTimestamp) {
-	if (SERIAL_LOGLEVEL >= _minLogLevel) {
-		if (printTimestamp) {
-			uint32_t ctime = millis();
-			const String sLogLevel = getLoglevel(_minLogLevel);
-			Serial.printf("%s [%" PRIu32 "] ", sLogLevel.c_str(), ctime);
-			Serial.print(_logBuffer);
-			Log_RingBuffer->printf("%s [%" PRIu32 "] ", sLogLevel.c_str(), ctime);
+// Renders an entry as line like it's shown on the console
+static size_t Log_Render(const logEntry_t &entry, char *buf, const size_t size) {
+	logWriter_t out = {buf, size, 0u};
+	buf[0] = '\0';
+	if (!(entry.flags & logFlagNoPrefix)) {
+		Log_Advance(out, snprintf(buf, size, "%s [%" PRIu32 "] ", Log_LevelName(entry.level), entry.timestampMs));
+	}
+	if (!Log_RenderMessage(entry, out)) {
+		Log_Append(out, "...", 3u);
+	}
+	if (!(entry.flags & logFlagNoNewline)) {
+		out.pos = std::min(out.pos, size - 2u); // keep room for the newline
+		Log_Append(out, "\n", 1u);
+	}
+	return out.pos;
+}
+
+// Writes an entry to the console and keeps it for /log
+static void Log_Output(const logEntry_t &entry) {
+	char line[logLineSize];
+	const size_t length = Log_Render(entry, line, sizeof(line));
+	Serial.write(reinterpret_cast<const uint8_t *>(line), length);
+#ifdef LOG_SD_ENABLE
+	LogSd_Append(line, length);
+#endif
+
+	if (Log_History) {
+		portENTER_CRITICAL(&Log_HistoryMux);
+		Log_History[Log_HistoryCount++ % Log_HistorySize] = entry;
+		portEXIT_CRITICAL(&Log_HistoryMux);
+	}
+}
+
+// Errors are written by the caller, so a crash that follows doesn't lose them. Only the error-line itself: the
+// backlog is left to the log-task (the error might show up before entries queued earlier), so the caller is
+// blocked for one line at most. Not from an ISR, before the scheduler runs or while the caller is writing the
+// queue already; if the log-task is busy for longer than logErrorWaitMs, the error is queued as usual.
+static bool Log_WriteError(const logEntry_t &entry) {
+	if (xPortInIsrContext() || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || xSemaphoreGetMutexHolder(Log_ConsumerMutex) == xTaskGetCurrentTaskHandle()) {
+		return false;
+	}
+	if (xSemaphoreTake(Log_ConsumerMutex, pdMS_TO_TICKS(logErrorWaitMs)) != pdTRUE) {
+		return false;
+	}
+	Log_Output(entry);
+	xSemaphoreGive(Log_ConsumerMutex);
+	return true;
+}
+
+static void Log_Push(const logEntry_t &entry) {
+	if (!Log_Queue) {
+		// not yet initialized: write synchronously
+		Log_Output(entry);
+		return;
+	}
+	if (entry.level == LOGLEVEL_ERROR && Log_WriteError(entry)) {
+		return;
+	}
+	uint32_t pos = Log_QueueHead.load(std::memory_order_relaxed);
+	for (;;) {
+		std::atomic<uint32_t> &seq = Log_QueueSeq[pos & (Log_QueueSize - 1u)];
+		const int32_t diff = static_cast<int32_t>(seq.load(std::memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (Log_QueueHead.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)) {
+				Log_Queue[pos & (Log_QueueSize - 1u)] = entry;
+				seq.store(pos + 1u, std::memory_order_release);
+				break;
+			}
+		} else if (diff < 0) {
+			Log_Dropped.fetch_add(1u, std::memory_order_relaxed); // queue is full
+			return;
 		} else {
-			Serial.print(_logBuffer);
+			pos = Log_QueueHead.load(std::memory_order_relaxed);
+		}
+	}
+	// wake the log-task early if the queue fills up or for errors (from an ISR); otherwise it picks the entry up within logTaskPeriodMs
+	if (entry.level == LOGLEVEL_ERROR || pos - Log_QueueTail.load(std::memory_order_relaxed) >= Log_QueueSize / 2u) {
+		if (xPortInIsrContext()) {
+			vTaskNotifyGiveFromISR(Log_TaskHandle, nullptr);
+		} else {
+			xTaskNotifyGive(Log_TaskHandle);
 		}
-		Log_RingBuffer->print(_logBuffer);
 	}
 }
 
-int Log_Printf(const uint8_t _minLogLevel, const char *format, ...) {
-	char loc_buf[201]; // Allow a maximum buffer of 200 characters in a single log message
+static void Log_AddToStats(const uint8_t level, const uint32_t startCycles) {
+	const uint32_t cycles = ESP.getCycleCount() - startCycles;
+	portENTER_CRITICAL_SAFE(&Log_StatsMux);
+	logStats_t &stats = Log_Stats[std::min<uint8_t>(level, logLevels - 1u)];
+	stats.count++;
+	stats.cycles += cycles;
+	portEXIT_CRITICAL_SAFE(&Log_StatsMux);
+}
 
-	int len;
-	va_list arg;
-	va_start(arg, format);
+// Called by Log_Println()/Log_Print() once the level passed
+void Log_RecordText(const char *text, const uint8_t level, const bool printTimestamp, const bool newline) {
+	const uint32_t startCycles = ESP.getCycleCount();
+	logEntry_t entry;
+	entry.timestampMs = millis();
+	entry.level = level;
+	entry.flags = logFlagText;
+	if (!printTimestamp) {
+		entry.flags |= logFlagNoPrefix;
+	}
+	if (!newline) {
+		entry.flags |= logFlagNoNewline;
+	}
+	entry.argsLen = 0u;
+	if (esp_ptr_in_drom(text)) {
+		entry.format = text;
+	} else {
+		const size_t length = strlen(text);
+		entry.format = nullptr;
+		entry.argsLen = std::min<size_t>(length, logEntryArgsSize);
+		memcpy(entry.args, text, entry.argsLen);
+		if (length > logEntryArgsSize) {
+			entry.flags |= logFlagTruncated;
+		}
+	}
+	Log_Push(entry);
+	Log_AddToStats(level, startCycles);
+}
 
-	// use the local buffer and trunctate string if it's larger
-	len = vsnprintf(loc_buf, sizeof(loc_buf), format, arg);
+// Called by Log_Printf() once the level passed
+void Log_Record(const uint8_t level, const char *format, ...) {
+	const uint32_t startCycles = ESP.getCycleCount();
+	logEntry_t entry;
+	entry.timestampMs = millis();
+	entry.level = level;
+	entry.flags = 0u;
+	entry.argsLen = 0u;
+	va_list args;
+	va_start(args, format);
+	if (esp_ptr_in_drom(format)) {
+		entry.format = format;
+		Log_Encode(entry, format, args);
+	} else {
+		// format isn't constant: the pointer might be gone when the entry is rendered, so format it right away
+		entry.format = nullptr;
+		entry.flags = logFlagText;
+		const int length = vsnprintf(reinterpret_cast<char *>(entry.args), logEntryArgsSize, format, args);
+		entry.argsLen = std::min<int>(std::max(length, 0), logEntryArgsSize - 1);
+		if (length >= logEntryArgsSize) {
+			entry.flags |= logFlagTruncated;
+		}
+	}
+	va_end(args);
+	Log_Push(entry);
+	Log_AddToStats(level, startCycles);
+}
 
-	Log_Print(loc_buf, _minLogLevel, true);
-	if (len > sizeof(loc_buf) - 1) {
-		// long string was trunctated
-		Log_Print("...", _minLogLevel, false);
+// Writes all queued entries (consumer-side of the queue)
+static void Log_Drain(void) {
+	if (xSemaphoreTake(Log_ConsumerMutex, portMAX_DELAY) != pdTRUE) {
+		return;
+	}
+	uint32_t tail = Log_QueueTail.load(std::memory_order_relaxed);
+	Log_HighWater = std::max(Log_HighWater, Log_QueueHead.load(std::memory_order_relaxed) - tail);
+	for (;;) {
+		std::atomic<uint32_t> &seq = Log_QueueSeq[tail & (Log_QueueSize - 1u)];
+		if (static_cast<int32_t>(seq.load(std::memory_order_acquire) - (tail + 1u)) < 0) {
+			break; // empty
+		}
+		const logEntry_t entry = Log_Queue[tail & (Log_QueueSize - 1u)];
+		seq.store(tail + Log_QueueSize, std::memory_order_release);
+		Log_QueueTail.store(++tail, std::memory_order_relaxed);
+		Log_Output(entry);
 	}
-	Log_Print("\n", _minLogLevel, false);
+	const uint32_t dropped = Log_Dropped.load(std::memory_order_relaxed);
+	if (dropped != Log_DroppedReported) {
+		logEntry_t entry = {};
+		entry.format = logMessagesDropped;
+		entry.timestampMs = millis();
+		entry.level = LOGLEVEL_ERROR;
+		const unsigned int count = dropped - Log_DroppedReported;
+		Log_Put(entry, &count, sizeof(count));
+		Log_DroppedReported = dropped;
+		Log_Output(entry);
+	}
+	xSemaphoreGive(Log_ConsumerMutex);
+}
 
-	va_end(arg);
+static void Log_Task(void *parameter) {
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(logTaskPeriodMs));
+		Log_Drain();
+#ifdef LOG_SD_ENABLE
+		LogSd_Cyclic();
+#endif
+	}
+}
 
-	return std::min<int>(len, sizeof(loc_buf) - 1);
+// Writes everything that's queued (before restart/deepsleep; also registered as shutdown-handler)
+void Log_Flush(void) {
+	if (Log_Queue) {
+		Log_Drain();
+	}
+	Serial.flush();
+}
+
+// Copies a history-entry; false if it doesn't exist (yet) or was overwritten in the meantime
+static bool Log_GetHistoryEntry(const uint32_t index, logEntry_t &entry) {
+	bool valid;
+	portENTER_CRITICAL(&Log_HistoryMux);
+	valid = (index < Log_HistoryCount) && (index + Log_HistorySize >= Log_HistoryCount);
+	if (valid) {
+		entry = Log_History[index % Log_HistorySize];
+	}
+	portEXIT_CRITICAL(&Log_HistoryMux);
+	return valid;
+}
+
+// Sequence-number of the next line
+uint32_t Log_GetSequence(void) {
+	portENTER_CRITICAL(&Log_HistoryMux);
+	const uint32_t count = Log_HistoryCount;
+	portEXIT_CRITICAL(&Log_HistoryMux);
+	return count;
+}
+
+// Sequence-number of the oldest line that is still kept
+uint32_t Log_GetHistoryStart(void) {
+	const uint32_t count = Log_GetSequence();
+	return (count > Log_HistorySize) ? count - Log_HistorySize : 0u;
+}
+
+// Renders the lines from the cursor up to (not including) end into buf and moves the cursor. The buffer is filled
+// completely, a line that doesn't fit is continued by the next call. Returns the number of characters (no terminator).
+size_t Log_ReadHistory(logCursor_t &cursor, const uint32_t end, char *buf, const size_t size) {
+	if (!Log_History) {
+		return 0u;
+	}
+	char line[logLineSize];
+	logEntry_t entry;
+	size_t pos = 0u;
+	while (cursor.seq < end && pos < size) {
+		if (!Log_GetHistoryEntry(cursor.seq, entry)) {
+			const uint32_t start = Log_GetHistoryStart();
+			if (cursor.seq >= start) {
+				break; // not yet written
+			}
+			cursor.lost += start - cursor.seq;
+			cursor.seq = start;
+			cursor.offset = 0u;
+			continue;
+		}
+		// rendering is repeatable, so a partly read line is simply rendered again
+		const size_t length = Log_Render(entry, line, sizeof(line));
+		const size_t offset = std::min<size_t>(cursor.offset, length);
+		const size_t count = std::min(length - offset, size - pos);
+		memcpy(buf + pos, line + offset, count);
+		pos += count;
+		cursor.offset = offset + count;
+		if (cursor.offset == length) {
+			cursor.seq++;
+			cursor.offset = 0u;
+		}
+	}
+	return pos;
+}
+
+static void Log_DumpValue(Print &out, const char type, const void *value, const uint8_t size) {
+	out.write(type);
+	out.write(size);
+	out.write(static_cast<const uint8_t *>(value), size);
+}
+
+static void Log_DumpString(Print &out, const char *str, const size_t length) {
+	const uint16_t n = std::min<size_t>(length, UINT16_MAX);
+	out.write('s');
+	out.write(reinterpret_cast<const uint8_t *>(&n), sizeof(n));
+	out.write(reinterpret_cast<const uint8_t *>(str), n);
 }
 
-String Log_GetRingBuffer(void) {
-	return Log_RingBuffer->get();
+// Writes the arguments of an entry with their type, as far as they are present
+static void Log_DumpArgs(Print &out, const logEntry_t &entry) {
+	size_t offset = 0;
+	for (const char *p = strchr(entry.format, '%'); p; p = strchr(p, '%')) {
+		logSpec_t spec;
+		Log_ParseSpec(p, spec);
+		const char conversion = p[spec.length - 1u];
+		p += spec.length;
+		if (spec.arg == LogArg::Invalid) {
+			return;
+		}
+		for (uint8_t i = 0; i < spec.stars; i++) {
+			int star;
+			if (!Log_Take(entry, offset, &star, sizeof(star))) {
+				return;
+			}
+			Log_DumpValue(out, 'i', &star, sizeof(star));
+		}
+		uint8_t value[sizeof(long long)];
+		uint8_t size = 0u;
+		char type = 'u';
+		switch (spec.arg) {
+			case LogArg::Int:
+				size = sizeof(int);
+				break;
+			case LogArg::Long:
+				size = sizeof(long);
+				break;
+			case LogArg::LongLong:
+				size = sizeof(long long);
+				break;
+			case LogArg::SizeT:
+				size = sizeof(size_t);
+				break;
+			case LogArg::Double:
+				size = sizeof(double);
+				type = 'd';
+				break;
+			case LogArg::Pointer:
+				size = sizeof(void *);
+				type = 'p';
+				break;
+			case LogArg::String: {
+				const char *str;
+				size_t length;
+				if (!Log_TakeString(entry, offset, str, length)) {
+					return;
+				}
+				Log_DumpString(out, str, length);
+				break;
+			}
+			default:
+				break;
+		}
+		if (size) {
+			if (!Log_Take(entry, offset, value, size)) {
+				return;
+			}
+			Log_DumpValue(out, (type == 'u' && (conversion == 'd' || conversion == 'i')) ? 'i' : type, value, size);
+		}
+	}
+}
+
+/* Writes the last entries in binary form for decode_log.py (/log?binary). Everything is little-endian:
+   "ESPL" <version:u8>, followed by records:
+   'F' <id:u16> <length:u16> <characters>   format-string, sent before its first use
+   'E' <ms:u32> <level:u8> <flags:u8> <id:u16> <arguments> 0x00
+       id 0xffff: plain text, given as the only argument
+       argument: 'i'/'u'/'d'/'p' <size:u8> <value> (signed, unsigned, double, pointer)
+                 's' <length:u16> <characters>
+   Arguments that didn't fit into the entry are missing (flag 0x04). */
+void Log_DumpHistory(Print &out) {
+	constexpr uint16_t textId = UINT16_MAX;
+	out.write(reinterpret_cast<const uint8_t *>("ESPL"), 4u);
+	out.write(static_cast<uint8_t>(1u));
+	if (!Log_History) {
+		return;
+	}
+	const char **formats = static_cast<const char **>(x_malloc(Log_HistorySize * sizeof(const char *)));
+	if (!formats) {
+		return;
+	}
+	uint16_t formatCount = 0u;
+	logEntry_t entry;
+	for (uint32_t i = Log_GetHistoryStart(); Log_GetHistoryEntry(i, entry); i++) {
+		uint16_t id = textId;
+		if (!(entry.flags & logFlagText)) {
+			id = std::find(formats, formats + formatCount, entry.format) - formats;
+			if (id == formatCount && formatCount < Log_HistorySize) {
+				formats[formatCount++] = entry.format;
+				const uint16_t length = std::min<size_t>(strlen(entry.format), UINT16_MAX);
+				out.write('F');
+				out.write(reinterpret_cast<const uint8_t *>(&id), sizeof(id));
+				out.write(reinterpret_cast<const uint8_t *>(&length), sizeof(length));
+				out.write(reinterpret_cast<const uint8_t *>(entry.format), length);
+			}
+		}
+		out.write('E');
+		out.write(reinterpret_cast<const uint8_t *>(&entry.timestampMs), sizeof(entry.timestampMs));
+		out.write(entry.level);
+		out.write(entry.flags);
+		out.write(reinterpret_cast<const uint8_t *>(&id), sizeof(id));
+		if (id != textId) {
+			Log_DumpArgs(out, entry);
+		} else if (entry.format) {
+			Log_DumpString(out, entry.format, strlen(entry.format));
+		} else {
+			Log_DumpString(out, reinterpret_cast<const char *>(entry.args), entry.argsLen);
+		}
+		out.write(static_cast<uint8_t>(0u));
+	}
+	free(formats);
+}
+
+// Per-level cost of the logging-calls that passed the level-check (/debug)
+void Log_ToJSON(JsonObject obj) {
+	logStats_t stats[logLevels];
+	portENTER_CRITICAL(&Log_StatsMux);
+	std::copy(std::begin(Log_Stats), std::end(Log_Stats), stats);
+	portEXIT_CRITICAL(&Log_StatsMux);
+
+	obj["level"] = gLogLevel;
+	obj["queueSize"] = Log_QueueSize;
+	obj["highWater"] = Log_HighWater;
+	obj["dropped"] = Log_Dropped.load(std::memory_order_relaxed);
+	obj["historySize"] = Log_HistorySize;
+	const uint32_t cpuMhz = getCpuFrequencyMhz();
+	JsonObject levelsObj = obj["levels"].to<JsonObject>();
+	for (uint8_t level = LOGLEVEL_ERROR; level < logLevels; level++) {
+		JsonObject levelObj = levelsObj[Log_LevelName(level)].to<JsonObject>();
+		levelObj["count"] = stats[level].count;
+		levelObj["avgCycles"] = stats[level].count ? static_cast<uint32_t>(stats[level].cycles / stats[level].count) : 0u;
+		levelObj["avgUs"] = stats[level].count ? (stats[level].cycles / stats[level].count) / static_cast<float>(cpuMhz) : 0.0f;
+	}
+#ifdef LOG_SD_ENABLE
+	LogSd_ToJSON(obj["sd"].to<JsonObject>());
+#endif
 }
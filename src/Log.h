@@ -1,24 +1,69 @@
 #pragma once
 #include "logmessages.h"
 
+#include "ArduinoJson.h"
+
+class Print;
+
 // Loglevels available (don't change!)
 #define LOGLEVEL_ERROR	1 // only errors
 #define LOGLEVEL_NOTICE 2 // errors + important messages
 #define LOGLEVEL_INFO	3 // infos + errors + important messages
 #define LOGLEVEL_DEBUG	4 // almost everything
 
+// Current loglevel (SERIAL_LOGLEVEL until the setting "logLevel" is loaded)
+extern uint8_t gLogLevel;
+
+/* Logging is asynchronous: a call only stores the format-pointer and the raw arguments in a queue. The text is
+   rendered later by a low-priority task (serial console) or on request (/log). The level is checked before
+   the arguments are even evaluated, so a filtered call costs a compare.
+   Formats (and strings passed as %s) that live in flash are stored as pointers, everything else is copied. */
+
 /* Wrapper-function for serial-logging (with newline)
    _logBuffer: char* to log
    _minLogLevel: loglevel configured for this message.
-   If (_currentLogLevel <= _minLogLevel) message will be logged
+   If (gLogLevel >= _minLogLevel) message will be logged
 */
-void Log_Println(const char *_logBuffer, const uint8_t _minLogLevel);
+#define Log_Println(_logBuffer, _minLogLevel)                         \
+	do {                                                              \
+		if (gLogLevel >= (_minLogLevel)) {                            \
+			Log_RecordText((_logBuffer), (_minLogLevel), true, true); \
+		}                                                             \
+	} while (0)
 
 /* Wrapper-function for serial-logging (without newline) */
-void Log_Print(const char *_logBuffer, const uint8_t _minLogLevel, bool printTimestamp);
+#define Log_Print(_logBuffer, _minLogLevel, printTimestamp)                        \
+	do {                                                                           \
+		if (gLogLevel >= (_minLogLevel)) {                                         \
+			Log_RecordText((_logBuffer), (_minLogLevel), (printTimestamp), false); \
+		}                                                                          \
+	} while (0)
 
 /* Wrapper-function for printf serial-logging (with newline) */
-int Log_Printf(const uint8_t _minLogLevel, const char *format, ...);
+#define Log_Printf(_minLogLevel, ...)                \
+	do {                                             \
+		if (gLogLevel >= (_minLogLevel)) {           \
+			Log_Record((_minLogLevel), __VA_ARGS__); \
+		}                                            \
+	} while (0)
+
+void Log_RecordText(const char *text, const uint8_t level, const bool printTimestamp, const bool newline);
+void Log_Record(const uint8_t level, const char *format, ...);
+
+/* Reading the history incrementally (/log?since=, live-tail via websocket). Every line gets a sequence-number
+   (counted since boot); a cursor points to the next line and into it, so a reader can stop anywhere and continue
+   with the next call. Lines that were overwritten before they were read are skipped and counted in "lost". */
+typedef struct {
+	uint32_t seq; // next line
+	uint32_t offset; // already read characters of it
+	uint32_t lost;
+} logCursor_t;
 
 void Log_Init(void);
-String Log_GetRingBuffer(void);
+void Log_SetLevel(const uint8_t level);
+void Log_Flush(void);
+uint32_t Log_GetSequence(void);
+uint32_t Log_GetHistoryStart(void);
+size_t Log_ReadHistory(logCursor_t &cursor, const uint32_t end, char *buf, const size_t size);
+void Log_DumpHistory(Print &out);
+void Log_ToJSON(JsonObject obj);
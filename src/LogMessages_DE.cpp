@@ -42,7 +42,6 @@ const char trackStart[] = "Titel wird von vorne gespielt.";
 const char trackChangeWebstream[] = "Im Webradio-Modus kann nicht an den Anfang gesprungen werden.";
 const char endOfPlaylistReached[] = "Ende der Playlist erreicht.";
 const char trackStartatPos[] = "Titel wird abgespielt ab Position %u";
-const char waitingForTaskQueues[] = "Task Queue für RFID existiert noch nicht, warte...";
 const char rfidScannerReady[] = "RFID-Tags koennen jetzt gescannt werden...";
 const char rfidTagDetected[] = "RFID-Karte erkannt: %s";
 const char rfid15693TagDetected[] = "RFID-Karte (ISO-15693) erkannt: ";
@@ -188,7 +187,8 @@ const char playlistGen[] = "Playlist-Generierung";
 const char playlistRecDepth[] = "Playlist-Generierung mit Rekursionstiefe: %u";
 const char bootLoopDetected[] = "Bootschleife erkannt! Letzte RFID wird nicht aufgerufen.";
 const char noBootLoopDetected[] = "Keine Bootschleife erkannt. Wunderbar :-)";
-const char importCountNokNvs[] = "Anzahl der ungültigen Import-Einträge: %u";
+const char nvsImportInvalidLine[] = "Importdatei abgelehnt: Zeile %" PRIu32 " ist keine gültige RFID-Zuweisung";
+const char nvsImportSummary[] = "Importdatei geprüft: %u neue, %u geänderte, %u gelöschte, %u unveränderte, %u ungültige Einträge";
 const char errorReadingTmpfile[] = "Beim Lesen der temporären Importdatei ist ein Fehler aufgetreten!";
 const char errorWritingTmpfile[] = "Beim Schreiben der temporären Importdatei ist ein Fehler aufgetreten!";
 const char eraseRfidNvs[] = "NVS-RFID-Zuweisungen werden gelöscht...";
@@ -221,11 +221,13 @@ const char jumpForwardsToFolder[] = "Springe vorwärts ordnerweise: %s/";
 const char jumpBackwardsToFolder[] = "Springe rückwärts ordnerweise: %s/";
 const char JumpToPosition[] = "Sprung zu Position %u/%u";
 const char wroteLastTrackToNvs[] = "Schreibe '%s' in NVS für RFID-Card-ID %s mit Abspielmodus %d und letzter Track %u";
+const char playPosJournalCompacted[] = "Schreibe Abspielpositions-Checkpoint aus Journal in NVS für RFID-Card-ID %s (Track %u, Position %" PRIu32 "s)";
 const char wifiConnectionInProgress[] = "Versuche mit WLAN '%s' zu verbinden...";
 const char wifiConnectionSuccess[] = "Verbunden mit WLAN '%s' (Signalstärke: %d dBm, Kanal: %d, MAC-Adresse: %s)";
 const char wifiCurrentIp[] = "Aktuelle IP: %s";
 const char jsonErrorMsg[] = "deserializeJson() fehlgeschlagen: %s";
 const char jsonbufferOverflow[] = "JSON-Puffer zu klein für Daten";
+const char logMessagesDropped[] = "%u Log-Meldungen verworfen (Logger zu langsam)";
 const char wifiDeleteNetwork[] = "Lösche gespeichertes WLAN %s";
 const char wifiAddTooManyNetworks[] = "Kein Platz, weiteres WLAN zu speichern!";
 const char wifiAddNetwork[] = "Füge WLAN hinzu: %s";
@@ -42,7 +42,6 @@ const char trackStart[] = "Starting track from the very beginning.";
 const char trackChangeWebstream[] = "Playing from the very beginning is not possible while webradio-mode is active.";
 const char endOfPlaylistReached[] = "Reached end of playlist.";
 const char trackStartatPos[] = "Starting track at position %u";
-const char waitingForTaskQueues[] = "Task Queue for RFID does not exist yet, waiting...";
 const char rfidScannerReady[] = "RFID-tags can now be applied...";
 const char rfidTagDetected[] = "RFID-tag detected: %s";
 const char rfid15693TagDetected[] = "RFID-ta (ISO-15693) detected: ";
@@ -189,7 +188,8 @@ const char playlistGen[] = "Playlist-generation";
 const char playlistRecDepth[] = "Playlist-generation with recursion depth";
 const char bootLoopDetected[] = "Bootloop detected! Last RFID won't be restored.";
 const char noBootLoopDetected[] = "No bootloop detected. Great :-)";
-const char importCountNokNvs[] = "Number of invalid import-entries: %u";
+const char nvsImportInvalidLine[] = "Import-file rejected: line %" PRIu32 " is not a valid RFID-assignment";
+const char nvsImportSummary[] = "Checked import-file: %u new, %u changed, %u deleted, %u unchanged, %u invalid entries";
 const char errorReadingTmpfile[] = "Error occured while reading from import-tmpfile";
 const char errorWritingTmpfile[] = "Error occured while writing to import-tmpfile";
 const char eraseRfidNvs[] = "NVS-RFID-assignments are being deleted...";
@@ -222,11 +222,13 @@ const char jumpForwardsToFolder[] = "Jump forwards folderwise: %s/";
 const char jumpBackwardsToFolder[] = "Jump backwards folderwise: %s/";
 const char JumpToPosition[] = "Jumped to position %u/%u";
 const char wroteLastTrackToNvs[] = "Write '%s' to NVS for RFID-Card-ID %s with playmode %d and last track %u";
+const char playPosJournalCompacted[] = "Write play-position checkpoint from journal to NVS for RFID-Card-ID %s (track %u, position %" PRIu32 "s)";
 const char wifiConnectionInProgress[] = "Try to connect to WiFi with SSID '%s'...";
 const char wifiConnectionSuccess[] = "Connected with WiFi '%s' (signal strength: %d dBm, channel: %d, BSSID: %s)";
 const char wifiCurrentIp[] = "Current IP: %s";
 const char jsonErrorMsg[] = "deserializeJson() failed: %s";
 const char jsonbufferOverflow[] = "JSON buffer too small for data";
+const char logMessagesDropped[] = "%u log-messages dropped (logger too slow)";
 const char wifiDeleteNetwork[] = "Deleting saved WiFi %s";
 const char wifiAddTooManyNetworks[] = "No space left to add another WiFi network!";
 const char wifiAddNetwork[] = "Add WiFi network %s";
@@ -41,7 +41,6 @@ const char trackStart[] = "Démarrage de la piste depuis le début.";
 const char trackChangeWebstream[] = "Le démarrage depuis le début n'est pas possible en mode webradio.";
 const char endOfPlaylistReached[] = "Fin de la liste de lecture atteinte.";
 const char trackStartatPos[] = "Démarrage de la piste à la position %u";
-const char waitingForTaskQueues[] = "La file d'attente des tâches pour RFID n'existe pas encore, en attente...";
 const char rfidScannerReady[] = "Les tags RFID peuvent maintenant être appliqués...";
 const char rfidTagDetected[] = "Tag RFID détecté : %s";
 const char rfid15693TagDetected[] = "Tag RFID (ISO-15693) détecté : ";
@@ -187,7 +186,8 @@ const char playlistGen[] = "Génération de la liste de lecture";
 const char playlistRecDepth[] = "Génération de la liste de lecture avec profondeur de récursion";
 const char bootLoopDetected[] = "Boucle de démarrage détectée ! Le dernier RFID ne sera pas restauré.";
 const char noBootLoopDetected[] = "Aucune boucle de démarrage détectée. Super :-)";
-const char importCountNokNvs[] = "Nombre d'entrées d'importation non valides : %u";
+const char nvsImportInvalidLine[] = "Fichier d'importation rejeté : la ligne %" PRIu32 " n'est pas une affectation RFID valide";
+const char nvsImportSummary[] = "Fichier d'importation vérifié : %u nouvelles, %u modifiées, %u supprimées, %u inchangées, %u entrées non valides";
 const char errorReadingTmpfile[] = "Erreur lors de la lecture du fichier temporaire d'importation";
 const char errorWritingTmpfile[] = "Erreur lors de l'écriture dans le fichier temporaire d'importation";
 const char eraseRfidNvs[] = "Les affectations NVS-RFID sont en cours de suppression...";
@@ -220,11 +220,13 @@ const char jumpForwardsToFolder[] = "Avancer par dossiers: %s/";
 const char jumpBackwardsToFolder[] = "Reculer par dossiers: %s/";
 const char JumpToPosition[] = "Aller à la position %u/%u";
 const char wroteLastTrackToNvs[] = "Écriture de '%s' dans NVS pour l'ID de carte RFID %s avec le mode de lecture %d et la dernière piste %u";
+const char playPosJournalCompacted[] = "Écriture du point de contrôle de la position de lecture du journal dans NVS pour l'ID de carte RFID %s (piste %u, position %" PRIu32 "s)";
 const char wifiConnectionInProgress[] = "Tentative de connexion au WiFi avec le SSID '%s'...";
 const char wifiConnectionSuccess[] = "Connecté au WiFi '%s' (force du signal : %d dBm, canal : %d, BSSID : %s)";
 const char wifiCurrentIp[] = "Adresse IP actuelle : %s";
 const char jsonErrorMsg[] = "Échec de deserializeJson() : %s";
 const char jsonbufferOverflow[] = "Tampon JSON trop petit pour les données";
+const char logMessagesDropped[] = "%u messages de journal ignorés (journalisation trop lente)";
 const char wifiDeleteNetwork[] = "Suppression du réseau WiFi enregistré %s";
 const char wifiAddTooManyNetworks[] = "Plus d'espace disponible pour ajouter un autre réseau WiFi !";
 const char wifiAddNetwork[] = "Ajouter le réseau WiFi %s";
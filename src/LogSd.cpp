@@ -0,0 +1,221 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "LogSd.h"
+
+#ifdef LOG_SD_ENABLE
+	#include "AudioPlayer.h"
+	#include "SdCard.h"
+	#include "gitrevision.h"
+
+	#include <algorithm>
+	#include <esp_attr.h>
+	#include <esp_system.h>
+
+constexpr uint32_t logSdMagic = 0x44534c45; // "ELSD"
+constexpr size_t logSdBufferSize = 4096u;
+constexpr size_t logSdSectorSize = 512u;
+constexpr size_t logSdBatchSize = 2048u; // preferred size of a write
+constexpr uint32_t logSdIntervalMs = 1000u; // minimum time between two writes
+constexpr uint32_t logSdIntervalPlayingMs = 10000u; // ... while audio is playing (unless the buffer is getting full)
+constexpr uint32_t logSdMaxDelayMs = 60000u; // less than a sector is written after this (but not while playing)
+constexpr uint32_t logSdFileSize = 256u * 1024u; // rotate after this
+constexpr uint8_t logSdFiles = 4u; // espuino-0.log (current) ... espuino-3.log
+constexpr const char *logSdDir = "/.logs";
+
+// Lines that are not yet on SD. Kept in not-initialized RAM, so they are still there after a panic or watchdog-reset
+// and are written after the next boot (length is a single aligned word, it's only increased after the data was copied).
+typedef struct {
+	uint32_t magic;
+	uint32_t length;
+	char data[logSdBufferSize];
+} logSdPending_t;
+
+static __NOINIT_ATTR logSdPending_t LogSd_Pending;
+static portMUX_TYPE LogSd_Mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t LogSd_WriteMutex = nullptr; // log-task vs. LogSd_Flush()
+static bool LogSd_Ready = false; // SD is mounted
+static uint32_t LogSd_FileSize = 0u;
+static uint32_t LogSd_LastWriteMs = 0u;
+static uint32_t LogSd_OldestMs = 0u; // when the buffer became non-empty
+static uint32_t LogSd_Recovered = 0u;
+static uint32_t LogSd_Written = 0u;
+static uint32_t LogSd_Writes = 0u;
+static uint32_t LogSd_Rotations = 0u;
+static uint32_t LogSd_Errors = 0u;
+static uint32_t LogSd_Dropped = 0u;
+
+static const char *LogSd_ResetReason(const esp_reset_reason_t reason) {
+	switch (reason) {
+		case ESP_RST_POWERON:
+			return "power-on";
+		case ESP_RST_SW:
+			return "restart";
+		case ESP_RST_PANIC:
+			return "panic";
+		case ESP_RST_INT_WDT:
+			return "interrupt-watchdog";
+		case ESP_RST_TASK_WDT:
+			return "task-watchdog";
+		case ESP_RST_WDT:
+			return "watchdog";
+		case ESP_RST_DEEPSLEEP:
+			return "deep-sleep";
+		case ESP_RST_BROWNOUT:
+			return "brownout";
+		default:
+			return "other";
+	}
+}
+
+// Called by Log_Init() before the first line: takes over what's left from before the reset and writes the boot-header
+void LogSd_Init(void) {
+	const esp_reset_reason_t reason = esp_reset_reason();
+	// RAM is random after power-on and not retained in deep-sleep (everything was written before going to sleep)
+	const bool retained = (reason != ESP_RST_POWERON && reason != ESP_RST_DEEPSLEEP && reason != ESP_RST_BROWNOUT);
+	if (!retained || LogSd_Pending.magic != logSdMagic || LogSd_Pending.length > logSdBufferSize) {
+		LogSd_Pending.magic = logSdMagic;
+		LogSd_Pending.length = 0u;
+	}
+	LogSd_Recovered = LogSd_Pending.length;
+	LogSd_WriteMutex = xSemaphoreCreateMutex();
+
+	char header[160];
+	const int length = snprintf(header, sizeof(header), "\n===== boot: %s, reset-reason: %s, %" PRIu32 " bytes recovered from before the reset =====\n", softwareRevision, LogSd_ResetReason(reason), LogSd_Recovered);
+	LogSd_Append(header, std::min<size_t>(length, sizeof(header) - 1u));
+}
+
+// Called once the SD is mounted
+void LogSd_Start(void) {
+	File file = gFSystem.open(LogSd_GetPath(0), FILE_READ);
+	LogSd_FileSize = file ? file.size() : 0u;
+	file.close();
+	LogSd_Ready = true;
+}
+
+const String LogSd_GetPath(const uint8_t file) {
+	char path[32];
+	snprintf(path, sizeof(path), "%s/espuino-%u.log", logSdDir, file);
+	return path;
+}
+
+// Takes a rendered line (called by the log-task). Lines that don't fit anymore are dropped.
+void LogSd_Append(const char *line, const size_t length) {
+	portENTER_CRITICAL(&LogSd_Mux);
+	const uint32_t used = LogSd_Pending.length;
+	if (used + length > logSdBufferSize) {
+		LogSd_Dropped++;
+	} else {
+		memcpy(LogSd_Pending.data + used, line, length);
+		LogSd_Pending.length = used + length;
+		if (!used) {
+			LogSd_OldestMs = millis();
+		}
+	}
+	portEXIT_CRITICAL(&LogSd_Mux);
+}
+
+// Moves the files one up and starts a new espuino-0.log
+static void LogSd_Rotate(void) {
+	const String last = LogSd_GetPath(logSdFiles - 1u);
+	if (gFSystem.exists(last)) {
+		gFSystem.remove(last);
+	}
+	for (uint8_t i = logSdFiles - 1u; i > 0; i--) {
+		const String from = LogSd_GetPath(i - 1u);
+		if (gFSystem.exists(from)) {
+			gFSystem.rename(from, LogSd_GetPath(i));
+		}
+	}
+	LogSd_FileSize = 0u;
+	LogSd_Rotations++;
+}
+
+// Appends the first bytes of the buffer to the file. Appenders only touch the data behind them, so the write runs
+// without holding the spinlock.
+static void LogSd_Write(const size_t length) {
+	File file = gFSystem.open(LogSd_GetPath(0), FILE_APPEND, true); // create=true, so the directory is created
+	const size_t written = file ? file.write(reinterpret_cast<const uint8_t *>(LogSd_Pending.data), length) : 0u;
+	file.close();
+	LogSd_LastWriteMs = millis();
+	if (written != length) {
+		LogSd_Errors++;
+	}
+	if (!written) {
+		return;
+	}
+
+	portENTER_CRITICAL(&LogSd_Mux);
+	const uint32_t remaining = LogSd_Pending.length - written;
+	memmove(LogSd_Pending.data, LogSd_Pending.data + written, remaining);
+	LogSd_Pending.length = remaining;
+	LogSd_OldestMs = LogSd_LastWriteMs;
+	portEXIT_CRITICAL(&LogSd_Mux);
+
+	LogSd_FileSize += written;
+	LogSd_Written += written;
+	LogSd_Writes++;
+	if (LogSd_FileSize >= logSdFileSize) {
+		LogSd_Rotate();
+	}
+}
+
+// Called by the log-task after it wrote the queued lines: writes a batch if it's time for one
+void LogSd_Cyclic(void) {
+	if (!LogSd_Ready || !LogSd_Pending.length || xSemaphoreTake(LogSd_WriteMutex, 0) != pdTRUE) {
+		return;
+	}
+	const uint32_t now = millis();
+	const size_t pending = LogSd_Pending.length;
+	const bool playing = (gPlayProperties.playMode != NO_PLAYLIST) && !gPlayProperties.pausePlay;
+	// the audio-task reads from the same card: write seldom while playing, unless the buffer runs full
+	const uint32_t interval = (playing && pending < logSdBufferSize * 3u / 4u) ? logSdIntervalPlayingMs : logSdIntervalMs;
+	if (now - LogSd_LastWriteMs >= interval) {
+		// end the write on a sector-boundary of the file (whole sectors, no read-modify-write by the FAT-driver)
+		const size_t end = ((LogSd_FileSize + std::min(pending, logSdBatchSize)) / logSdSectorSize) * logSdSectorSize;
+		if (end > LogSd_FileSize) {
+			LogSd_Write(end - LogSd_FileSize);
+		} else if (!playing && now - LogSd_OldestMs >= logSdMaxDelayMs) {
+			LogSd_Write(pending);
+		}
+	}
+	xSemaphoreGive(LogSd_WriteMutex);
+}
+
+// Writes everything (before the SD is unmounted for restart or deep-sleep). Lines that are logged afterwards stay in
+// RAM and are written after a restart.
+void LogSd_Flush(void) {
+	if (!LogSd_Ready || xSemaphoreTake(LogSd_WriteMutex, portMAX_DELAY) != pdTRUE) {
+		return;
+	}
+	if (LogSd_Pending.length) {
+		LogSd_Write(LogSd_Pending.length);
+	}
+	LogSd_Ready = false;
+	xSemaphoreGive(LogSd_WriteMutex);
+}
+
+void LogSd_ToJSON(JsonObject obj) {
+	obj["pending"] = LogSd_Pending.length;
+	obj["recovered"] = LogSd_Recovered;
+	obj["written"] = LogSd_Written;
+	obj["writes"] = LogSd_Writes;
+	obj["rotations"] = LogSd_Rotations;
+	obj["errors"] = LogSd_Errors;
+	obj["dropped"] = LogSd_Dropped;
+	obj["fileSize"] = LogSd_FileSize;
+	if (LogSd_Ready) {
+		// sizes of espuino-0.log ... (download via /log?file=n)
+		JsonArray filesArr = obj["files"].to<JsonArray>();
+		for (uint8_t i = 0; i < logSdFiles; i++) {
+			File file = gFSystem.open(LogSd_GetPath(i), FILE_READ);
+			if (!file) {
+				break;
+			}
+			filesArr.add(file.size());
+			file.close();
+		}
+	}
+}
+
+#endif
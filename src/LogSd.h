@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+
+// Optional log-sink on SD: rendered lines are collected in a RAM-buffer that survives software-resets, panics and
+// watchdog-resets, and are appended to /.logs/espuino-0.log in large, sector-aligned batches. Writes are rate-limited
+// (even more while audio is playing), files are rotated by size (espuino-1.log is the previous one and so on).
+// Lines that didn't make it to SD before a crash are written after the next boot. Compiled out unless LOG_SD_ENABLE.
+
+#ifdef LOG_SD_ENABLE
+void LogSd_Init(void);
+void LogSd_Start(void);
+void LogSd_Append(const char *line, const size_t length);
+void LogSd_Cyclic(void);
+void LogSd_Flush(void);
+const String LogSd_GetPath(const uint8_t file);
+void LogSd_ToJSON(JsonObject obj);
+#endif
@@ -0,0 +1,138 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "LoopProfiler.h"
+
+#ifdef LOOP_PROFILER_ENABLE
+	#include "Log.h"
+	#include "Mqtt.h"
+
+	#include <algorithm>
+
+constexpr uint8_t loopProfilerBuckets = 32u; // bucket n: 2^(n-1) <= cycles < 2^n
+constexpr uint32_t loopProfilerStallLogMs = 100u; // a new worst call above this is logged
+constexpr uint32_t loopProfilerMqttIntervalMs = 60000u;
+
+typedef struct {
+	uint32_t count;
+	uint32_t minCycles;
+	uint32_t maxCycles;
+	uint64_t sumCycles;
+	uint32_t histogram[loopProfilerBuckets];
+} loopProfilerStats_t;
+
+// Only written by the loop-task; /debug reads without locking (a torn value is fine for diagnostics)
+static loopProfilerStats_t LoopProfiler_Handlers[static_cast<uint8_t>(LoopHandler::Count)];
+static loopProfilerStats_t LoopProfiler_Loop;
+static uint32_t LoopProfiler_WorstCycles = 0u;
+static LoopHandler LoopProfiler_WorstHandler = LoopHandler::Count;
+static uint32_t LoopProfiler_WorstTimestamp = 0u;
+static uint32_t LoopProfiler_LastMqttTimestamp = 0u;
+
+static inline void LoopProfiler_Add(loopProfilerStats_t &stats, const uint32_t cycles) {
+	if (!stats.count++ || cycles < stats.minCycles) {
+		stats.minCycles = cycles;
+	}
+	if (cycles > stats.maxCycles) {
+		stats.maxCycles = cycles;
+	}
+	stats.sumCycles += cycles;
+	stats.histogram[cycles ? std::min<uint8_t>(32 - __builtin_clz(cycles), loopProfilerBuckets - 1) : 0]++;
+}
+
+void LoopProfiler_Record(const LoopHandler handler, const uint32_t startCycles) {
+	const uint32_t cycles = ESP.getCycleCount() - startCycles;
+	LoopProfiler_Add(LoopProfiler_Handlers[static_cast<uint8_t>(handler)], cycles);
+	if (cycles > LoopProfiler_WorstCycles) {
+		LoopProfiler_WorstCycles = cycles;
+		LoopProfiler_WorstHandler = handler;
+		LoopProfiler_WorstTimestamp = millis();
+		const uint32_t ms = cycles / (getCpuFrequencyMhz() * 1000u);
+		if (ms >= loopProfilerStallLogMs) {
+			Log_Printf(LOGLEVEL_NOTICE, "LoopProfiler: %s took %" PRIu32 " ms", Scheduler_GetHandlerName(handler), ms);
+		}
+	}
+}
+
+// Whole pass of the scheduler (without the time it waited)
+void LoopProfiler_LoopFinished(const uint32_t startCycles) {
+	LoopProfiler_Add(LoopProfiler_Loop, ESP.getCycleCount() - startCycles);
+}
+
+// 99th percentile from the histogram, interpolated linearly within the bucket
+static uint32_t LoopProfiler_P99Cycles(const loopProfilerStats_t &stats) {
+	const uint32_t target = stats.count - stats.count / 100u;
+	uint32_t seen = 0u;
+	for (uint8_t bucket = 0; bucket < loopProfilerBuckets; bucket++) {
+		const uint32_t inBucket = stats.histogram[bucket];
+		if (seen + inBucket >= target && inBucket) {
+			const uint32_t low = bucket ? (1u << (bucket - 1)) : 0u;
+			const uint32_t high = std::min(bucket ? (low << 1) - 1u : 0u, stats.maxCycles);
+			return low + static_cast<uint32_t>((uint64_t) (high - std::min(low, high)) * (target - seen) / inBucket);
+		}
+		seen += inBucket;
+	}
+	return stats.maxCycles;
+}
+
+static void LoopProfiler_StatsToJSON(JsonObject obj, const loopProfilerStats_t &stats, const bool withHistogram) {
+	const float cyclesPerUs = getCpuFrequencyMhz();
+	obj["count"] = stats.count;
+	obj["minUs"] = stats.count ? stats.minCycles / cyclesPerUs : 0.0f;
+	obj["avgUs"] = stats.count ? (stats.sumCycles / stats.count) / cyclesPerUs : 0.0f;
+	obj["p99Us"] = stats.count ? LoopProfiler_P99Cycles(stats) / cyclesPerUs : 0.0f;
+	obj["maxUs"] = stats.maxCycles / cyclesPerUs;
+	if (withHistogram) {
+		// bucket n counts calls of 2^(n-1) up to 2^n cycles; trailing empty buckets are left out
+		JsonArray histogramArr = obj["log2Histogram"].to<JsonArray>();
+		uint8_t last = loopProfilerBuckets;
+		while (last && !stats.histogram[last - 1]) {
+			last--;
+		}
+		for (uint8_t bucket = 0; bucket < last; bucket++) {
+			histogramArr.add(stats.histogram[bucket]);
+		}
+	}
+}
+
+static void LoopProfiler_WorstToJSON(JsonObject obj) {
+	obj["handler"] = (LoopProfiler_WorstHandler != LoopHandler::Count) ? Scheduler_GetHandlerName(LoopProfiler_WorstHandler) : "";
+	obj["us"] = LoopProfiler_WorstCycles / static_cast<float>(getCpuFrequencyMhz());
+	obj["uptimeMs"] = LoopProfiler_WorstTimestamp;
+}
+
+void LoopProfiler_ToJSON(JsonObject obj) {
+	LoopProfiler_StatsToJSON(obj["loop"].to<JsonObject>(), LoopProfiler_Loop, true);
+	LoopProfiler_WorstToJSON(obj["worst"].to<JsonObject>());
+	JsonObject handlersObj = obj["handlers"].to<JsonObject>();
+	for (uint8_t i = 0; i < static_cast<uint8_t>(LoopHandler::Count); i++) {
+		if (LoopProfiler_Handlers[i].count) {
+			LoopProfiler_StatsToJSON(handlersObj[Scheduler_GetHandlerName(static_cast<LoopHandler>(i))].to<JsonObject>(), LoopProfiler_Handlers[i], true);
+		}
+	}
+}
+
+// Publishes a summary (without histograms) via MQTT once a minute
+void LoopProfiler_Cyclic(void) {
+	#ifdef MQTT_ENABLE
+	if (millis() - LoopProfiler_LastMqttTimestamp < loopProfilerMqttIntervalMs) {
+		return;
+	}
+	LoopProfiler_LastMqttTimestamp = millis();
+
+	JsonDocument doc;
+	LoopProfiler_StatsToJSON(doc["loop"].to<JsonObject>(), LoopProfiler_Loop, false);
+	LoopProfiler_WorstToJSON(doc["worst"].to<JsonObject>());
+	JsonObject handlersObj = doc["handlers"].to<JsonObject>();
+	for (uint8_t i = 0; i < static_cast<uint8_t>(LoopHandler::Count); i++) {
+		if (LoopProfiler_Handlers[i].count) {
+			LoopProfiler_StatsToJSON(handlersObj[Scheduler_GetHandlerName(static_cast<LoopHandler>(i))].to<JsonObject>(), LoopProfiler_Handlers[i], false);
+		}
+	}
+	String payload;
+	serializeJson(doc, payload);
+	publishMqtt(topicLoopProfile, payload.c_str(), false);
+	#endif
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+#include "Scheduler.h"
+
+// Runtime of the handlers of the main-loop, measured with the cycle-counter: min, avg, p99 and max plus a
+// log2-histogram per handler and per pass of the scheduler, and the slowest call seen so far. Compiled out completely
+// unless LOOP_PROFILER_ENABLE is set; the handlers are then called directly.
+
+#ifdef LOOP_PROFILER_ENABLE
+	#include <Esp.h>
+
+	// Measures one call; costs a few dozen cycles
+	#define LOOP_PROFILE(id, call)                                  \
+		do {                                                        \
+			const uint32_t loopProfileStart = ESP.getCycleCount(); \
+			call;                                                   \
+			LoopProfiler_Record(id, loopProfileStart);              \
+		} while (0)
+
+void LoopProfiler_Record(const LoopHandler handler, const uint32_t startCycles);
+void LoopProfiler_LoopFinished(const uint32_t startCycles);
+void LoopProfiler_Cyclic(void);
+void LoopProfiler_ToJSON(JsonObject obj);
+#else
+	#define LOOP_PROFILE(id, call) call
+#endif
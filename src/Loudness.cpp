@@ -0,0 +1,521 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Loudness.h"
+
+#include "Log.h"
+#include "SdCard.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+constexpr float loudnessReferenceLufs = -18.0f; // ReplayGain 2.0
+constexpr float loudnessMinGainDb = -24.0f;
+constexpr float loudnessMaxGainDb = 12.0f;
+constexpr float loudnessOpusReferenceOffsetDb = 5.0f; // R128-tags refer to -23 LUFS
+constexpr int16_t loudnessUnknown = INT16_MIN; // centi-dB / centi-LUFS
+constexpr uint32_t loudnessTagScanBytes = 16384u; // OGG: comment-header is expected within this
+constexpr uint8_t loudnessHistogramBinsPerLu = 4u;
+constexpr int16_t loudnessHistogramMinLufs = -70; // absolute gate
+constexpr int16_t loudnessHistogramMaxLufs = 5;
+constexpr uint16_t loudnessHistogramBins = (loudnessHistogramMaxLufs - loudnessHistogramMinLufs) * loudnessHistogramBinsPerLu;
+constexpr uint32_t loudnessBlockMs = 400u; // gating-block
+constexpr uint32_t loudnessBlockPeriodMs = 1600u; // one block is measured per period, the rest isn't filtered
+constexpr uint32_t loudnessWarmupMs = 20u; // filters settle before a block (RLB-highpass)
+constexpr uint8_t loudnessMinMeasuredPercent = 50u; // of the track, otherwise the result isn't stored
+constexpr uint8_t loudnessMaxPending = 8u;
+constexpr const char *loudnessCacheDir = "/.cache/loudness";
+constexpr const char *loudnessCacheFile = "/loudness.txt";
+
+// Gains of the current track (only touched by the audio-task)
+static int16_t Loudness_TagTrackGainCb = loudnessUnknown;
+static int16_t Loudness_TagAlbumGainCb = loudnessUnknown;
+static int16_t Loudness_CachedTrackLufsCb = loudnessUnknown;
+static int16_t Loudness_CachedAlbumLufsCb = loudnessUnknown; // all measured tracks of the folder
+static int16_t Loudness_TagTrackPeakCb = loudnessUnknown; // centi-dBFS
+static int16_t Loudness_TagAlbumPeakCb = loudnessUnknown;
+static int16_t Loudness_CachedTrackPeakCb = loudnessUnknown;
+static int16_t Loudness_CachedAlbumPeakCb = loudnessUnknown;
+static String Loudness_Path;
+
+// Results waiting to be written to SD while nothing is played
+typedef struct {
+	String path;
+	int16_t lufsCb;
+	uint16_t seconds;
+	int16_t peakCb;
+} loudnessResult_t;
+static loudnessResult_t Loudness_Pending[loudnessMaxPending];
+static uint8_t Loudness_PendingCount = 0;
+
+// Measurement. The state is only touched by the audio-lib's task; reset is requested by the audio-task.
+static std::atomic<bool> Loudness_Measuring {false};
+static std::atomic<bool> Loudness_ResetRequested {false};
+static uint32_t Loudness_Histogram[loudnessHistogramBins]; // 400 ms blocks per 0.25 LU above the absolute gate
+static uint32_t Loudness_Blocks = 0;
+static float Loudness_Peak = 0.0f; // sample-peak relative to full scale
+static uint32_t Loudness_SampleRate = 0;
+static uint32_t Loudness_WarmupFrames = 0;
+static uint32_t Loudness_BlockEndFrames = 0;
+static uint32_t Loudness_PeriodFrames = 0;
+static uint32_t Loudness_Pos = 0; // within the period
+static float Loudness_Energy = 0.0f; // of the running block
+
+// K-weighting: pre-filter (high-shelf) and RLB-highpass as biquads, Q29 coefficients, samples scaled to 24 bit
+typedef struct {
+	int32_t b0, b1, b2, a1, a2;
+} loudnessBiquad_t;
+typedef struct {
+	int32_t x1, x2, y1, y2;
+} loudnessBiquadState_t;
+static loudnessBiquad_t Loudness_Filter[2];
+static loudnessBiquadState_t Loudness_FilterState[2][2]; // [channel][stage]
+
+static int32_t Loudness_ToQ29(const double value) {
+	return static_cast<int32_t>(lround(value * (1 << 29)));
+}
+
+// Coefficients of ITU-R BS.1770 for any sample-rate (as in libebur128)
+static void Loudness_SetSampleRate(const uint32_t sampleRate) {
+	const double fs = sampleRate;
+	double k = tan(M_PI * 1681.974450955533 / fs);
+	const double vh = pow(10.0, 3.999843853973347 / 20.0);
+	const double vb = pow(vh, 0.4996667741545416);
+	double q = 0.7071752369554196;
+	double a0 = 1.0 + k / q + k * k;
+	Loudness_Filter[0] = {Loudness_ToQ29((vh + vb * k / q + k * k) / a0), Loudness_ToQ29(2.0 * (k * k - vh) / a0), Loudness_ToQ29((vh - vb * k / q + k * k) / a0), Loudness_ToQ29(2.0 * (k * k - 1.0) / a0), Loudness_ToQ29((1.0 - k / q + k * k) / a0)};
+
+	k = tan(M_PI * 38.13547087602444 / fs);
+	q = 0.5003270373238773;
+	a0 = 1.0 + k / q + k * k;
+	Loudness_Filter[1] = {Loudness_ToQ29(1.0), Loudness_ToQ29(-2.0), Loudness_ToQ29(1.0), Loudness_ToQ29(2.0 * (k * k - 1.0) / a0), Loudness_ToQ29((1.0 - k / q + k * k) / a0)};
+
+	Loudness_SampleRate = sampleRate;
+	Loudness_WarmupFrames = sampleRate * loudnessWarmupMs / 1000u;
+	Loudness_BlockEndFrames = Loudness_WarmupFrames + sampleRate * loudnessBlockMs / 1000u;
+	Loudness_PeriodFrames = sampleRate * loudnessBlockPeriodMs / 1000u;
+	memset(Loudness_FilterState, 0, sizeof(Loudness_FilterState));
+	Loudness_Pos = 0;
+	Loudness_Energy = 0.0f;
+}
+
+static inline int32_t Loudness_Biquad(const loudnessBiquad_t &f, loudnessBiquadState_t &s, const int32_t x) {
+	const int64_t acc = static_cast<int64_t>(f.b0) * x + static_cast<int64_t>(f.b1) * s.x1 + static_cast<int64_t>(f.b2) * s.x2 - static_cast<int64_t>(f.a1) * s.y1 - static_cast<int64_t>(f.a2) * s.y2;
+	const int32_t y = static_cast<int32_t>(acc >> 29);
+	s.x2 = s.x1;
+	s.x1 = x;
+	s.y2 = s.y1;
+	s.y1 = y;
+	return y;
+}
+
+// Energy of K-weighted frames (24 bit, summed over both channels)
+static uint64_t Loudness_KWeightedEnergy(const int32_t *buff, const uint32_t frames) {
+	uint64_t acc = 0;
+	for (uint32_t i = 0; i < frames; i++) {
+		for (uint8_t ch = 0; ch < 2; ch++) {
+			const int32_t x = buff[i * 2 + ch] >> 8; // 16 bit in the upper half -> 24 bit
+			const int32_t y = Loudness_Biquad(Loudness_Filter[1], Loudness_FilterState[ch][1], Loudness_Biquad(Loudness_Filter[0], Loudness_FilterState[ch][0], x));
+			acc += static_cast<uint64_t>(static_cast<int64_t>(y) * y) >> 16;
+		}
+	}
+	return acc;
+}
+
+// 400 ms block is complete: its loudness goes into the histogram
+static void Loudness_EndBlock(void) {
+	const float energy = Loudness_Energy / (Loudness_BlockEndFrames - Loudness_WarmupFrames);
+	Loudness_Energy = 0.0f;
+	Loudness_Blocks++;
+	if (energy <= 0.0f) {
+		return;
+	}
+	const float lufs = -0.691f + 10.0f * log10f(energy);
+	if (lufs > loudnessHistogramMinLufs) {
+		const int32_t bin = static_cast<int32_t>((lufs - loudnessHistogramMinLufs) * loudnessHistogramBinsPerLu);
+		Loudness_Histogram[std::min<int32_t>(bin, loudnessHistogramBins - 1)]++;
+	}
+}
+
+// Called by the audio-lib for every decoded buffer (before fades and announcements). The lib has already applied
+// the volume (gainQ15), which is divided out per buffer, so changing the volume doesn't change the result.
+// The K-weighting is expensive, so only one gating-block out of every 1.6 s is measured (a quarter of the frames);
+// the sample-peak is taken from all of them.
+void Loudness_Analyse(const int32_t *buff, const int16_t frames, const uint32_t sampleRate, const uint16_t gainQ15) {
+	if (!Loudness_Measuring.load()) {
+		return;
+	}
+	if (Loudness_ResetRequested.exchange(false)) {
+		memset(Loudness_Histogram, 0, sizeof(Loudness_Histogram));
+		Loudness_Blocks = 0;
+		Loudness_Peak = 0.0f;
+		Loudness_SampleRate = 0;
+	}
+	if (!sampleRate || !gainQ15 || frames <= 0) {
+		return;
+	}
+	if (sampleRate != Loudness_SampleRate) {
+		Loudness_SetSampleRate(sampleRate);
+	}
+
+	int32_t peak = 0;
+	for (int16_t i = 0; i < 2 * frames; i++) {
+		peak = std::max(peak, std::abs(buff[i] >> 16));
+	}
+	Loudness_Peak = std::max(Loudness_Peak, static_cast<float>(peak) / gainQ15);
+
+	// energy relative to full scale (16 bit: 2^30), corrected by the volume
+	const float scale = 1.0f / (static_cast<float>(gainQ15) * gainQ15);
+	uint32_t i = 0;
+	while (i < static_cast<uint32_t>(frames)) {
+		const uint32_t remaining = frames - i;
+		if (Loudness_Pos >= Loudness_BlockEndFrames) {
+			const uint32_t skip = std::min(remaining, Loudness_PeriodFrames - Loudness_Pos);
+			i += skip;
+			Loudness_Pos += skip;
+			if (Loudness_Pos == Loudness_PeriodFrames) {
+				Loudness_Pos = 0;
+				memset(Loudness_FilterState, 0, sizeof(Loudness_FilterState));
+			}
+			continue;
+		}
+		const bool warmup = (Loudness_Pos < Loudness_WarmupFrames);
+		const uint32_t n = std::min(remaining, (warmup ? Loudness_WarmupFrames : Loudness_BlockEndFrames) - Loudness_Pos);
+		const uint64_t acc = Loudness_KWeightedEnergy(&buff[i * 2], n);
+		if (!warmup) {
+			Loudness_Energy += acc * scale;
+		}
+		i += n;
+		Loudness_Pos += n;
+		if (Loudness_Pos == Loudness_BlockEndFrames) {
+			Loudness_EndBlock();
+		}
+	}
+}
+
+// Integrated loudness: absolute gate -70 LUFS, relative gate 10 LU below the mean above the absolute gate
+static float Loudness_GetIntegratedLufs(void) {
+	float binEnergy[2] = {0.0f, 0.0f};
+	uint32_t binBlocks[2] = {0, 0};
+	for (uint16_t bin = 0; bin < loudnessHistogramBins; bin++) {
+		if (Loudness_Histogram[bin]) {
+			binEnergy[0] += Loudness_Histogram[bin] * powf(10.0f, (loudnessHistogramMinLufs + (bin + 0.5f) / loudnessHistogramBinsPerLu + 0.691f) / 10.0f);
+			binBlocks[0] += Loudness_Histogram[bin];
+		}
+	}
+	if (!binBlocks[0]) {
+		return NAN;
+	}
+	const float relativeGate = -0.691f + 10.0f * log10f(binEnergy[0] / binBlocks[0]) - 10.0f;
+	for (uint16_t bin = 0; bin < loudnessHistogramBins; bin++) {
+		const float lufs = loudnessHistogramMinLufs + (bin + 0.5f) / loudnessHistogramBinsPerLu;
+		if (Loudness_Histogram[bin] && lufs > relativeGate) {
+			binEnergy[1] += Loudness_Histogram[bin] * powf(10.0f, (lufs + 0.691f) / 10.0f);
+			binBlocks[1] += Loudness_Histogram[bin];
+		}
+	}
+	return binBlocks[1] ? -0.691f + 10.0f * log10f(binEnergy[1] / binBlocks[1]) : NAN;
+}
+
+// "-6.54 dB" -> -654
+static int16_t Loudness_ParseGainCb(const char *value) {
+	char *end;
+	const float db = strtof(value, &end);
+	return (end != value && std::isfinite(db)) ? static_cast<int16_t>(lroundf(std::clamp(db, -60.0f, 60.0f) * 100.0f)) : loudnessUnknown;
+}
+
+// Linear peak "0.988553" -> -10 (centi-dBFS)
+static int16_t Loudness_ParsePeakCb(const char *value) {
+	char *end;
+	const float peak = strtof(value, &end);
+	return (end != value && std::isfinite(peak) && peak > 0.0f) ? static_cast<int16_t>(lroundf(std::clamp(2000.0f * log10f(peak), -6000.0f, 6000.0f))) : loudnessUnknown;
+}
+
+// Vorbis-comment or ID3-TXXX ("key", "value") of ReplayGain/R128
+static void Loudness_ParseTag(const char *key, const char *value) {
+	if (!strcasecmp(key, "REPLAYGAIN_TRACK_GAIN")) {
+		Loudness_TagTrackGainCb = Loudness_ParseGainCb(value);
+	} else if (!strcasecmp(key, "REPLAYGAIN_ALBUM_GAIN")) {
+		Loudness_TagAlbumGainCb = Loudness_ParseGainCb(value);
+	} else if (!strcasecmp(key, "REPLAYGAIN_TRACK_PEAK")) {
+		Loudness_TagTrackPeakCb = Loudness_ParsePeakCb(value);
+	} else if (!strcasecmp(key, "REPLAYGAIN_ALBUM_PEAK")) {
+		Loudness_TagAlbumPeakCb = Loudness_ParsePeakCb(value);
+	} else if (!strcasecmp(key, "R128_TRACK_GAIN") || !strcasecmp(key, "R128_ALBUM_GAIN")) {
+		// Q7.8 dB relative to -23 LUFS
+		const int16_t gainCb = static_cast<int16_t>(std::clamp<long>(strtol(value, nullptr, 10) * 100 / 256 + lroundf(loudnessOpusReferenceOffsetDb * 100.0f), -6000, 6000));
+		(!strcasecmp(key, "R128_TRACK_GAIN") ? Loudness_TagTrackGainCb : Loudness_TagAlbumGainCb) = gainCb;
+	}
+}
+
+// ID3v2.3/2.4: TXXX-frames (description, value); text in UTF-16 is reduced to ASCII
+static void Loudness_ReadId3Tags(File &file) {
+	uint8_t h[10];
+	if (file.read(h, 10) != 10 || memcmp(h, "ID3", 3) || h[3] < 3 || h[3] > 4) {
+		return;
+	}
+	const uint8_t version = h[3];
+	const uint32_t tagEnd = 10u + ((h[6] & 0x7F) << 21 | (h[7] & 0x7F) << 14 | (h[8] & 0x7F) << 7 | (h[9] & 0x7F));
+	uint32_t pos = 10;
+	if (h[5] & 0x40) { // extended header
+		uint8_t e[4];
+		if (file.read(e, 4) != 4) {
+			return;
+		}
+		pos += (version == 4) ? ((e[0] & 0x7F) << 21 | (e[1] & 0x7F) << 14 | (e[2] & 0x7F) << 7 | (e[3] & 0x7F)) : (4u + (e[0] << 24 | e[1] << 16 | e[2] << 8 | e[3]));
+	}
+	while (pos + 10 <= tagEnd && file.seek(pos) && file.read(h, 10) == 10 && h[0]) {
+		const uint32_t size = (version == 4) ? ((h[4] & 0x7F) << 21 | (h[5] & 0x7F) << 14 | (h[6] & 0x7F) << 7 | (h[7] & 0x7F)) : (h[4] << 24 | h[5] << 16 | h[6] << 8 | h[7]);
+		if (!memcmp(h, "TXXX", 4) && size > 1 && size < 256) {
+			uint8_t data[256];
+			if (file.read(data, size) != size) {
+				return;
+			}
+			char text[2][48] = {};
+			const bool utf16 = (data[0] == 1 || data[0] == 2);
+			uint8_t field = 0;
+			uint8_t len = 0;
+			for (uint32_t i = 1; i < size && field < 2; i += utf16 ? 2 : 1) {
+				uint16_t c = data[i];
+				if (utf16) {
+					if (i + 1 >= size) {
+						break;
+					}
+					if ((data[i] == 0xFF && data[i + 1] == 0xFE) || (data[i] == 0xFE && data[i + 1] == 0xFF)) {
+						continue; // BOM
+					}
+					c = data[i] | data[i + 1]; // ASCII is in one of the bytes, the other one is 0
+				}
+				if (!c) {
+					field++;
+					len = 0;
+				} else if (len < sizeof(text[0]) - 1) {
+					text[field][len++] = c;
+				}
+			}
+			Loudness_ParseTag(text[0], text[1]);
+		}
+		pos += 10u + size;
+	}
+}
+
+// List of "key=value" as in FLAC's VORBIS_COMMENT-block and OGG's comment-header (behind the vendor-string)
+static void Loudness_ParseVorbisComments(const uint8_t *data, const uint32_t size) {
+	auto le32 = [data](const uint32_t pos) {
+		return data[pos] | data[pos + 1] << 8 | data[pos + 2] << 16 | static_cast<uint32_t>(data[pos + 3]) << 24;
+	};
+	if (size < 8) {
+		return;
+	}
+	uint32_t pos = 4u + le32(0);
+	if (pos + 4 > size) {
+		return;
+	}
+	const uint32_t count = le32(pos);
+	pos += 4;
+	for (uint32_t i = 0; i < count && pos + 4 <= size; i++) {
+		const uint32_t len = le32(pos);
+		pos += 4;
+		if (len > size - pos) {
+			return;
+		}
+		char comment[64];
+		if (len < sizeof(comment)) {
+			memcpy(comment, &data[pos], len);
+			comment[len] = '\0';
+			char *value = strchr(comment, '=');
+			if (value) {
+				*value++ = '\0';
+				Loudness_ParseTag(comment, value);
+			}
+		}
+		pos += len;
+	}
+}
+
+static void Loudness_ReadVorbisTags(File &file) {
+	uint8_t *buf = (uint8_t *) malloc(loudnessTagScanBytes);
+	if (!buf) {
+		return;
+	}
+	const uint32_t len = file.read(buf, loudnessTagScanBytes);
+	if (len >= 8 && !memcmp(buf, "fLaC", 4)) {
+		// metadata-blocks: type 4 is VORBIS_COMMENT
+		uint32_t pos = 4;
+		while (pos + 4 <= len) {
+			const uint8_t type = buf[pos] & 0x7F;
+			const uint32_t size = buf[pos + 1] << 16 | buf[pos + 2] << 8 | buf[pos + 3];
+			if (type == 4) {
+				if (pos + 4 + size > len && (!file.seek(pos + 4) || size > loudnessTagScanBytes || file.read(buf, size) != size)) {
+					break;
+				}
+				Loudness_ParseVorbisComments((pos + 4 + size > len) ? buf : &buf[pos + 4], size);
+				break;
+			}
+			if (buf[pos] & 0x80) { // last block
+				break;
+			}
+			pos += 4u + size;
+		}
+	} else if (len >= 4 && !memcmp(buf, "OggS", 4)) {
+		// comment-header of Vorbis or Opus (usually within the second page)
+		for (uint32_t pos = 0; pos + 8 <= len; pos++) {
+			if (!memcmp(&buf[pos], "\x03vorbis", 7)) {
+				Loudness_ParseVorbisComments(&buf[pos + 7], len - pos - 7);
+				break;
+			}
+			if (!memcmp(&buf[pos], "OpusTags", 8)) {
+				Loudness_ParseVorbisComments(&buf[pos + 8], len - pos - 8);
+				break;
+			}
+		}
+	}
+	free(buf);
+}
+
+static String Loudness_GetCachePath(const String &path) {
+	String cachePath = loudnessCacheDir;
+	cachePath.concat(path.substring(0, path.lastIndexOf('/')));
+	cachePath.concat(loudnessCacheFile);
+	return cachePath;
+}
+
+// Cache-file of the folder: "<file name>;<LUFS * 100>;<seconds>;<peak dBFS * 100>" per line
+static void Loudness_ReadCache(const String &path) {
+	File file = gFSystem.open(Loudness_GetCachePath(path), FILE_READ);
+	if (!file) {
+		return;
+	}
+	const String name = path.substring(path.lastIndexOf('/') + 1);
+	float albumEnergy = 0.0f;
+	uint32_t albumSeconds = 0;
+	while (file.available()) {
+		const String line = file.readStringUntil('\n');
+		const int sep1 = line.lastIndexOf(';');
+		const int sep2 = (sep1 > 0) ? line.lastIndexOf(';', sep1 - 1) : -1;
+		const int sep3 = (sep2 > 0) ? line.lastIndexOf(';', sep2 - 1) : -1;
+		if (sep3 <= 0) {
+			continue;
+		}
+		const int16_t lufsCb = line.substring(sep3 + 1, sep2).toInt();
+		const uint32_t seconds = line.substring(sep2 + 1, sep1).toInt();
+		const int16_t peakCb = line.substring(sep1 + 1).toInt();
+		if (line.substring(0, sep3) == name) {
+			Loudness_CachedTrackLufsCb = lufsCb;
+			Loudness_CachedTrackPeakCb = peakCb;
+		}
+		albumEnergy += seconds * powf(10.0f, lufsCb / 1000.0f);
+		albumSeconds += seconds;
+		Loudness_CachedAlbumPeakCb = std::max(Loudness_CachedAlbumPeakCb, peakCb);
+	}
+	file.close();
+	if (albumSeconds) {
+		Loudness_CachedAlbumLufsCb = lroundf(1000.0f * log10f(albumEnergy / albumSeconds));
+	}
+}
+
+// Reads the gains of a track (tags, cache) and starts measuring it if it's unknown; nullptr for webstreams
+void Loudness_TrackStarted(const char *path, const ReplayGainMode mode) {
+	Loudness_Measuring = false;
+	Loudness_TagTrackGainCb = loudnessUnknown;
+	Loudness_TagAlbumGainCb = loudnessUnknown;
+	Loudness_CachedTrackLufsCb = loudnessUnknown;
+	Loudness_CachedAlbumLufsCb = loudnessUnknown;
+	Loudness_TagTrackPeakCb = loudnessUnknown;
+	Loudness_TagAlbumPeakCb = loudnessUnknown;
+	Loudness_CachedTrackPeakCb = loudnessUnknown;
+	Loudness_CachedAlbumPeakCb = loudnessUnknown;
+	Loudness_Path = path ? path : "";
+	if (!path || mode == ReplayGainMode::Off) {
+		return;
+	}
+
+	File file = gFSystem.open(path, FILE_READ);
+	if (file) {
+		Loudness_ReadId3Tags(file);
+		if (Loudness_TagTrackGainCb == loudnessUnknown && file.seek(0)) {
+			Loudness_ReadVorbisTags(file);
+		}
+		file.close();
+	}
+	Loudness_ReadCache(Loudness_Path);
+	// measured, but not written yet
+	for (uint8_t i = 0; i < Loudness_PendingCount; i++) {
+		if (Loudness_Pending[i].path == Loudness_Path) {
+			Loudness_CachedTrackLufsCb = Loudness_Pending[i].lufsCb;
+			Loudness_CachedTrackPeakCb = Loudness_Pending[i].peakCb;
+		}
+	}
+
+	if (Loudness_TagTrackGainCb == loudnessUnknown && Loudness_CachedTrackLufsCb == loudnessUnknown) {
+		Loudness_ResetRequested = true;
+		Loudness_Measuring = true;
+	}
+	Log_Printf(LOGLEVEL_DEBUG, "Loudness: %.2f dB (track), %.2f dB (album), peak %.2f dBFS%s", Loudness_GetGainDb(ReplayGainMode::Track), Loudness_GetGainDb(ReplayGainMode::Album), Loudness_GetPeakDb(ReplayGainMode::Track), Loudness_Measuring ? ", measuring" : "");
+}
+
+// Gain to apply to the current track; 0 if it's unknown
+float Loudness_GetGainDb(const ReplayGainMode mode) {
+	int16_t gainCb = loudnessUnknown;
+	if (mode == ReplayGainMode::Album) {
+		if (Loudness_TagAlbumGainCb != loudnessUnknown) {
+			gainCb = Loudness_TagAlbumGainCb;
+		} else if (Loudness_TagTrackGainCb == loudnessUnknown && Loudness_CachedAlbumLufsCb != loudnessUnknown) {
+			gainCb = lroundf(loudnessReferenceLufs * 100.0f) - Loudness_CachedAlbumLufsCb;
+		}
+	}
+	if (mode != ReplayGainMode::Off && gainCb == loudnessUnknown) {
+		if (Loudness_TagTrackGainCb != loudnessUnknown) {
+			gainCb = Loudness_TagTrackGainCb;
+		} else if (Loudness_CachedTrackLufsCb != loudnessUnknown) {
+			gainCb = lroundf(loudnessReferenceLufs * 100.0f) - Loudness_CachedTrackLufsCb;
+		}
+	}
+	return (gainCb == loudnessUnknown) ? 0.0f : std::clamp(gainCb / 100.0f, loudnessMinGainDb, loudnessMaxGainDb);
+}
+
+// Sample-peak (dBFS) the gain of the mode refers to; 0 if it's unknown, so the level isn't raised then
+float Loudness_GetPeakDb(const ReplayGainMode mode) {
+	int16_t peakCb = loudnessUnknown;
+	if (mode == ReplayGainMode::Album) {
+		peakCb = (Loudness_TagAlbumPeakCb != loudnessUnknown) ? Loudness_TagAlbumPeakCb : Loudness_CachedAlbumPeakCb;
+	}
+	if (mode != ReplayGainMode::Off && peakCb == loudnessUnknown) {
+		peakCb = (Loudness_TagTrackPeakCb != loudnessUnknown) ? Loudness_TagTrackPeakCb : Loudness_CachedTrackPeakCb;
+	}
+	return (peakCb == loudnessUnknown) ? 0.0f : peakCb / 100.0f;
+}
+
+// Track played to its end: keep the result of the measurement (if enough of it was heard)
+void Loudness_TrackFinished(const uint32_t durationSec) {
+	if (!Loudness_Measuring.exchange(false)) {
+		return;
+	}
+	const uint32_t measuredSec = Loudness_Blocks * loudnessBlockPeriodMs / 1000u;
+	const float lufs = Loudness_GetIntegratedLufs();
+	if (!durationSec || measuredSec * 100u < durationSec * loudnessMinMeasuredPercent || std::isnan(lufs)) {
+		Log_Printf(LOGLEVEL_DEBUG, "Loudness: not enough measured (%" PRIu32 " of %" PRIu32 " s)", measuredSec, durationSec);
+		return;
+	}
+	Log_Printf(LOGLEVEL_INFO, "Loudness: %s has %.1f LUFS", Loudness_Path.c_str(), lufs);
+	if (Loudness_PendingCount < loudnessMaxPending) {
+		const int16_t peakCb = (Loudness_Peak > 0.0f) ? lroundf(std::clamp(2000.0f * log10f(Loudness_Peak), -6000.0f, 6000.0f)) : loudnessUnknown;
+		Loudness_Pending[Loudness_PendingCount++] = {Loudness_Path, static_cast<int16_t>(lroundf(lufs * 100.0f)), static_cast<uint16_t>(std::min<uint32_t>(durationSec, UINT16_MAX)), peakCb};
+	}
+}
+
+// Writes measured results to the cache while nothing is played (SD-card is free then)
+void Loudness_Cyclic(const bool idle) {
+	if (!idle || !Loudness_PendingCount) {
+		return;
+	}
+	const loudnessResult_t &result = Loudness_Pending[--Loudness_PendingCount];
+	File file = gFSystem.open(Loudness_GetCachePath(result.path), FILE_APPEND, true); // create=true, so the directories are created
+	if (!file) {
+		Log_Println("Loudness: writing cache failed", LOGLEVEL_ERROR);
+		return;
+	}
+	file.printf("%s;%d;%u;%d\n", result.path.substring(result.path.lastIndexOf('/') + 1).c_str(), result.lufsCb, result.seconds, result.peakCb);
+	file.close();
+}
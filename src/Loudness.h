@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Loudness-normalisation (ReplayGain). The gain of a track is taken from its ReplayGain-/R128-tags. Tracks without
+// tags are measured while they're played (integrated loudness as in ITU-R BS.1770, fixed-point K-weighting) and the
+// result is cached on SD (/.cache/loudness/<folder>/loudness.txt), so they're normalised from the next time on.
+
+enum class ReplayGainMode : uint8_t {
+	Off = 0,
+	Track,
+	Album
+};
+
+void Loudness_TrackStarted(const char *path, const ReplayGainMode mode);
+float Loudness_GetGainDb(const ReplayGainMode mode);
+float Loudness_GetPeakDb(const ReplayGainMode mode);
+void Loudness_TrackFinished(const uint32_t durationSec);
+void Loudness_Cyclic(const bool idle);
+void Loudness_Analyse(const int32_t *buff, const int16_t frames, const uint32_t sampleRate, const uint16_t gainQ15);
@@ -0,0 +1,176 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Metrics.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <math.h>
+
+constexpr uint8_t metricsMax = 64u;
+constexpr const char *metricsPrefix = "espuino_";
+constexpr const char *metricsTypeNames[] = {"counter", "gauge", "histogram"};
+
+enum class MetricSource : uint8_t {
+	Value,
+	Atomic,
+	Histogram,
+	Collector,
+};
+
+typedef struct {
+	const char *name;
+	const char *help;
+	MetricType type;
+	MetricSource source;
+	union {
+		const uint32_t *value;
+		const std::atomic<uint32_t> *atomicValue;
+		const MetricsHistogram *histogram;
+		metricsCollector_t collector;
+	};
+} metric_t;
+
+// Entries are only added (by the loop-task); /metrics reads the ones below the count without locking
+static metric_t Metrics_Entries[metricsMax];
+static std::atomic<uint8_t> Metrics_Count {0};
+
+static void Metrics_Add(const metric_t &metric) {
+	const uint8_t count = Metrics_Count;
+	for (uint8_t i = 0; i < count; i++) {
+		if (!strcmp(Metrics_Entries[i].name, metric.name)) {
+			return;
+		}
+	}
+	if (count >= metricsMax) {
+		Log_Printf(LOGLEVEL_ERROR, "Metrics: no room for %s", metric.name);
+		return;
+	}
+	Metrics_Entries[count] = metric;
+	Metrics_Count = count + 1u;
+}
+
+void Metrics_Register(const char *name, const MetricType type, const char *help, const uint32_t *value) {
+	metric_t metric = {name, help, type, MetricSource::Value, {}};
+	metric.value = value;
+	Metrics_Add(metric);
+}
+
+void Metrics_Register(const char *name, const MetricType type, const char *help, const std::atomic<uint32_t> *value) {
+	metric_t metric = {name, help, type, MetricSource::Atomic, {}};
+	metric.atomicValue = value;
+	Metrics_Add(metric);
+}
+
+void Metrics_Register(const char *name, const char *help, const MetricsHistogram *histogram) {
+	metric_t metric = {name, help, MetricType::Histogram, MetricSource::Histogram, {}};
+	metric.histogram = histogram;
+	Metrics_Add(metric);
+}
+
+void Metrics_Register(const char *name, const MetricType type, const char *help, const metricsCollector_t collector) {
+	metric_t metric = {name, help, type, MetricSource::Collector, {}};
+	metric.collector = collector;
+	Metrics_Add(metric);
+}
+
+// Appends a complete line or nothing (so the text never ends in the middle of a line)
+static void Metrics_Append(metricsWriter_t &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void Metrics_Append(metricsWriter_t &out, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	const int length = vsnprintf(out.buf + out.pos, out.size - out.pos, format, args);
+	va_end(args);
+	if (length > 0 && static_cast<size_t>(length) < out.size - out.pos) {
+		out.pos += length;
+	}
+}
+
+static const char *Metrics_FormatValue(const double value, char *buf, const size_t size) {
+	if (isnan(value)) {
+		return "NaN";
+	}
+	if (isinf(value)) {
+		return (value > 0) ? "+Inf" : "-Inf";
+	}
+	snprintf(buf, size, "%.15g", value);
+	return buf;
+}
+
+void Metrics_Sample(metricsWriter_t &out, const double value) {
+	char valueStr[24];
+	Metrics_Append(out, "%s%s %s\n", metricsPrefix, out.name, Metrics_FormatValue(value, valueStr, sizeof(valueStr)));
+}
+
+// Label values are identifiers of the firmware, so they aren't escaped
+void Metrics_Sample(metricsWriter_t &out, const double value, const char *label, const char *labelValue) {
+	char valueStr[24];
+	Metrics_Append(out, "%s%s{%s=\"%s\"} %s\n", metricsPrefix, out.name, label, labelValue, Metrics_FormatValue(value, valueStr, sizeof(valueStr)));
+}
+
+static void Metrics_WriteHistogram(metricsWriter_t &out, const MetricsHistogram &histogram) {
+	// copy first, so the buckets, sum and count fit together (as far as possible without locking)
+	uint32_t counts[MetricsHistogram::buckets];
+	for (uint8_t i = 0; i < MetricsHistogram::buckets; i++) {
+		counts[i] = histogram.counts[i].load(std::memory_order_relaxed);
+	}
+	const uint64_t sumUs = histogram.sumUs.load(std::memory_order_relaxed);
+
+	uint32_t cumulative = 0u;
+	uint32_t boundUs = MetricsHistogram::firstBoundUs;
+	for (uint8_t i = 0; i < MetricsHistogram::buckets; i++) {
+		cumulative += counts[i];
+		if (i < MetricsHistogram::buckets - 1u) {
+			Metrics_Append(out, "%s%s_bucket{le=\"%g\"} %" PRIu32 "\n", metricsPrefix, out.name, boundUs / 1000000.0, cumulative);
+			boundUs *= 4u;
+		} else {
+			Metrics_Append(out, "%s%s_bucket{le=\"+Inf\"} %" PRIu32 "\n", metricsPrefix, out.name, cumulative);
+		}
+	}
+	Metrics_Append(out, "%s%s_sum %.6f\n", metricsPrefix, out.name, sumUs / 1000000.0);
+	Metrics_Append(out, "%s%s_count %" PRIu32 "\n", metricsPrefix, out.name, cumulative);
+}
+
+static size_t Metrics_Render(const metric_t &metric, char *buf, const size_t size) {
+	metricsWriter_t out = {buf, size, 0u, metric.name};
+	Metrics_Append(out, "# HELP %s%s %s\n", metricsPrefix, metric.name, metric.help);
+	Metrics_Append(out, "# TYPE %s%s %s\n", metricsPrefix, metric.name, metricsTypeNames[static_cast<uint8_t>(metric.type)]);
+	switch (metric.source) {
+		case MetricSource::Value:
+			Metrics_Sample(out, *metric.value);
+			break;
+		case MetricSource::Atomic:
+			Metrics_Sample(out, metric.atomicValue->load(std::memory_order_relaxed));
+			break;
+		case MetricSource::Histogram:
+			Metrics_WriteHistogram(out, *metric.histogram);
+			break;
+		case MetricSource::Collector:
+			metric.collector(out);
+			break;
+	}
+	return out.pos;
+}
+
+// Renders the metrics from the cursor on into buf and moves the cursor. A metric is rendered completely before it's
+// sent, so its samples are taken at the same time even if it's continued by the next call. Returns the number of
+// characters (no terminator), 0 at the end.
+size_t Metrics_Read(metricsCursor_t &cursor, char *buf, const size_t size) {
+	size_t pos = 0u;
+	while (pos < size) {
+		if (cursor.offset >= cursor.length) {
+			if (cursor.metric >= Metrics_Count) {
+				break;
+			}
+			cursor.length = Metrics_Render(Metrics_Entries[cursor.metric++], cursor.text, sizeof(cursor.text));
+			cursor.offset = 0u;
+			continue;
+		}
+		const size_t count = std::min<size_t>(cursor.length - cursor.offset, size - pos);
+		memcpy(buf + pos, cursor.text + cursor.offset, count);
+		pos += count;
+		cursor.offset += count;
+	}
+	return pos;
+}
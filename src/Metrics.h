@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Metrics in the text-format of Prometheus, streamed by /metrics. A module keeps its counters in its own variables,
+// increments them where things happen and registers them once at init (name, help and a pointer): nothing is added to
+// the hot path, the values are only read when /metrics is scraped. Values that are computed on request (heap, RSSI) or
+// have labels are registered as a function that writes the samples.
+// Names get the prefix "espuino_"; use base units (bytes, seconds) and end the names of counters with "_total".
+
+constexpr size_t metricsFamilySize = 2048u; // rendered text of one metric (help, type and all samples)
+
+enum class MetricType : uint8_t {
+	Counter,
+	Gauge,
+	Histogram,
+};
+
+// Latency-histogram with fixed buckets of 100 µs, 400 µs, ... 409.6 ms and +Inf. observe() can be called from any
+// task while /metrics reads it (keep it in internal RAM, atomics don't work on PSRAM).
+class MetricsHistogram {
+public:
+	static constexpr uint8_t buckets = 8u;
+	static constexpr uint32_t firstBoundUs = 100u; // every further bound is 4 times the previous one
+
+	void observe(const uint32_t us) {
+		uint8_t i = 0;
+		for (uint32_t bound = firstBoundUs; i < buckets - 1u && us > bound; bound *= 4u) {
+			i++;
+		}
+		counts[i].fetch_add(1u, std::memory_order_relaxed);
+		sumUs.fetch_add(us, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint32_t> counts[buckets] = {};
+	std::atomic<uint64_t> sumUs {0u};
+};
+
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t pos;
+	const char *name;
+} metricsWriter_t;
+
+typedef void (*metricsCollector_t)(metricsWriter_t &out);
+
+// Registration (only from the loop-task, a name that's already registered is ignored)
+void Metrics_Register(const char *name, const MetricType type, const char *help, const uint32_t *value);
+void Metrics_Register(const char *name, const MetricType type, const char *help, const std::atomic<uint32_t> *value);
+void Metrics_Register(const char *name, const char *help, const MetricsHistogram *histogram);
+void Metrics_Register(const char *name, const MetricType type, const char *help, const metricsCollector_t collector);
+
+// Writes a sample of the metric that's collected, optionally with a label (name and value)
+void Metrics_Sample(metricsWriter_t &out, const double value);
+void Metrics_Sample(metricsWriter_t &out, const double value, const char *label, const char *labelValue);
+
+typedef struct {
+	uint8_t metric; // next one to render
+	uint16_t offset; // of the rendered text that's already sent
+	uint16_t length;
+	char text[metricsFamilySize];
+} metricsCursor_t;
+
+size_t Metrics_Read(metricsCursor_t &cursor, char *buf, const size_t size);
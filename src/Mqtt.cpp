@@ -4,10 +4,10 @@
 #include "Mqtt.h"
 
 #include "AudioPlayer.h"
+#include "CommandBus.h"
 #include "Led.h"
 #include "Log.h"
 #include "MemX.h"
-#include "Queues.h"
 #include "System.h"
 #include "Wlan.h"
 #include "gitrevision.h"
@@ -456,7 +456,7 @@ void Mqtt_ClientCallback(const char *topic_buf, uint32_t topic_length, const cha
 		// New track to play? Take RFID-ID as input
 		else if (reduced_topic_str == topicRfid) {
 			if (payload_str.size() >= (cardIdStringSize - 1)) {
-				xQueueSend(gRfidCardQueue, payload_str.data(), 0);
+				CommandBus_PostRfidCard(payload_str.data(), CommandSource::Mqtt);
 			} else {
 				System_IndicateError();
 			}
@@ -468,7 +468,7 @@ void Mqtt_ClientCallback(const char *topic_buf, uint32_t topic_length, const cha
 				return;
 			}
 			unsigned long vol = toNumber<uint32_t>(payload_str);
-			AudioPlayer_SetVolume(vol);
+			CommandBus_PostVolume(std::min<unsigned long>(vol, UINT8_MAX), CommandSource::Mqtt);
 		}
 		// Modify sleep-timer?
 		else if (reduced_topic_str == topicSleepTimer) {
@@ -538,7 +538,7 @@ void Mqtt_ClientCallback(const char *topic_buf, uint32_t topic_length, const cha
 				Log_Println(notAllowedInCurrentMode, LOGLEVEL_NOTICE);
 				return;
 			}
-			AudioPlayer_SetTrackControl(controlCommand);
+			CommandBus_PostTrackControl(controlCommand, CommandSource::Mqtt);
 		}
 
 		// Ambient Light
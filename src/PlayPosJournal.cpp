@@ -0,0 +1,184 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "PlayPosJournal.h"
+
+#include "Log.h"
+
+#include <esp_attr.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+
+// Append-only journal for periodic play-position checkpoints.
+// Writing every checkpoint into NVS costs a flash-write of the whole RFID-entry (plus erase every now and then)
+// and blocks the loop for a few milliseconds. Instead checkpoints are appended as 32-byte records to the raw
+// data-partition "ppjournal" (see the partition-tables): a record is a single flash-write, a sector is only erased
+// when the ring comes back to it (every 128 records), and it survives a loss of power. So the position is
+// journalled every few seconds, while NVS is only written at the usual points (track-boundaries, pause,
+// shutdown) and by the compaction after a reboot.
+// Devices that were updated by OTA keep their old partition-table without "ppjournal". There the ring lives in
+// RTC-memory, which survives software-resets, panics, watchdog-resets, brownouts and deepsleep, but not a loss
+// of power - so AudioPlayer keeps its periodic NVS-checkpoint (PlayPosJournal_IsDurable()).
+// Every record carries its sequence-number, the newest sequence-number that is in NVS already, and a CRC. A
+// record is written into an erased slot only, so a reset in the middle of an append leaves at most this record
+// broken, while the previous one is still intact and gets replayed instead. A broken slot is skipped.
+
+constexpr const char *playPosJournalPartition = "ppjournal";
+constexpr uint32_t playPosJournalSectorSize = 4096u;
+constexpr uint8_t playPosJournalRtcSlots = 8u;
+
+typedef struct {
+	uint32_t seq; // 0xFFFFFFFF: erased slot
+	uint32_t compactedSeq; // newest sequence-number that was in NVS when this record was written
+	PlayPosJournalEntry entry;
+	uint32_t crc; // has to be the last member, covers everything in front of it
+} PlayPosJournalRecord;
+
+static_assert(sizeof(PlayPosJournalRecord) == 32u, "records fill the flash-sectors exactly");
+
+typedef struct {
+	PlayPosJournalRecord records[playPosJournalRtcSlots];
+} PlayPosJournalRing;
+
+static RTC_NOINIT_ATTR PlayPosJournalRing PlayPosJournal_Ring; // fallback without partition
+static const esp_partition_t *PlayPosJournal_Partition = nullptr;
+static uint32_t PlayPosJournal_Slots = 0u;
+static uint32_t PlayPosJournal_SlotsPerSector = 1u; // RTC: every slot is "erased" on its own
+static uint32_t PlayPosJournal_HeadSlot = 0u;
+static PlayPosJournalRecord PlayPosJournal_Head; // newest valid record (seq 0: none)
+
+static uint32_t PlayPosJournal_Crc(const PlayPosJournalRecord *_record) {
+	return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(_record), offsetof(PlayPosJournalRecord, crc));
+}
+
+static bool PlayPosJournal_IsValid(const PlayPosJournalRecord *_record) {
+	return _record->seq != 0u && _record->seq != UINT32_MAX && _record->crc == PlayPosJournal_Crc(_record);
+}
+
+static bool PlayPosJournal_IsErased(const PlayPosJournalRecord *_record) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(_record);
+	for (size_t i = 0; i < sizeof(PlayPosJournalRecord); i++) {
+		if (bytes[i] != 0xFF) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool PlayPosJournal_Read(const uint32_t _slot, PlayPosJournalRecord *_record) {
+	if (!PlayPosJournal_Partition) {
+		*_record = PlayPosJournal_Ring.records[_slot];
+		return true;
+	}
+	return esp_partition_read(PlayPosJournal_Partition, _slot * sizeof(PlayPosJournalRecord), _record, sizeof(PlayPosJournalRecord)) == ESP_OK;
+}
+
+static bool PlayPosJournal_Write(const uint32_t _slot, const PlayPosJournalRecord *_record) {
+	if (!PlayPosJournal_Partition) {
+		PlayPosJournalRecord *slot = &PlayPosJournal_Ring.records[_slot];
+		slot->seq = 0u; // invalidate first: a torn record must never look valid
+		memcpy(reinterpret_cast<uint8_t *>(slot) + sizeof(slot->seq), reinterpret_cast<const uint8_t *>(_record) + sizeof(_record->seq), sizeof(PlayPosJournalRecord) - sizeof(_record->seq));
+		slot->seq = _record->seq;
+		return true;
+	}
+	return esp_partition_write(PlayPosJournal_Partition, _slot * sizeof(PlayPosJournalRecord), _record, sizeof(PlayPosJournalRecord)) == ESP_OK;
+}
+
+// Erases the sector that starts with this slot (~40 ms on flash, once every 128 records)
+static bool PlayPosJournal_Erase(const uint32_t _slot) {
+	if (!PlayPosJournal_Partition) {
+		memset(&PlayPosJournal_Ring.records[_slot], 0xFF, sizeof(PlayPosJournalRecord));
+		return true;
+	}
+	return esp_partition_erase_range(PlayPosJournal_Partition, _slot * sizeof(PlayPosJournalRecord), playPosJournalSectorSize) == ESP_OK;
+}
+
+// Finds the newest valid record after a reset. RTC-memory is random after a power-on and an erased or random
+// slot is never valid, so there's nothing to clear.
+void PlayPosJournal_Init(void) {
+	PlayPosJournal_Partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, playPosJournalPartition);
+	if (PlayPosJournal_Partition && PlayPosJournal_Partition->size >= 2u * playPosJournalSectorSize) {
+		PlayPosJournal_Slots = (PlayPosJournal_Partition->size / playPosJournalSectorSize) * playPosJournalSectorSize / sizeof(PlayPosJournalRecord);
+		PlayPosJournal_SlotsPerSector = playPosJournalSectorSize / sizeof(PlayPosJournalRecord);
+	} else {
+		PlayPosJournal_Partition = nullptr;
+		PlayPosJournal_Slots = playPosJournalRtcSlots;
+		PlayPosJournal_SlotsPerSector = 1u;
+		Log_Println("Play-position journal: no partition \"ppjournal\", using RTC-memory (doesn't survive a loss of power)", LOGLEVEL_NOTICE);
+	}
+
+	memset(&PlayPosJournal_Head, 0, sizeof(PlayPosJournal_Head));
+	PlayPosJournal_HeadSlot = PlayPosJournal_Slots - 1u; // next append goes to slot 0
+	PlayPosJournalRecord record;
+	for (uint32_t i = 0; i < PlayPosJournal_Slots; i++) {
+		if (PlayPosJournal_Read(i, &record) && PlayPosJournal_IsValid(&record) && record.seq > PlayPosJournal_Head.seq) {
+			PlayPosJournal_Head = record;
+			PlayPosJournal_HeadSlot = i;
+		}
+	}
+}
+
+bool PlayPosJournal_IsDurable(void) {
+	return PlayPosJournal_Partition != nullptr;
+}
+
+// Writes a record into the next erased slot; a sector is erased when the ring enters it, a slot that isn't erased
+// (torn by a reset) is skipped
+static void PlayPosJournal_Put(PlayPosJournalRecord *_record) {
+	if (!PlayPosJournal_Slots) {
+		return;
+	}
+	_record->seq = PlayPosJournal_Head.seq + 1u;
+	_record->crc = PlayPosJournal_Crc(_record);
+	uint32_t slot = PlayPosJournal_HeadSlot;
+	for (uint32_t tries = 0; tries < PlayPosJournal_Slots; tries++) {
+		slot = (slot + 1u) % PlayPosJournal_Slots;
+		PlayPosJournalRecord current;
+		if (slot % PlayPosJournal_SlotsPerSector == 0u) {
+			if (!PlayPosJournal_Erase(slot)) {
+				break;
+			}
+		} else if (!PlayPosJournal_Read(slot, &current) || !PlayPosJournal_IsErased(&current)) {
+			continue;
+		}
+		if (!PlayPosJournal_Write(slot, _record)) {
+			break;
+		}
+		PlayPosJournal_Head = *_record;
+		PlayPosJournal_HeadSlot = slot;
+		return;
+	}
+	Log_Println("Play-position journal: write failed", LOGLEVEL_ERROR);
+}
+
+// Appends a checkpoint: a single write of 32 bytes (RTC: only RAM is touched)
+void PlayPosJournal_Append(const char *_rfidTag, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed) {
+	PlayPosJournalRecord record;
+	memset(&record, 0, sizeof(record));
+	record.compactedSeq = PlayPosJournal_Head.compactedSeq;
+	strncpy(record.entry.rfidTag, _rfidTag, cardIdStringSize - 1);
+	record.entry.playPosition = _playPosition;
+	record.entry.playMode = _playMode;
+	record.entry.trackLastPlayed = _trackLastPlayed;
+	PlayPosJournal_Put(&record);
+}
+
+// Returns the newest checkpoint that didn't make it into NVS yet (if any)
+bool PlayPosJournal_GetPending(PlayPosJournalEntry *_entry) {
+	if (!PlayPosJournal_Head.seq || PlayPosJournal_Head.compactedSeq >= PlayPosJournal_Head.seq) {
+		return false;
+	}
+	*_entry = PlayPosJournal_Head.entry;
+	return true;
+}
+
+// To be called once the pending checkpoint (or a newer position of the same card) was written to NVS. Appends a
+// copy of the newest record that marks itself as compacted (nothing is written if there's nothing pending).
+void PlayPosJournal_MarkCompacted(void) {
+	if (!PlayPosJournal_Head.seq || PlayPosJournal_Head.compactedSeq >= PlayPosJournal_Head.seq) {
+		return;
+	}
+	PlayPosJournalRecord record = PlayPosJournal_Head;
+	record.compactedSeq = PlayPosJournal_Head.seq + 1u;
+	PlayPosJournal_Put(&record);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Rfid.h"
+
+// Play-position checkpoint as stored in the journal (same fields as the tail of the NVS RFID-entry)
+typedef struct {
+	char rfidTag[cardIdStringSize];
+	uint8_t playMode;
+	uint16_t trackLastPlayed;
+	uint32_t playPosition;
+} PlayPosJournalEntry;
+
+void PlayPosJournal_Init(void);
+bool PlayPosJournal_IsDurable(void);
+void PlayPosJournal_Append(const char *_rfidTag, const uint32_t _playPosition, const uint8_t _playMode, const uint16_t _trackLastPlayed);
+bool PlayPosJournal_GetPending(PlayPosJournalEntry *_entry);
+void PlayPosJournal_MarkCompacted(void);
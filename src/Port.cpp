@@ -4,6 +4,7 @@
 #include "Port.h"
 
 #include "Log.h"
+#include "Scheduler.h"
 
 #include <Wire.h>
 
@@ -21,6 +22,7 @@ extern TwoWire i2cBusTwo;
 
 uint8_t Port_ExpanderPortsInputChannelStatus[2];
 static uint8_t Port_ExpanderPortsOutputChannelStatus[2]; // Stores current configuration of output-channels locally
+static uint32_t Port_ExpanderInputChanged = 0; // Used to debounce once in case of register-change
 void Port_ExpanderHandler(void);
 uint8_t Port_ChannelToBit(const uint8_t _channel);
 void Port_WriteInitMaskForOutputChannels(void);
@@ -57,6 +59,17 @@ void Port_Cyclic(void) {
 #endif
 }
 
+// Port_Cyclic() has to be called periodically: expander without interrupt-pin, or its inputs are still settling
+bool Port_NeedsPolling(void) {
+#if defined(PE_INTERRUPT_PIN_ENABLE)
+	return Port_ExpanderInputChanged || Port_AllowReadFromPortExpander;
+#elif defined(PORT_EXPANDER_ENABLE)
+	return true;
+#else
+	return false;
+#endif
+}
+
 // Wrapper: reads from GPIOs (via digitalRead()) or from port-expander (if enabled)
 // Behaviour like digitalRead(): returns true if not pressed and false if pressed
 bool Port_Read(const uint8_t _channel) {
@@ -308,7 +321,6 @@ void Port_MakeSomeChannelsOutputForShutdown(void) {
 // Reads input-registers from port-expander and writes output into global cache-array
 // Datasheet: https://www.nxp.com/docs/en/data-sheet/PCA9555.pdf
 void Port_ExpanderHandler(void) {
-	static uint32_t inputChanged = 0; // Used to debounce once in case of register-change
 	static uint32_t inputPrev = 0;
 
 	// If interrupt-handling is active, only read port-expander's registers if interrupt was fired
@@ -316,7 +328,7 @@ void Port_ExpanderHandler(void) {
 	#ifdef PE_INTERRUPT_PIN_ENABLE
 	if (Port_AllowReadFromPortExpander) {
 		Port_AllowReadFromPortExpander = false;
-	} else if (!inputChanged) {
+	} else if (!Port_ExpanderInputChanged) {
 		return;
 	}
 	#endif
@@ -345,7 +357,7 @@ void Port_ExpanderHandler(void) {
 		// Check if input-register changed. If so, don't use the changed bits immediately
 		// but wait another cycle instead (=> rudimentary debounce).
 		// Added because there've been "ghost"-events occasionally with Arduino2 (https://forum.espuino.de/t/aktueller-stand-esp32-arduino-2/1389/55)
-		inputChanged = inputPrev ^ inputCurr;
+		Port_ExpanderInputChanged = inputPrev ^ inputCurr;
 
 		uint32_t inputStable = 0;
 		for (uint8_t i = 0; i < 2; i++) {
@@ -353,8 +365,8 @@ void Port_ExpanderHandler(void) {
 		}
 
 		// update bits that were stable since the last run
-		inputStable &= inputChanged;
-		inputStable |= (~inputChanged & inputCurr);
+		inputStable &= Port_ExpanderInputChanged;
+		inputStable |= (~Port_ExpanderInputChanged & inputCurr);
 
 		for (uint8_t i = 0; i < 2; i++) {
 			Port_ExpanderPortsInputChannelStatus[i] = (inputStable >> 8 * i) & 0xff;
@@ -366,7 +378,7 @@ void Port_ExpanderHandler(void) {
 
 	#ifdef PE_INTERRUPT_PIN_ENABLE
 	// input is stable; go back to interrupt mode
-	if (!inputChanged) {
+	if (!Port_ExpanderInputChanged) {
 		attachInterrupt(digitalPinToInterrupt(PE_INTERRUPT_PIN), PORT_ExpanderISR, ONLOW);
 	}
 	#endif
@@ -411,6 +423,7 @@ void PORT_ExpanderISR(void) {
 	// until the interrupt is handled we don't need any more ISR calls
 	if (Port_AllowReadFromPortExpander) {
 		detachInterrupt(digitalPinToInterrupt(PE_INTERRUPT_PIN));
+		Scheduler_SignalFromISR(LoopHandler::Button); // Port_Cyclic() is called by the button-handler
 	}
 }
 	#endif
@@ -0,0 +1,234 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "PromptPack.h"
+
+#include "Log.h"
+#include "MemX.h"
+#include "SdCard.h"
+
+#include <algorithm>
+
+// File-layout (little-endian), see prompt_pack.py:
+//   header 16 bytes: "EPPK", version, codec, word-gap in ms (u16), sample-rate (u32), snippet-count (u16), reserved (u16)
+//   index  32 bytes per snippet, sorted by name: name (20 chars, 0-padded), offset from file-start (u32), frames (u32),
+//          ADPCM start-predictor (i16), ADPCM start step-index (u8), reserved (u8)
+//   data   snippets
+
+#if (LANGUAGE == DE)
+constexpr const char *promptPackPath = "/.prompts/de.pak";
+#elif (LANGUAGE == FR)
+constexpr const char *promptPackPath = "/.prompts/fr.pak";
+#else
+constexpr const char *promptPackPath = "/.prompts/en.pak";
+#endif
+
+constexpr uint8_t promptPackVersion = 1u;
+constexpr uint8_t promptPackNameLength = 20u;
+constexpr uint16_t promptPackMaxSnippets = 1024u;
+
+enum class PromptCodec : uint8_t {
+	Pcm16 = 0,
+	ImaAdpcm = 1
+};
+
+typedef struct {
+	char magic[4];
+	uint8_t version;
+	uint8_t codec;
+	uint16_t gapMs;
+	uint32_t sampleRate;
+	uint16_t count;
+	uint16_t reserved;
+} promptPackHeader_t;
+
+typedef struct {
+	char name[promptPackNameLength];
+	uint32_t offset;
+	uint32_t frames;
+	int16_t predictor;
+	uint8_t stepIndex;
+	uint8_t reserved;
+} promptPackEntry_t;
+
+static_assert(sizeof(promptPackHeader_t) == 16 && sizeof(promptPackEntry_t) == 32, "layout has to match prompt_pack.py");
+
+static promptPackHeader_t PromptPack_Header;
+static const promptPackEntry_t *PromptPack_Index = nullptr;
+static uint8_t *PromptPack_Data = nullptr; // whole pack in PSRAM; nullptr: snippets are read from SD-card
+static File PromptPack_File;
+
+static constexpr int8_t PromptPack_AdpcmIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+static constexpr int16_t PromptPack_AdpcmStepTable[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+	1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+	7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+typedef struct {
+	int32_t predictor;
+	int8_t stepIndex;
+} adpcmState_t;
+
+static int16_t PromptPack_AdpcmDecodeNibble(adpcmState_t &state, const uint8_t nibble) {
+	const int32_t step = PromptPack_AdpcmStepTable[state.stepIndex];
+	int32_t diff = step >> 3;
+	if (nibble & 4) {
+		diff += step;
+	}
+	if (nibble & 2) {
+		diff += step >> 1;
+	}
+	if (nibble & 1) {
+		diff += step >> 2;
+	}
+	state.predictor = std::clamp<int32_t>((nibble & 8) ? state.predictor - diff : state.predictor + diff, INT16_MIN, INT16_MAX);
+	state.stepIndex = std::clamp<int8_t>(state.stepIndex + PromptPack_AdpcmIndexTable[nibble], 0, 88);
+	return static_cast<int16_t>(state.predictor);
+}
+
+// Two frames per byte, low nibble first
+static void PromptPack_AdpcmDecode(adpcmState_t &state, const uint8_t *src, int16_t *dst, const uint32_t frames) {
+	for (uint32_t i = 0; i < frames; i++) {
+		const uint8_t nibble = (i & 1) ? (src[i >> 1] >> 4) : (src[i >> 1] & 0x0F);
+		dst[i] = PromptPack_AdpcmDecodeNibble(state, nibble);
+	}
+}
+
+// 64 bit, so a bogus frame-count can't wrap around
+static uint64_t PromptPack_GetBytes(const promptPackEntry_t &entry) {
+	const uint64_t frames = entry.frames;
+	return (PromptPack_Header.codec == static_cast<uint8_t>(PromptCodec::ImaAdpcm)) ? (frames + 1) / 2 : frames * sizeof(int16_t);
+}
+
+// Reads the index (with PSRAM the whole pack) of the configured language
+bool PromptPack_Init(void) {
+	File file = gFSystem.open(promptPackPath, FILE_READ);
+	if (!file) {
+		Log_Printf(LOGLEVEL_NOTICE, "PromptPack: %s not found, announcements use online speech", promptPackPath);
+		return false;
+	}
+	const size_t fileSize = file.size();
+	promptPackHeader_t &header = PromptPack_Header;
+	if (file.read((uint8_t *) &header, sizeof(header)) != sizeof(header) || memcmp(header.magic, "EPPK", 4) || header.version != promptPackVersion
+		|| header.codec > static_cast<uint8_t>(PromptCodec::ImaAdpcm) || !header.count || header.count > promptPackMaxSnippets
+		|| !header.sampleRate || header.sampleRate >= 65536u || fileSize < sizeof(header) + header.count * sizeof(promptPackEntry_t)) {
+		Log_Printf(LOGLEVEL_ERROR, "PromptPack: %s is invalid", promptPackPath);
+		file.close();
+		return false;
+	}
+
+	const size_t indexSize = header.count * sizeof(promptPackEntry_t);
+	bool success;
+	void *buffer; // index (and with PSRAM the data) point into it
+	uint8_t *data = psramFound() ? (uint8_t *) ps_malloc(fileSize) : nullptr; // if it doesn't fit, snippets are read from SD-card
+	if (data) {
+		success = file.seek(0) && (file.read(data, fileSize) == fileSize);
+		PromptPack_Index = reinterpret_cast<const promptPackEntry_t *>(data + sizeof(header));
+		buffer = data;
+	} else {
+		promptPackEntry_t *index = (promptPackEntry_t *) x_malloc(indexSize);
+		success = index && (file.read((uint8_t *) index, indexSize) == indexSize);
+		PromptPack_Index = index;
+		buffer = index;
+	}
+	for (uint16_t i = 0; success && i < header.count; i++) {
+		const promptPackEntry_t &entry = PromptPack_Index[i];
+		success = (entry.offset <= fileSize) && (PromptPack_GetBytes(entry) <= fileSize - entry.offset) && (entry.stepIndex <= 88);
+	}
+	if (!success) {
+		Log_Printf(LOGLEVEL_ERROR, "PromptPack: %s is invalid", promptPackPath);
+		free(buffer);
+		PromptPack_Index = nullptr;
+		file.close();
+		return false;
+	}
+
+	PromptPack_Data = data;
+	if (PromptPack_Data) {
+		file.close();
+	} else {
+		PromptPack_File = file; // kept open, snippets are read when needed
+	}
+	Log_Printf(LOGLEVEL_NOTICE, "PromptPack: %u prompts, %" PRIu32 " Hz, %s (%u kB%s)", header.count, header.sampleRate, header.codec ? "ADPCM" : "PCM", fileSize / 1024, PromptPack_Data ? ", PSRAM" : "");
+	return true;
+}
+
+bool PromptPack_IsAvailable(void) {
+	return PromptPack_Index != nullptr;
+}
+
+// Index is sorted by name, so it's a binary search
+int16_t PromptPack_Find(const char *name) {
+	if (!PromptPack_Index) {
+		return promptPackInvalid;
+	}
+	int32_t low = 0;
+	int32_t high = PromptPack_Header.count - 1;
+	while (low <= high) {
+		const int32_t mid = (low + high) / 2;
+		const int cmp = strncmp(name, PromptPack_Index[mid].name, promptPackNameLength);
+		if (!cmp) {
+			return mid;
+		}
+		if (cmp < 0) {
+			high = mid - 1;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return promptPackInvalid;
+}
+
+uint32_t PromptPack_GetFrames(const int16_t snippet) {
+	return (snippet >= 0 && snippet < PromptPack_Header.count) ? PromptPack_Index[snippet].frames : 0;
+}
+
+uint32_t PromptPack_GetSampleRate(void) {
+	return PromptPack_Header.sampleRate;
+}
+
+uint16_t PromptPack_GetGapMs(void) {
+	return PromptPack_Header.gapMs;
+}
+
+// Decodes a snippet to 16 bit PCM; dst needs space for PromptPack_GetFrames() frames. Returns the frames written.
+uint32_t PromptPack_Decode(const int16_t snippet, int16_t *dst) {
+	if (!PromptPack_GetFrames(snippet)) {
+		return 0;
+	}
+	const promptPackEntry_t &entry = PromptPack_Index[snippet];
+	const bool adpcm = (PromptPack_Header.codec == static_cast<uint8_t>(PromptCodec::ImaAdpcm));
+	adpcmState_t state = {entry.predictor, static_cast<int8_t>(entry.stepIndex)};
+
+	if (PromptPack_Data) {
+		const uint8_t *src = PromptPack_Data + entry.offset;
+		if (adpcm) {
+			PromptPack_AdpcmDecode(state, src, dst, entry.frames);
+		} else {
+			memcpy(dst, src, entry.frames * sizeof(int16_t));
+		}
+		return entry.frames;
+	}
+
+	if (!PromptPack_File.seek(entry.offset)) {
+		return 0;
+	}
+	if (!adpcm) {
+		const size_t bytes = entry.frames * sizeof(int16_t);
+		return (PromptPack_File.read((uint8_t *) dst, bytes) == bytes) ? entry.frames : 0;
+	}
+	// ADPCM: decode chunk by chunk (chunk is an even number of frames, so chunks start with a low nibble)
+	uint8_t chunk[256];
+	uint32_t done = 0;
+	while (done < entry.frames) {
+		const uint32_t frames = std::min<uint32_t>(entry.frames - done, sizeof(chunk) * 2);
+		const size_t bytes = (frames + 1) / 2;
+		if (PromptPack_File.read(chunk, bytes) != bytes) {
+			return 0;
+		}
+		PromptPack_AdpcmDecode(state, chunk, &dst[done], frames);
+		done += frames;
+	}
+	return done;
+}
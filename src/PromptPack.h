@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Voice-prompt pack: one file per language (/.prompts/<language>.pak, built by prompt_pack.py from WAV-files).
+// It holds an index of named mono snippets (16 bit PCM or 4 bit IMA-ADPCM). Every snippet decodes on its own
+// and has no leading/trailing silence, so snippets can be joined sample-accurately.
+
+constexpr int16_t promptPackInvalid = -1;
+
+bool PromptPack_Init(void);
+bool PromptPack_IsAvailable(void);
+int16_t PromptPack_Find(const char *name);
+uint32_t PromptPack_GetFrames(const int16_t snippet);
+uint32_t PromptPack_GetSampleRate(void);
+uint16_t PromptPack_GetGapMs(void);
+uint32_t PromptPack_Decode(const int16_t snippet, int16_t *dst);
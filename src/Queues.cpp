@@ -2,19 +2,11 @@
 #include "settings.h"
 
 #include "Log.h"
-#include "Playlist.h"
-#include "Rfid.h"
 
-QueueHandle_t gRfidCardQueue;
 QueueHandle_t gLedQueue;
 
 void Queues_Init(void) {
-	// Create queues
-
-	gRfidCardQueue = xQueueCreate(1, cardIdStringSize);
-	if (gRfidCardQueue == NULL) {
-		Log_Printf(LOGLEVEL_ERROR, unableToCreateQueue, "Rfid");
-	}
+	// Create queues (commands of the input-sources go through the command-bus, see CommandBus.cpp)
 
 	gLedQueue = xQueueCreate(1, sizeof(uint8_t));
 	if (gLedQueue == NULL) {
@@ -0,0 +1,166 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Resampler.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <array>
+
+// Polyphase FIR: a windowed-sinc prototype, oversampled by resamplerPhases, is split into resamplerPhases+1
+// sub-filters of resamplerTaps taps. Every output-frame interpolates the coefficients of the two sub-filters
+// next to its fractional position. So any ratio works with a fixed amount of work per output-frame:
+// resamplerTaps coefficient-interpolations + 2 * resamplerTaps MACs.
+// The tables are computed by the compiler, so they end up in flash and there's no startup-cost.
+
+constexpr uint8_t resamplerTaps = 48u;
+constexpr uint8_t resamplerPhaseBits = 6u;
+constexpr uint16_t resamplerPhases = 1u << resamplerPhaseBits;
+constexpr uint8_t resamplerFracBits = 10u; // resolution for interpolating between two phases
+constexpr uint8_t resamplerPosBits = 32u; // position is Q32.32, so rounding the ratio doesn't cause an audible drift
+constexpr double resamplerKaiserBeta = 5.65; // ~60 dB stopband
+
+typedef std::array<std::array<int16_t, resamplerTaps>, resamplerPhases + 1> resamplerTable_t;
+
+// constexpr replacements for sin() / sqrt() / Bessel I0 (only used at compile-time)
+constexpr double resamplerPi = 3.14159265358979323846;
+
+constexpr double Resampler_Sin(double x) {
+	const long long turns = static_cast<long long>(x / (2.0 * resamplerPi) + (x >= 0 ? 0.5 : -0.5));
+	x -= turns * 2.0 * resamplerPi; // -pi..pi
+	double term = x;
+	double sum = x;
+	for (int i = 1; i < 14; i++) {
+		term *= -x * x / ((2 * i) * (2 * i + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double Resampler_Sqrt(const double x) {
+	if (x <= 0.0) {
+		return 0.0;
+	}
+	double r = x > 1.0 ? x : 1.0;
+	for (int i = 0; i < 40; i++) {
+		r = 0.5 * (r + x / r);
+	}
+	return r;
+}
+
+constexpr double Resampler_BesselI0(const double x) {
+	double term = 1.0;
+	double sum = 1.0;
+	for (int k = 1; k < 40; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+// cutoff: -6 dB point relative to the Nyquist-frequency of the input
+constexpr resamplerTable_t Resampler_MakeTable(const double cutoff) {
+	resamplerTable_t table {};
+	for (uint16_t p = 0; p <= resamplerPhases; p++) {
+		double coefs[resamplerTaps] {};
+		double sum = 0.0;
+		for (uint8_t k = 0; k < resamplerTaps; k++) {
+			// distance (in input-samples) between output-position and tap k
+			const double tau = (resamplerTaps / 2.0) - 1.0 - k + static_cast<double>(p) / resamplerPhases;
+			const double x = tau / (resamplerTaps / 2.0);
+			const double window = (x > -1.0 && x < 1.0) ? Resampler_BesselI0(resamplerKaiserBeta * Resampler_Sqrt(1.0 - x * x)) / Resampler_BesselI0(resamplerKaiserBeta) : 0.0;
+			const double arg = resamplerPi * cutoff * tau;
+			const double sinc = (tau == 0.0) ? 1.0 : Resampler_Sin(arg) / arg;
+			coefs[k] = cutoff * sinc * window;
+			sum += coefs[k];
+		}
+		// every phase gets a DC-gain of exactly 1
+		for (uint8_t k = 0; k < resamplerTaps; k++) {
+			const double v = coefs[k] / sum * 32768.0;
+			table[p][k] = static_cast<int16_t>(v >= 0 ? v + 0.5 : v - 0.5);
+		}
+	}
+	return table;
+}
+
+// Upsampling (e.g. 22.05k / 32k -> 44.1k): remove the images above the input's Nyquist-frequency
+static constexpr resamplerTable_t Resampler_TableUp = Resampler_MakeTable(0.92);
+// Downsampling 48k -> 44.1k: band-limit to the output's Nyquist-frequency first
+static constexpr resamplerTable_t Resampler_TableDown = Resampler_MakeTable(0.84);
+
+static const resamplerTable_t *Resampler_Table = nullptr; // nullptr: input is already 44.1 kHz
+static uint32_t Resampler_InputRate = resamplerOutputRate;
+static uint64_t Resampler_Step = 0; // input-frames per output-frame
+static uint64_t Resampler_Pos = 0; // fractional position of the next output-frame (in input-frames)
+static int16_t Resampler_History[2 * resamplerTaps][2]; // delay-line, stored twice so it can always be read in one run
+static uint8_t Resampler_HistoryIndex = 0;
+
+// Selects the filter for a new input-rate and resets the filter-state (e.g. when a new track starts)
+void Resampler_SetInputRate(const uint32_t inputRate) {
+	if (inputRate == Resampler_InputRate || inputRate == 0) {
+		return;
+	}
+	Resampler_InputRate = inputRate;
+	Resampler_Pos = 0;
+	Resampler_HistoryIndex = 0;
+	memset(Resampler_History, 0, sizeof(Resampler_History));
+
+	if (inputRate == resamplerOutputRate) {
+		Resampler_Table = nullptr;
+	} else {
+		Resampler_Table = (inputRate < resamplerOutputRate) ? &Resampler_TableUp : &Resampler_TableDown;
+		Resampler_Step = (static_cast<uint64_t>(inputRate) << resamplerPosBits) / resamplerOutputRate;
+		if (inputRate > 48000u) {
+			Log_Printf(LOGLEVEL_NOTICE, "Resampler: %" PRIu32 " Hz is not supported properly (max. 48000 Hz), expect aliasing", inputRate);
+		}
+	}
+	Log_Printf(LOGLEVEL_DEBUG, "Resampler: %" PRIu32 " Hz -> %" PRIu32 " Hz", inputRate, resamplerOutputRate);
+}
+
+bool Resampler_IsActive(void) {
+	return Resampler_Table != nullptr;
+}
+
+// Number of input-frames that can be passed at most to fill outCapacity output-frames
+size_t Resampler_GetMaxInputFrames(const size_t outCapacity) {
+	if (!Resampler_Table || outCapacity < 2) {
+		return outCapacity;
+	}
+	return (static_cast<uint64_t>(outCapacity - 1) * Resampler_InputRate) / resamplerOutputRate;
+}
+
+// Converts interleaved stereo-frames; returns the number of output-frames written
+size_t Resampler_Process(const int16_t *in, const size_t inFrames, int16_t *out, const size_t outCapacity) {
+	size_t outFrames = 0;
+	const resamplerTable_t &table = *Resampler_Table;
+
+	for (size_t i = 0; i < inFrames; i++) {
+		Resampler_History[Resampler_HistoryIndex][0] = Resampler_History[Resampler_HistoryIndex + resamplerTaps][0] = in[i * 2];
+		Resampler_History[Resampler_HistoryIndex][1] = Resampler_History[Resampler_HistoryIndex + resamplerTaps][1] = in[i * 2 + 1];
+		Resampler_HistoryIndex = (Resampler_HistoryIndex + 1) % resamplerTaps;
+		const int16_t(*x)[2] = &Resampler_History[Resampler_HistoryIndex]; // oldest frame first
+
+		while (Resampler_Pos < (1ull << resamplerPosBits)) {
+			const uint32_t phase = Resampler_Pos >> (resamplerPosBits - resamplerPhaseBits);
+			const int32_t frac = (Resampler_Pos >> (resamplerPosBits - resamplerPhaseBits - resamplerFracBits)) & ((1u << resamplerFracBits) - 1);
+			const int16_t *c0 = table[phase].data();
+			const int16_t *c1 = table[phase + 1].data();
+			int64_t accLeft = 0;
+			int64_t accRight = 0;
+			for (uint8_t k = 0; k < resamplerTaps; k++) {
+				const int32_t c = c0[k] + (((c1[k] - c0[k]) * frac) >> resamplerFracBits);
+				accLeft += c * x[k][0];
+				accRight += c * x[k][1];
+			}
+			if (outFrames < outCapacity) {
+				out[outFrames * 2] = static_cast<int16_t>(std::clamp<int64_t>(accLeft >> 15, INT16_MIN, INT16_MAX));
+				out[outFrames * 2 + 1] = static_cast<int16_t>(std::clamp<int64_t>(accRight >> 15, INT16_MIN, INT16_MAX));
+				outFrames++;
+			}
+			Resampler_Pos += Resampler_Step;
+		}
+		Resampler_Pos -= (1ull << resamplerPosBits);
+	}
+	return outFrames;
+}
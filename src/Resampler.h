@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point polyphase sample-rate converter (interleaved 16 bit stereo) to the 44.1 kHz used for A2DP.
+// Works for input-rates between 8 kHz and 48 kHz; costs a constant number of MACs per output-frame.
+
+constexpr uint32_t resamplerOutputRate = 44100u;
+
+void Resampler_SetInputRate(const uint32_t inputRate);
+bool Resampler_IsActive(void);
+size_t Resampler_GetMaxInputFrames(const size_t outCapacity);
+size_t Resampler_Process(const int16_t *in, const size_t inFrames, int16_t *out, const size_t outCapacity);
@@ -15,4 +15,4 @@ void Rfid_TaskPause(void);
 void Rfid_TaskResume(void);
 void Rfid_TaskReset(void);
 void Rfid_WakeupCheck(void);
-void Rfid_PreferenceLookupHandler(void);
+void Rfid_PreferenceLookupHandler(const char *cardId);
@@ -3,105 +3,121 @@
 
 #include "AudioPlayer.h"
 #include "Cmd.h"
+#include "CommandBus.h"
 #include "Common.h"
 #include "Log.h"
 #include "MemX.h"
+#include "Metrics.h"
 #include "Mqtt.h"
-#include "Queues.h"
 #include "Rfid.h"
 #include "RfidConfig.h"
 #include "System.h"
+#include "TapTrace.h"
 #include "Web.h"
 
 unsigned long Rfid_LastRfidCheckTimestamp = 0;
 char gCurrentRfidTagId[cardIdStringSize] = ""; // No crap here as otherwise it could be shown in GUI
 char gOldRfidTagId[cardIdStringSize] = "X"; // Init with crap
 
-// Tries to lookup RFID-tag-string in NVS and extracts parameter from it if found
-void Rfid_PreferenceLookupHandler(void) {
+// for /metrics
+uint32_t Rfid_ReadErrors = 0; // card was present but couldn't be read (counted by the reader)
+static uint32_t Rfid_Reads = 0;
+static uint32_t Rfid_UnknownTags = 0;
+static uint32_t Rfid_InvalidEntries = 0;
+
+void Rfid_RegisterMetrics(void) {
+	Metrics_Register("rfid_reads_total", MetricType::Counter, "RFID-tags that were read", &Rfid_Reads);
+	Metrics_Register("rfid_errors_total", MetricType::Counter, "RFID-tags that couldn't be read or used", [](metricsWriter_t &out) {
+		Metrics_Sample(out, Rfid_ReadErrors, "reason", "read");
+		Metrics_Sample(out, Rfid_UnknownTags, "reason", "unknown");
+		Metrics_Sample(out, Rfid_InvalidEntries, "reason", "invalid");
+	});
+}
+
+// Tries to lookup RFID-tag-string in NVS and extracts parameter from it if found (called by the command-bus)
+void Rfid_PreferenceLookupHandler(const char *cardId) {
 #if defined(RFID_READER_TYPE_RUNTIME)
-	BaseType_t rfidStatus;
-	char rfidTagId[cardIdStringSize];
 	char _file[255];
 	uint32_t _lastPlayPos = 0;
 	uint16_t _trackLastPlayed = 0;
 	uint32_t _playMode = 1;
 
-	rfidStatus = xQueueReceive(gRfidCardQueue, &rfidTagId, 0);
-	if (rfidStatus == pdPASS) {
-		System_UpdateActivityTimer();
-		strncpy(gCurrentRfidTagId, rfidTagId, cardIdStringSize - 1);
-		Log_Printf(LOGLEVEL_INFO, "%s: %s", rfidTagReceived, gCurrentRfidTagId);
-		Web_SendWebsocketData(0, WebsocketCodeType::CurrentRfid); // Push new rfidTagId to all websocket-clients
-		String s = "-1";
-		if (gPrefsRfid.isKey(gCurrentRfidTagId)) {
-			s = gPrefsRfid.getString(gCurrentRfidTagId, "-1"); // Try to lookup rfidId in NVS
-		}
-		if (!s.compareTo("-1")) {
-			Log_Println(rfidTagUnknownInNvs, LOGLEVEL_ERROR);
-			System_IndicateError();
-			// allow to escape from bluetooth mode with an unknown card, switch back to normal mode
-			System_SetOperationMode(OPMODE_NORMAL);
-			return;
-		}
+	TapTrace_Mark(TraceStage::Lookup);
+	System_UpdateActivityTimer();
+	Rfid_Reads++;
+	strncpy(gCurrentRfidTagId, cardId, cardIdStringSize - 1);
+	Log_Printf(LOGLEVEL_INFO, "%s: %s", rfidTagReceived, gCurrentRfidTagId);
+	Web_SendWebsocketData(0, WebsocketCodeType::CurrentRfid); // Push new rfidTagId to all websocket-clients
+	String s = "-1";
+	if (gPrefsRfid.isKey(gCurrentRfidTagId)) {
+		s = gPrefsRfid.getString(gCurrentRfidTagId, "-1"); // Try to lookup rfidId in NVS
+	}
+	if (!s.compareTo("-1")) {
+		Rfid_UnknownTags++;
+		Log_Println(rfidTagUnknownInNvs, LOGLEVEL_ERROR);
+		System_IndicateError();
+		// allow to escape from bluetooth mode with an unknown card, switch back to normal mode
+		System_SetOperationMode(OPMODE_NORMAL);
+		return;
+	}
 
-		char *token;
-		uint8_t i = 1;
-		token = strtok((char *) s.c_str(), stringDelimiter);
-		while (token != NULL) { // Try to extract data from string after lookup
-			if (i == 1) {
-				strncpy(_file, token, sizeof(_file) / sizeof(_file[0]));
-			} else if (i == 2) {
-				_lastPlayPos = strtoul(token, NULL, 10);
-			} else if (i == 3) {
-				_playMode = strtoul(token, NULL, 10);
-			} else if (i == 4) {
-				_trackLastPlayed = strtoul(token, NULL, 10);
-			}
-			i++;
-			token = strtok(NULL, stringDelimiter);
+	char *token;
+	uint8_t i = 1;
+	token = strtok((char *) s.c_str(), stringDelimiter);
+	while (token != NULL) { // Try to extract data from string after lookup
+		if (i == 1) {
+			strncpy(_file, token, sizeof(_file) / sizeof(_file[0]));
+		} else if (i == 2) {
+			_lastPlayPos = strtoul(token, NULL, 10);
+		} else if (i == 3) {
+			_playMode = strtoul(token, NULL, 10);
+		} else if (i == 4) {
+			_trackLastPlayed = strtoul(token, NULL, 10);
 		}
+		i++;
+		token = strtok(NULL, stringDelimiter);
+	}
 
-		if (i != 5) {
-			Log_Println(errorOccuredNvs, LOGLEVEL_ERROR);
-			System_IndicateError();
+	if (i != 5) {
+		Rfid_InvalidEntries++;
+		Log_Println(errorOccuredNvs, LOGLEVEL_ERROR);
+		System_IndicateError();
+	} else {
+		// Only pass file to queue if strtok revealed 3 items
+		if (_playMode >= 100) {
+			// Modification-cards can change some settings (e.g. introducing track-looping or sleep after track/playlist).
+			Cmd_Action(_playMode);
 		} else {
-			// Only pass file to queue if strtok revealed 3 items
-			if (_playMode >= 100) {
-				// Modification-cards can change some settings (e.g. introducing track-looping or sleep after track/playlist).
-				Cmd_Action(_playMode);
-			} else {
-				if (gPlayProperties.dontAcceptRfidTwice) {
-					if (strncmp(gCurrentRfidTagId, gOldRfidTagId, 12) == 0) {
-						// If pause is active, resume playback when the same RFID is put on again.
-						if (gPlayProperties.pausePlay && gPlayProperties.resumeOnSameRfid) {
-							Log_Printf(LOGLEVEL_INFO, "Same RFID while paused -> resume playback (%s)", gCurrentRfidTagId);
-							AudioPlayer_SetTrackControl(PAUSEPLAY);
-							return;
-						}
-						Log_Printf(LOGLEVEL_ERROR, dontAccepctSameRfid, gCurrentRfidTagId);
-						// System_IndicateError(); // Enable to have shown error @neopixel every time
+			if (gPlayProperties.dontAcceptRfidTwice) {
+				if (strncmp(gCurrentRfidTagId, gOldRfidTagId, 12) == 0) {
+					// If pause is active, resume playback when the same RFID is put on again.
+					if (gPlayProperties.pausePlay && gPlayProperties.resumeOnSameRfid) {
+						Log_Printf(LOGLEVEL_INFO, "Same RFID while paused -> resume playback (%s)", gCurrentRfidTagId);
+						AudioPlayer_SetTrackControl(PAUSEPLAY);
 						return;
-					} else {
-						strncpy(gOldRfidTagId, gCurrentRfidTagId, 12);
-						// Arm the lock-reset now that a new tag was accepted. This must not depend on playback
-						// actually starting, otherwise a tag whose first track fails immediately stays locked forever.
-						AudioPlayer_ArmRfidResetOnIdle();
 					}
+					Log_Printf(LOGLEVEL_ERROR, dontAccepctSameRfid, gCurrentRfidTagId);
+					// System_IndicateError(); // Enable to have shown error @neopixel every time
+					return;
+				} else {
+					strncpy(gOldRfidTagId, gCurrentRfidTagId, 12);
+					// Arm the lock-reset now that a new tag was accepted. This must not depend on playback
+					// actually starting, otherwise a tag whose first track fails immediately stays locked forever.
+					AudioPlayer_ArmRfidResetOnIdle();
 				}
+			}
 	#ifdef MQTT_ENABLE
-				publishMqtt(topicRfid, gCurrentRfidTagId, false);
+			publishMqtt(topicRfid, gCurrentRfidTagId, false);
 	#endif
 
 	#ifdef BLUETOOTH_ENABLE
-				// if music rfid was read, go back to normal mode
-				if (System_GetOperationMode() == OPMODE_BLUETOOTH_SINK) {
-					System_SetOperationMode(OPMODE_NORMAL);
-				}
+			// if music rfid was read, go back to normal mode
+			if (System_GetOperationMode() == OPMODE_BLUETOOTH_SINK) {
+				System_SetOperationMode(OPMODE_NORMAL);
+			}
 	#endif
 
-				AudioPlayer_SetPlaylist(_file, _lastPlayPos, _playMode, _trackLastPlayed);
-			}
+			AudioPlayer_SetPlaylist(_file, _lastPlayPos, _playMode, _trackLastPlayed);
 		}
 	}
 #endif
@@ -2,13 +2,14 @@
 #include "settings.h"
 
 #include "AudioPlayer.h"
+#include "CommandBus.h"
 #include "HallEffectSensor.h"
 #include "Log.h"
 #include "MemX.h"
-#include "Queues.h"
 #include "Rfid.h"
 #include "RfidConfig.h"
 #include "System.h"
+#include "TapTrace.h"
 
 #include <esp_task_wdt.h>
 
@@ -23,6 +24,7 @@
 	#include <MFRC522_I2C.h>
 
 extern unsigned long Rfid_LastRfidCheckTimestamp;
+extern uint32_t Rfid_ReadErrors;
 extern TaskHandle_t rfidTaskHandle;
 static void RfidMfrc522_Task(void *parameter);
 
@@ -94,6 +96,7 @@ static void RfidMfrc522_TaskImpl(Reader &reader) {
 			// Log_Printf(LOGLEVEL_DEBUG, "%u", uxTaskGetStackHighWaterMark(NULL));
 
 			Rfid_LastRfidCheckTimestamp = millis();
+			const uint32_t pollStartUs = micros();
 			// Reset the loop if no new card is present on the sensor/reader. This saves the entire process when idle.
 
 			if (!reader.PICC_IsNewCardPresent()) {
@@ -102,8 +105,10 @@ static void RfidMfrc522_TaskImpl(Reader &reader) {
 
 			// Select one of the cards
 			if (!reader.PICC_ReadCardSerial()) {
+				Rfid_ReadErrors++;
 				continue;
 			}
+			const uint32_t readUs = micros();
 
 			if (!gPlayProperties.pauseIfRfidRemoved) {
 				reader.PICC_HaltA();
@@ -140,16 +145,18 @@ static void RfidMfrc522_TaskImpl(Reader &reader) {
 	#else
 				if (!sameCardReapplied) { // Don't allow to send card to queue if it's the same card again...
 	#endif
-					xQueueSend(gRfidCardQueue, cardIdString.c_str(), 0);
+					TapTrace_Begin(pollStartUs, readUs);
+					CommandBus_PostRfidCard(cardIdString.c_str(), CommandSource::Rfid);
 				} else {
 					// If pause-button was pressed while card was not applied, playback could be active. If so: don't pause when card is reapplied again as the desired functionality would be reversed in this case.
 					if (gPlayProperties.pausePlay && System_GetOperationMode() != OPMODE_BLUETOOTH_SINK) {
-						AudioPlayer_SetTrackControl(PAUSEPLAY); // ... play/pause instead (but not for BT)
+						CommandBus_PostTrackControl(PAUSEPLAY, CommandSource::Rfid); // ... play/pause instead (but not for BT)
 					}
 				}
 				memcpy(lastValidcardId, reader.uid.uidByte, cardIdSize);
 			} else {
-				xQueueSend(gRfidCardQueue, cardIdString.c_str(), 0); // If pauseIfRfidRemoved isn't active, every card-apply leads to new playlist-generation
+				TapTrace_Begin(pollStartUs, readUs);
+				CommandBus_PostRfidCard(cardIdString.c_str(), CommandSource::Rfid); // If pauseIfRfidRemoved isn't active, every card-apply leads to new playlist-generation
 			}
 
 			if (gPlayProperties.pauseIfRfidRemoved) {
@@ -183,7 +190,7 @@ static void RfidMfrc522_TaskImpl(Reader &reader) {
 
 				Log_Println(rfidTagRemoved, LOGLEVEL_NOTICE);
 				if (!gPlayProperties.pausePlay && System_GetOperationMode() != OPMODE_BLUETOOTH_SINK) {
-					AudioPlayer_SetTrackControl(PAUSEPLAY);
+					CommandBus_PostTrackControl(PAUSEPLAY, CommandSource::Rfid);
 					Log_Println(rfidTagReapplied, LOGLEVEL_NOTICE);
 				}
 				reader.PICC_HaltA();
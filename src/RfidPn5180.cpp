@@ -2,13 +2,14 @@
 #include "settings.h"
 
 #include "AudioPlayer.h"
+#include "CommandBus.h"
 #include "HallEffectSensor.h"
 #include "Log.h"
 #include "MemX.h"
 #include "Port.h"
-#include "Queues.h"
 #include "Rfid.h"
 #include "System.h"
+#include "TapTrace.h"
 
 #include <SPI.h>
 #include <Wire.h>
@@ -36,6 +37,7 @@
 #define RFID_PN5180_NFC15693_STATE_ACTIVE				100u
 
 extern unsigned long Rfid_LastRfidCheckTimestamp;
+extern uint32_t Rfid_ReadErrors;
 extern TaskHandle_t rfidTaskHandle;
 
 #if (defined(PORT_EXPANDER_ENABLE) && (RFID_IRQ > 99))
@@ -144,12 +146,6 @@ void RfidPn5180_Task(void *parameter) {
 	uint8_t uid[10];
 	bool showDisablePrivacyNotification = true;
 
-	// wait until queues are created
-	while (gRfidCardQueue == NULL) {
-		Log_Println(waitingForTaskQueues, LOGLEVEL_DEBUG);
-		vTaskDelay(50);
-	}
-
 	for (;;) {
 		vTaskDelay(portTICK_PERIOD_MS * 10u);
 		if (Rfid_Pn5180LpcdEnabled() && Rfid_GetLpcdShutdownStatus()) {
@@ -162,6 +158,8 @@ void RfidPn5180_Task(void *parameter) {
 		String cardIdString;
 		bool cardReceived = false;
 		bool sameCardReapplied = false;
+		const uint32_t pollStartUs = micros();
+		uint32_t readUs = 0;
 
 		if (RFID_PN5180_STATE_INIT == stateMachine) {
 			nfc14443.begin();
@@ -186,12 +184,17 @@ void RfidPn5180_Task(void *parameter) {
 			// Log_Printf(LOGLEVEL_DEBUG, "%u", uxTaskGetStackHighWaterMark(NULL));
 		} else if (RFID_PN5180_NFC14443_STATE_READCARD == stateMachine) {
 
-			if (nfc14443.readCardSerial(uid) >= 4) {
+			const int8_t uidLength = nfc14443.readCardSerial(uid);
+			if (uidLength >= 4) {
 				cardReceived = true;
+				readUs = micros();
 				stateMachine = RFID_PN5180_NFC14443_STATE_ACTIVE;
 				lastTimeDetected14443 = millis();
 				cardAppliedCurrentRun = true;
 			} else {
+				if (uidLength < 0) {
+					Rfid_ReadErrors++; // 0 is "no card", negative values are errors of the activation
+				}
 				// Reset to dummy-value if no card is there
 				// Necessary to differentiate between "card is still applied" and "card is re-applied again after removal"
 				// lastTimeDetected14443 is used to prevent "new card detection with old card" with single events where no card was detected
@@ -240,10 +243,14 @@ void RfidPn5180_Task(void *parameter) {
 			ISO15693ErrorCode rc = nfc15693.getInventory(uid);
 			if (rc == ISO15693_EC_OK) {
 				cardReceived = true;
+				readUs = micros();
 				stateMachine = RFID_PN5180_NFC15693_STATE_ACTIVE;
 				lastTimeDetected15693 = millis();
 				cardAppliedCurrentRun = true;
 			} else {
+				if (rc != EC_NO_CARD) {
+					Rfid_ReadErrors++; // a card answered, but with an error (collision, CRC, ...)
+				}
 				// lastTimeDetected15693 is used to prevent "new card detection with old card" with single events where no card was detected
 				if (!lastTimeDetected15693 || (millis() - lastTimeDetected15693 >= debounceMs)) {
 					lastTimeDetected15693 = 0;
@@ -259,7 +266,7 @@ void RfidPn5180_Task(void *parameter) {
 
 		if (gPlayProperties.pauseIfRfidRemoved) {
 			if (!cardAppliedCurrentRun && cardAppliedLastRun && !gPlayProperties.pausePlay && System_GetOperationMode() != OPMODE_BLUETOOTH_SINK) { // Card removed => pause
-				AudioPlayer_SetTrackControl(PAUSEPLAY);
+				CommandBus_PostTrackControl(PAUSEPLAY, CommandSource::Rfid);
 				Log_Println(rfidTagRemoved, LOGLEVEL_NOTICE);
 			}
 			cardAppliedLastRun = cardAppliedCurrentRun;
@@ -316,17 +323,19 @@ void RfidPn5180_Task(void *parameter) {
 	#else
 				if (!sameCardReapplied) { // Don't allow to send card to queue if it's the same card again...
 	#endif
-					xQueueSend(gRfidCardQueue, cardIdString.c_str(), 0);
+					TapTrace_Begin(pollStartUs, readUs);
+					CommandBus_PostRfidCard(cardIdString.c_str(), CommandSource::Rfid);
 				} else {
 					// If pause-button was pressed while card was not applied, playback could be active. If so: don't pause when card is reapplied again as the desired functionality would be reversed in this case.
 					if (gPlayProperties.pausePlay && System_GetOperationMode() != OPMODE_BLUETOOTH_SINK) {
-						AudioPlayer_SetTrackControl(PAUSEPLAY); // ... play/pause instead
+						CommandBus_PostTrackControl(PAUSEPLAY, CommandSource::Rfid); // ... play/pause instead
 						Log_Println(rfidTagReapplied, LOGLEVEL_NOTICE);
 					}
 				}
 				memcpy(lastValidcardId, uid, cardIdSize);
 			} else {
-				xQueueSend(gRfidCardQueue, cardIdString.c_str(), 0); // If pauseIfRfidRemoved isn't active, every card-apply leads to new playlist-generation
+				TapTrace_Begin(pollStartUs, readUs);
+				CommandBus_PostRfidCard(cardIdString.c_str(), CommandSource::Rfid); // If pauseIfRfidRemoved isn't active, every card-apply leads to new playlist-generation
 			}
 		}
 
@@ -496,6 +505,7 @@ void RfidPn5180_WakeupCheck(void) {
 			gpio_hold_en(gpio_num_t(RFID_RST)); // RST
 			gpio_deep_sleep_hold_en();
 			Log_Println(wakeUpRfidNoCard, LOGLEVEL_ERROR);
+			Log_Flush();
 			esp_deep_sleep_start();
 		} else {
 			Log_Println("switchToLPCD failed", LOGLEVEL_ERROR);
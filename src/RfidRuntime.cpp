@@ -21,10 +21,13 @@ extern void RfidPn5180_Exit(void);
 extern void RfidPn5180_TaskReset(void);
 extern void RfidPn5180_WakeupCheck(void);
 
+extern void Rfid_RegisterMetrics(void);
+
 TaskHandle_t rfidTaskHandle = NULL;
 
 void Rfid_Init(void) {
 #if defined(RFID_READER_TYPE_RUNTIME)
+	Rfid_RegisterMetrics();
 	RfidConfig_Init();
 	RfidReaderType readerType = RfidConfig_GetReaderType();
 	if ((readerType == RfidReaderType::TYPE_MFRC522_SPI) || (readerType == RfidReaderType::TYPE_MFRC522_I2C)) {
@@ -54,6 +57,7 @@ void Rfid_WakeupHandling(void) {
 // starts the task itself and this is a no-op.
 void Rfid_StartTask(void) {
 #if defined(RFID_READER_TYPE_RUNTIME)
+	Rfid_RegisterMetrics();
 	if (RfidConfig_GetReaderType() == RfidReaderType::TYPE_PN5180) {
 		RfidPn5180_StartTask();
 	}
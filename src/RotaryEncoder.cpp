@@ -4,25 +4,25 @@
 #include "RotaryEncoder.h"
 
 #include "AudioPlayer.h"
-#include "Bluetooth.h"
 #include "Button.h"
-#include "Cmd.h"
+#include "CommandBus.h"
 #include "Log.h"
+#include "Scheduler.h"
+#include "SettingsRegistry.h"
 #include "System.h"
 
 #ifdef USEROTARY_ENABLE
 	#include <ESP32Encoder.h>
 #endif
 
-// An override written before this feature existed does not define it (settings-override.h replaces
-// settings.h wholesale), so fall back rather than break those builds.
-#ifndef JUMP_OFFSET_ROTARY
-	#define JUMP_OFFSET_ROTARY 10
-#endif
-
 // Rotary encoder-configuration
 #ifdef USEROTARY_ENABLE
-ESP32Encoder encoder;
+// Called by the PCNT-interrupt on every count: wakes the main-loop instead of polling the encoder
+static void IRAM_ATTR RotaryEncoder_OnCount(void *) {
+	Scheduler_SignalFromISR(LoopHandler::RotaryEncoder);
+}
+
+ESP32Encoder encoder(true, RotaryEncoder_OnCount);
 // Rotary encoder-helper
 int32_t lastEncoderValue;
 int32_t currentEncoderValue;
@@ -125,26 +125,20 @@ void RotaryEncoder_Cyclic(void) {
 					// (30s by default) *each time*, so a flick of the encoder scrubs minutes. Apply the smaller
 					// per-detent rotary step directly instead. Direction comes from the configured command, so
 					// a user who maps CW to backwards still gets backwards.
-					const int32_t step = gPrefsSettings.getUChar("rotSeekStep", JUMP_OFFSET_ROTARY);
+					const int32_t step = SettingsRegistry_Get(SettingId::RotarySeekStep);
 					const int32_t magnitude = abs(detents) * step;
 					AudioPlayer_AddSeekOffset(static_cast<int16_t>((cmd == CMD_SEEK_FORWARDS) ? magnitude : -magnitude));
 					return;
 				}
 
 				for (int32_t i = 0; i < abs(detents); i++) {
-					Cmd_Action(cmd);
+					CommandBus_PostAction(cmd, CommandSource::RotaryEncoder);
 				}
 				return;
 			}
 		}
 
-		if ((OPMODE_NORMAL == System_GetOperationMode()) || (OPMODE_BLUETOOTH_SOURCE == System_GetOperationMode())) {
-			auto newVol = AudioPlayer_GetCurrentVolume() + detents;
-			AudioPlayer_SetVolume(newVol);
-		} else {
-			auto newVol = Bluetooth_GetCurrentVolume() + detents;
-			Bluetooth_SetVolume(newVol);
-		}
+		CommandBus_PostVolumeStep(detents, CommandSource::RotaryEncoder);
 		return;
 	}
 #endif
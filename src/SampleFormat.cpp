@@ -0,0 +1,27 @@
+#include <Arduino.h>
+
+#include "SampleFormat.h"
+
+// Converts interleaved stereo 32-bit samples to 16-bit (upper half of each sample) in place.
+// Works on whole words: one stereo-frame (L+R) is packed into one 32-bit word, four frames per iteration.
+// Writing word i only ever reads words >= i, so in-place is safe.
+void SampleFormat_PackStereo32To16(int32_t *buff, const int16_t frames) {
+	const uint32_t *in = reinterpret_cast<const uint32_t *>(buff);
+	uint32_t *out = reinterpret_cast<uint32_t *>(buff);
+	int16_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		const uint32_t l0 = in[0], r0 = in[1], l1 = in[2], r1 = in[3];
+		const uint32_t l2 = in[4], r2 = in[5], l3 = in[6], r3 = in[7];
+		out[0] = (l0 >> 16) | (r0 & 0xFFFF0000u);
+		out[1] = (l1 >> 16) | (r1 & 0xFFFF0000u);
+		out[2] = (l2 >> 16) | (r2 & 0xFFFF0000u);
+		out[3] = (l3 >> 16) | (r3 & 0xFFFF0000u);
+		in += 8;
+		out += 4;
+	}
+	for (; i < frames; i++) {
+		*out++ = (in[0] >> 16) | (in[1] & 0xFFFF0000u);
+		in += 2;
+	}
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Conversions between the sample-formats of the audio-lib (32 bit I2S-frames) and the Bluetooth source (16 bit)
+void SampleFormat_PackStereo32To16(int32_t *buff, const int16_t frames);
@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "Scheduler.h"
+
+#include "Log.h"
+#include "LoopProfiler.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <freertos/event_groups.h>
+
+constexpr uint8_t schedulerHandlers = static_cast<uint8_t>(LoopHandler::Count);
+constexpr uint32_t schedulerMaxWaitMs = 1000u;
+constexpr uint32_t schedulerIdleWindowMs = 10000u; // idle-percentage is calculated over this window
+
+static_assert(schedulerHandlers <= 24, "one event-bit per handler");
+
+constexpr const char *schedulerHandlerNames[] = {"Wlan", "Web", "Bluetooth", "RotaryEncoder", "Ftp", "AudioPlayer", "Battery",
+	"Button", "System", "SettingsRegistry", "CommandBus", "RecoverLastRfid", "IrReceiver", "HallEffectSensor"};
+static_assert(sizeof(schedulerHandlerNames) / sizeof(schedulerHandlerNames[0]) == schedulerHandlers, "a name per handler");
+
+typedef struct {
+	schedulerHandler_t handler;
+	uint32_t periodMs; // 0: only when signalled
+	uint32_t lastRunMs;
+	uint32_t runs;
+	uint32_t signals; // runs because of a signal
+	uint32_t latencyAvgUs; // signal -> handler
+	uint32_t latencyMaxUs;
+} schedulerEntry_t;
+
+static EventGroupHandle_t Scheduler_Events = nullptr;
+static EventBits_t Scheduler_RegisteredBits = 0u;
+static schedulerEntry_t Scheduler_Entries[schedulerHandlers];
+static volatile uint32_t Scheduler_SignalUs[schedulerHandlers]; // time of the first signal that's not handled yet
+
+// Only touched by the loop-task
+static uint32_t Scheduler_WindowStartUs = 0u;
+static uint32_t Scheduler_WindowIdleUs = 0u;
+static uint8_t Scheduler_IdlePercent = 0u;
+static uint32_t Scheduler_Wakeups = 0u;
+
+// A sample per registered handler
+static void Scheduler_HandlerSamples(metricsWriter_t &out, double (*read)(const schedulerEntry_t &entry)) {
+	for (uint8_t i = 0; i < schedulerHandlers; i++) {
+		if (Scheduler_Entries[i].handler) {
+			Metrics_Sample(out, read(Scheduler_Entries[i]), "handler", schedulerHandlerNames[i]);
+		}
+	}
+}
+
+static void Scheduler_RegisterMetrics(void) {
+	Metrics_Register("loop_wakeups_total", MetricType::Counter, "Wakeups of the main-loop", &Scheduler_Wakeups);
+	Metrics_Register("loop_idle_ratio", MetricType::Gauge, "Share of time the main-loop was idle (last 10 s)", [](metricsWriter_t &out) {
+		Metrics_Sample(out, Scheduler_IdlePercent / 100.0);
+	});
+	Metrics_Register("loop_handler_runs_total", MetricType::Counter, "Runs of the handlers of the main-loop", [](metricsWriter_t &out) {
+		Scheduler_HandlerSamples(out, [](const schedulerEntry_t &entry) -> double {
+			return entry.runs;
+		});
+	});
+	Metrics_Register("loop_handler_latency_avg_seconds", MetricType::Gauge, "Average time from a signal to its handler", [](metricsWriter_t &out) {
+		Scheduler_HandlerSamples(out, [](const schedulerEntry_t &entry) -> double {
+			return entry.latencyAvgUs / 1000000.0;
+		});
+	});
+	Metrics_Register("loop_handler_latency_max_seconds", MetricType::Gauge, "Longest time from a signal to its handler", [](metricsWriter_t &out) {
+		Scheduler_HandlerSamples(out, [](const schedulerEntry_t &entry) -> double {
+			return entry.latencyMaxUs / 1000000.0;
+		});
+	});
+}
+
+void Scheduler_Init(void) {
+	Scheduler_Events = xEventGroupCreate();
+	if (!Scheduler_Events) {
+		Log_Println("Scheduler: unable to create event-group", LOGLEVEL_ERROR);
+	}
+	Scheduler_WindowStartUs = micros();
+	Scheduler_RegisterMetrics();
+}
+
+void Scheduler_Register(const LoopHandler id, const schedulerHandler_t handler, const uint32_t periodMs) {
+	const uint8_t i = static_cast<uint8_t>(id);
+	if (i >= schedulerHandlers) {
+		return;
+	}
+	Scheduler_Entries[i] = {};
+	Scheduler_Entries[i].handler = handler;
+	Scheduler_Entries[i].periodMs = periodMs;
+	Scheduler_RegisteredBits |= (1u << i);
+}
+
+// Handlers may adapt their period to their state (e.g. faster while a server is running)
+void Scheduler_SetPeriod(const LoopHandler id, const uint32_t periodMs) {
+	const uint8_t i = static_cast<uint8_t>(id);
+	if (i < schedulerHandlers) {
+		Scheduler_Entries[i].periodMs = periodMs;
+	}
+}
+
+// Wakes the loop and runs the handler with its next pass (can be called from any task)
+void Scheduler_Signal(const LoopHandler id) {
+	const uint8_t i = static_cast<uint8_t>(id);
+	if (!Scheduler_Events || i >= schedulerHandlers) {
+		return;
+	}
+	if (!(xEventGroupGetBits(Scheduler_Events) & (1u << i))) {
+		Scheduler_SignalUs[i] = micros();
+	}
+	xEventGroupSetBits(Scheduler_Events, 1u << i);
+}
+
+void IRAM_ATTR Scheduler_SignalFromISR(const LoopHandler id) {
+	const uint8_t i = static_cast<uint8_t>(id);
+	if (!Scheduler_Events || i >= schedulerHandlers) {
+		return;
+	}
+	if (!(xEventGroupGetBitsFromISR(Scheduler_Events) & (1u << i))) {
+		Scheduler_SignalUs[i] = micros();
+	}
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	if (xEventGroupSetBitsFromISR(Scheduler_Events, 1u << i, &higherPriorityTaskWoken) == pdPASS) {
+		portYIELD_FROM_ISR(higherPriorityTaskWoken);
+	}
+}
+
+// Time until the next periodic handler is due
+static uint32_t Scheduler_GetWaitMs(const uint32_t now) {
+	uint32_t waitMs = schedulerMaxWaitMs;
+	for (uint8_t i = 0; i < schedulerHandlers; i++) {
+		const schedulerEntry_t &entry = Scheduler_Entries[i];
+		if (!entry.handler || !entry.periodMs) {
+			continue;
+		}
+		const uint32_t elapsed = now - entry.lastRunMs;
+		waitMs = std::min(waitMs, (elapsed >= entry.periodMs) ? 0u : entry.periodMs - elapsed);
+	}
+	return waitMs;
+}
+
+// One pass of the main-loop: blocks until a handler is due or signalled, then runs those
+void Scheduler_Run(void) {
+	const uint32_t waitMs = Scheduler_GetWaitMs(millis());
+	const uint32_t waitStartUs = micros();
+	EventBits_t signalled = 0u;
+	if (Scheduler_Events) {
+		signalled = waitMs ? xEventGroupWaitBits(Scheduler_Events, Scheduler_RegisteredBits, pdTRUE, pdFALSE, pdMS_TO_TICKS(waitMs)) : xEventGroupClearBits(Scheduler_Events, Scheduler_RegisteredBits);
+		signalled &= Scheduler_RegisteredBits;
+	} else {
+		vTaskDelay(pdMS_TO_TICKS(waitMs));
+	}
+	const uint32_t wakeupUs = micros();
+	Scheduler_WindowIdleUs += wakeupUs - waitStartUs;
+	Scheduler_Wakeups++;
+
+#ifdef LOOP_PROFILER_ENABLE
+	const uint32_t passStartCycles = ESP.getCycleCount();
+#endif
+	const uint32_t now = millis();
+	for (uint8_t i = 0; i < schedulerHandlers; i++) {
+		schedulerEntry_t &entry = Scheduler_Entries[i];
+		const bool isSignalled = signalled & (1u << i);
+		if (!entry.handler || (!isSignalled && (!entry.periodMs || now - entry.lastRunMs < entry.periodMs))) {
+			continue;
+		}
+		if (isSignalled) {
+			const uint32_t latencyUs = micros() - Scheduler_SignalUs[i];
+			entry.latencyAvgUs = entry.signals ? entry.latencyAvgUs + (static_cast<int32_t>(latencyUs) - static_cast<int32_t>(entry.latencyAvgUs)) / 16 : latencyUs;
+			entry.latencyMaxUs = std::max(entry.latencyMaxUs, latencyUs);
+			entry.signals++;
+		}
+		entry.lastRunMs = now;
+		entry.runs++;
+		LOOP_PROFILE(static_cast<LoopHandler>(i), entry.handler());
+	}
+#ifdef LOOP_PROFILER_ENABLE
+	LoopProfiler_LoopFinished(passStartCycles);
+	LoopProfiler_Cyclic();
+#endif
+
+	const uint32_t windowUs = micros() - Scheduler_WindowStartUs;
+	if (windowUs >= schedulerIdleWindowMs * 1000u) {
+		Scheduler_IdlePercent = std::min<uint32_t>(100u, (uint64_t) Scheduler_WindowIdleUs * 100u / windowUs);
+		Scheduler_WindowStartUs += windowUs;
+		Scheduler_WindowIdleUs = 0u;
+	}
+}
+
+const char *Scheduler_GetHandlerName(const LoopHandler id) {
+	const uint8_t i = static_cast<uint8_t>(id);
+	return (i < schedulerHandlers) ? schedulerHandlerNames[i] : "";
+}
+
+void Scheduler_ToJSON(JsonObject obj) {
+	obj["idlePercent"] = Scheduler_IdlePercent;
+	obj["wakeups"] = Scheduler_Wakeups;
+	JsonObject handlersObj = obj["handlers"].to<JsonObject>();
+	for (uint8_t i = 0; i < schedulerHandlers; i++) {
+		const schedulerEntry_t &entry = Scheduler_Entries[i];
+		if (!entry.handler) {
+			continue;
+		}
+		JsonObject handlerObj = handlersObj[schedulerHandlerNames[i]].to<JsonObject>();
+		handlerObj["periodMs"] = entry.periodMs;
+		handlerObj["runs"] = entry.runs;
+		handlerObj["signals"] = entry.signals;
+		handlerObj["avgLatencyUs"] = entry.latencyAvgUs;
+		handlerObj["maxLatencyUs"] = entry.latencyMaxUs;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+
+// Scheduler of the main-loop: every handler is registered with a period and/or is woken by its event
+// (Scheduler_Signal(), e.g. after putting something into a queue or from an ISR). In between, the loop-task blocks
+// on an event-group, so the CPU is idle (and can light-sleep if power-management is enabled) instead of polling.
+
+enum class LoopHandler : uint8_t {
+	Wlan = 0,
+	Web,
+	Bluetooth,
+	RotaryEncoder,
+	Ftp,
+	AudioPlayer,
+	Battery,
+	Button,
+	System,
+	SettingsRegistry,
+	CommandBus,
+	RecoverLastRfid,
+	IrReceiver,
+	HallEffectSensor,
+	Count
+};
+
+typedef void (*schedulerHandler_t)(void);
+
+void Scheduler_Init(void);
+void Scheduler_Register(const LoopHandler id, const schedulerHandler_t handler, const uint32_t periodMs);
+void Scheduler_SetPeriod(const LoopHandler id, const uint32_t periodMs);
+void Scheduler_Signal(const LoopHandler id);
+void Scheduler_SignalFromISR(const LoopHandler id);
+void Scheduler_Run(void);
+const char *Scheduler_GetHandlerName(const LoopHandler id);
+void Scheduler_ToJSON(JsonObject obj);
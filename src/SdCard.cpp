@@ -7,10 +7,13 @@
 #include "Led.h"
 #include "Log.h"
 #include "MemX.h"
+#include "Metrics.h"
 #include "System.h"
 
 #include <esp_random.h>
 #include <esp_vfs_fat.h>
+#include <ff.h>
+#include <diskio.h> // after ff.h
 
 #ifdef SD_MMC_1BIT_MODE
 	#define HARDWARE_FS SD_MMC
@@ -22,6 +25,62 @@ SanitizedFS gFSystem(HARDWARE_FS);
 
 uint8_t maxRecursionDepth;
 
+#ifdef IO_METRICS_ENABLE
+// Traffic of the SD-card: everything FatFs reads or writes (audio, playlists, uploads, FTP, log-files) passes its
+// disk-I/O layer, which is wrapped by the linker (${io_metrics.build_flags} in platformio.ini).
+// FatFs locks the volume around the calls, so they don't run concurrently.
+constexpr uint16_t sdCardSectorSize = 512u;
+
+static uint32_t SdCard_SectorsRead = 0u;
+static uint32_t SdCard_SectorsWritten = 0u;
+static uint32_t SdCard_ReadErrors = 0u;
+static uint32_t SdCard_WriteErrors = 0u;
+static MetricsHistogram SdCard_ReadLatency;
+static MetricsHistogram SdCard_WriteLatency;
+
+extern "C" DRESULT __real_ff_disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) __attribute__((weak));
+extern "C" DRESULT __real_ff_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count) __attribute__((weak));
+
+extern "C" DRESULT __wrap_ff_disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) {
+	const uint32_t startUs = micros();
+	const DRESULT result = __real_ff_disk_read(pdrv, buff, sector, count);
+	SdCard_ReadLatency.observe(micros() - startUs);
+	if (result == RES_OK) {
+		SdCard_SectorsRead += count;
+	} else {
+		SdCard_ReadErrors++;
+	}
+	return result;
+}
+
+extern "C" DRESULT __wrap_ff_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count) {
+	const uint32_t startUs = micros();
+	const DRESULT result = __real_ff_disk_write(pdrv, buff, sector, count);
+	SdCard_WriteLatency.observe(micros() - startUs);
+	if (result == RES_OK) {
+		SdCard_SectorsWritten += count;
+	} else {
+		SdCard_WriteErrors++;
+	}
+	return result;
+}
+
+static void SdCard_RegisterMetrics(void) {
+	Metrics_Register("sd_read_bytes_total", MetricType::Counter, "Bytes read from the SD-card", [](metricsWriter_t &out) {
+		Metrics_Sample(out, static_cast<double>(SdCard_SectorsRead) * sdCardSectorSize);
+	});
+	Metrics_Register("sd_written_bytes_total", MetricType::Counter, "Bytes written to the SD-card", [](metricsWriter_t &out) {
+		Metrics_Sample(out, static_cast<double>(SdCard_SectorsWritten) * sdCardSectorSize);
+	});
+	Metrics_Register("sd_errors_total", MetricType::Counter, "Failed reads and writes of the SD-card", [](metricsWriter_t &out) {
+		Metrics_Sample(out, SdCard_ReadErrors, "op", "read");
+		Metrics_Sample(out, SdCard_WriteErrors, "op", "write");
+	});
+	Metrics_Register("sd_read_seconds", "Latency of the reads of the SD-card", &SdCard_ReadLatency);
+	Metrics_Register("sd_write_seconds", "Latency of the writes of the SD-card", &SdCard_WriteLatency);
+}
+#endif
+
 void SdCard_Init(void) {
 #ifdef NO_SDCARD
 	// Initialize without any SD card, e.g. for webplayer only
@@ -53,11 +112,16 @@ void SdCard_Init(void) {
 #ifdef SHUTDOWN_IF_SD_BOOT_FAILS
 		if (millis() >= deepsleepTimeAfterBootFails * 1000) {
 			Log_Println(sdBootFailedDeepsleep, LOGLEVEL_ERROR);
+			Log_Flush();
 			esp_deep_sleep_start();
 		}
 #endif
 	}
 
+#ifdef IO_METRICS_ENABLE
+	SdCard_RegisterMetrics();
+#endif
+
 	// Used when building recursive playlists
 	maxRecursionDepth = gPrefsSettings.getUInt("nvsRecDepth", 255);
 	if (maxRecursionDepth == 255) {
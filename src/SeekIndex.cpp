@@ -0,0 +1,401 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "SeekIndex.h"
+
+#include "Log.h"
+#include "MemX.h"
+#include "SdCard.h"
+
+#include <algorithm>
+#include <freertos/task.h>
+
+// File-layout (little-endian):
+//   header  24 bytes: "ESKI", version, type (0: MP3, 1: AAC), frames per entry (u16), size of the audio-file (u32),
+//           sample-rate (u32), samples per frame (u16), reserved (u16), entry-count (u32)
+//   entries byte-offset (u32) of audio-frame entry * frames per entry (a Xing-/Info-frame isn't an audio-frame)
+// Lookups read just the entry they need from the card, so the index can be fine-grained for files of any length.
+
+constexpr uint8_t seekIndexVersion = 2u;
+constexpr uint16_t seekIndexFramesPerEntry = 16u; // a lookup walks 15 frame-headers at most (< 0.4 s of audio)
+constexpr uint32_t seekIndexWriteEntries = 256u; // entries are written in blocks while the file is scanned
+constexpr uint32_t seekIndexLookupBufferSize = 4096u; // so the frames behind an entry are read at once
+constexpr uint32_t seekIndexFramesPerYield = 256u; // indexing runs in the background while playback reads the same card
+constexpr uint32_t seekIndexMaxResyncBytes = 65536u; // garbage between two frames that's skipped
+constexpr uint32_t seekIndexTaskStackSize = 4096u;
+constexpr UBaseType_t seekIndexTaskPriority = 1u; // below the audio-task
+constexpr size_t seekIndexMaxPathLength = 256u;
+constexpr const char *seekIndexDir = "/.cache/seek";
+
+enum class SeekIndexType : uint8_t {
+	Mp3 = 0,
+	Aac = 1 // ADTS
+};
+
+typedef struct {
+	char magic[4];
+	uint8_t version;
+	uint8_t type;
+	uint16_t framesPerEntry;
+	uint32_t fileSize;
+	uint32_t sampleRate;
+	uint16_t samplesPerFrame;
+	uint16_t reserved;
+	uint32_t count;
+} seekIndexHeader_t;
+
+static_assert(sizeof(seekIndexHeader_t) == 24, "layout of the index-file");
+
+typedef struct {
+	uint32_t sampleRate;
+	uint16_t samplesPerFrame;
+	uint32_t length; // bytes including header
+} seekIndexFrame_t;
+
+// Buffered reading of frame-headers (the frames themselves are skipped)
+typedef struct {
+	File file;
+	uint8_t *buf;
+	uint32_t capacity;
+	uint32_t start; // file-offset of buf[0]
+	uint32_t len;
+} seekIndexReader_t;
+
+static TaskHandle_t SeekIndex_TaskHandle = nullptr;
+static portMUX_TYPE SeekIndex_RequestMux = portMUX_INITIALIZER_UNLOCKED;
+static char SeekIndex_RequestedPath[seekIndexMaxPathLength];
+static bool SeekIndex_RequestPending = false;
+
+// Index of the file last looked up, kept open (only used by the audio-task)
+static String SeekIndex_LoadedPath;
+static seekIndexHeader_t SeekIndex_LoadedHeader;
+static File SeekIndex_LoadedFile;
+
+static bool SeekIndex_GetType(const char *path, SeekIndexType *type) {
+	const size_t len = strlen(path);
+	if (len > 4 && !strcasecmp(&path[len - 4], ".mp3")) {
+		*type = SeekIndexType::Mp3;
+		return true;
+	}
+	if (len > 4 && !strcasecmp(&path[len - 4], ".aac")) {
+		*type = SeekIndexType::Aac;
+		return true;
+	}
+	return false;
+}
+
+static String SeekIndex_GetIndexPath(const char *path) {
+	String indexPath = seekIndexDir;
+	indexPath.concat(path);
+	indexPath.concat(".idx");
+	return indexPath;
+}
+
+// MPEG 1/2/2.5 layer III
+static bool SeekIndex_ParseMp3Frame(const uint8_t *h, seekIndexFrame_t *frame) {
+	static constexpr uint16_t bitratesMpeg1[15] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+	static constexpr uint16_t bitratesMpeg2[15] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160};
+	static constexpr uint32_t sampleRates[3] = {44100, 48000, 32000};
+
+	if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0 || ((h[1] >> 1) & 0x03) != 0x01) {
+		return false;
+	}
+	const uint8_t version = (h[1] >> 3) & 0x03; // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+	const uint8_t bitrateIndex = h[2] >> 4;
+	const uint8_t rateIndex = (h[2] >> 2) & 0x03;
+	if (version == 1 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) { // reserved or free-format
+		return false;
+	}
+	const bool mpeg1 = (version == 3);
+	frame->sampleRate = sampleRates[rateIndex] >> (mpeg1 ? 0 : ((version == 2) ? 1 : 2));
+	frame->samplesPerFrame = mpeg1 ? 1152u : 576u;
+	const uint32_t bitrate = (mpeg1 ? bitratesMpeg1 : bitratesMpeg2)[bitrateIndex] * 1000u;
+	frame->length = (mpeg1 ? 144u : 72u) * bitrate / frame->sampleRate + ((h[2] >> 1) & 0x01);
+	return true;
+}
+
+// ADTS with one raw data block per frame (which is what encoders write)
+static bool SeekIndex_ParseAdtsFrame(const uint8_t *h, seekIndexFrame_t *frame) {
+	static constexpr uint32_t sampleRates[13] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+
+	if (h[0] != 0xFF || (h[1] & 0xF6) != 0xF0) {
+		return false;
+	}
+	const uint8_t rateIndex = (h[2] >> 2) & 0x0F;
+	if (rateIndex >= 13 || (h[6] & 0x03) != 0) {
+		return false;
+	}
+	frame->sampleRate = sampleRates[rateIndex];
+	frame->samplesPerFrame = 1024u;
+	frame->length = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+	return frame->length > 7u;
+}
+
+static bool SeekIndex_ParseFrame(const SeekIndexType type, const uint8_t *h, seekIndexFrame_t *frame) {
+	return (type == SeekIndexType::Mp3) ? SeekIndex_ParseMp3Frame(h, frame) : SeekIndex_ParseAdtsFrame(h, frame);
+}
+
+// The Xing-/Info-frame (or VBRI-frame) at the start of a MP3 only holds the header of the file: decoders don't
+// output it, so it's no audio-frame. h has to hold seekIndexXingBytes.
+constexpr uint32_t seekIndexXingBytes = 4u + 32u + 4u;
+static bool SeekIndex_IsXingFrame(const uint8_t *h) {
+	const bool mpeg1 = (((h[1] >> 3) & 0x03) == 0x03);
+	const bool mono = (((h[3] >> 6) & 0x03) == 0x03);
+	const uint8_t *xing = &h[4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17))]; // behind the side-info
+	return !memcmp(xing, "Xing", 4) || !memcmp(xing, "Info", 4) || !memcmp(&h[4 + 32], "VBRI", 4);
+}
+
+// Returns the bytes at pos (at least 'bytes' of them) or nullptr at the end of the file
+static const uint8_t *SeekIndex_Peek(seekIndexReader_t &reader, const uint32_t pos, const uint32_t bytes) {
+	if (pos < reader.start || pos + bytes > reader.start + reader.len) {
+		if (!reader.file.seek(pos)) {
+			return nullptr;
+		}
+		reader.start = pos;
+		reader.len = reader.file.read(reader.buf, reader.capacity);
+		if (reader.len < bytes) {
+			return nullptr;
+		}
+	}
+	return &reader.buf[pos - reader.start];
+}
+
+// Offset of the audio-data (behind an ID3v2-tag)
+static uint32_t SeekIndex_GetDataStart(seekIndexReader_t &reader) {
+	const uint8_t *h = SeekIndex_Peek(reader, 0, 10);
+	if (!h || memcmp(h, "ID3", 3)) {
+		return 0;
+	}
+	return 10u + ((h[6] & 0x7F) << 21 | (h[7] & 0x7F) << 14 | (h[8] & 0x7F) << 7 | (h[9] & 0x7F)) + ((h[5] & 0x10) ? 10u : 0u);
+}
+
+// Searches the next frame from pos on. A frame counts only if it's followed by another one (or the end of the file),
+// so a stray sync-word in the data isn't taken for a frame.
+static bool SeekIndex_FindFrame(seekIndexReader_t &reader, const SeekIndexType type, uint32_t &pos, const uint32_t sampleRate, seekIndexFrame_t *frame) {
+	const uint32_t limit = pos + seekIndexMaxResyncBytes;
+	for (; pos < limit; pos++) {
+		const uint8_t *h = SeekIndex_Peek(reader, pos, 8);
+		if (!h) {
+			return false;
+		}
+		if (!SeekIndex_ParseFrame(type, h, frame) || (sampleRate && frame->sampleRate != sampleRate)) {
+			continue;
+		}
+		seekIndexFrame_t next;
+		const uint8_t *n = SeekIndex_Peek(reader, pos + frame->length, 8);
+		if (!n || (SeekIndex_ParseFrame(type, n, &next) && next.sampleRate == frame->sampleRate)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool SeekIndex_IsValid(const char *indexPath, const uint32_t fileSize, seekIndexHeader_t *header) {
+	File file = gFSystem.open(indexPath, FILE_READ);
+	if (!file) {
+		return false;
+	}
+	const bool valid = (file.read((uint8_t *) header, sizeof(*header)) == sizeof(*header)) && !memcmp(header->magic, "ESKI", 4) && header->version == seekIndexVersion
+		&& header->fileSize == fileSize && header->count && header->sampleRate && header->samplesPerFrame && header->framesPerEntry
+		&& file.size() == sizeof(*header) + static_cast<uint64_t>(header->count) * sizeof(uint32_t);
+	file.close();
+	return valid;
+}
+
+// Scans all frames of the file and writes its index
+static bool SeekIndex_Build(const char *path, const SeekIndexType type, const String &indexPath) {
+	static uint8_t readBuf[4096];
+	static uint32_t entries[seekIndexWriteEntries];
+	seekIndexReader_t reader = {gFSystem.open(path, FILE_READ), readBuf, sizeof(readBuf), 0, 0};
+	if (!reader.file) {
+		return false;
+	}
+	const uint32_t startMs = millis();
+	const uint32_t fileSize = reader.file.size();
+	uint32_t pos = SeekIndex_GetDataStart(reader);
+	seekIndexFrame_t frame;
+	if (!SeekIndex_FindFrame(reader, type, pos, 0, &frame)) {
+		Log_Printf(LOGLEVEL_DEBUG, "SeekIndex: no frames found in %s", path);
+		reader.file.close();
+		return false;
+	}
+	if (type == SeekIndexType::Mp3) {
+		const uint8_t *h = SeekIndex_Peek(reader, pos, seekIndexXingBytes);
+		if (h && SeekIndex_IsXingFrame(h)) {
+			pos += frame.length;
+			if (!SeekIndex_FindFrame(reader, type, pos, frame.sampleRate, &frame)) {
+				reader.file.close();
+				return false;
+			}
+		}
+	}
+
+	// written to a temporary file first, so the audio-task never reads an incomplete index
+	const String tmpPath = indexPath + ".tmp";
+	File file = gFSystem.open(tmpPath, FILE_WRITE, true); // create=true, so the directories are created
+	seekIndexHeader_t header = {{'E', 'S', 'K', 'I'}, seekIndexVersion, static_cast<uint8_t>(type), seekIndexFramesPerEntry, fileSize, frame.sampleRate, frame.samplesPerFrame, 0u, 0u};
+	bool success = file && (file.write((const uint8_t *) &header, sizeof(header)) == sizeof(header));
+	uint32_t pending = 0;
+	uint32_t frames = 0;
+	while (success) {
+		if (frames % seekIndexFramesPerEntry == 0) {
+			entries[pending++] = pos;
+			header.count++;
+			if (pending == seekIndexWriteEntries) {
+				success = (file.write((const uint8_t *) entries, sizeof(entries)) == sizeof(entries));
+				pending = 0;
+			}
+		}
+		pos += frame.length;
+		if (++frames % seekIndexFramesPerYield == 0) {
+			vTaskDelay(1);
+		}
+
+		const uint8_t *h = SeekIndex_Peek(reader, pos, 8);
+		if (!h) {
+			break;
+		}
+		if (!SeekIndex_ParseFrame(type, h, &frame) || frame.sampleRate != header.sampleRate) {
+			// damaged frame or tags at the end (ID3v1, APE)
+			if (!SeekIndex_FindFrame(reader, type, pos, header.sampleRate, &frame)) {
+				break;
+			}
+		}
+	}
+	reader.file.close();
+	success = success && (file.write((const uint8_t *) entries, pending * sizeof(uint32_t)) == pending * sizeof(uint32_t)) && file.seek(0)
+		&& (file.write((const uint8_t *) &header, sizeof(header)) == sizeof(header));
+	if (file) {
+		file.close();
+	}
+	if (!success || (gFSystem.exists(indexPath) && !gFSystem.remove(indexPath)) || !gFSystem.rename(tmpPath, indexPath)) {
+		Log_Printf(LOGLEVEL_ERROR, "SeekIndex: writing %s failed", indexPath.c_str());
+		gFSystem.remove(tmpPath);
+		return false;
+	}
+	Log_Printf(LOGLEVEL_DEBUG, "SeekIndex: %s indexed (%" PRIu32 " frames, %" PRIu32 " s) in %" PRIu32 " ms", path, frames, static_cast<uint32_t>(static_cast<uint64_t>(frames) * header.samplesPerFrame / header.sampleRate), millis() - startMs);
+	return true;
+}
+
+static void SeekIndex_Task(void * /*parameter*/) {
+	static char path[seekIndexMaxPathLength];
+	while (true) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		portENTER_CRITICAL(&SeekIndex_RequestMux);
+		const bool pending = SeekIndex_RequestPending;
+		SeekIndex_RequestPending = false;
+		strncpy(path, SeekIndex_RequestedPath, sizeof(path));
+		portEXIT_CRITICAL(&SeekIndex_RequestMux);
+
+		SeekIndexType type;
+		if (!pending || !SeekIndex_GetType(path, &type)) {
+			continue;
+		}
+		File file = gFSystem.open(path, FILE_READ);
+		if (!file) {
+			continue;
+		}
+		const uint32_t fileSize = file.size();
+		file.close();
+		const String indexPath = SeekIndex_GetIndexPath(path);
+		seekIndexHeader_t header;
+		if (!SeekIndex_IsValid(indexPath.c_str(), fileSize, &header)) {
+			SeekIndex_Build(path, type, indexPath);
+		}
+	}
+}
+
+void SeekIndex_Init(void) {
+	xTaskCreatePinnedToCore(
+		SeekIndex_Task, /* Function to implement the task */
+		"SeekIndex", /* Name of the task */
+		seekIndexTaskStackSize, /* Stack size in words */
+		NULL, /* Task input parameter */
+		seekIndexTaskPriority, /* Priority of the task */
+		&SeekIndex_TaskHandle, /* Task handle. */
+		0 /* Core where the task should run */
+	);
+}
+
+// Index the file in the background (if it's MP3/AAC and has no valid index yet). A newer request replaces one
+// that's not started yet.
+void SeekIndex_Request(const char *path) {
+	SeekIndexType type;
+	if (!SeekIndex_TaskHandle || !SeekIndex_GetType(path, &type) || strlen(path) >= seekIndexMaxPathLength) {
+		return;
+	}
+	portENTER_CRITICAL(&SeekIndex_RequestMux);
+	strncpy(SeekIndex_RequestedPath, path, sizeof(SeekIndex_RequestedPath));
+	SeekIndex_RequestPending = true;
+	portEXIT_CRITICAL(&SeekIndex_RequestMux);
+	xTaskNotifyGive(SeekIndex_TaskHandle);
+}
+
+static bool SeekIndex_Load(const char *path, const uint32_t fileSize) {
+	if (SeekIndex_LoadedFile && SeekIndex_LoadedPath == path && SeekIndex_LoadedHeader.fileSize == fileSize) {
+		return true;
+	}
+	if (SeekIndex_LoadedFile) {
+		SeekIndex_LoadedFile.close();
+	}
+	SeekIndex_LoadedPath = path;
+
+	const String indexPath = SeekIndex_GetIndexPath(path);
+	if (!SeekIndex_IsValid(indexPath.c_str(), fileSize, &SeekIndex_LoadedHeader)) {
+		SeekIndex_Request(path); // not indexed (or changed): next time it will be
+		return false;
+	}
+	SeekIndex_LoadedFile = gFSystem.open(indexPath, FILE_READ);
+	return static_cast<bool>(SeekIndex_LoadedFile);
+}
+
+// Byte-offset of the frame that contains targetMs, and the position of its first decoded sample. Reads the entry
+// before the target and walks the frame-headers from there (at most seekIndexFramesPerEntry - 1 of them).
+// False if the file has no (valid) index yet.
+bool SeekIndex_Lookup(const char *path, const uint32_t targetMs, uint32_t *filePos, uint32_t *frameSample) {
+	SeekIndexType type;
+	if (!SeekIndex_GetType(path, &type)) {
+		return false;
+	}
+	seekIndexReader_t reader = {gFSystem.open(path, FILE_READ), nullptr, seekIndexLookupBufferSize, 0, 0};
+	if (!reader.file) {
+		return false;
+	}
+	const seekIndexHeader_t &header = SeekIndex_LoadedHeader;
+	uint32_t pos;
+	if (!SeekIndex_Load(path, reader.file.size())) {
+		reader.file.close();
+		return false;
+	}
+	const uint32_t targetFrame = static_cast<uint64_t>(targetMs) * header.sampleRate / 1000u / header.samplesPerFrame;
+	const uint32_t entry = std::min<uint32_t>(targetFrame / header.framesPerEntry, header.count - 1);
+	if (!SeekIndex_LoadedFile.seek(sizeof(header) + entry * sizeof(uint32_t)) || SeekIndex_LoadedFile.read((uint8_t *) &pos, sizeof(pos)) != sizeof(pos)) {
+		SeekIndex_LoadedFile.close();
+		reader.file.close();
+		return false;
+	}
+
+	uint32_t frameNumber = entry * header.framesPerEntry;
+	reader.buf = (uint8_t *) x_malloc(reader.capacity);
+	seekIndexFrame_t frame;
+	const uint8_t *h = reader.buf ? SeekIndex_Peek(reader, pos, 8) : nullptr;
+	bool valid = h && SeekIndex_ParseFrame(type, h, &frame) && frame.sampleRate == header.sampleRate;
+	while (valid && frameNumber < targetFrame && frameNumber + 1u < (entry + 1u) * header.framesPerEntry) {
+		uint32_t next = pos + frame.length;
+		h = SeekIndex_Peek(reader, next, 8);
+		if (!h || !SeekIndex_ParseFrame(type, h, &frame) || frame.sampleRate != header.sampleRate) {
+			// damaged frame or end of the audio-data, same as while building
+			valid = SeekIndex_FindFrame(reader, type, next, header.sampleRate, &frame);
+			if (!valid) {
+				break;
+			}
+		}
+		pos = next;
+		frameNumber++;
+	}
+	free(reader.buf);
+	reader.file.close();
+	*filePos = pos;
+	*frameSample = frameNumber * header.samplesPerFrame;
+	return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Seek-index for MP3 and AAC (ADTS): a background-task scans a file once and stores the byte-offset of every 16th
+// frame (/.cache/seek/<path of the file>.idx). With it seek and resume jump to an exact frame instead of estimating
+// the position from the bitrate. Positions are counted in decoded samples (at the sample-rate of the file).
+
+void SeekIndex_Init(void);
+void SeekIndex_Request(const char *path);
+bool SeekIndex_Lookup(const char *path, const uint32_t targetMs, uint32_t *filePos, uint32_t *frameSample);
@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "SettingsRegistry.h"
+
+#include "AudioPlayer.h"
+#include "Log.h"
+#include "System.h"
+#include "VolumeCurveLut.h"
+
+#include <algorithm>
+#include <atomic>
+
+// An override written before this feature existed does not define it (settings-override.h replaces
+// settings.h wholesale), so fall back rather than break those builds.
+#ifndef JUMP_OFFSET_ROTARY
+	#define JUMP_OFFSET_ROTARY 10
+#endif
+
+// Defaults that depend on compile-time features
+#ifdef PLAY_LAST_RFID_AFTER_REBOOT
+constexpr bool settingsDefaultPlayLastOnBoot = true;
+#else
+constexpr bool settingsDefaultPlayLastOnBoot = false;
+#endif
+#ifdef PAUSE_WHEN_RFID_REMOVED
+constexpr bool settingsDefaultPauseRfidRemoved = true;
+#else
+constexpr bool settingsDefaultPauseRfidRemoved = false;
+#endif
+#ifdef DONT_ACCEPT_SAME_RFID_TWICE
+constexpr bool settingsDefaultDontAcceptRfidTwice = true;
+#else
+constexpr bool settingsDefaultDontAcceptRfidTwice = false;
+#endif
+#ifdef RESUME_ON_SAME_RFID
+constexpr bool settingsDefaultResumeOnSameRfid = true;
+#else
+constexpr bool settingsDefaultResumeOnSameRfid = false;
+#endif
+
+typedef struct {
+	const char *nvsKey;
+	SettingType type;
+	uint32_t defaultValue;
+	uint32_t minValue;
+	uint32_t maxValue;
+	const char *owner;
+	const char *section;
+	const char *jsonName;
+} settingDescriptor_t;
+
+static constexpr settingDescriptor_t SettingsRegistry_Table[] = {
+#define SETTINGS_REGISTRY_DESCRIPTOR(id, key, type, def, min, max, owner, section, json) {key, SettingType::type, static_cast<uint32_t>(def), static_cast<uint32_t>(min), static_cast<uint32_t>(max), owner, section, json},
+	SETTINGS_REGISTRY_TABLE(SETTINGS_REGISTRY_DESCRIPTOR)
+#undef SETTINGS_REGISTRY_DESCRIPTOR
+};
+static constexpr size_t settingsCount = static_cast<size_t>(SettingId::Count);
+static_assert(sizeof(SettingsRegistry_Table) / sizeof(SettingsRegistry_Table[0]) == settingsCount, "settings-table and SettingId are out of sync");
+static_assert(settingsCount <= 32, "dirty-mask is limited to 32 settings");
+
+uint32_t gSettingsValues[settingsCount];
+
+static constexpr uint32_t settingsWriteDelay = 2000; // ms to wait for further changes before writing to NVS
+static std::atomic<uint32_t> SettingsRegistry_DirtyMask = 0; // settings can be changed from the web-task while loop() flushes
+static uint32_t SettingsRegistry_LastChangeTimestamp = 0;
+
+static constexpr uint8_t settingsMaxListeners = 16;
+static struct {
+	SettingId id;
+	SettingsRegistryListener listener;
+} SettingsRegistry_Listeners[settingsMaxListeners];
+static uint8_t SettingsRegistry_ListenerCount = 0;
+
+static uint32_t SettingsRegistry_Clamp(const settingDescriptor_t &setting, uint32_t value) {
+	return std::clamp(value, setting.minValue, setting.maxValue);
+}
+
+// Loads all settings from NVS (or their default if not present). Has to be called after gPrefsSettings was opened.
+void SettingsRegistry_Init(void) {
+	for (size_t i = 0; i < settingsCount; i++) {
+		const settingDescriptor_t &setting = SettingsRegistry_Table[i];
+		uint32_t value = setting.defaultValue;
+		if (gPrefsSettings.isKey(setting.nvsKey)) {
+			switch (setting.type) {
+				case SettingType::Bool:
+					value = gPrefsSettings.getBool(setting.nvsKey, setting.defaultValue);
+					break;
+				case SettingType::UChar:
+					value = gPrefsSettings.getUChar(setting.nvsKey, setting.defaultValue);
+					break;
+				case SettingType::UShort:
+					value = gPrefsSettings.getUShort(setting.nvsKey, setting.defaultValue);
+					break;
+				case SettingType::UInt:
+					value = gPrefsSettings.getUInt(setting.nvsKey, setting.defaultValue);
+					break;
+			}
+		}
+		gSettingsValues[i] = SettingsRegistry_Clamp(setting, value);
+	}
+	SettingsRegistry_DirtyMask = 0;
+}
+
+// Updates a setting in RAM, notifies its subscribers and schedules the NVS-write.
+// Values out of range are clamped; returns false for an unknown id.
+bool SettingsRegistry_Set(const SettingId id, uint32_t value) {
+	const size_t index = static_cast<size_t>(id);
+	if (index >= settingsCount) {
+		return false;
+	}
+	const settingDescriptor_t &setting = SettingsRegistry_Table[index];
+	const uint32_t clamped = SettingsRegistry_Clamp(setting, value);
+	if (clamped != value) {
+		Log_Printf(LOGLEVEL_NOTICE, "Setting '%s' out of range (%" PRIu32 "), using %" PRIu32, setting.nvsKey, value, clamped);
+	}
+	if (gSettingsValues[index] == clamped) {
+		return true;
+	}
+
+	gSettingsValues[index] = clamped;
+	SettingsRegistry_DirtyMask.fetch_or(1u << index);
+	SettingsRegistry_LastChangeTimestamp = millis();
+	Log_Printf(LOGLEVEL_DEBUG, "Setting '%s' (%s) changed to %" PRIu32, setting.nvsKey, setting.owner, clamped);
+
+	for (uint8_t i = 0; i < SettingsRegistry_ListenerCount; i++) {
+		if (SettingsRegistry_Listeners[i].id == id) {
+			SettingsRegistry_Listeners[i].listener(id, clamped);
+		}
+	}
+	return true;
+}
+
+// Registers a callback that's called (from the writer's context) whenever the given setting changes
+bool SettingsRegistry_Subscribe(const SettingId id, SettingsRegistryListener listener) {
+	if (SettingsRegistry_ListenerCount >= settingsMaxListeners) {
+		Log_Println("SettingsRegistry: too many listeners", LOGLEVEL_ERROR);
+		return false;
+	}
+	SettingsRegistry_Listeners[SettingsRegistry_ListenerCount].id = id;
+	SettingsRegistry_Listeners[SettingsRegistry_ListenerCount].listener = listener;
+	SettingsRegistry_ListenerCount++;
+	return true;
+}
+
+// Writes all changed settings to NVS
+void SettingsRegistry_Flush(void) {
+	const uint32_t dirtyMask = SettingsRegistry_DirtyMask.exchange(0);
+
+	for (size_t i = 0; i < settingsCount; i++) {
+		if (!(dirtyMask & (1u << i))) {
+			continue;
+		}
+		const settingDescriptor_t &setting = SettingsRegistry_Table[i];
+		size_t written = 0;
+		switch (setting.type) {
+			case SettingType::Bool:
+				written = gPrefsSettings.putBool(setting.nvsKey, gSettingsValues[i] != 0);
+				break;
+			case SettingType::UChar:
+				written = gPrefsSettings.putUChar(setting.nvsKey, gSettingsValues[i]);
+				break;
+			case SettingType::UShort:
+				written = gPrefsSettings.putUShort(setting.nvsKey, gSettingsValues[i]);
+				break;
+			case SettingType::UInt:
+				written = gPrefsSettings.putUInt(setting.nvsKey, gSettingsValues[i]);
+				break;
+		}
+		if (!written) {
+			Log_Printf(LOGLEVEL_ERROR, webSaveSettingsError, setting.nvsKey);
+		}
+	}
+}
+
+// Coalesces writes: settings are written once no further change happened for settingsWriteDelay
+void SettingsRegistry_Cyclic(void) {
+	if (SettingsRegistry_DirtyMask && (millis() - SettingsRegistry_LastChangeTimestamp >= settingsWriteDelay)) {
+		SettingsRegistry_Flush();
+	}
+}
+
+// Adds all settings of a section to a JSON-object (current values or their defaults)
+void SettingsRegistry_ToJSON(JsonObject obj, const char *section, bool defaults) {
+	for (size_t i = 0; i < settingsCount; i++) {
+		const settingDescriptor_t &setting = SettingsRegistry_Table[i];
+		if (strcmp(setting.section, section) != 0) {
+			continue;
+		}
+		const uint32_t value = defaults ? setting.defaultValue : gSettingsValues[i];
+		if (setting.type == SettingType::Bool) {
+			obj[setting.jsonName].set(value != 0);
+		} else {
+			obj[setting.jsonName].set(value);
+		}
+	}
+}
+
+// Takes over all settings of a section from a JSON-object. Settings missing in the object are left untouched
+// (e.g. an older cached GUI-page that doesn't know a setting yet must not reset it).
+bool SettingsRegistry_FromJSON(JsonObject obj, const char *section) {
+	bool success = true;
+	for (size_t i = 0; i < settingsCount; i++) {
+		const settingDescriptor_t &setting = SettingsRegistry_Table[i];
+		if (strcmp(setting.section, section) != 0 || obj[setting.jsonName].isNull()) {
+			continue;
+		}
+		const uint32_t value = (setting.type == SettingType::Bool) ? obj[setting.jsonName].as<bool>() : obj[setting.jsonName].as<uint32_t>();
+		success = SettingsRegistry_Set(static_cast<SettingId>(i), value) && success;
+	}
+	return success;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ArduinoJson.h"
+
+// Typed settings that are loaded from NVS into RAM once at boot.
+// Reading one of them is a plain memory-load. Writes update RAM immediately, notify subscribed modules
+// and are written back to NVS coalesced by SettingsRegistry_Cyclic() (or SettingsRegistry_Flush() at shutdown).
+// The JSON-representation of the web-interface ("general"-section) is generated from this table as well.
+
+enum class SettingType : uint8_t {
+	Bool = 0,
+	UChar,
+	UShort,
+	UInt
+};
+
+// X(id, NVS-key, type, default, min, max, owning module, JSON-section, JSON-name)
+// Defaults are only evaluated in SettingsRegistry.cpp
+#define SETTINGS_REGISTRY_TABLE(X)                                                                                                      \
+	X(InitVolume, "initVolume", UInt, AUDIOPLAYER_VOLUME_INIT, 1u, AUDIOPLAYER_VOLUME_MAX, "AudioPlayer", "general", "initVolume")      \
+	X(MaxVolumeSpeaker, "maxVolumeSp", UInt, AUDIOPLAYER_VOLUME_MAX, 1u, AUDIOPLAYER_VOLUME_MAX, "AudioPlayer", "general", "maxVolumeSp") \
+	X(MaxVolumeHeadphone, "maxVolumeHp", UInt, AUDIOPLAYER_VOLUME_MAX, 1u, AUDIOPLAYER_VOLUME_MAX, "AudioPlayer", "general", "maxVolumeHp") \
+	X(MaxInactivityTime, "mInactiviyT", UInt, 10u, 0u, 255u, "System", "general", "sleepInactivity")                                  \
+	X(RotarySeekStep, "rotSeekStep", UChar, JUMP_OFFSET_ROTARY, 1u, 255u, "RotaryEncoder", "general", "rotSeekStep")                  \
+	X(PlayMono, "playMono", Bool, false, 0u, 1u, "AudioPlayer", "general", "playMono")                                                 \
+	X(SavePosShutdown, "savePosShutdown", Bool, false, 0u, 1u, "AudioPlayer", "general", "savePosShutdown")                            \
+	X(SavePosRfidChange, "savePosRfidChge", Bool, false, 0u, 1u, "AudioPlayer", "general", "savePosRfidChge")                          \
+	X(SavePosInterval, "savePosIntv", UShort, 0u, 0u, UINT16_MAX, "AudioPlayer", "general", "savePosInterval")                        \
+	X(PlayLastRfidOnReboot, "playLastOnBoot", Bool, settingsDefaultPlayLastOnBoot, 0u, 1u, "main", "general", "playLastRfidOnReboot")  \
+	X(PauseIfRfidRemoved, "pauseRfidRem", Bool, settingsDefaultPauseRfidRemoved, 0u, 1u, "AudioPlayer", "general", "pauseIfRfidRemoved") \
+	X(DontAcceptRfidTwice, "dAccRfidTwice", Bool, settingsDefaultDontAcceptRfidTwice, 0u, 1u, "AudioPlayer", "general", "dontAcceptRfidTwice") \
+	X(ResumeOnSameRfid, "p2pSameRfid", Bool, settingsDefaultResumeOnSameRfid, 0u, 1u, "AudioPlayer", "general", "resumeOnSameRfid")    \
+	X(PauseOnMinVolume, "pauseOnMinVol", Bool, false, 0u, 1u, "AudioPlayer", "general", "pauseOnMinVol")                               \
+	X(RecoverVolumeOnBoot, "recoverVolBoot", Bool, false, 0u, 1u, "AudioPlayer", "general", "recoverVolBoot")                          \
+	X(VolumeCurve, "volumeCurve", UChar, 0u, 0u, (VOL_LUT_CURVES - 1), "AudioPlayer", "general", "volumeCurve")                        \
+	X(TrackTransition, "trackTrans", UChar, 0u, 0u, 2u, "AudioPlayer", "general", "trackTransition")                                   \
+	X(CrossfadeMs, "crossfadeMs", UShort, 3000u, 500u, 5000u, "AudioPlayer", "general", "crossfadeMs")                                 \
+	X(ReplayGain, "replayGain", UChar, 0u, 0u, 2u, "AudioPlayer", "general", "replayGain")                                              \
+	X(LogLevel, "logLevel", UChar, SERIAL_LOGLEVEL, LOGLEVEL_ERROR, LOGLEVEL_DEBUG, "Log", "general", "logLevel")
+
+enum class SettingId : uint8_t {
+#define SETTINGS_REGISTRY_ENUM(id, key, type, def, min, max, owner, section, json) id,
+	SETTINGS_REGISTRY_TABLE(SETTINGS_REGISTRY_ENUM)
+#undef SETTINGS_REGISTRY_ENUM
+	Count
+};
+
+typedef void (*SettingsRegistryListener)(SettingId id, uint32_t value);
+
+extern uint32_t gSettingsValues[static_cast<size_t>(SettingId::Count)];
+
+inline uint32_t SettingsRegistry_Get(const SettingId id) {
+	return gSettingsValues[static_cast<size_t>(id)];
+}
+
+inline bool SettingsRegistry_GetBool(const SettingId id) {
+	return gSettingsValues[static_cast<size_t>(id)] != 0;
+}
+
+void SettingsRegistry_Init(void);
+void SettingsRegistry_Cyclic(void);
+void SettingsRegistry_Flush(void);
+bool SettingsRegistry_Set(const SettingId id, uint32_t value);
+bool SettingsRegistry_Subscribe(const SettingId id, SettingsRegistryListener listener);
+void SettingsRegistry_ToJSON(JsonObject obj, const char *section, bool defaults);
+bool SettingsRegistry_FromJSON(JsonObject obj, const char *section);
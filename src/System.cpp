@@ -7,14 +7,19 @@
 #include "AudioPlayer.h"
 #include "Bluetooth.h"
 #include "Ftp.h"
+#include "HeapProfiler.h"
 #include "Led.h"
 #include "Log.h"
+#include "LogSd.h"
 #include "MemX.h"
+#include "Metrics.h"
 #include "Mqtt.h"
 #include "Port.h"
 #include "Power.h"
 #include "Rfid.h"
 #include "SdCard.h"
+#include "SettingsRegistry.h"
+#include "TaskMonitor.h"
 #include "Web.h"
 #include "Wlan.h"
 #include "esp_system.h"
@@ -22,7 +27,9 @@
 #include "freertos/task.h"
 
 #include <atomic>
+#include <esp_heap_caps.h>
 #include <esp_random.h>
+#include <nvs.h>
 
 constexpr const char prefsRfidNamespace[] = "rfidTags"; // Namespace used to save IDs of rfid-tags
 constexpr const char prefsSettingsNamespace[] = "settings"; // Namespace used for generic settings
@@ -46,6 +53,54 @@ void System_SleepHandler(void);
 void System_DeepSleepManager(void);
 void System_RebootHandler(void);
 
+#ifdef IO_METRICS_ENABLE
+// Every write of Preferences ends with a commit, which is wrapped by the linker (${io_metrics.build_flags} in platformio.ini)
+static std::atomic<uint32_t> System_NvsCommits {0u};
+
+extern "C" esp_err_t __real_nvs_commit(nvs_handle_t handle) __attribute__((weak));
+
+extern "C" esp_err_t __wrap_nvs_commit(nvs_handle_t handle) {
+	System_NvsCommits++;
+	return __real_nvs_commit(handle);
+}
+#endif
+
+// Writes a sample per memory (PSRAM only if present)
+static void System_HeapSamples(metricsWriter_t &out, size_t (*read)(uint32_t caps)) {
+	Metrics_Sample(out, read(MALLOC_CAP_INTERNAL), "memory", "internal");
+	if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM)) {
+		Metrics_Sample(out, read(MALLOC_CAP_SPIRAM), "memory", "psram");
+	}
+}
+
+static void System_RegisterMetrics(void) {
+	Metrics_Register("uptime_seconds", MetricType::Gauge, "Time since boot", [](metricsWriter_t &out) {
+		Metrics_Sample(out, millis() / 1000.0);
+	});
+	Metrics_Register("heap_size_bytes", MetricType::Gauge, "Size of the heap", [](metricsWriter_t &out) {
+		System_HeapSamples(out, heap_caps_get_total_size);
+	});
+	Metrics_Register("heap_free_bytes", MetricType::Gauge, "Free heap", [](metricsWriter_t &out) {
+		System_HeapSamples(out, heap_caps_get_free_size);
+	});
+	Metrics_Register("heap_min_free_bytes", MetricType::Gauge, "Lowest free heap since boot", [](metricsWriter_t &out) {
+		System_HeapSamples(out, heap_caps_get_minimum_free_size);
+	});
+	Metrics_Register("heap_largest_free_block_bytes", MetricType::Gauge, "Largest free block of the heap", [](metricsWriter_t &out) {
+		System_HeapSamples(out, heap_caps_get_largest_free_block);
+	});
+#ifdef IO_METRICS_ENABLE
+	Metrics_Register("nvs_commits_total", MetricType::Counter, "Writes to NVS", &System_NvsCommits);
+#endif
+	Metrics_Register("nvs_entries", MetricType::Gauge, "Entries of the NVS-partition", [](metricsWriter_t &out) {
+		nvs_stats_t stats;
+		if (nvs_get_stats(NULL, &stats) == ESP_OK) {
+			Metrics_Sample(out, stats.used_entries, "state", "used");
+			Metrics_Sample(out, stats.free_entries, "state", "free");
+		}
+	});
+}
+
 // Init only NVS required for LPCD
 void System_Init_Rfid_Prefs(void) {
 	if (!gPrefsRfid.begin(prefsRfidNamespace)) {
@@ -61,24 +116,35 @@ void System_Init(void) {
 	if (!gPrefsSettings.begin(prefsSettingsNamespace)) {
 		Log_Println("Failed to open NVS namespace 'settings'", LOGLEVEL_ERROR);
 	}
+	SettingsRegistry_Init();
 
-	// Get maximum inactivity-time from NVS
-	uint32_t nvsMInactivityTime = gPrefsSettings.getUInt("mInactiviyT", System_MaxInactivityTime);
-	if (nvsMInactivityTime) {
-		System_MaxInactivityTime = nvsMInactivityTime;
-		Log_Printf(LOGLEVEL_INFO, restoredMaxInactivityFromNvs, nvsMInactivityTime);
-	} else {
-		gPrefsSettings.putUInt("mInactiviyT", System_MaxInactivityTime);
-		Log_Println(wroteMaxInactivityToNvs, LOGLEVEL_ERROR);
-	}
+	// Get maximum inactivity-time
+	System_MaxInactivityTime = SettingsRegistry_Get(SettingId::MaxInactivityTime);
+	Log_Printf(LOGLEVEL_INFO, restoredMaxInactivityFromNvs, System_MaxInactivityTime);
+	SettingsRegistry_Subscribe(SettingId::MaxInactivityTime, [](SettingId, uint32_t value) {
+		System_MaxInactivityTime = value;
+	});
+
+	// Loglevel (SERIAL_LOGLEVEL is only the default)
+	Log_SetLevel(SettingsRegistry_Get(SettingId::LogLevel));
+	SettingsRegistry_Subscribe(SettingId::LogLevel, [](SettingId, uint32_t value) {
+		Log_SetLevel(value);
+	});
 
 	System_OperationMode = gPrefsSettings.getUChar("operationMode", OPMODE_NORMAL);
+	System_RegisterMetrics();
 }
 
 void System_Cyclic(void) {
 	System_SleepHandler();
 	System_DeepSleepManager();
 	System_RebootHandler();
+#ifdef HEAP_PROFILER_ENABLE
+	HeapProfiler_Cyclic();
+#endif
+#ifdef TASK_MONITOR_ENABLE
+	TaskMonitor_Cyclic();
+#endif
 }
 
 void System_UpdateActivityTimer(void) {
@@ -142,6 +208,17 @@ uint8_t System_GetSleepTimer(void) {
 	return System_SleepTimer;
 }
 
+// Remaining minutes (rounded up) of the sleep-timer; 0 if it's not running
+uint8_t System_GetSleepTimerMinutesLeft(void) {
+	const uint32_t sleepStart = System_SleepTimerStartTimestamp.load();
+	if (!sleepStart) {
+		return 0u;
+	}
+	const uint32_t elapsedMs = millis() - sleepStart;
+	const uint32_t timerMs = System_SleepTimer * 60000u;
+	return (elapsedMs < timerMs) ? (timerMs - elapsedMs + 59999u) / 60000u : 0u;
+}
+
 void System_SetLockControls(bool value) {
 	System_LockControls = value;
 }
@@ -168,6 +245,7 @@ void System_SetOperationMode(uint8_t opMode) {
 	if (currentOperationMode != opMode) {
 		if (gPrefsSettings.putUChar("operationMode", opMode)) {
 			Log_Println(restartAfterOperationModeChange, LOGLEVEL_INFO);
+			Log_Flush();
 			ESP.restart();
 		}
 	}
@@ -231,9 +309,17 @@ void System_PreparePowerDown(void) {
 	Led_Exit();
 	Bluetooth_Exit();
 
-	if (gPrefsSettings.getBool("recoverVolBoot", false)) {
+	if (SettingsRegistry_GetBool(SettingId::RecoverVolumeOnBoot)) {
 		gPrefsSettings.putUInt("previousVolume", AudioPlayer_GetCurrentVolume());
 	}
+	SettingsRegistry_Flush(); // write pending (coalesced) settings
+#ifdef TASK_MONITOR_ENABLE
+	TaskMonitor_Save(); // stack-usage of this boot
+#endif
+	Log_Flush();
+#ifdef LOG_SD_ENABLE
+	LogSd_Flush(); // before the SD is unmounted
+#endif
 	SdCard_Exit();
 
 	Serial.flush();
@@ -249,6 +335,7 @@ void System_RebootHandler(void) {
 		System_PreparePowerDown();
 		// restart the ESP-32
 		Log_Println("restarting..", LOGLEVEL_NOTICE);
+		Log_Flush();
 		ESP.restart();
 	}
 }
@@ -273,6 +360,7 @@ void System_DeepSleepManager(void) {
 #endif
 		// goto sleep now
 		Log_Println("deep-sleep, good night.......", LOGLEVEL_NOTICE);
+		Log_Flush();
 		esp_deep_sleep_start();
 	}
 }
@@ -0,0 +1,221 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "TapTrace.h"
+
+#include "Rfid.h"
+
+#include <algorithm>
+#include <atomic>
+
+constexpr uint8_t tapTraceStages = static_cast<uint8_t>(TraceStage::Count);
+constexpr uint8_t tapTraceHistorySize = 8u; // traces kept for /debug/traces
+constexpr uint8_t tapTraceBuckets = 16u; // bucket n: 2^(n-1) <= ms < 2^n
+constexpr uint32_t tapTraceMaxAgeMs = 60000u; // older traces are closed as incomplete
+
+// Name of the interval that ends with the stage (the first stage only marks the start)
+constexpr const char *tapTraceIntervalNames[] = {"start", "rfidRead", "rfidPost", "queue", "lookup", "playlist", "handover", "prepare", "open", "firstSound"};
+static_assert(sizeof(tapTraceIntervalNames) / sizeof(tapTraceIntervalNames[0]) == tapTraceStages, "a name per stage");
+
+typedef struct {
+	uint32_t id;
+	uint16_t reached; // bit per stage
+	bool complete;
+	uint32_t stageUs[tapTraceStages];
+	uint32_t startMs; // uptime
+	char cardId[cardIdStringSize];
+} tapTrace_t;
+
+typedef struct {
+	uint32_t count;
+	uint64_t sumUs;
+	uint32_t maxUs;
+	uint32_t histogram[tapTraceBuckets];
+} tapTraceStats_t;
+
+static portMUX_TYPE TapTrace_Mux = portMUX_INITIALIZER_UNLOCKED;
+static tapTrace_t TapTrace_Active;
+static bool TapTrace_IsActive = false;
+static std::atomic<uint8_t> TapTrace_Expected {tapTraceStages}; // next stage of the active trace (lock-free check for the hot paths)
+static uint32_t TapTrace_NextId = 1u;
+static tapTrace_t TapTrace_History[tapTraceHistorySize];
+static uint32_t TapTrace_HistoryCount = 0u;
+static tapTraceStats_t TapTrace_Stats[tapTraceStages]; // index 0: whole trace (start to sound)
+static uint32_t TapTrace_Incomplete = 0u;
+
+static void TapTrace_AddToStats(tapTraceStats_t &stats, const uint32_t us) {
+	const uint32_t ms = us / 1000u;
+	stats.count++;
+	stats.sumUs += us;
+	stats.maxUs = std::max(stats.maxUs, us);
+	stats.histogram[ms ? std::min<uint8_t>(32 - __builtin_clz(ms), tapTraceBuckets - 1) : 0]++;
+}
+
+// Needs TapTrace_Mux
+static void TapTrace_Finish(void) {
+	if (!TapTrace_IsActive) {
+		return;
+	}
+	tapTrace_t &trace = TapTrace_Active;
+	int8_t first = -1;
+	int8_t previous = -1;
+	for (uint8_t stage = 0; stage < tapTraceStages; stage++) {
+		if (!(trace.reached & (1u << stage))) {
+			continue;
+		}
+		if (previous >= 0) {
+			TapTrace_AddToStats(TapTrace_Stats[stage], trace.stageUs[stage] - trace.stageUs[previous]);
+		} else {
+			first = stage;
+		}
+		previous = stage;
+	}
+	if (trace.complete) {
+		TapTrace_AddToStats(TapTrace_Stats[0], trace.stageUs[static_cast<uint8_t>(TraceStage::Sound)] - trace.stageUs[first]);
+	} else {
+		TapTrace_Incomplete++;
+	}
+	TapTrace_History[TapTrace_HistoryCount++ % tapTraceHistorySize] = trace;
+	TapTrace_IsActive = false;
+	TapTrace_Expected.store(tapTraceStages, std::memory_order_relaxed);
+}
+
+// Needs TapTrace_Mux
+static void TapTrace_Start(const TraceStage stage, const uint32_t us) {
+	TapTrace_Finish();
+	TapTrace_Active = {};
+	TapTrace_Active.id = TapTrace_NextId++;
+	TapTrace_Active.startMs = millis();
+	TapTrace_Active.stageUs[static_cast<uint8_t>(stage)] = us;
+	TapTrace_Active.reached = 1u << static_cast<uint8_t>(stage);
+	TapTrace_IsActive = true;
+}
+
+// Called by the RFID-readers right before a card is posted
+void TapTrace_Begin(const uint32_t pollStartUs, const uint32_t readUs) {
+	portENTER_CRITICAL(&TapTrace_Mux);
+	TapTrace_Start(TraceStage::Start, pollStartUs);
+	TapTrace_Active.stageUs[static_cast<uint8_t>(TraceStage::Read)] = readUs;
+	TapTrace_Active.reached |= 1u << static_cast<uint8_t>(TraceStage::Read);
+	TapTrace_Expected.store(static_cast<uint8_t>(TraceStage::Posted), std::memory_order_relaxed);
+	portEXIT_CRITICAL(&TapTrace_Mux);
+}
+
+// Continues the reader's trace or starts a new one (cards from MQTT, web, virtual cards, ...)
+void TapTrace_CardPosted(const char *cardId) {
+	const uint32_t now = micros();
+	portENTER_CRITICAL(&TapTrace_Mux);
+	if (TapTrace_Expected.load(std::memory_order_relaxed) == static_cast<uint8_t>(TraceStage::Posted)) {
+		TapTrace_Active.stageUs[static_cast<uint8_t>(TraceStage::Posted)] = now;
+		TapTrace_Active.reached |= 1u << static_cast<uint8_t>(TraceStage::Posted);
+	} else {
+		TapTrace_Start(TraceStage::Posted, now);
+	}
+	strncpy(TapTrace_Active.cardId, cardId, cardIdStringSize - 1);
+	TapTrace_Expected.store(static_cast<uint8_t>(TraceStage::Lookup), std::memory_order_relaxed);
+	portEXIT_CRITICAL(&TapTrace_Mux);
+}
+
+// Records a stage of the active trace. Stages are only taken in order, so e.g. a track-change of an older playlist
+// doesn't end up in a trace whose card turned out to be unknown.
+void TapTrace_Mark(const TraceStage stage) {
+	if (TapTrace_Expected.load(std::memory_order_relaxed) != static_cast<uint8_t>(stage)) {
+		return; // fast path: not waiting for this stage
+	}
+	const uint32_t now = micros();
+	portENTER_CRITICAL(&TapTrace_Mux);
+	if (TapTrace_Expected.load(std::memory_order_relaxed) == static_cast<uint8_t>(stage)) {
+		if (millis() - TapTrace_Active.startMs > tapTraceMaxAgeMs) {
+			TapTrace_Finish();
+		} else {
+			TapTrace_Active.stageUs[static_cast<uint8_t>(stage)] = now;
+			TapTrace_Active.reached |= 1u << static_cast<uint8_t>(stage);
+			if (stage == TraceStage::Sound) {
+				TapTrace_Active.complete = true;
+				TapTrace_Finish();
+			} else {
+				TapTrace_Expected.store(static_cast<uint8_t>(stage) + 1u, std::memory_order_relaxed);
+			}
+		}
+	}
+	portEXIT_CRITICAL(&TapTrace_Mux);
+}
+
+static void TapTrace_StatsToJSON(JsonObject obj, const tapTraceStats_t &stats) {
+	obj["count"] = stats.count;
+	obj["avgMs"] = stats.count ? (stats.sumUs / stats.count) / 1000.0f : 0.0f;
+	obj["maxMs"] = stats.maxUs / 1000.0f;
+	// bucket n counts durations of 2^(n-1) up to 2^n ms; trailing empty buckets are left out
+	JsonArray histogramArr = obj["log2HistogramMs"].to<JsonArray>();
+	uint8_t last = tapTraceBuckets;
+	while (last && !stats.histogram[last - 1]) {
+		last--;
+	}
+	for (uint8_t bucket = 0; bucket < last; bucket++) {
+		histogramArr.add(stats.histogram[bucket]);
+	}
+}
+
+// Per-stage histograms for /debug
+void TapTrace_ToJSON(JsonObject obj) {
+	tapTraceStats_t stats[tapTraceStages];
+	uint32_t incomplete;
+	portENTER_CRITICAL(&TapTrace_Mux);
+	std::copy(std::begin(TapTrace_Stats), std::end(TapTrace_Stats), stats);
+	incomplete = TapTrace_Incomplete;
+	portEXIT_CRITICAL(&TapTrace_Mux);
+
+	obj["incomplete"] = incomplete; // unknown card, modification-card, error, ...
+#ifdef RFID_SCAN_INTERVAL
+	obj["unseenMaxMs"] = RFID_SCAN_INTERVAL; // a card can sit on the reader this long before a poll starts
+#endif
+	TapTrace_StatsToJSON(obj["total"].to<JsonObject>(), stats[0]);
+	JsonObject stagesObj = obj["stages"].to<JsonObject>();
+	for (uint8_t stage = 1; stage < tapTraceStages; stage++) {
+		TapTrace_StatsToJSON(stagesObj[tapTraceIntervalNames[stage]].to<JsonObject>(), stats[stage]);
+	}
+}
+
+// The last traces as Chrome trace-events: one row ("thread") per trace, one complete-event per interval
+void TapTrace_ChromeTraceToJSON(JsonObject obj) {
+	tapTrace_t traces[tapTraceHistorySize];
+	uint32_t count;
+	portENTER_CRITICAL(&TapTrace_Mux);
+	count = TapTrace_HistoryCount;
+	std::copy(std::begin(TapTrace_History), std::end(TapTrace_History), traces);
+	portEXIT_CRITICAL(&TapTrace_Mux);
+
+	obj["displayTimeUnit"] = "ms";
+	JsonArray eventsArr = obj["traceEvents"].to<JsonArray>();
+	const uint32_t first = (count > tapTraceHistorySize) ? count - tapTraceHistorySize : 0u;
+	for (uint32_t i = first; i < count; i++) {
+		const tapTrace_t &trace = traces[i % tapTraceHistorySize];
+
+		JsonObject nameObj = eventsArr.add<JsonObject>();
+		nameObj["name"] = "thread_name";
+		nameObj["ph"] = "M";
+		nameObj["pid"] = 1;
+		nameObj["tid"] = trace.id;
+		char label[48];
+		snprintf(label, sizeof(label), "tap %" PRIu32 " (%s)%s", trace.id, trace.cardId, trace.complete ? "" : " incomplete");
+		nameObj["args"]["name"] = label;
+
+		int8_t previous = -1;
+		for (uint8_t stage = 0; stage < tapTraceStages; stage++) {
+			if (!(trace.reached & (1u << stage))) {
+				continue;
+			}
+			if (previous >= 0) {
+				JsonObject eventObj = eventsArr.add<JsonObject>();
+				eventObj["name"] = tapTraceIntervalNames[stage];
+				eventObj["cat"] = "tap";
+				eventObj["ph"] = "X";
+				eventObj["ts"] = trace.stageUs[previous];
+				eventObj["dur"] = trace.stageUs[stage] - trace.stageUs[previous];
+				eventObj["pid"] = 1;
+				eventObj["tid"] = trace.id;
+			}
+			previous = stage;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+
+// Tap-to-sound tracing: every RFID-card (or a card posted via MQTT, web, ...) gets a trace-id, and the stages it passes
+// on its way to the speaker are timestamped. Finished traces are added to per-stage histograms (/debug) and the last
+// ones are kept for /debug/traces (Chrome trace-format, open it with chrome://tracing or ui.perfetto.dev).
+
+enum class TraceStage : uint8_t {
+	Start = 0, // reader started the poll that found the card
+	Read, // card-id was read
+	Posted, // posted to the command-bus
+	Lookup, // main-loop starts the NVS-lookup
+	Playlist, // AudioPlayer_SetPlaylist() starts (directory-walk and sort)
+	PlaylistReady, // playlist is handed over to the audio-task
+	Pickup, // audio-task has taken the new playlist
+	Open, // connecttoFS() of the first track starts
+	Opened, // connecttoFS() returned
+	Sound, // first samples are written to I2S (or Bluetooth)
+	Count
+};
+
+void TapTrace_Begin(const uint32_t pollStartUs, const uint32_t readUs);
+void TapTrace_CardPosted(const char *cardId);
+void TapTrace_Mark(const TraceStage stage);
+void TapTrace_ToJSON(JsonObject obj);
+void TapTrace_ChromeTraceToJSON(JsonObject obj);
@@ -0,0 +1,267 @@
+#include <Arduino.h>
+#include "settings.h"
+
+#include "TaskMonitor.h"
+
+#ifdef TASK_MONITOR_ENABLE
+	#include "Log.h"
+
+	#include <Preferences.h>
+	#include <algorithm>
+	#include <esp_freertos_hooks.h>
+	#include <esp_private/freertos_debug.h>
+	#include <esp_timer.h>
+
+	#ifndef CONFIG_FREERTOS_USE_TRACE_FACILITY
+		#error "TASK_MONITOR_ENABLE needs CONFIG_FREERTOS_USE_TRACE_FACILITY (sdkconfig.defaults)"
+	#endif
+
+constexpr uint8_t taskMonitorTasks = 40u; // tasks that are monitored (deleted ones are kept)
+constexpr uint32_t taskMonitorSampleIntervalMs = 1000u;
+constexpr uint8_t taskMonitorSamples = 60u; // per-second busy-time of the cores (last minute)
+constexpr uint8_t taskMonitorCpuAverage = 10u; // CPU-share of the tasks is averaged over ~10 samples
+constexpr uint32_t taskMonitorSaveIntervalMs = 10u * 60u * 1000u; // NVS is written at most this often (and at power-down)
+constexpr uint32_t taskMonitorReportMs = 10u * 60u * 1000u; // uptime when the stack-report is logged
+constexpr uint32_t taskMonitorMinMargin = 512u; // stack kept free: at least this...
+constexpr uint8_t taskMonitorMarginDivisor = 4u; // ...or a quarter of the used stack
+constexpr uint32_t taskMonitorStackGranularity = 256u;
+constexpr uint32_t taskMonitorLowStack = 256u; // less free stack is logged (once per task)
+constexpr const char *taskMonitorNamespace = "taskMonitor"; // key is the name of the task
+
+typedef struct {
+	char name[configMAX_TASK_NAME_LEN];
+	TaskHandle_t handle; // of the last instance
+	BaseType_t core; // tskNO_AFFINITY if not pinned
+	UBaseType_t priority;
+	bool alive;
+	bool lowStackLogged;
+	uint32_t stackSize; // bytes (ESP-IDF counts stacks in bytes)
+	uint32_t stackFree; // high-water-mark
+	uint32_t stackUsed; // maximum of this boot
+	uint32_t stackUsedSaved; // maximum of all boots (NVS)
+	uint32_t runTime; // run-time counter of the last sample
+	uint32_t cpuShare; // 0.01 %, averaged
+	uint32_t cpuShareMax; // of a single sample
+} taskMonitorTask_t;
+
+// Only written by the loop-task; /debug/tasks reads without locking (a torn value is fine for diagnostics)
+static taskMonitorTask_t TaskMonitor_Tasks[taskMonitorTasks];
+static uint8_t TaskMonitor_TaskCount = 0u;
+static TaskStatus_t TaskMonitor_Status[taskMonitorTasks + 8u]; // uxTaskGetSystemState() fails if too small
+static uint16_t TaskMonitor_Busy[portNUM_PROCESSORS][taskMonitorSamples]; // 0.1 %
+static uint32_t TaskMonitor_SampleCount = 0u;
+static uint32_t TaskMonitor_SwitchesPerSecond[portNUM_PROCESSORS];
+static uint32_t TaskMonitor_LastSwitches[portNUM_PROCESSORS];
+static uint64_t TaskMonitor_LastSampleUs = 0u;
+static uint32_t TaskMonitor_LastSampleTimestamp = 0u;
+static uint32_t TaskMonitor_LastSaveTimestamp = 0u;
+static bool TaskMonitor_Reported = false;
+static Preferences TaskMonitor_Prefs;
+
+// Written by the tick-hooks
+static DRAM_ATTR TaskHandle_t TaskMonitor_LastTask[portNUM_PROCESSORS];
+static DRAM_ATTR volatile uint32_t TaskMonitor_Switches[portNUM_PROCESSORS];
+
+// Called by the tick-interrupt (1 kHz) of each core: counts the changes of the running task. Switches back and forth
+// between two ticks aren't seen, so it's a lower bound of the context-switches.
+static IRAM_ATTR void TaskMonitor_TickHook(void) {
+	const BaseType_t core = xPortGetCoreID();
+	const TaskHandle_t task = xTaskGetCurrentTaskHandle();
+	if (task != TaskMonitor_LastTask[core]) {
+		TaskMonitor_LastTask[core] = task;
+		TaskMonitor_Switches[core] = TaskMonitor_Switches[core] + 1u;
+	}
+}
+
+void TaskMonitor_Init(void) {
+	TaskMonitor_Prefs.begin(taskMonitorNamespace);
+	for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+		esp_register_freertos_tick_hook_for_cpu(TaskMonitor_TickHook, core);
+	}
+}
+
+// Entry of a task by name, so a task that is created again (like fileStorageTask) continues its statistics
+static taskMonitorTask_t *TaskMonitor_GetTask(const char *name) {
+	for (uint8_t i = 0; i < TaskMonitor_TaskCount; i++) {
+		if (!strncmp(TaskMonitor_Tasks[i].name, name, configMAX_TASK_NAME_LEN)) {
+			return &TaskMonitor_Tasks[i];
+		}
+	}
+	if (TaskMonitor_TaskCount >= taskMonitorTasks) {
+		return nullptr;
+	}
+	taskMonitorTask_t *task = &TaskMonitor_Tasks[TaskMonitor_TaskCount++];
+	strlcpy(task->name, name, sizeof(task->name));
+	task->stackUsedSaved = TaskMonitor_Prefs.isKey(task->name) ? TaskMonitor_Prefs.getUInt(task->name) : 0u;
+	return task;
+}
+
+// Stack-size the task was created with (FreeRTOS only keeps both ends of the stack)
+static uint32_t TaskMonitor_GetStackSize(const TaskStatus_t &status) {
+	TaskSnapshot_t snapshot;
+	if (vTaskGetSnapshot(status.xHandle, &snapshot) != pdTRUE || !snapshot.pxEndOfStack || !status.pxStackBase) {
+		return 0u;
+	}
+	// the end is aligned down to 16 bytes
+	const uint32_t size = reinterpret_cast<const uint8_t *>(snapshot.pxEndOfStack) - reinterpret_cast<const uint8_t *>(status.pxStackBase) + 1u;
+	return (size + 15u) & ~15u;
+}
+
+static uint32_t TaskMonitor_Recommend(const taskMonitorTask_t &task) {
+	const uint32_t used = std::max(task.stackUsed, task.stackUsedSaved);
+	const uint32_t size = used + std::max(taskMonitorMinMargin, used / taskMonitorMarginDivisor);
+	return (size + taskMonitorStackGranularity - 1u) / taskMonitorStackGranularity * taskMonitorStackGranularity;
+}
+
+static uint32_t TaskMonitor_Reclaimable(const taskMonitorTask_t &task) {
+	const uint32_t recommended = TaskMonitor_Recommend(task);
+	return (task.stackSize > recommended) ? task.stackSize - recommended : 0u;
+}
+
+static void TaskMonitor_Sample(void) {
+	const UBaseType_t count = uxTaskGetSystemState(TaskMonitor_Status, sizeof(TaskMonitor_Status) / sizeof(TaskMonitor_Status[0]), nullptr);
+	const uint64_t nowUs = esp_timer_get_time();
+	const uint32_t elapsedUs = nowUs - TaskMonitor_LastSampleUs;
+	const bool firstSample = !TaskMonitor_LastSampleUs;
+	TaskMonitor_LastSampleUs = nowUs;
+
+	for (uint8_t i = 0; i < TaskMonitor_TaskCount; i++) {
+		TaskMonitor_Tasks[i].alive = false;
+	}
+	for (UBaseType_t i = 0; i < count; i++) {
+		const TaskStatus_t &status = TaskMonitor_Status[i];
+		taskMonitorTask_t *task = TaskMonitor_GetTask(status.pcTaskName);
+		if (!task) {
+			continue;
+		}
+		const bool sameInstance = (task->handle == status.xHandle);
+		if (!sameInstance) {
+			task->handle = status.xHandle;
+			task->stackSize = TaskMonitor_GetStackSize(status);
+		}
+		task->alive = true;
+		task->core = status.xCoreID;
+		task->priority = status.uxCurrentPriority;
+		task->stackFree = status.usStackHighWaterMark;
+		if (task->stackSize > task->stackFree) {
+			task->stackUsed = std::max(task->stackUsed, task->stackSize - task->stackFree);
+		}
+		if (task->stackFree < taskMonitorLowStack && !task->lowStackLogged) {
+			task->lowStackLogged = true;
+			Log_Printf(LOGLEVEL_NOTICE, "TaskMonitor: stack of %s is almost full (%" PRIu32 " of %" PRIu32 " bytes free)", task->name, task->stackFree, task->stackSize);
+		}
+
+		// CPU-share since the last sample (relative to one core)
+		if (sameInstance && elapsedUs) {
+			const uint32_t runTime = status.ulRunTimeCounter - task->runTime;
+			const uint32_t share = std::min<uint64_t>(10000u, static_cast<uint64_t>(runTime) * 10000u / elapsedUs);
+			task->cpuShare = task->cpuShare + (static_cast<int32_t>(share) - static_cast<int32_t>(task->cpuShare)) / taskMonitorCpuAverage;
+			task->cpuShareMax = std::max(task->cpuShareMax, share);
+			for (uint8_t core = 0; core < portNUM_PROCESSORS && !firstSample; core++) {
+				if (status.xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+					TaskMonitor_Busy[core][TaskMonitor_SampleCount % taskMonitorSamples] = 1000u - share / 10u;
+				}
+			}
+		}
+		task->runTime = status.ulRunTimeCounter;
+	}
+	if (firstSample || !elapsedUs) {
+		return;
+	}
+	for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+		const uint32_t switches = TaskMonitor_Switches[core];
+		TaskMonitor_SwitchesPerSecond[core] = static_cast<uint64_t>(switches - TaskMonitor_LastSwitches[core]) * 1000000u / elapsedUs;
+		TaskMonitor_LastSwitches[core] = switches;
+	}
+	TaskMonitor_SampleCount++;
+}
+
+// Logs the recommended stack-sizes (details only with loglevel debug)
+static void TaskMonitor_Report(void) {
+	uint32_t reclaimable = 0u;
+	for (uint8_t i = 0; i < TaskMonitor_TaskCount; i++) {
+		const taskMonitorTask_t &task = TaskMonitor_Tasks[i];
+		if (!task.stackSize) {
+			continue;
+		}
+		reclaimable += TaskMonitor_Reclaimable(task);
+		Log_Printf(LOGLEVEL_DEBUG, "TaskMonitor: %s: stack %" PRIu32 " bytes, used at most %" PRIu32 ", recommended %" PRIu32, task.name, task.stackSize, std::max(task.stackUsed, task.stackUsedSaved), TaskMonitor_Recommend(task));
+	}
+	Log_Printf(LOGLEVEL_INFO, "TaskMonitor: %" PRIu32 " bytes of stack could be reclaimed (details in /debug/tasks)", reclaimable);
+}
+
+// Samples the tasks once a second (called by System_Cyclic())
+void TaskMonitor_Cyclic(void) {
+	const uint32_t now = millis();
+	if (now - TaskMonitor_LastSampleTimestamp < taskMonitorSampleIntervalMs) {
+		return;
+	}
+	TaskMonitor_LastSampleTimestamp = now;
+	TaskMonitor_Sample();
+
+	if (now - TaskMonitor_LastSaveTimestamp >= taskMonitorSaveIntervalMs) {
+		TaskMonitor_LastSaveTimestamp = now;
+		TaskMonitor_Save();
+	}
+	if (!TaskMonitor_Reported && now >= taskMonitorReportMs) {
+		TaskMonitor_Reported = true;
+		TaskMonitor_Report();
+	}
+}
+
+// Keeps the stack-usage of the tasks that used more than in all boots before
+void TaskMonitor_Save(void) {
+	for (uint8_t i = 0; i < TaskMonitor_TaskCount; i++) {
+		taskMonitorTask_t &task = TaskMonitor_Tasks[i];
+		if (task.stackUsed > task.stackUsedSaved) {
+			TaskMonitor_Prefs.putUInt(task.name, task.stackUsed);
+			task.stackUsedSaved = task.stackUsed;
+		}
+	}
+}
+
+// Average busy-time of a core over the last samples (%)
+static float TaskMonitor_GetBusy(const uint8_t core, const uint32_t samples) {
+	const uint32_t count = std::min({samples, TaskMonitor_SampleCount, static_cast<uint32_t>(taskMonitorSamples)});
+	uint32_t sum = 0u;
+	for (uint32_t i = TaskMonitor_SampleCount - count; i < TaskMonitor_SampleCount; i++) {
+		sum += TaskMonitor_Busy[core][i % taskMonitorSamples];
+	}
+	return count ? sum / (10.0f * count) : 0.0f;
+}
+
+void TaskMonitor_ToJSON(JsonObject obj) {
+	JsonArray coresArr = obj["cores"].to<JsonArray>();
+	for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+		JsonObject coreObj = coresArr.add<JsonObject>();
+		coreObj["busy1s"] = TaskMonitor_GetBusy(core, 1u);
+		coreObj["busy10s"] = TaskMonitor_GetBusy(core, 10u);
+		coreObj["busy60s"] = TaskMonitor_GetBusy(core, 60u);
+		coreObj["switchesPerSecond"] = TaskMonitor_SwitchesPerSecond[core];
+	}
+
+	// stack in bytes; stackUsedAllBoots is kept in NVS, recommendedStack is based on it
+	uint32_t reclaimable = 0u;
+	JsonArray tasksArr = obj["tasks"].to<JsonArray>();
+	for (uint8_t i = 0; i < TaskMonitor_TaskCount; i++) {
+		const taskMonitorTask_t &task = TaskMonitor_Tasks[i];
+		JsonObject taskObj = tasksArr.add<JsonObject>();
+		taskObj["name"] = task.name;
+		taskObj["alive"] = task.alive;
+		taskObj["core"] = (task.core == tskNO_AFFINITY) ? -1 : task.core;
+		taskObj["priority"] = task.priority;
+		taskObj["cpuPercent"] = task.cpuShare / 100.0f;
+		taskObj["cpuMaxPercent"] = task.cpuShareMax / 100.0f;
+		taskObj["stackFree"] = task.stackFree;
+		taskObj["stackUsed"] = task.stackUsed;
+		taskObj["stackUsedAllBoots"] = std::max(task.stackUsed, task.stackUsedSaved);
+		if (task.stackSize) {
+			taskObj["stackSize"] = task.stackSize;
+			taskObj["recommendedStack"] = TaskMonitor_Recommend(task);
+			reclaimable += TaskMonitor_Reclaimable(task);
+		}
+	}
+	obj["reclaimableStack"] = reclaimable;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ArduinoJson.h"
+
+// Budget of the FreeRTOS-tasks: stack-usage per task (the maximum of all boots is kept in NVS) with a recommended
+// stack-size, CPU-share per task and busy-time per core over 1 s, 10 s and 60 s, and the rate of task-switches per
+// core. Results in /debug/tasks; the stack that could be reclaimed is logged 10 minutes after boot.
+// Compiled out completely unless TASK_MONITOR_ENABLE is set.
+
+#ifdef TASK_MONITOR_ENABLE
+void TaskMonitor_Init(void);
+void TaskMonitor_Cyclic(void);
+void TaskMonitor_Save(void);
+void TaskMonitor_ToJSON(JsonObject obj);
+#endif
@@ -0,0 +1,42 @@
+#include <Arduino.h>
+
+#include "TrackFade.h"
+
+#include <algorithm>
+
+// Length of a fade in frames; longer fades than trackFadeMaxMs would start before the next track is known
+uint32_t TrackFade_GetFrames(const uint32_t fadeMs, const uint32_t sampleRate) {
+	return static_cast<uint64_t>(std::min(fadeMs, trackFadeMaxMs)) * sampleRate / 1000u;
+}
+
+// Gain at the end of the buffer that ends with frame framesOut of the track. Fades out over the last fadeFrames of
+// the track (trackFrames, 0: unknown) and in over its first fadeFrames.
+int32_t TrackFade_GetGain(const uint32_t framesOut, const uint32_t trackFrames, const uint32_t fadeFrames, const bool fadeOut, const bool fadeIn) {
+	int32_t gain = trackFadeUnityQ15;
+	if (!fadeFrames) {
+		return gain;
+	}
+	if (fadeOut && trackFrames) {
+		const uint32_t remaining = (trackFrames > framesOut) ? trackFrames - framesOut : 0;
+		if (remaining < fadeFrames) {
+			gain = static_cast<uint64_t>(remaining) * trackFadeUnityQ15 / fadeFrames;
+		}
+	}
+	if (fadeIn && framesOut < fadeFrames) {
+		gain = std::min<int32_t>(gain, static_cast<uint64_t>(framesOut) * trackFadeUnityQ15 / fadeFrames);
+	}
+	return gain;
+}
+
+// Ramps the gain linearly over the buffer (Q30 interpolation), so there are no steps between buffers.
+// Interleaved stereo, 32 bit.
+void TrackFade_Apply(int32_t *buff, const int16_t frames, const int32_t fromQ15, const int32_t toQ15) {
+	const int64_t stepQ30 = (static_cast<int64_t>(toQ15) - fromQ15) * trackFadeUnityQ15 / std::max<int16_t>(frames, 1);
+	int64_t gainQ30 = static_cast<int64_t>(fromQ15) * trackFadeUnityQ15;
+	for (int16_t i = 0; i < frames; i++) {
+		gainQ30 += stepQ30;
+		for (uint8_t ch = 0; ch < 2; ch++) {
+			buff[i * 2 + ch] = static_cast<int32_t>((static_cast<int64_t>(buff[i * 2 + ch]) * gainQ30) >> 30);
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// Gain of the crossfade-transition (Q15): the end of a track is faded out and the next one in. The lib has only one
+// decoder, so the two fades follow each other instead of overlapping.
+
+constexpr int32_t trackFadeUnityQ15 = 32768;
+constexpr uint32_t trackFadeMaxMs = 5000u; // fade-out only starts once the next track is prepared
+
+uint32_t TrackFade_GetFrames(const uint32_t fadeMs, const uint32_t sampleRate);
+int32_t TrackFade_GetGain(const uint32_t framesOut, const uint32_t trackFrames, const uint32_t fadeFrames, const bool fadeOut, const bool fadeIn);
+void TrackFade_Apply(int32_t *buff, const int16_t frames, const int32_t fromQ15, const int32_t toQ15);
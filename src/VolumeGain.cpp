@@ -0,0 +1,73 @@
+#include <Arduino.h>
+
+#include "VolumeGain.h"
+
+#include "VolumeCurveLut.h"
+
+#include <algorithm>
+
+// Evaluates the volume-LUT (dB) at position t (0..1); only used to build the gain-table
+float VolumeGain_CurveDb(uint8_t curveType, const float t) {
+	// 1. Safety Checks
+	if (curveType >= VOL_LUT_CURVES) {
+		curveType = VOL_CURVE_PERCEPTUAL;
+	}
+	if (t <= 0.0f) {
+		return pgm_read_float(&(VOLUME_TABLE[curveType][0]));
+	}
+
+	// 2. Calculate indices
+	const float index_f = t * (VOL_LUT_STEPS - 1);
+	const int index = (int) index_f;
+
+	// Safety clamp for the edge case where index_f is exactly 63.0
+	if (index >= VOL_LUT_STEPS - 1) {
+		return pgm_read_float(&(VOLUME_TABLE[curveType][VOL_LUT_STEPS - 1]));
+	}
+
+	const float fraction = index_f - (float) index;
+
+	// 3. Interpolate
+	const float val1 = pgm_read_float(&(VOLUME_TABLE[curveType][index]));
+	const float val2 = pgm_read_float(&(VOLUME_TABLE[curveType][index + 1]));
+
+	return val1 + (val2 - val1) * fraction;
+}
+
+// Fills table[0..steps] for the volume-curve. Steps above maxStep get the gain of maxStep, so the limit of
+// speaker/headphone holds even if a volume-step beyond it reaches the audio-lib. offsetDb (ReplayGain) is added,
+// but the level isn't raised above maxDb (headroom of the track's peak, 0 if it's unknown).
+void VolumeGain_BuildTable(volumeGain_t *table, const uint8_t steps, const uint8_t curveType, const uint8_t maxStep, const float offsetDb, const float maxDb) {
+	for (uint8_t step = 0; step <= steps; step++) {
+		const uint8_t limitedStep = std::min(step, maxStep);
+		const float db = std::min(std::max(0.0f, maxDb), VolumeGain_CurveDb(curveType, (float) limitedStep / steps) + offsetDb);
+		table[step].db = std::min(0.0f, db);
+		table[step].gainQ15 = lroundf(powf(10.0f, db / 20.0f) * volumeGainUnityQ15);
+	}
+}
+
+// dB at position t (0..1) of the table: positions in between two steps (e.g. while ramping) are interpolated
+float VolumeGain_Interpolate(const volumeGain_t *table, const uint8_t steps, const float t) {
+	if (t <= 0.0f) {
+		return table[0].db;
+	}
+	const float index_f = t * steps;
+	const uint8_t index = (uint8_t) index_f;
+	if (index >= steps) {
+		return table[steps].db;
+	}
+	const float fraction = index_f - (float) index;
+	return table[index].db + (table[index + 1].db - table[index].db) * fraction;
+}
+
+// Applies the part of the gain above 0 dB the audio-lib can't (interleaved stereo, 32 bit). The peak-limit should
+// prevent clipping, samples are saturated anyway.
+void VolumeGain_ApplyBoost(int32_t *buff, const int16_t frames, const uint32_t gainQ15) {
+	if (gainQ15 <= volumeGainUnityQ15) {
+		return;
+	}
+	for (int16_t i = 0; i < 2 * frames; i++) {
+		const int64_t y = (static_cast<int64_t>(buff[i]) * gainQ15) >> 15;
+		buff[i] = static_cast<int32_t>(std::clamp<int64_t>(y, INT32_MIN, INT32_MAX));
+	}
+}
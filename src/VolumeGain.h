@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+constexpr uint32_t volumeGainUnityQ15 = 32768u;
+
+// Gain per volume-step, precomputed from the volume-curve (VolumeCurveLut.h), so the audio-path only needs a lookup.
+// A positive ReplayGain can raise the level above full scale: the audio-lib only attenuates (db), the part above
+// 0 dB is applied afterwards by VolumeGain_ApplyBoost().
+typedef struct {
+	float db; // attenuation as expected by the volume-curve callback of the audio-lib
+	uint32_t gainQ15; // whole linear gain (32768 = 0 dB), above unity with a positive ReplayGain
+} volumeGain_t;
+
+float VolumeGain_CurveDb(uint8_t curveType, const float t);
+void VolumeGain_BuildTable(volumeGain_t *table, const uint8_t steps, const uint8_t curveType, const uint8_t maxStep, const float offsetDb, const float maxDb);
+float VolumeGain_Interpolate(const volumeGain_t *table, const uint8_t steps, const float t);
+void VolumeGain_ApplyBoost(int32_t *buff, const int16_t frames, const uint32_t gainQ15);
@@ -9,21 +9,30 @@
 #include "Battery.h"
 #include "Bluetooth.h"
 #include "Button.h"
-#include "Cmd.h"
+#include "CommandBus.h"
 #include "Common.h"
 #include "ESPAsyncWebServer.h"
 #include "EnumUtils.h"
+#include "Equalizer.h"
 #include "Ftp.h"
 #include "HTMLbinary.h"
 #include "HallEffectSensor.h"
+#include "HeapProfiler.h"
 #include "Led.h"
 #include "Log.h"
+#include "LogSd.h"
+#include "LoopProfiler.h"
 #include "MemX.h"
+#include "Metrics.h"
 #include "Mqtt.h"
 #include "Rfid.h"
 #include "RotaryEncoder.h"
+#include "Scheduler.h"
 #include "SdCard.h"
+#include "SettingsRegistry.h"
 #include "System.h"
+#include "TapTrace.h"
+#include "TaskMonitor.h"
 #include "Wlan.h"
 #include "freertos/ringbuf.h"
 #include "gitrevision.h"
@@ -33,16 +42,12 @@
 
 #include <Update.h>
 #include <WiFi.h>
+#include <algorithm>
 #include <atomic>
 #include <esp_task_wdt.h>
+#include <memory>
 #include <nvs.h>
 
-// An override written before this feature existed does not define it (settings-override.h replaces
-// settings.h wholesale), so fall back rather than break those builds.
-#ifndef JUMP_OFFSET_ROTARY
-	#define JUMP_OFFSET_ROTARY 10
-#endif
-
 typedef struct {
 	char nvsKey[cardIdStringSize];
 	char nvsEntry[512];
@@ -70,7 +75,40 @@ static SemaphoreHandle_t explorerFileUploadFinished;
 static TaskHandle_t fileStorageTaskHandle;
 static std::atomic<bool> uploadAborted = false;
 
-void Web_DumpSdToNvs(const char *_filename);
+// State of the last/running NVS-import (backup-restore); reported via websocket and as response of /upload
+typedef struct {
+	uint16_t added; // entries not yet present in NVS
+	uint16_t changed; // entries present in NVS but with a different assignment
+	uint16_t removed; // delete-records (change-log) of entries present in NVS
+	uint16_t unchanged;
+	uint16_t invalid; // lines that aren't a valid assignment
+	uint16_t processed; // entries written so far
+	bool dryRun;
+	bool running;
+	bool failed;
+} nvsImport_t;
+static nvsImport_t Web_NvsImport;
+
+// Websocket-clients following the log (live-tail): new lines are pushed in batches from Web_Cyclic()
+static constexpr uint8_t logSubscribersMax = 4;
+static constexpr uint32_t logPushIntervalMs = 200u;
+static constexpr size_t logPushBatchSize = 2048u; // characters per message; the rest follows with the next one
+typedef struct {
+	uint32_t client; // 0: unused
+	logCursor_t cursor;
+} logSubscriber_t;
+static logSubscriber_t Web_LogSubscribers[logSubscribersMax];
+static portMUX_TYPE Web_LogSubscribersMux = portMUX_INITIALIZER_UNLOCKED;
+static char *Web_LogBatch = nullptr; // allocated with the first push
+static uint32_t Web_LogLastPushTimestamp = 0u;
+
+// for /metrics
+static std::atomic<uint32_t> Web_WsSentBytes {0u};
+static std::atomic<uint32_t> Web_WsReceivedBytes {0u};
+static uint64_t Web_UploadBytes = 0u; // only written by the file-storage task
+static uint32_t Web_UploadMs = 0u;
+
+bool Web_DumpSdToNvs(const char *_filename, const bool _dryRun);
 static void handleUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
 // Raw (non-multipart) request body: one PUT/POST per file, the target path
 // (folder + filename) travels in the "path" query param since a raw body
@@ -108,6 +146,13 @@ static void handlePostSettings(AsyncWebServerRequest *request, JsonVariant &json
 static void handleGetOperationMode(AsyncWebServerRequest *request);
 static void handlePostOperationMode(AsyncWebServerRequest *request, JsonVariant &json);
 static void handleDebugRequest(AsyncWebServerRequest *request);
+static void handleDebugTracesRequest(AsyncWebServerRequest *request);
+#ifdef HEAP_PROFILER_ENABLE
+static void handleDebugHeapRequest(AsyncWebServerRequest *request);
+#endif
+#ifdef TASK_MONITOR_ENABLE
+static void handleDebugTasksRequest(AsyncWebServerRequest *request);
+#endif
 
 static void onWebsocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 static void settingsToJSON(JsonObject obj, const String section);
@@ -159,6 +204,7 @@ static bool allocateDoubleBuffer() {
 		return (ptr != nullptr);
 	};
 
+	HEAP_PROFILER_SCOPE("upload");
 	chunk_size = start_chunk_size;
 	size_t retries = retry_count;
 	while (retries) {
@@ -320,6 +366,119 @@ bool Web_DumpNvsToSd(const char *_namespace, const char *_destFile) {
 	return success;
 }
 
+// Incremental RFID-backup: web-handlers only queue the tag-id of a changed assignment (no SD-access).
+// Web_Cyclic() appends those entries to a change-log next to the backup-file and rewrites the full
+// snapshot (Web_DumpNvsToSd()) only after no change happened for rfidBackupCompactionDelay while
+// nothing's being played - or at shutdown. Lines in the change-log use the same format as the
+// snapshot, deleted tags are logged with the delete-record rfidBackupDeleted as assignment. The
+// export of backupFile is the snapshot followed by the change-log, and the importer replays it in
+// order (the last line of a tag wins, a delete-record erases the tag).
+// A download of the export reads both files under Web_RfidBackupMutex, chunk by chunk. Compaction is
+// deferred while a download is running; if it has to run anyway (shutdown, NVS-erase), the download
+// is aborted instead of sending a mix of the old and the new snapshot.
+static constexpr const char rfidBackupChangeLog[] = "/backup.log";
+static constexpr const char rfidBackupDeleted[] = "-";
+static constexpr uint32_t rfidBackupCompactionDelay = 30000; // ms without changes before the snapshot is rewritten
+static constexpr uint32_t rfidBackupRetryDelay = 60000; // ms before a failed compaction is retried
+static constexpr uint32_t rfidBackupDownloadLease = 5000; // ms after the last chunk of a download before compaction may run
+static QueueHandle_t Web_RfidBackupQueue = NULL;
+static SemaphoreHandle_t Web_RfidBackupMutex = NULL;
+static std::atomic<bool> Web_RfidBackupSnapshotOutdated = false; // full rewrite required (change-log or queue overflowed, import, ...)
+static std::atomic<bool> Web_RfidBackupChangeLogPending = false; // change-log contains entries that aren't part of the snapshot yet
+static uint32_t Web_RfidBackupLastChangeTimestamp = 0;
+static uint32_t Web_RfidBackupFailedTimestamp = 0; // millis() of the last failed compaction (0: none)
+static std::atomic<uint32_t> Web_RfidBackupDownloadTimestamp = 0; // millis() of the last chunk sent of the export (0: none)
+static std::atomic<uint32_t> Web_RfidBackupGeneration = 0; // incremented by every compaction, invalidates running downloads
+
+static void Web_RfidBackupInit(void) {
+	if (Web_RfidBackupQueue != NULL) {
+		return;
+	}
+	Web_RfidBackupQueue = xQueueCreate(16, cardIdStringSize);
+	Web_RfidBackupMutex = xSemaphoreCreateMutex();
+	if (Web_RfidBackupQueue == NULL || Web_RfidBackupMutex == NULL) {
+		Log_Printf(LOGLEVEL_ERROR, unableToCreateQueue, "RfidBackup");
+	}
+	// a change-log left over from the last run (e.g. power-loss) isn't part of the snapshot yet
+	Web_RfidBackupChangeLogPending = gFSystem.exists(rfidBackupChangeLog);
+}
+
+// Remembers a changed (or deleted) RFID-assignment for the backup. Never touches the SD-card.
+static void Web_RfidBackupNoteChange(const char *_rfidTagId) {
+	char tagId[cardIdStringSize] = {0};
+	strncpy(tagId, _rfidTagId, cardIdStringSize - 1);
+	if (Web_RfidBackupQueue == NULL || xQueueSend(Web_RfidBackupQueue, tagId, 0) != pdPASS) {
+		Web_RfidBackupSnapshotOutdated = true;
+	}
+	Web_RfidBackupLastChangeTimestamp = millis();
+}
+
+static bool Web_RfidBackupDownloadActive(void) {
+	const uint32_t lastChunk = Web_RfidBackupDownloadTimestamp;
+	return lastChunk && (millis() - lastChunk < rfidBackupDownloadLease);
+}
+
+// Rewrites the full snapshot from NVS and discards the change-log. Unless forced, it waits for a running
+// download of the export.
+static bool Web_RfidBackupCompact(bool _force) {
+	if (Web_RfidBackupMutex == NULL || xSemaphoreTake(Web_RfidBackupMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+		return false;
+	}
+	if (!_force && Web_RfidBackupDownloadActive()) {
+		xSemaphoreGive(Web_RfidBackupMutex);
+		return false;
+	}
+	Web_RfidBackupGeneration++; // aborts a running download
+	Web_RfidBackupSnapshotOutdated = false; // set before dumping: changes made meanwhile trigger another round
+	const bool success = Web_DumpNvsToSd("rfidTags", backupFile);
+	if (success) {
+		gFSystem.remove(rfidBackupChangeLog);
+		Web_RfidBackupChangeLogPending = false;
+		Web_RfidBackupFailedTimestamp = 0;
+		Log_Printf(LOGLEVEL_DEBUG, "RFID-backup: snapshot %s rewritten", backupFile);
+	} else {
+		Web_RfidBackupSnapshotOutdated = true;
+		Web_RfidBackupFailedTimestamp = millis() | 1u; // don't retry in every cycle (e.g. SD-card full)
+		Log_Printf(LOGLEVEL_ERROR, "RFID-backup: unable to rewrite snapshot %s", backupFile);
+	}
+	xSemaphoreGive(Web_RfidBackupMutex);
+	return success;
+}
+
+// Appends queued changes to the change-log and compacts once everything went quiet
+static void Web_RfidBackupCyclic(bool _forceCompaction) {
+	char tagId[cardIdStringSize];
+
+	if (Web_RfidBackupQueue == NULL) {
+		return;
+	}
+	if (uxQueueMessagesWaiting(Web_RfidBackupQueue) > 0 && xSemaphoreTake(Web_RfidBackupMutex, 0) == pdTRUE) {
+		File file = gFSystem.open(rfidBackupChangeLog, FILE_APPEND);
+		while (xQueueReceive(Web_RfidBackupQueue, tagId, 0) == pdPASS) {
+			if (!file) {
+				Web_RfidBackupSnapshotOutdated = true;
+				continue;
+			}
+			const String entry = gPrefsRfid.isKey(tagId) ? gPrefsRfid.getString(tagId) : String(rfidBackupDeleted);
+			file.printf("%s%s%s%s\n", stringOuterDelimiter, tagId, stringOuterDelimiter, entry.c_str());
+			Web_RfidBackupChangeLogPending = true;
+		}
+		if (file) {
+			file.close();
+		}
+		xSemaphoreGive(Web_RfidBackupMutex);
+	}
+
+	if (!Web_RfidBackupChangeLogPending && !Web_RfidBackupSnapshotOutdated) {
+		return;
+	}
+	const bool idle = (gPlayProperties.playMode == NO_PLAYLIST || gPlayProperties.pausePlay) && (millis() - Web_RfidBackupLastChangeTimestamp >= rfidBackupCompactionDelay);
+	const bool retryDue = !Web_RfidBackupFailedTimestamp || (millis() - Web_RfidBackupFailedTimestamp >= rfidBackupRetryDelay);
+	if (_forceCompaction || (idle && retryDue)) {
+		Web_RfidBackupCompact(_forceCompaction);
+	}
+}
+
 // First request will return 0 results unless you start scan from somewhere else (loop/setup)
 // Do not request more often than 3-5 seconds
 static void handleWiFiScanRequest(AsyncWebServerRequest *request) {
@@ -366,10 +525,94 @@ static void handleWiFiScanRequest(AsyncWebServerRequest *request) {
 	json = String();
 }
 
+// Starts/stops the live-tail for a websocket-client ({"log":{"subscribe":true,"since":n}}, called by the async_tcp-task)
+static WebsocketCodeType Web_LogSubscribe(const uint32_t client, const bool subscribe, const uint32_t since) {
+	int8_t slot = -1;
+	portENTER_CRITICAL(&Web_LogSubscribersMux);
+	for (uint8_t i = 0; i < logSubscribersMax; i++) {
+		if (Web_LogSubscribers[i].client == client) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 && !Web_LogSubscribers[i].client) {
+			slot = i;
+		}
+	}
+	if (slot >= 0) {
+		if (subscribe) {
+			Web_LogSubscribers[slot] = {client, {since, 0u, 0u}};
+		} else if (Web_LogSubscribers[slot].client == client) {
+			Web_LogSubscribers[slot].client = 0u;
+		}
+	}
+	portEXIT_CRITICAL(&Web_LogSubscribersMux);
+	return (slot >= 0 || !subscribe) ? WebsocketCodeType::Silent : WebsocketCodeType::Error;
+}
+
+// Sends the new lines to the subscribers. A client only gets the next batch once the previous one has left its
+// queue, so a slow client gets bigger batches instead of a growing queue (lines are only lost if it falls behind
+// by more than the whole history).
+static void Web_LogPush(void) {
+	const uint32_t end = Log_GetSequence();
+	for (uint8_t i = 0; i < logSubscribersMax; i++) {
+		portENTER_CRITICAL(&Web_LogSubscribersMux);
+		logSubscriber_t subscriber = Web_LogSubscribers[i];
+		portEXIT_CRITICAL(&Web_LogSubscribersMux);
+		if (!subscriber.client || (subscriber.cursor.seq >= end && !subscriber.cursor.lost)) {
+			continue;
+		}
+		AsyncWebSocketClient *client = ws.client(subscriber.client);
+		if (!client || client->status() != WS_CONNECTED) {
+			Web_LogSubscribe(subscriber.client, false, 0u);
+			continue;
+		}
+		if (client->queueLen()) {
+			continue; // backpressure
+		}
+		if (!Web_LogBatch) {
+			Web_LogBatch = static_cast<char *>(x_malloc(logPushBatchSize + 1u));
+			if (!Web_LogBatch) {
+				Log_Println(unableToAllocateMem, LOGLEVEL_ERROR);
+				return;
+			}
+		}
+		const size_t length = Log_ReadHistory(subscriber.cursor, end, Web_LogBatch, logPushBatchSize);
+		Web_LogBatch[length] = '\0';
+
+		SpiRamAllocator allocator;
+		JsonDocument doc(&allocator);
+		JsonObject logObj = doc["log"].to<JsonObject>();
+		logObj["next"] = subscriber.cursor.seq; // first line that wasn't sent completely
+		logObj["lost"] = subscriber.cursor.lost;
+		logObj["lines"] = static_cast<const char *>(Web_LogBatch);
+		const size_t len = measureJson(doc);
+		AsyncWebSocketMessageBuffer *jsonBuffer = ws.makeBuffer(len);
+		if (!jsonBuffer) {
+			Log_Println(unableToAllocateMem, LOGLEVEL_ERROR);
+			return;
+		}
+		serializeJson(doc, jsonBuffer->get(), len);
+		ws.text(subscriber.client, jsonBuffer);
+		Web_WsSentBytes += len;
+
+		subscriber.cursor.lost = 0u;
+		portENTER_CRITICAL(&Web_LogSubscribersMux);
+		if (Web_LogSubscribers[i].client == subscriber.client) {
+			Web_LogSubscribers[i].cursor = subscriber.cursor;
+		}
+		portEXIT_CRITICAL(&Web_LogSubscribersMux);
+	}
+}
+
 unsigned long lastCleanupClientsTimestamp;
 
 void Web_Cyclic(void) {
 	webserverStart();
+	Web_RfidBackupCyclic(false);
+	if ((millis() - Web_LogLastPushTimestamp) >= logPushIntervalMs) {
+		Web_LogLastPushTimestamp = millis();
+		Web_LogPush();
+	}
 	if ((millis() - lastCleanupClientsTimestamp) > 1000u) {
 		// cleanup closed/deserted websocket clients once per second
 		lastCleanupClientsTimestamp = millis();
@@ -379,6 +622,7 @@ void Web_Cyclic(void) {
 
 void Web_Exit(void) {
 	esp_task_wdt_reset();
+	Web_RfidBackupCyclic(true); // make sure the backup-snapshot contains all changes
 	if (webserverStarted) {
 		// Gracefully abort active file storage task if running
 		if (fileStorageTaskHandle != NULL) {
@@ -395,6 +639,20 @@ void Web_Exit(void) {
 		webserverStarted = false;
 	}
 }
+static void Web_RegisterMetrics(void) {
+	Metrics_Register("websocket_clients", MetricType::Gauge, "Connected websocket-clients", [](metricsWriter_t &out) {
+		Metrics_Sample(out, ws.count());
+	});
+	Metrics_Register("websocket_sent_bytes_total", MetricType::Counter, "Bytes sent to websocket-clients", &Web_WsSentBytes);
+	Metrics_Register("websocket_received_bytes_total", MetricType::Counter, "Bytes received from websocket-clients", &Web_WsReceivedBytes);
+	Metrics_Register("upload_bytes_total", MetricType::Counter, "Bytes of completed file-uploads", [](metricsWriter_t &out) {
+		Metrics_Sample(out, static_cast<double>(Web_UploadBytes));
+	});
+	Metrics_Register("upload_seconds_total", MetricType::Counter, "Duration of completed file-uploads", [](metricsWriter_t &out) {
+		Metrics_Sample(out, Web_UploadMs / 1000.0);
+	});
+}
+
 // handle not found
 void notFound(AsyncWebServerRequest *request) {
 	Log_Printf(LOGLEVEL_ERROR, "%s not found, redirect to startpage", request->url().c_str());
@@ -406,6 +664,8 @@ void notFound(AsyncWebServerRequest *request) {
 
 void webserverStart(void) {
 	if (!webserverStarted && (Wlan_IsConnected() || (WiFi.getMode() == WIFI_AP))) {
+		Web_RfidBackupInit();
+
 		// attach AsyncWebSocket for Mgmt-Interface
 		ws.onEvent(onWebsocketEvent);
 		wServer.addHandler(&ws);
@@ -469,19 +729,74 @@ void webserverStart(void) {
 
 		WWWData::registerRoutes(serveProgmemFiles);
 
-		// Log
+		// Log (rendered from the binary history; add ?binary for the raw entries, see decode_log.py)
 		wServer.on("/log", HTTP_GET, [](AsyncWebServerRequest *request) {
-			request->send(200, "text/plain; charset=utf-8", Log_GetRingBuffer());
+#ifdef LOG_SD_ENABLE
+			// ?file=n: log-file from SD (0 is the current one), sent chunk by chunk
+			if (request->hasParam("file")) {
+				const String path = LogSd_GetPath(request->getParam("file")->value().toInt());
+				if (!gFSystem.exists(path)) {
+					request->send(404, "text/plain; charset=utf-8", "log-file not found");
+					return;
+				}
+				request->send(gFSystem, path, "text/plain; charset=utf-8");
+				System_UpdateActivityTimer();
+				return;
+			}
+#endif
+			if (request->hasParam("binary")) {
+				AsyncResponseStream *response = request->beginResponseStream("application/octet-stream");
+				Log_DumpHistory(*response);
+				request->send(response);
+				System_UpdateActivityTimer();
+				return;
+			}
+			// ?since=n: only lines from sequence-number n on (X-Log-Next is the one to ask for next time). Lines are
+			// rendered straight into the send-buffer, chunk by chunk.
+			const uint32_t end = Log_GetSequence();
+			const uint32_t start = Log_GetHistoryStart();
+			logCursor_t cursor = {start, 0u, 0u};
+			if (request->hasParam("since")) {
+				const uint32_t since = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+				cursor.seq = std::min(std::max(since, start), end);
+				cursor.lost = (since < start) ? start - since : 0u;
+			}
+			AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain; charset=utf-8", [cursor, end](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+				return Log_ReadHistory(cursor, end, reinterpret_cast<char *>(buffer), maxLen);
+			});
+			response->addHeader("X-Log-Next", String(end));
+			response->addHeader("X-Log-Lost", String(cursor.lost));
+			request->send(response);
 			System_UpdateActivityTimer();
 		});
 
 		// info
 		wServer.on("/info", HTTP_GET, handleGetInfo);
 
-		// NVS-backup-upload
+		// Prometheus-metrics, rendered straight into the send buffer
+		Web_RegisterMetrics();
+		wServer.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+			std::shared_ptr<metricsCursor_t> cursor = std::make_shared<metricsCursor_t>();
+			AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain; version=0.0.4; charset=utf-8", [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+				return Metrics_Read(*cursor, reinterpret_cast<char *>(buffer), maxLen);
+			});
+			request->send(response);
+		});
+
+		// NVS-backup-upload (add ?dryRun to only validate and diff the backup against the current assignments)
 		wServer.on(
 			"/upload", HTTP_POST, [](AsyncWebServerRequest *request) {
-				request->send(200);
+				AsyncJsonResponse *response = new AsyncJsonResponse(false);
+				JsonObject object = response->getRoot();
+				object["added"] = Web_NvsImport.added;
+				object["changed"] = Web_NvsImport.changed;
+				object["removed"] = Web_NvsImport.removed;
+				object["unchanged"] = Web_NvsImport.unchanged;
+				object["invalid"] = Web_NvsImport.invalid;
+				object["dryRun"] = Web_NvsImport.dryRun;
+				response->setCode(Web_NvsImport.failed ? 500 : 200);
+				response->setLength();
+				request->send(response);
 			},
 			handleUpload);
 
@@ -582,14 +897,21 @@ void webserverStart(void) {
 			request->send(response);
 		});
 #endif
-		// debug info
+		// debug info (traces first, "/debug" would match it as well)
+		wServer.on("/debug/traces", HTTP_GET, handleDebugTracesRequest);
+#ifdef HEAP_PROFILER_ENABLE
+		wServer.on("/debug/heap", HTTP_GET, handleDebugHeapRequest);
+#endif
+#ifdef TASK_MONITOR_ENABLE
+		wServer.on("/debug/tasks", HTTP_GET, handleDebugTasksRequest);
+#endif
 		wServer.on("/debug", HTTP_GET, handleDebugRequest);
 
 		// erase all RFID-assignments from NVS
 		wServer.on("/rfidnvserase", HTTP_POST, [](AsyncWebServerRequest *request) {
 			Log_Println(eraseRfidNvs, LOGLEVEL_NOTICE);
-			// make a backup first
-			Web_DumpNvsToSd("rfidTags", backupFile);
+			// make a backup first. This has to be a full snapshot taken right now, as the assignments are gone afterwards.
+			Web_RfidBackupCompact(true);
 			if (gPrefsRfid.clear()) {
 				request->send(200);
 			} else {
@@ -722,6 +1044,7 @@ void webserverStart(void) {
 		DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Accept, Content-Type, Authorization");
 		DefaultHeaders::Instance().addHeader("Access-Control-Allow-Credentials", "true");
 		DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
+		DefaultHeaders::Instance().addHeader("Access-Control-Expose-Headers", "X-Log-Next, X-Log-Lost");
 		wServer.begin();
 		webserverStarted = true;
 		Log_Println(httpReady, LOGLEVEL_NOTICE);
@@ -732,6 +1055,42 @@ void webserverStart(void) {
 
 unsigned long lastPongTimestamp;
 
+static const char *Web_EqualizerProfileName(const EqualizerProfile profile) {
+	return (profile == EqualizerProfile::Headphone) ? "headphone" : "speaker";
+}
+
+// Parametric equalizer-bands: [{"type": "peak", "freq": 120, "gain": -3.5, "q": 1.4}, ...]
+static void Web_EqualizerBandsToJSON(JsonArray bandsArr, const EqualizerProfile profile) {
+	equalizerBand_t bands[equalizerMaxBands];
+	const uint8_t count = Equalizer_GetBands(profile, bands);
+	for (uint8_t i = 0; i < count; i++) {
+		JsonObject bandObj = bandsArr.add<JsonObject>();
+		bandObj["type"] = Equalizer_BandTypeToString(bands[i].type);
+		bandObj["freq"] = bands[i].freqHz;
+		bandObj["gain"] = bands[i].gainCb / 10.0f;
+		bandObj["q"] = bands[i].q100 / 100.0f;
+	}
+}
+
+static bool Web_EqualizerBandsFromJSON(JsonArray bandsArr, const EqualizerProfile profile) {
+	if (bandsArr.size() > equalizerMaxBands) {
+		return false;
+	}
+	equalizerBand_t bands[equalizerMaxBands];
+	uint8_t count = 0;
+	for (JsonObject bandObj : bandsArr) {
+		equalizerBand_t &band = bands[count++];
+		if (!Equalizer_BandTypeFromString(bandObj["type"].as<const char *>(), &band.type)) {
+			return false;
+		}
+		band.freqHz = bandObj["freq"] | 1000u;
+		band.gainCb = lroundf((bandObj["gain"] | 0.0f) * 10.0f);
+		band.q100 = lroundf((bandObj["q"] | 0.71f) * 100.0f);
+		band.reserved = 0u;
+	}
+	return Equalizer_SetBands(profile, bands, count);
+}
+
 // process JSON to settings
 WebsocketCodeType JSONToSettings(JsonObject doc) {
 	if (!doc) {
@@ -741,29 +1100,8 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 	if (doc["general"].is<JsonObject>()) {
 		// general settings
 		JsonObject generalObj = doc["general"];
-		bool success = (gPrefsSettings.putUInt("initVolume", generalObj["initVolume"].as<uint8_t>()) != 0);
-		success = success && (gPrefsSettings.putUInt("maxVolumeSp", generalObj["maxVolumeSp"].as<uint8_t>()) != 0);
-		success = success && (gPrefsSettings.putUInt("maxVolumeHp", generalObj["maxVolumeHp"].as<uint8_t>()) != 0);
-		success = success && (gPrefsSettings.putUInt("mInactiviyT", generalObj["sleepInactivity"].as<uint8_t>()) != 0);
-		if (generalObj["rotSeekStep"].is<uint8_t>()) {
-			success = success && (gPrefsSettings.putUChar("rotSeekStep", generalObj["rotSeekStep"].as<uint8_t>()) != 0);
-		}
-		success = success && (gPrefsSettings.putBool("playMono", generalObj["playMono"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("savePosShutdown", generalObj["savePosShutdown"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("savePosRfidChge", generalObj["savePosRfidChge"].as<bool>()) != 0);
-		if (generalObj["savePosInterval"].is<uint16_t>()) {
-			// Guard: an older cached GUI page POSTs this block without the field; without this guard
-			// putUShort would persist a 0 and silently disable a checkpoint interval the user had set.
-			success = success && (gPrefsSettings.putUShort("savePosIntv", generalObj["savePosInterval"].as<uint16_t>()) != 0);
-			gPlayProperties.savePosIntervalSecs = generalObj["savePosInterval"].as<uint16_t>(); // apply live, no reboot needed
-		}
-		success = success && (gPrefsSettings.putBool("playLastOnBoot", generalObj["playLastRfidOnReboot"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("pauseRfidRem", generalObj["pauseIfRfidRemoved"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("dAccRfidTwice", generalObj["dontAcceptRfidTwice"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("p2pSameRfid", generalObj["resumeOnSameRfid"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("pauseOnMinVol", generalObj["pauseOnMinVol"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putBool("recoverVolBoot", generalObj["recoverVolBoot"].as<bool>()) != 0);
-		success = success && (gPrefsSettings.putUChar("volumeCurve", generalObj["volumeCurve"].as<uint8_t>()) != 0);
+		// settings of the registry are applied live (modules get notified) and written to NVS coalesced
+		bool success = SettingsRegistry_FromJSON(generalObj, "general");
 		success = success && (gPrefsRfid.putUChar("rfidReaderType", generalObj["rfidReaderType"].as<uint8_t>()) != 0);
 		success = success && (gPrefsRfid.putBool("pn5180Lpcd", generalObj["pn5180Lpcd"].as<bool>()) != 0);
 		success = success && (gPrefsRfid.putUChar("mfrc522Gain", generalObj["mfrc522Gain"].as<uint8_t>()) != 0);
@@ -772,20 +1110,8 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 			Log_Printf(LOGLEVEL_ERROR, webSaveSettingsError, "general");
 			return WebsocketCodeType::Error;
 		}
-		gPlayProperties.newPlayMono = generalObj["playMono"].as<bool>();
-		gPlayProperties.SavePlayPosRfidChange = generalObj["savePosRfidChge"].as<bool>();
-		gPlayProperties.pauseOnMinVolume = generalObj["pauseOnMinVol"].as<bool>();
-		gPlayProperties.pauseIfRfidRemoved = generalObj["pauseIfRfidRemoved"].as<bool>();
-		gPlayProperties.resumeOnSameRfid = generalObj["resumeOnSameRfid"].as<bool>();
-		if (gPlayProperties.pauseIfRfidRemoved) {
-			// ignore feature silently if PAUSE_WHEN_RFID_REMOVED is active
-			Log_Println("pauseIfRfidRemoved is enabled -> deactivate dontAcceptRfidTwice", LOGLEVEL_NOTICE);
-			gPlayProperties.dontAcceptRfidTwice = false;
-		} else {
-			gPlayProperties.dontAcceptRfidTwice = generalObj["dontAcceptRfidTwice"].as<bool>();
-		}
 	}
-	if (doc["equalizer"].is<JsonObject>()) {
+	if (doc["equalizer"].is<JsonObject>() && doc["equalizer"]["gainLowPass"].is<int8_t>()) {
 		int8_t _gainLowPass = doc["equalizer"]["gainLowPass"].as<int8_t>();
 		int8_t _gainBandPass = doc["equalizer"]["gainBandPass"].as<int8_t>();
 		int8_t _gainHighPass = doc["equalizer"]["gainHighPass"].as<int8_t>();
@@ -798,6 +1124,16 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 			AudioPlayer_SetEqualizer(_gainLowPass, _gainBandPass, _gainHighPass);
 		}
 	}
+	if (doc["equalizer"].is<JsonObject>()) {
+		// parametric bands of the speaker- and headphone-profile
+		for (const EqualizerProfile profile : {EqualizerProfile::Speaker, EqualizerProfile::Headphone}) {
+			JsonArray bandsArr = doc["equalizer"][Web_EqualizerProfileName(profile)];
+			if (!bandsArr.isNull() && !Web_EqualizerBandsFromJSON(bandsArr, profile)) {
+				Log_Printf(LOGLEVEL_ERROR, webSaveSettingsError, "equalizer");
+				return WebsocketCodeType::Error;
+			}
+		}
+	}
 	if (doc["wifi"].is<JsonObject>()) {
 		// WiFi settings
 		String hostName = doc["wifi"]["hostname"];
@@ -1040,7 +1376,7 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 				return WebsocketCodeType::Error;
 			}
 		}
-		Web_DumpNvsToSd("rfidTags", backupFile); // Store backup-file every time when a new rfid-tag is programmed
+		Web_RfidBackupNoteChange(_rfidIdModId); // Update backup every time when a new rfid-tag is programmed
 	} else if (doc["rfidAssign"].is<JsonObject>()) {
 		const char *_rfidIdAssinId = doc["rfidAssign"]["rfidIdMusic"];
 		const char *_fileOrUrlAscii = doc["rfidAssign"]["fileOrUrl"];
@@ -1060,7 +1396,7 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 		if (s.compareTo(rfidString)) {
 			return WebsocketCodeType::Error;
 		}
-		Web_DumpNvsToSd("rfidTags", backupFile); // Store backup-file every time when a new rfid-tag is programmed
+		Web_RfidBackupNoteChange(_rfidIdAssinId); // Update backup every time when a new rfid-tag is programmed
 		Web_SendWebsocketData(0, WebsocketCodeType::Ok);
 	} else if (doc["ping"].is<JsonObject>()) {
 		if ((millis() - lastPongTimestamp) > 1000u) {
@@ -1079,7 +1415,7 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 		const JsonObject controlsObj = doc["controls"].as<JsonObject>();
 		if (controlsObj["set_volume"].is<uint8_t>()) {
 			uint8_t new_vol = controlsObj["set_volume"].as<uint8_t>();
-			AudioPlayer_SetVolume(new_vol); // already broadcasts its own Volume update
+			CommandBus_PostVolume(new_vol, CommandSource::Web); // broadcasts its own Volume update once applied
 			if (!controlsObj["action"].is<uint8_t>()) {
 				// pure volume-slider drag (no button action alongside it) - don't also send
 				// back an Ok ack, or dragging the slider spams a "success" toast per tick
@@ -1088,7 +1424,7 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 		}
 		if (controlsObj["action"].is<uint8_t>()) {
 			uint8_t cmd = controlsObj["action"].as<uint8_t>();
-			Cmd_Action(cmd);
+			CommandBus_PostAction(cmd, CommandSource::Web);
 		}
 	} else if (doc["trackinfo"].is<JsonObject>()) {
 		Web_SendWebsocketData(0, WebsocketCodeType::TrackInfo);
@@ -1113,8 +1449,7 @@ WebsocketCodeType JSONToSettings(JsonObject doc) {
 		}
 		const JsonObject trackObj = doc["trackProgress"].as<JsonObject>();
 		if (trackObj["posPercent"].is<uint8_t>()) {
-			gPlayProperties.seekmode = SEEK_POS_PERCENT;
-			gPlayProperties.currentRelPos = trackObj["posPercent"].as<uint8_t>();
+			AudioPlayer_SeekToPercent(trackObj["posPercent"].as<uint8_t>());
 		}
 		Web_SendWebsocketData(0, WebsocketCodeType::TrackProgress);
 		return WebsocketCodeType::Silent;
@@ -1134,26 +1469,11 @@ static void settingsToJSON(JsonObject obj, const String section) {
 	if ((section == "") || (section == "general")) {
 		// general settings
 		JsonObject generalObj = obj["general"].to<JsonObject>();
-		generalObj["initVolume"].set(gPrefsSettings.getUInt("initVolume", 3));
-		generalObj["maxVolumeSp"].set(gPrefsSettings.getUInt("maxVolumeSp", 21));
-		generalObj["maxVolumeHp"].set(gPrefsSettings.getUInt("maxVolumeHp", 21));
-		generalObj["sleepInactivity"].set(gPrefsSettings.getUInt("mInactiviyT", 10));
-		generalObj["rotSeekStep"].set(gPrefsSettings.getUChar("rotSeekStep", JUMP_OFFSET_ROTARY)); // seconds per detent when seeking via a rotary gesture
-		generalObj["playMono"].set(gPrefsSettings.getBool("playMono", false));
-		generalObj["savePosShutdown"].set(gPrefsSettings.getBool("savePosShutdown", false)); // SAVE_PLAYPOS_BEFORE_SHUTDOWN
-		generalObj["savePosRfidChge"].set(gPrefsSettings.getBool("savePosRfidChge", false)); // SAVE_PLAYPOS_WHEN_RFID_CHANGE
-		generalObj["savePosInterval"].set(gPrefsSettings.getUShort("savePosIntv", 0)); // SAVE_PLAYPOS_INTERVAL (periodic checkpoint seconds, 0 = off)
-		generalObj["playLastRfidOnReboot"].set(gPrefsSettings.getBool("playLastOnBoot", false)); // PLAY_LAST_RFID_AFTER_REBOOT
-		generalObj["pauseIfRfidRemoved"].set(gPrefsSettings.getBool("pauseRfidRem", false)); // PAUSE_WHEN_RFID_REMOVED
-		generalObj["dontAcceptRfidTwice"].set(gPrefsSettings.getBool("dAccRfidTwice", false)); // DONT_ACCEPT_SAME_RFID_TWICE
-		generalObj["resumeOnSameRfid"].set(gPrefsSettings.getBool("p2pSameRfid", false)); // RESUME_ON_SAME_RFID (only in combination with DONT_ACCEPT_SAME_RFID_TWICE)
+		SettingsRegistry_ToJSON(generalObj, "general", false);
 		generalObj["rfidReaderType"].set(gPrefsRfid.getUChar("rfidReaderType", 0)); // RFID_READER_TYPE_RUNTIME
 		generalObj["pn5180Lpcd"].set(gPrefsRfid.getBool("pn5180Lpcd", false)); // PN5180 LPCD
 		generalObj["mfrc522Gain"].set(gPrefsRfid.getUChar("mfrc522Gain", 7)); // MFRC522_GAIN
 		generalObj["pn5180Debounce"].set(gPrefsRfid.getUShort("pn5180Debounce", 500)); // PN5180 debounce (ms)
-		generalObj["pauseOnMinVol"].set(gPrefsSettings.getBool("pauseOnMinVol", false)); // PAUSE_ON_MIN_VOLUME
-		generalObj["recoverVolBoot"].set(gPrefsSettings.getBool("recoverVolBoot", false)); // USE_LAST_VOLUME_AFTER_REBOOT
-		generalObj["volumeCurve"].set(gPrefsSettings.getUChar("volumeCurve", 0)); // VOLUMECURVE
 	}
 	if ((section == "") || (section == "equalizer")) {
 		// equalizer settings
@@ -1161,6 +1481,9 @@ static void settingsToJSON(JsonObject obj, const String section) {
 		equalizerObj["gainLowPass"].set(gPrefsSettings.getChar("gainLowPass", 0));
 		equalizerObj["gainBandPass"].set(gPrefsSettings.getChar("gainBandPass", 0));
 		equalizerObj["gainHighPass"].set(gPrefsSettings.getChar("gainHighPass", 0));
+		for (const EqualizerProfile profile : {EqualizerProfile::Speaker, EqualizerProfile::Headphone}) {
+			Web_EqualizerBandsToJSON(equalizerObj[Web_EqualizerProfileName(profile)].to<JsonArray>(), profile);
+		}
 	}
 	if ((section == "") || (section == "wifi")) {
 		// WiFi settings
@@ -1293,21 +1616,7 @@ static void settingsToJSON(JsonObject obj, const String section) {
 		// default factory settings NOTE: maintain the settings section structure as above to make it easier for clients to use
 		JsonObject defaultsObj = obj["defaults"].to<JsonObject>();
 		JsonObject genSettings = defaultsObj["general"].to<JsonObject>();
-		genSettings["initVolume"].set(AUDIOPLAYER_VOLUME_INIT);
-		genSettings["maxVolumeSp"].set(AUDIOPLAYER_VOLUME_MAX);
-		genSettings["maxVolumeHp"].set(18u); // gPrefsSettings.getUInt("maxVolumeHp", 0));
-		genSettings["sleepInactivity"].set(10u); // System_MaxInactivityTime
-		genSettings["playMono"].set(false); // PLAY_MONO_SPEAKER
-		genSettings["savePosShutdown"].set(false); // SAVE_PLAYPOS_BEFORE_SHUTDOWN
-		genSettings["savePosRfidChge"].set(false); // SAVE_PLAYPOS_WHEN_RFID_CHANGE
-		genSettings["savePosInterval"].set(0); // SAVE_PLAYPOS_INTERVAL (periodic checkpoint seconds, 0 = off)
-		genSettings["playLastRfidOnReboot"].set(false); // PLAY_LAST_RFID_AFTER_REBOOT
-		genSettings["pauseIfRfidRemoved"].set(false); // PAUSE_WHEN_RFID_REMOVED
-		genSettings["dontAcceptRfidTwice"].set(false); // DONT_ACCEPT_SAME_RFID_TWICE
-		genSettings["resumeOnSameRfid"].set(false); // RESUME_ON_SAME_RFID (only in combination with DONT_ACCEPT_SAME_RFID_TWICE)
-		genSettings["pauseOnMinVol"].set(false); // PAUSE_ON_MIN_VOLUME
-		genSettings["recoverVolBoot"].set(false); // USE_LAST_VOLUME_AFTER_REBOOT
-		genSettings["volumeCurve"].set(0u); // VOLUME_CURVE
+		SettingsRegistry_ToJSON(genSettings, "general", true);
 		genSettings["rfidReaderType"].set(0u); // RFID_READER_TYPE_RUNTIME (auto-detect)
 		genSettings["pn5180Lpcd"].set(false); // PN5180 LPCD disabled
 		genSettings["mfrc522Gain"].set(7u); // MFRC522_GAIN default (max gain)
@@ -1316,6 +1625,8 @@ static void settingsToJSON(JsonObject obj, const String section) {
 		eqSettings["gainHighPass"].set(0);
 		eqSettings["gainBandPass"].set(0);
 		eqSettings["gainLowPass"].set(0);
+		eqSettings["speaker"].to<JsonArray>();
+		eqSettings["headphone"].to<JsonArray>();
 #ifdef NEOPIXEL_ENABLE
 		JsonObject ledSettings = defaultsObj["led"].to<JsonObject>();
 		ledSettings["initBrightness"].set(16u); // LED_INITIAL_BRIGHTNESS
@@ -1633,6 +1944,68 @@ void handleDebugRequest(AsyncWebServerRequest *request) {
 		taskObj["runtimePercentage"] = ulStatsAsPercentage;
 		taskObj["stackHighWaterMark"] = task_status_arr[i].usStackHighWaterMark;
 	}
+#endif
+	// audio-task
+	audioTaskStats_t audioStats;
+	AudioPlayer_GetTaskStats(&audioStats);
+	JsonObject audioTaskObj = response->getRoot()["audioTask"].to<JsonObject>();
+	audioTaskObj["loopTimeAvgUs"] = audioStats.loopTimeAvgUs;
+	audioTaskObj["loopTimeMaxUs"] = audioStats.loopTimeMaxUs;
+	audioTaskObj["jitterAvgUs"] = audioStats.jitterAvgUs;
+	audioTaskObj["jitterMaxUs"] = audioStats.jitterMaxUs;
+	audioTaskObj["deadlineMisses"] = audioStats.deadlineMisses;
+	audioTaskObj["commandsDropped"] = audioStats.commandsDropped;
+	// gaps between tracks (preload/crossfade)
+	transitionStats_t transitionStats;
+	AudioPlayer_GetTransitionStats(&transitionStats);
+	JsonObject transitionsObj = response->getRoot()["transitions"].to<JsonObject>();
+	transitionsObj["count"] = transitionStats.count;
+	transitionsObj["lastGapMs"] = transitionStats.lastGapUs / 1000.0f;
+	transitionsObj["avgGapMs"] = transitionStats.avgGapUs / 1000.0f;
+	transitionsObj["maxGapMs"] = transitionStats.maxGapUs / 1000.0f;
+	// seek and resume
+	seekStats_t seekStats;
+	AudioPlayer_GetSeekStats(&seekStats);
+	JsonObject seekObj = response->getRoot()["seek"].to<JsonObject>();
+	seekObj["count"] = seekStats.count;
+	seekObj["indexed"] = seekStats.indexed;
+	seekObj["lastLatencyMs"] = seekStats.lastLatencyUs / 1000.0f;
+	seekObj["avgLatencyMs"] = seekStats.avgLatencyUs / 1000.0f;
+	seekObj["maxLatencyMs"] = seekStats.maxLatencyUs / 1000.0f;
+	seekObj["lastErrorMs"] = seekStats.lastErrorUs / 1000.0f;
+	seekObj["maxErrorMs"] = seekStats.maxErrorUs / 1000.0f;
+	// cost of the equalizer
+	equalizerStats_t eqStats;
+	Equalizer_GetStats(&eqStats);
+	JsonObject equalizerObj = response->getRoot()["equalizer"].to<JsonObject>();
+	equalizerObj["profile"] = Web_EqualizerProfileName(eqStats.profile);
+	equalizerObj["biquads"] = eqStats.stages;
+	equalizerObj["sampleRate"] = eqStats.sampleRate;
+	equalizerObj["preampDb"] = eqStats.preampDb;
+	equalizerObj["cyclesPerFrame"] = eqStats.cyclesPerFrame;
+	equalizerObj["rebuilds"] = eqStats.rebuilds;
+	// main-loop
+	Scheduler_ToJSON(response->getRoot()["scheduler"].to<JsonObject>());
+	// commands of the input-sources
+	CommandBus_ToJSON(response->getRoot()["commandBus"].to<JsonObject>());
+	// tap-to-sound latency of RFID-cards
+	TapTrace_ToJSON(response->getRoot()["tapLatency"].to<JsonObject>());
+	// cost of the logging-calls
+	Log_ToJSON(response->getRoot()["logger"].to<JsonObject>());
+#ifdef LOOP_PROFILER_ENABLE
+	// runtime of the main-loop's handlers
+	LoopProfiler_ToJSON(response->getRoot()["loopProfiler"].to<JsonObject>());
+#endif
+#ifdef BLUETOOTH_ENABLE
+	// jitter-buffer of the A2DP-source
+	bluetoothSourceStats_t btStats;
+	Bluetooth_Source_GetStats(&btStats);
+	JsonObject btSourceObj = response->getRoot()["btSource"].to<JsonObject>();
+	btSourceObj["underruns"] = btStats.underruns;
+	btSourceObj["overruns"] = btStats.overruns;
+	btSourceObj["paddedFrames"] = btStats.paddedFrames;
+	btSourceObj["fillMs"] = btStats.fillMs;
+	btSourceObj["targetMs"] = btStats.targetMs;
 #endif
 	if (response->overflowed()) {
 		// JSON buffer too small for data
@@ -1644,9 +2017,55 @@ void handleDebugRequest(AsyncWebServerRequest *request) {
 	request->send(response);
 }
 
+// handle request for the last tap-to-sound traces (Chrome trace-format)
+void handleDebugTracesRequest(AsyncWebServerRequest *request) {
+	AsyncJsonResponse *response = new AsyncJsonResponse(false);
+	TapTrace_ChromeTraceToJSON(response->getRoot().to<JsonObject>());
+	if (response->overflowed()) {
+		// JSON buffer too small for data
+		Log_Println(jsonbufferOverflow, LOGLEVEL_ERROR);
+		request->send(500);
+		return;
+	}
+	response->setLength();
+	request->send(response);
+}
+
+#ifdef HEAP_PROFILER_ENABLE
+// handle request for the allocations per task/module and the free memory over time
+void handleDebugHeapRequest(AsyncWebServerRequest *request) {
+	AsyncJsonResponse *response = new AsyncJsonResponse(false);
+	HeapProfiler_ToJSON(response->getRoot().to<JsonObject>());
+	if (response->overflowed()) {
+		// JSON buffer too small for data
+		Log_Println(jsonbufferOverflow, LOGLEVEL_ERROR);
+		request->send(500);
+		return;
+	}
+	response->setLength();
+	request->send(response);
+}
+#endif
+
+#ifdef TASK_MONITOR_ENABLE
+// handle request for the stack-usage and CPU-share per task
+void handleDebugTasksRequest(AsyncWebServerRequest *request) {
+	AsyncJsonResponse *response = new AsyncJsonResponse(false);
+	TaskMonitor_ToJSON(response->getRoot().to<JsonObject>());
+	if (response->overflowed()) {
+		// JSON buffer too small for data
+		Log_Println(jsonbufferOverflow, LOGLEVEL_ERROR);
+		request->send(500);
+		return;
+	}
+	response->setLength();
+	request->send(response);
+}
+#endif
+
 // Takes inputs from webgui, parses JSON and saves values in NVS
 // If operation was successful (NVS-write is verified) true is returned
-WebsocketCodeType processJsonRequest(char *_serialJson) {
+WebsocketCodeType processJsonRequest(char *_serialJson, const uint32_t client) {
 	if (!_serialJson) {
 		return WebsocketCodeType::Error;
 	}
@@ -1661,6 +2080,13 @@ WebsocketCodeType processJsonRequest(char *_serialJson) {
 	}
 
 	JsonObject obj = doc.as<JsonObject>();
+	if (obj["log"].is<JsonObject>()) {
+		// live-tail of the log (per client); without "since" only new lines are sent
+		const JsonObject logObj = obj["log"].as<JsonObject>();
+		const uint32_t next = Log_GetSequence();
+		const uint32_t since = logObj["since"].is<uint32_t>() ? std::min(logObj["since"].as<uint32_t>(), next) : next;
+		return Web_LogSubscribe(client, logObj["subscribe"] | false, since);
+	}
 	return JSONToSettings(obj);
 }
 
@@ -1725,6 +2151,13 @@ void Web_SendWebsocketData(uint32_t client, WebsocketCodeType code) {
 		object["bt_scan"] = "in_progress";
 	} else if (code == WebsocketCodeType::BluetoothScanComplete) {
 		object["bt_scan"] = "complete";
+	} else if (code == WebsocketCodeType::NvsImportProgress) {
+		JsonObject entry = object["nvsImport"].to<JsonObject>();
+		entry["running"] = Web_NvsImport.running;
+		entry["dryRun"] = Web_NvsImport.dryRun;
+		entry["failed"] = Web_NvsImport.failed;
+		entry["processed"] = Web_NvsImport.processed;
+		entry["total"] = Web_NvsImport.added + Web_NvsImport.changed + Web_NvsImport.removed;
 	};
 
 	if (doc.overflowed()) {
@@ -1742,8 +2175,10 @@ void Web_SendWebsocketData(uint32_t client, WebsocketCodeType code) {
 	}
 	serializeJson(doc, jsonBuffer->get(), len);
 	if (client == 0) {
+		Web_WsSentBytes += len * ws.count();
 		ws.textAll(jsonBuffer);
 	} else {
+		Web_WsSentBytes += len;
 		ws.text(client, jsonBuffer);
 	}
 }
@@ -1764,6 +2199,7 @@ void onWebsocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsE
 	} else if (type == WS_EVT_DISCONNECT) {
 		// client disconnected
 		Log_Printf(LOGLEVEL_DEBUG, "ws[%s][%u] disconnect", server->url(), client->id());
+		Web_LogSubscribe(client->id(), false, 0u);
 	} else if (type == WS_EVT_ERROR) {
 		// error was received from the other end
 		Log_Printf(LOGLEVEL_DEBUG, "ws[%s][%u] error(%u): %s", server->url(), client->id(), *((uint16_t *) arg), (char *) data);
@@ -1772,12 +2208,13 @@ void onWebsocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsE
 		Log_Printf(LOGLEVEL_DEBUG, "ws[%s][%u] pong[%u]: %s", server->url(), client->id(), len, (len) ? (char *) data : "");
 	} else if (type == WS_EVT_DATA) {
 		// data packet
+		Web_WsReceivedBytes += len;
 		const AwsFrameInfo *info = (AwsFrameInfo *) arg;
 		if (info && info->final && info->index == 0 && info->len == len && client && len > 0) {
 			// the whole message is in a single frame and we got all of it's data
 			// Serial.printf("ws[%s][%u] %s-message[%llu]: ", server->url(), client->id(), (info->opcode == WS_TEXT) ? "text" : "binary", info->len);
 
-			WebsocketCodeType result = processJsonRequest((char *) data);
+			WebsocketCodeType result = processJsonRequest((char *) data, client->id());
 			if (result != WebsocketCodeType::Error && result != WebsocketCodeType::Silent) {
 				Web_SendWebsocketData(client->id(), result);
 			}
@@ -1991,6 +2428,8 @@ static void explorerHandleFileStorageTask(void *parameter) {
 					uploadFile.close();
 				}
 				Log_Printf(LOGLEVEL_INFO, fileWritten, filePath, bytesOk, (millis() - transferStartTimestamp), (bytesOk) / (millis() - transferStartTimestamp));
+				Web_UploadBytes += bytesOk;
+				Web_UploadMs += millis() - transferStartTimestamp;
 				Log_Printf(LOGLEVEL_DEBUG, "Bytes [ok] %zu, Chunks: %zu\n", bytesOk, chunkCount);
 				// done exit loop to terminate
 				break;
@@ -2128,9 +2567,19 @@ void explorerHandleDownloadRequest(AsyncWebServerRequest *request) {
 		request->send(404);
 		return;
 	}
+	// RFID-backup: snapshot and change-log are opened and read under Web_RfidBackupMutex (see Web_RfidBackupCompact())
+	const bool rfidBackup = (strcmp(filePath, backupFile) == 0);
+	if (rfidBackup && (Web_RfidBackupMutex == NULL || xSemaphoreTake(Web_RfidBackupMutex, pdMS_TO_TICKS(100)) != pdTRUE)) {
+		Log_Printf(LOGLEVEL_ERROR, "DOWNLOAD:  %s is being rewritten, try again", filePath);
+		request->send(503);
+		return;
+	}
 	// check is file and not a directory
 	file = gFSystem.open(filePath);
 	if (file.isDirectory()) {
+		if (rfidBackup) {
+			xSemaphoreGive(Web_RfidBackupMutex);
+		}
 		Log_Printf(LOGLEVEL_ERROR, "DOWNLOAD:  Cannot download a directory %s", filePath);
 		request->send(404);
 		file.close();
@@ -2141,16 +2590,61 @@ void explorerHandleDownloadRequest(AsyncWebServerRequest *request) {
 	String dataType = "application/octet-stream";
 	struct fileBlk {
 		File dataFile;
+		File nextFile; // served after dataFile
+		size_t dataSize;
+		size_t size;
+		bool rfidBackup;
+		uint32_t generation; // of the RFID-backup when it was opened
 	};
 	fileBlk *fileObj = new fileBlk;
 	fileObj->dataFile = file;
+	fileObj->dataSize = file.size();
+	fileObj->rfidBackup = rfidBackup;
+	if (rfidBackup) {
+		if (Web_RfidBackupChangeLogPending) {
+			// the changes since the last snapshot follow it, so the import replays both
+			fileObj->nextFile = gFSystem.open(rfidBackupChangeLog);
+		}
+		fileObj->generation = Web_RfidBackupGeneration;
+		Web_RfidBackupDownloadTimestamp = millis() | 1u;
+		xSemaphoreGive(Web_RfidBackupMutex);
+	}
+	// the change-log might grow meanwhile, only what's there now is sent
+	fileObj->size = fileObj->dataSize + (fileObj->nextFile ? fileObj->nextFile.size() : 0);
 	request->_tempObject = (void *) fileObj;
 
-	AsyncWebServerResponse *response = request->beginResponse(dataType, fileObj->dataFile.size(), [request](uint8_t *buffer, size_t maxlen, size_t index) -> size_t {
+	AsyncWebServerResponse *response = request->beginResponse(dataType, fileObj->size, [request](uint8_t *buffer, size_t maxlen, size_t index) -> size_t {
 		fileBlk *fileObj = (fileBlk *) request->_tempObject;
-		size_t thisSize = fileObj->dataFile.read(buffer, maxlen);
-		if ((index + thisSize) >= fileObj->dataFile.size()) {
+		size_t thisSize = 0;
+		bool locked = false;
+		bool aborted = false;
+		if (fileObj->rfidBackup) {
+			// a compaction since the start of the download would mix old and new snapshot: abort
+			locked = (xSemaphoreTake(Web_RfidBackupMutex, pdMS_TO_TICKS(100)) == pdTRUE);
+			aborted = !locked || fileObj->generation != Web_RfidBackupGeneration;
+			if (aborted) {
+				Log_Printf(LOGLEVEL_ERROR, "DOWNLOAD:  %s was rewritten meanwhile, aborted", backupFile);
+			}
+			Web_RfidBackupDownloadTimestamp = millis() | 1u;
+		}
+		if (!aborted) {
+			if (index < fileObj->dataSize) {
+				thisSize = fileObj->dataFile.read(buffer, std::min(maxlen, fileObj->dataSize - index));
+			} else {
+				thisSize = fileObj->nextFile.read(buffer, std::min(maxlen, fileObj->size - index));
+			}
+		}
+		if (locked) {
+			xSemaphoreGive(Web_RfidBackupMutex);
+		}
+		if ((index + thisSize) >= fileObj->size || !thisSize) {
 			fileObj->dataFile.close();
+			if (fileObj->nextFile) {
+				fileObj->nextFile.close();
+			}
+			if (fileObj->rfidBackup) {
+				Web_RfidBackupDownloadTimestamp = 0; // done, compaction may run
+			}
 			request->_tempObject = NULL;
 			delete fileObj;
 		}
@@ -2172,7 +2666,7 @@ void explorerHandleDeleteRequest(AsyncWebServerRequest *request) {
 		const char *filePath = param->value().c_str();
 		if (gFSystem.exists(filePath)) {
 			// stop playback, file to delete might be in use
-			Cmd_Action(CMD_STOP);
+			CommandBus_PostAction(CMD_STOP, CommandSource::Web);
 			file = gFSystem.open(filePath);
 			if (file.isDirectory()) {
 				if (explorerDeleteDirectory(file)) {
@@ -2654,7 +3148,7 @@ static void handlePostRFIDRequest(AsyncWebServerRequest *request, JsonVariant &j
 		request->send(500, "text/plain; charset=utf-8", "/rfid (POST): cannot save assignment to NVS");
 		return;
 	}
-	Web_DumpNvsToSd("rfidTags", backupFile); // Store backup-file every time when a new rfid-tag is programmed
+	Web_RfidBackupNoteChange(tagId.c_str()); // Update backup every time when a new rfid-tag is programmed
 	// return the new/modified RFID assignment
 	AsyncJsonResponse *response = new AsyncJsonResponse(false);
 	JsonObject obj = response->getRoot();
@@ -2676,9 +3170,10 @@ static void handleDeleteRFIDRequest(AsyncWebServerRequest *request) {
 	if (gPrefsRfid.isKey(tagId.c_str())) {
 		if (tagId.equals(gCurrentRfidTagId)) {
 			// stop playback, tag to delete is in use
-			Cmd_Action(CMD_STOP);
+			CommandBus_PostAction(CMD_STOP, CommandSource::Web);
 		}
 		if (gPrefsRfid.remove(tagId.c_str())) {
+			Web_RfidBackupNoteChange(tagId.c_str());
 			Log_Printf(LOGLEVEL_INFO, "/rfid (DELETE): tag %s removed successfuly", tagId);
 			request->send(200, "text/plain; charset=utf-8", tagId + " removed successfuly");
 		} else {
@@ -2719,78 +3214,243 @@ void handleUpload(AsyncWebServerRequest *request, String filename, size_t index,
 
 	if (final) {
 		tmpFile.close();
-		Web_DumpSdToNvs(tmpFileName);
+		Web_DumpSdToNvs(tmpFileName, request->hasParam("dryRun"));
 		fileIndex = 0;
 	}
 }
 
-// Parses content of temporary backup-file and writes payload into NVS
-void Web_DumpSdToNvs(const char *_filename) {
-	char ebuf[290];
-	uint16_t j = 0;
-	char *token;
-	bool count = false;
-	uint16_t importCount = 0;
-	uint16_t invalidCount = 0;
-	nvs_t nvsEntry[1];
-	File tmpFile = gFSystem.open(_filename);
-
-	if (!tmpFile || (tmpFile.available() < 3)) {
-		Log_Println(errorReadingTmpfile, LOGLEVEL_ERROR);
-		return;
-	}
-
-	Led_SetPause(true);
+// Reads a backup-file line by line through a block-buffer (instead of single-byte reads from SD) and
+// calls _callback for every RFID-assignment or delete-record (with its line-number). Empty lines are skipped;
+// the file is rejected as a whole if a line is too long or is neither.
+static bool Web_ParseNvsBackup(File &_file, bool (*_callback)(const nvs_t *entry, const uint32_t line, void *data), void *_data) {
+	constexpr size_t blockSize = 512;
+	char block[blockSize];
+	char ebuf[sizeof(nvs_t::nvsEntry) + sizeof(nvs_t::nvsKey) + 2];
+	size_t j = 0;
+	uint32_t line = 0;
+	nvs_t nvsEntry;
+
+	_file.seek(0);
 	// try to read UTF-8 BOM marker
-	bool isUtf8 = (tmpFile.read() == 0xEF) && (tmpFile.read() == 0xBB) && (tmpFile.read() == 0xBF);
+	uint8_t bom[3] = {0};
+	const bool isUtf8 = (_file.read(bom, sizeof(bom)) == sizeof(bom)) && (bom[0] == 0xEF) && (bom[1] == 0xBB) && (bom[2] == 0xBF);
 	if (!isUtf8) {
 		// no BOM found, reset to start of file
-		tmpFile.seek(0);
-	}
-
-	while (tmpFile.available() > 0) {
-		if (j >= sizeof(ebuf)) {
-			Log_Println(errorReadingTmpfile, LOGLEVEL_ERROR);
-			return;
-		}
-		char buf = tmpFile.read();
-		if (buf != '\n') {
-			ebuf[j++] = buf;
-		} else {
+		_file.seek(0);
+	}
+
+	bool eof = false;
+	while (!eof) {
+		const size_t bytesRead = _file.read(reinterpret_cast<uint8_t *>(block), blockSize);
+		eof = (bytesRead == 0);
+		for (size_t i = 0; i < bytesRead || (eof && j > 0); i++) {
+			const char c = eof ? '\n' : block[i]; // last line might come without a trailing newline
+			if (c != '\n') {
+				if (j >= sizeof(ebuf) - 1) {
+					Log_Printf(LOGLEVEL_ERROR, nvsImportInvalidLine, line + 1);
+					Web_NvsImport.invalid++;
+					return false;
+				}
+				ebuf[j++] = c;
+				continue;
+			}
+			line++;
+			if (j > 0 && ebuf[j - 1] == '\r') {
+				j--;
+			}
 			ebuf[j] = '\0';
 			j = 0;
-			token = strtok(ebuf, stringOuterDelimiter);
-			while (token != NULL) {
-				if (!count) {
-					count = true;
-					size_t keyLen = std::min(strlen(token), sizeof(nvsEntry[0].nvsKey) - 1);
-					memcpy(nvsEntry[0].nvsKey, token, keyLen);
-					nvsEntry[0].nvsKey[keyLen] = '\0';
+
+			// format of a line: ^<rfidTag>^<#file#pos#playmode#track>
+			nvsEntry.nvsKey[0] = '\0';
+			nvsEntry.nvsEntry[0] = '\0';
+			char *token = strtok(ebuf, stringOuterDelimiter);
+			if (token != NULL) {
+				strncpy(nvsEntry.nvsKey, token, sizeof(nvsEntry.nvsKey) - 1);
+				nvsEntry.nvsKey[sizeof(nvsEntry.nvsKey) - 1] = '\0';
+				token = strtok(NULL, stringOuterDelimiter);
+			}
+			if (token != NULL) {
+				if (isUtf8) {
+					strncpy(nvsEntry.nvsEntry, token, sizeof(nvsEntry.nvsEntry) - 1);
+					nvsEntry.nvsEntry[sizeof(nvsEntry.nvsEntry) - 1] = '\0';
 				} else {
-					count = false;
-					if (isUtf8) {
-						size_t entryLen = std::min(strlen(token), sizeof(nvsEntry[0].nvsEntry) - 1);
-						memcpy(nvsEntry[0].nvsEntry, token, entryLen);
-						nvsEntry[0].nvsEntry[entryLen] = '\0';
-					} else {
-						convertAsciiToUtf8(String(token), nvsEntry[0].nvsEntry, sizeof(nvsEntry[0].nvsEntry));
-					}
+					convertAsciiToUtf8(String(token), nvsEntry.nvsEntry, sizeof(nvsEntry.nvsEntry));
 				}
-				token = strtok(NULL, stringOuterDelimiter);
 			}
-			if (isNumber(nvsEntry[0].nvsKey) && nvsEntry[0].nvsEntry[0] == '#') {
-				Log_Printf(LOGLEVEL_NOTICE, writeEntryToNvs, ++importCount, nvsEntry[0].nvsKey, nvsEntry[0].nvsEntry);
-				gPrefsRfid.putString(nvsEntry[0].nvsKey, nvsEntry[0].nvsEntry);
-			} else {
-				invalidCount++;
+			if (isNumber(nvsEntry.nvsKey) && (nvsEntry.nvsEntry[0] == '#' || !strcmp(nvsEntry.nvsEntry, rfidBackupDeleted))) {
+				if (!_callback(&nvsEntry, line, _data)) {
+					return false;
+				}
+			} else if (ebuf[0] != '\0') {
+				Log_Printf(LOGLEVEL_ERROR, nvsImportInvalidLine, line);
+				Web_NvsImport.invalid++;
+				return false;
+			}
+			if (eof) {
+				break;
 			}
 		}
 	}
+	return true;
+}
+
+// A tag can appear more than once in a backup; like in NVS the last line wins. The tags are kept as number
+// (plus their length, as leading zeros count) along with the line that's applied.
+typedef struct {
+	uint64_t key;
+	uint32_t line;
+} nvsImportKey_t;
+using NvsImportKeys = std::vector<nvsImportKey_t, PSRAMAllocator<nvsImportKey_t>>;
+
+static uint64_t Web_NvsImportKey(const char *_rfidTag) {
+	return (static_cast<uint64_t>(strlen(_rfidTag)) << 56) | strtoull(_rfidTag, nullptr, 10);
+}
+
+// 1st pass: syntax only, collects the tags
+static bool Web_NvsImportCollectCallback(const nvs_t *entry, const uint32_t line, void *data) {
+	static_cast<NvsImportKeys *>(data)->push_back({Web_NvsImportKey(entry->nvsKey), line});
+	return true;
+}
+
+// Sorts the tags and keeps only their last line
+static void Web_NvsImportDeduplicate(NvsImportKeys &_keys) {
+	std::stable_sort(_keys.begin(), _keys.end(), [](const nvsImportKey_t &a, const nvsImportKey_t &b) { return a.key < b.key; });
+	auto last = _keys.begin();
+	for (auto it = _keys.begin(); it != _keys.end(); ++it) {
+		if (it != _keys.begin() && it->key == last->key) {
+			last->line = it->line; // same order as in the file, so the later one
+		} else if (it != _keys.begin()) {
+			*(++last) = *it;
+		}
+	}
+	if (!_keys.empty()) {
+		_keys.erase(last + 1, _keys.end());
+	}
+}
+
+// true if the line is the one that counts for its tag (not overridden by a later line)
+static bool Web_NvsImportIsLatest(const NvsImportKeys &_keys, const nvs_t *_entry, const uint32_t _line) {
+	const uint64_t key = Web_NvsImportKey(_entry->nvsKey);
+	const auto it = std::lower_bound(_keys.begin(), _keys.end(), key, [](const nvsImportKey_t &a, const uint64_t k) { return a.key < k; });
+	return it != _keys.end() && it->key == key && it->line == _line;
+}
+
+static bool Web_NvsEntryIsDeletion(const nvs_t *_entry) {
+	return !strcmp(_entry->nvsEntry, rfidBackupDeleted);
+}
+
+// Returns true if an entry differs from what's currently stored in NVS (new, changed or deleted assignment)
+static bool Web_NvsEntryDiffers(const nvs_t *_entry, bool *_isNew) {
+	const bool exists = gPrefsRfid.isKey(_entry->nvsKey);
+	*_isNew = !exists;
+	if (Web_NvsEntryIsDeletion(_entry)) {
+		*_isNew = false;
+		return exists;
+	}
+	if (*_isNew) {
+		return true;
+	}
+	return gPrefsRfid.getString(_entry->nvsKey).compareTo(_entry->nvsEntry) != 0;
+}
+
+// 2nd pass: diffs the backup against the current assignments. Nothing is written.
+static bool Web_NvsImportDiffCallback(const nvs_t *entry, const uint32_t line, void *data) {
+	bool isNew;
+	if (!Web_NvsImportIsLatest(*static_cast<const NvsImportKeys *>(data), entry, line)) {
+		return true;
+	}
+	if (!Web_NvsEntryDiffers(entry, &isNew)) {
+		Web_NvsImport.unchanged++;
+	} else if (Web_NvsEntryIsDeletion(entry)) {
+		Web_NvsImport.removed++;
+		Log_Printf(LOGLEVEL_INFO, "NVS-import (-) %s", entry->nvsKey);
+	} else if (isNew) {
+		Web_NvsImport.added++;
+		Log_Printf(LOGLEVEL_INFO, "NVS-import (+) %s => %s", entry->nvsKey, entry->nvsEntry);
+	} else {
+		Web_NvsImport.changed++;
+		Log_Printf(LOGLEVEL_INFO, "NVS-import (~) %s => %s", entry->nvsKey, entry->nvsEntry);
+	}
+	return true;
+}
+
+typedef struct {
+	const NvsImportKeys *keys;
+	nvs_handle_t handle;
+} nvsImportCommit_t;
+
+// 3rd pass: writes the new/changed entries and erases the deleted ones
+static bool Web_NvsImportCommitCallback(const nvs_t *entry, const uint32_t line, void *data) {
+	constexpr uint16_t nvsImportProgressInterval = 32; // entries
+	const nvsImportCommit_t *commit = static_cast<const nvsImportCommit_t *>(data);
+	bool isNew;
+
+	if (!Web_NvsImportIsLatest(*commit->keys, entry, line) || !Web_NvsEntryDiffers(entry, &isNew)) {
+		return true;
+	}
+	Log_Printf(LOGLEVEL_NOTICE, writeEntryToNvs, Web_NvsImport.processed + 1, entry->nvsKey, entry->nvsEntry);
+	const esp_err_t err = Web_NvsEntryIsDeletion(entry) ? nvs_erase_key(commit->handle, entry->nvsKey) : nvs_set_str(commit->handle, entry->nvsKey, entry->nvsEntry);
+	if (err != ESP_OK) {
+		return false;
+	}
+	Web_NvsImport.processed++;
+	if ((Web_NvsImport.processed % nvsImportProgressInterval) == 0) {
+		esp_task_wdt_reset();
+		Web_SendWebsocketData(0, WebsocketCodeType::NvsImportProgress);
+	}
+	return true;
+}
+
+// Parses content of temporary backup-file and writes payload into NVS.
+// NVS has no transactions (every nvs_set_str() goes to flash right away), so the whole file is checked
+// first: a single invalid line rejects the backup before anything is written. Then it's diffed against
+// the current assignments and only new/changed/deleted entries are written. With _dryRun nothing is written at all.
+bool Web_DumpSdToNvs(const char *_filename, const bool _dryRun) {
+	File tmpFile = gFSystem.open(_filename);
+
+	Web_NvsImport = {};
+	Web_NvsImport.dryRun = _dryRun;
+	if (!tmpFile || (tmpFile.available() < 3)) {
+		Log_Println(errorReadingTmpfile, LOGLEVEL_ERROR);
+		Web_NvsImport.failed = true;
+		return false;
+	}
+
+	Web_NvsImport.running = true;
+	NvsImportKeys keys;
+	bool success = Web_ParseNvsBackup(tmpFile, Web_NvsImportCollectCallback, &keys);
+	if (success) {
+		Web_NvsImportDeduplicate(keys);
+		success = Web_ParseNvsBackup(tmpFile, Web_NvsImportDiffCallback, &keys);
+	}
+	Log_Printf(LOGLEVEL_NOTICE, nvsImportSummary, Web_NvsImport.added, Web_NvsImport.changed, Web_NvsImport.removed, Web_NvsImport.unchanged, Web_NvsImport.invalid);
+	Web_SendWebsocketData(0, WebsocketCodeType::NvsImportProgress);
+
+	if (success && !_dryRun && (Web_NvsImport.added + Web_NvsImport.changed + Web_NvsImport.removed) > 0) {
+		nvsImportCommit_t commit = {&keys, 0};
+		if (nvs_open("rfidTags", NVS_READWRITE, &commit.handle) != ESP_OK) {
+			success = false;
+		} else {
+			Led_SetPause(true); // Workaround to prevent exceptions due to Neopixel-signalisation while NVS-write
+			success = Web_ParseNvsBackup(tmpFile, Web_NvsImportCommitCallback, &commit);
+			success = (nvs_commit(commit.handle) == ESP_OK) && success;
+			nvs_close(commit.handle);
+			Led_SetPause(false);
+			Web_RfidBackupSnapshotOutdated = true;
+			Web_RfidBackupLastChangeTimestamp = millis();
+		}
+	}
 
-	Led_SetPause(false);
-	Log_Printf(LOGLEVEL_NOTICE, importCountNokNvs, invalidCount);
+	if (!success) {
+		Log_Println(errorReadingTmpfile, LOGLEVEL_ERROR);
+	}
+	Web_NvsImport.running = false;
+	Web_NvsImport.failed = !success;
+	Web_SendWebsocketData(0, WebsocketCodeType::NvsImportProgress);
 	tmpFile.close();
 	gFSystem.remove(_filename);
+	return success;
 }
 
 // handle album cover image request
@@ -16,6 +16,7 @@ typedef enum class WebsocketCode {
 	NotAllowedInCurrentMode,
 	BluetoothScanInProgress,
 	BluetoothScanComplete,
+	NvsImportProgress,
 	// Request was a read-only data fetch (ssids/settings/trackinfo/coverimg/volume/...) that
 	// already sent its own specific response - the caller should not also forward Ok/an ack
 	// for it, unlike a genuine settings-save or control action.
@@ -4,11 +4,13 @@
 #include "Wlan.h"
 
 #include "AudioPlayer.h"
+#include "CommandBus.h"
 #include "Log.h"
 #include "MemX.h"
+#include "Metrics.h"
 #include "Mqtt.h"
-#include "Queues.h"
 #include "RotaryEncoder.h"
+#include "Scheduler.h"
 #include "System.h"
 #include "Web.h"
 #include "esp_sntp.h"
@@ -52,6 +54,10 @@ static uint8_t connectionAttemptCounter = 0;
 static unsigned long connectStartTimestamp = 0;
 static uint32_t connectionFailedTimestamp = 0;
 
+// for /metrics
+static uint32_t wifiConnects = 0;
+static uint32_t wifiConnectionsLost = 0;
+
 // diagnostics of the running/last connection attempt. The state machine only
 // polls WiFi.status(), which never surfaces WHY an attempt failed — the 802.11
 // reason code (wrong password vs. network not found vs. AP refused) only
@@ -337,6 +343,17 @@ void Wlan_Init(void) {
 	},
 		WiFiEvent_t::ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 
+	Metrics_Register("wifi_connects_total", MetricType::Counter, "Successful connections to a WiFi", &wifiConnects);
+	Metrics_Register("wifi_connections_lost_total", MetricType::Counter, "Established WiFi-connections that were lost", &wifiConnectionsLost);
+	Metrics_Register("wifi_connected", MetricType::Gauge, "1 if connected to a WiFi", [](metricsWriter_t &out) {
+		Metrics_Sample(out, Wlan_IsConnected() ? 1 : 0);
+	});
+	Metrics_Register("wifi_rssi_dbm", MetricType::Gauge, "Signal strength of the WiFi (only if connected)", [](metricsWriter_t &out) {
+		if (Wlan_IsConnected()) {
+			Metrics_Sample(out, Wlan_GetRssi());
+		}
+	});
+
 	wifiState = WIFI_STATE_INIT;
 	handleWifiStateInit();
 }
@@ -554,7 +571,7 @@ void handleWifiStateConnectionSuccess() {
 	if (gRetryRfidOnWifiConnect) {
 		gRetryRfidOnWifiConnect = false;
 		if (gPlayProperties.playMode == NO_PLAYLIST && strlen(gRetryRfidTagId) > 0) {
-			if (xQueueSend(gRfidCardQueue, gRetryRfidTagId, 0) == pdPASS) {
+			if (CommandBus_PostRfidCard(gRetryRfidTagId, CommandSource::System)) {
 				Log_Printf(LOGLEVEL_NOTICE, retryRfidAfterWifiConnect, gRetryRfidTagId);
 			} else {
 				Log_Println(retryRfidQueueFull, LOGLEVEL_ERROR);
@@ -568,6 +585,7 @@ void handleWifiStateConnectionSuccess() {
 		gPrefsSettings.remove(nvsFailSsidKey);
 	}
 
+	wifiConnects++;
 	wifiState = WIFI_STATE_CONNECTED;
 	Mqtt_OnWifiConnected();
 }
@@ -582,10 +600,12 @@ void handleWifiStateConnected() {
 			break;
 		case WL_NO_SSID_AVAIL:
 			// is set if reconnect failed and network is not found
+			wifiConnectionsLost++;
 			wifiState = WIFI_STATE_DISCONNECTED;
 			return;
 		case WL_DISCONNECTED:
 			// is set if reconnect failed for other reason
+			wifiConnectionsLost++;
 			wifiState = WIFI_STATE_DISCONNECTED;
 			return;
 		default:
@@ -710,6 +730,9 @@ void handleWifiStateAP() {
 }
 
 void Wlan_Cyclic(void) {
+	// The DNS-server of the captive portal needs to be served often; everything else only has timeouts of seconds
+	Scheduler_SetPeriod(LoopHandler::Wlan, (wifiState == WIFI_STATE_AP) ? 10u : 100u);
+
 	switch (wifiState) {
 		case WIFI_STATE_INIT:
 			handleWifiStateInit();
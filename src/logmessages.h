@@ -38,7 +38,6 @@ extern const char trackStart[];
 extern const char trackChangeWebstream[];
 extern const char endOfPlaylistReached[];
 extern const char trackStartatPos[];
-extern const char waitingForTaskQueues[];
 extern const char rfidScannerReady[];
 extern const char rfidTagDetected[];
 extern const char rfid15693TagDetected[];
@@ -186,7 +185,8 @@ extern const char playlistGen[];
 extern const char playlistRecDepth[];
 extern const char bootLoopDetected[];
 extern const char noBootLoopDetected[];
-extern const char importCountNokNvs[];
+extern const char nvsImportInvalidLine[];
+extern const char nvsImportSummary[];
 extern const char errorReadingTmpfile[];
 extern const char errorWritingTmpfile[];
 extern const char eraseRfidNvs[];
@@ -219,11 +219,13 @@ extern const char secondsJumpForward[];
 extern const char secondsJumpBackward[];
 extern const char JumpToPosition[];
 extern const char wroteLastTrackToNvs[];
+extern const char playPosJournalCompacted[];
 extern const char wifiConnectionInProgress[];
 extern const char wifiConnectionSuccess[];
 extern const char wifiCurrentIp[];
 extern const char jsonErrorMsg[];
 extern const char jsonbufferOverflow[];
+extern const char logMessagesDropped[];
 extern const char wifiDeleteNetwork[];
 extern const char wifiAddTooManyNetworks[];
 extern const char wifiAddNetwork[];
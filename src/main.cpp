@@ -4,17 +4,21 @@
 
 #include "main.h"
 
+#include "Announcement.h"
 #include "AudioPlayer.h"
 #include "Battery.h"
 #include "Bluetooth.h"
 #include "Button.h"
 #include "Cmd.h"
+#include "CommandBus.h"
 #include "Common.h"
 #include "Ftp.h"
 #include "HallEffectSensor.h"
+#include "HeapProfiler.h"
 #include "IrReceiver.h"
 #include "Led.h"
 #include "Log.h"
+#include "LogSd.h"
 #include "MemX.h"
 #include "Mqtt.h"
 #include "Port.h"
@@ -24,7 +28,11 @@
 #include "RfidConfig.h"
 #include "RotaryEncoder.h"
 #include "SdCard.h"
+#include "Scheduler.h"
+#include "SeekIndex.h"
+#include "SettingsRegistry.h"
 #include "System.h"
+#include "TaskMonitor.h"
 #include "Web.h"
 #include "Wlan.h"
 #include "gitrevision.h"
@@ -106,14 +114,27 @@ void recoverLastRfidPlayedFromNvs(bool force) {
 		if (!lastRfidPlayed.compareTo("-1")) {
 			Log_Println(unableToRestoreLastRfidFromNVS, LOGLEVEL_INFO);
 		} else {
-			xQueueSend(gRfidCardQueue, lastRfidPlayed.c_str(), 0);
+			CommandBus_PostRfidCard(lastRfidPlayed.c_str(), CommandSource::System);
 			Log_Printf(LOGLEVEL_INFO, restoredLastRfidFromNVS, lastRfidPlayed.c_str());
 		}
 	}
 }
 
+static void recoverLastRfidCyclic(void) {
+	recoverBootCountFromNvs();
+	recoverLastRfidPlayedFromNvs();
+}
+
 void setup() {
 	Log_Init();
+#ifdef HEAP_PROFILER_ENABLE
+	HeapProfiler_Init();
+#endif
+#ifdef TASK_MONITOR_ENABLE
+	TaskMonitor_Init();
+#endif
+	Scheduler_Init();
+	CommandBus_Init();
 	Queues_Init();
 
 	// Make sure all wakeups can be enabled *before* initializing RFID, which can enter sleep immediately
@@ -158,6 +179,11 @@ void setup() {
 
 	// Needs power first
 	SdCard_Init();
+#ifdef LOG_SD_ENABLE
+	LogSd_Start();
+#endif
+	Announcement_Init();
+	SeekIndex_Init();
 
 	// welcome message
 	Serial.print(logo);
@@ -218,43 +244,32 @@ void setup() {
 #ifdef CONTROLS_LOCKED_BY_DEFAULT
 	System_SetLockControls(true);
 #endif
-}
 
-void loop() {
-	Wlan_Cyclic();
-	Web_Cyclic();
-	if (OPMODE_BLUETOOTH_SINK == System_GetOperationMode()) {
-		// bluetooth speaker mode
-		Bluetooth_Cyclic();
-	} else if (OPMODE_BLUETOOTH_SOURCE == System_GetOperationMode()) {
-		// bluetooth headset mode
-		Bluetooth_Cyclic();
+	// Handlers of the main-loop with their period (0: only when signalled)
+	Scheduler_Register(LoopHandler::Wlan, Wlan_Cyclic, 100u); // faster in AP-mode, see Wlan_Cyclic()
+	Scheduler_Register(LoopHandler::Web, Web_Cyclic, 100u);
+	if (System_GetOperationMode() == OPMODE_BLUETOOTH_SINK || System_GetOperationMode() == OPMODE_BLUETOOTH_SOURCE) {
+		Scheduler_Register(LoopHandler::Bluetooth, Bluetooth_Cyclic, 20u);
 	}
-	RotaryEncoder_Cyclic();
-	Ftp_Cyclic();
-	AudioPlayer_Cyclic();
-	Battery_Cyclic();
-	Button_Cyclic();
-	System_Cyclic();
-	Rfid_PreferenceLookupHandler();
-
-	bool playLastRfidAfterReboot;
-#ifdef PLAY_LAST_RFID_AFTER_REBOOT
-	playLastRfidAfterReboot = gPrefsSettings.getBool("playLastOnBoot", true);
-#else
-	playLastRfidAfterReboot = gPrefsSettings.getBool("playLastOnBoot", false);
-#endif
-
-	if (playLastRfidAfterReboot) {
-		recoverBootCountFromNvs();
-		recoverLastRfidPlayedFromNvs();
+	Scheduler_Register(LoopHandler::RotaryEncoder, RotaryEncoder_Cyclic, 0u); // signalled by the encoder-interrupt and button-changes
+	Scheduler_Register(LoopHandler::Ftp, Ftp_Cyclic, 500u); // faster while the server is running, see Ftp_Cyclic()
+	Scheduler_Register(LoopHandler::AudioPlayer, AudioPlayer_Cyclic, 50u);
+	Scheduler_Register(LoopHandler::Battery, Battery_Cyclic, 1000u);
+	Scheduler_Register(LoopHandler::Button, Button_Cyclic, 10u); // first scan; then signalled by pin-interrupts, polled only while busy
+	Scheduler_Register(LoopHandler::System, System_Cyclic, 100u);
+	Scheduler_Register(LoopHandler::SettingsRegistry, SettingsRegistry_Cyclic, 500u);
+	Scheduler_Register(LoopHandler::CommandBus, CommandBus_Cyclic, 0u); // signalled by every post
+	if (SettingsRegistry_GetBool(SettingId::PlayLastRfidOnReboot)) {
+		Scheduler_Register(LoopHandler::RecoverLastRfid, recoverLastRfidCyclic, 1000u);
 	}
-
-	IrReceiver_Cyclic();
-
+#ifdef IR_CONTROL_ENABLE
+	Scheduler_Register(LoopHandler::IrReceiver, IrReceiver_Cyclic, 20u);
+#endif
 #ifdef HALLEFFECT_SENSOR_ENABLE
-	gHallEffectSensor.cyclic();
+	Scheduler_Register(LoopHandler::HallEffectSensor, [] { gHallEffectSensor.cyclic(); }, 20u);
 #endif
+}
 
-	vTaskDelay(portTICK_PERIOD_MS * 6u);
+void loop() {
+	Scheduler_Run();
 }
@@ -54,6 +54,10 @@
 	//#define DONT_ACCEPT_SAME_RFID_TWICE   // RFID-reader doesn't accept the same RFID-tag twice in a row (unless it's a modification-card or RFID-tag is unknown in NVS). Flag will be ignored silently if PAUSE_WHEN_RFID_REMOVED is active. (https://forum.espuino.de/t/neues-feature-dont-accept-same-rfid-twice/1247)
 	//#define RESUME_ON_SAME_RFID          // If playback is paused and the same RFID is detected again, playback resumes (only in combination with DONT_ACCEPT_SAME_RFID_TWICE)
 	//#define HALLEFFECT_SENSOR_ENABLE      // Support for hallsensor. For fine-tuning please adjust HallEffectSensor.h Please note: only user-support provided (https://forum.espuino.de/t/magnetische-hockey-tags/1449/35)
+	//#define LOOP_PROFILER_ENABLE          // Measures the runtime of every *_Cyclic-handler of the main-loop (cycle-counter, min/avg/p99/max and histogram); results in /debug and via MQTT (topic loop_profile)
+	//#define HEAP_PROFILER_ENABLE          // Tracks every allocation per task/module (live bytes, peak, lifetimes), samples the largest free blocks and logs failed allocations with a backtrace; results in /debug/heap. Needs CONFIG_HEAP_USE_HOOKS (added by updateSdkConfig.py if this is defined), costs ~28 KB of internal RAM
+	//#define TASK_MONITOR_ENABLE           // Stack-usage (maximum of all boots kept in NVS) with a recommended stack-size, CPU-share per task, busy-time and task-switches per core; results in /debug/tasks, reclaimable stack is logged 10 minutes after boot. Needs CONFIG_FREERTOS_USE_TRACE_FACILITY (sdkconfig.defaults)
+	//#define LOG_SD_ENABLE                 // Writes the log to SD (/.logs/espuino-0.log, rotated by size; survives crashes and restarts). Older files can be downloaded via /log?file=1 etc.
 
 	//################## set PAUSE_WHEN_RFID_REMOVED behaviour #############################
 	#ifdef PAUSE_WHEN_RFID_REMOVED
@@ -160,7 +164,7 @@
 	//#################### Various settings ##############################
 
 	// Serial-logging-configuration
-	#define SERIAL_LOGLEVEL LOGLEVEL_DEBUG              // Current loglevel for serial console
+	#define SERIAL_LOGLEVEL LOGLEVEL_DEBUG              // Default loglevel (can be changed in the web-interface)
 
     // DEPRECATED: This is now done using dynamic network configuration.
     //              If left, it is used for the automatic migration exactly once
@@ -209,7 +213,7 @@
 	constexpr const char nameBluetoothSinkDevice[] = "ESPuino";        // Name of your ESPuino as Bluetooth-device
 
 	// Where to store the backup-file for NVS-records
-	constexpr const char backupFile[] = "/backup.txt"; // File is written every time a (new) RFID-assignment via GUI is done
+	constexpr const char backupFile[] = "/backup.txt"; // Snapshot of all RFID-assignments; changes are collected in /backup.log and merged when idle
 
 	//#################### Settings for optional Modules##############################
 	// (optinal) Neopixel
@@ -287,6 +291,9 @@
 		constexpr const char topicBatteryVoltage[] = "battery_voltage"; // State: battery voltage float (e.g. 3.81)
 		constexpr const char topicBatterySOC[]     = "battery_soc"; // State: battery charge percent (e.g. 83.0)
 		#endif
+		#ifdef LOOP_PROFILER_ENABLE
+		constexpr const char topicLoopProfile[] = "loop_profile"; // State: JSON with runtime of the main-loop's handlers (once a minute)
+		#endif
 	#endif
 
 	// !!! MAKE SURE TO EDIT PLATFORM SPECIFIC settings-****.h !!!
@@ -60,6 +60,8 @@
 #define CMD_TOGGLE_AMBIENT_LIGHT		 153 // Command: toggles the ambient light
 #define CMD_BRIGHTNESS_UP				 154 // Command: raise LED-brightness by one step
 #define CMD_BRIGHTNESS_DOWN				 155 // Command: lower LED-brightness by one step
+#define CMD_TELL_BATTERY_LEVEL			 156 // Command: ESPuino announces battery-level via speech
+#define CMD_TELL_SLEEP_TIMER			 157 // Command: ESPuino announces remaining time of sleep-timer via speech
 
 #define CMD_PLAYPAUSE	   170 // Command: play/pause
 #define CMD_PREVTRACK	   171 // Command: previous track
@@ -103,9 +105,11 @@
 #define SEEK_POS_PERCENT 3 // Seek to position (0-100)
 
 // TTS
-#define TTS_NONE		 0 // Do nothng (IDLE)
-#define TTS_IP_ADDRESS	 1 // Tell IP-address
-#define TTS_CURRENT_TIME 2 // Tell current time
+#define TTS_NONE		  0 // Do nothng (IDLE)
+#define TTS_IP_ADDRESS	  1 // Tell IP-address
+#define TTS_CURRENT_TIME  2 // Tell current time
+#define TTS_BATTERY_LEVEL 3 // Tell battery-level
+#define TTS_SLEEP_TIMER	  4 // Tell remaining time of sleep-timer
 
 // supported languages
 #define DE 1
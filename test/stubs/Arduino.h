@@ -0,0 +1,73 @@
+#pragma once
+
+// Minimal stand-in for the Arduino-core, so modules without hardware-access can be compiled by the host-tests
+// (pio test -e native). Time is controlled by the test via Stub_SetMillis()/Stub_SetMicros().
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// used by the settings of the boards
+typedef enum {
+	ADC_0db,
+	ADC_2_5db,
+	ADC_6db,
+	ADC_11db,
+} adc_attenuation_t;
+
+inline uint32_t Stub_Millis = 0u;
+inline uint32_t Stub_Micros = 0u;
+
+inline uint32_t millis(void) {
+	return Stub_Millis;
+}
+
+inline uint32_t micros(void) {
+	return Stub_Micros;
+}
+
+inline void Stub_SetMillis(const uint32_t ms) {
+	Stub_Millis = ms;
+	Stub_Micros = ms * 1000u;
+}
+
+// Cycle-counter of the CPU: nanoseconds of the host, so benchmarks give plausible numbers. A test that needs exact
+// numbers freezes it and sets Stub_CycleCount itself.
+inline bool Stub_CycleCountFrozen = false;
+inline uint32_t Stub_CycleCount = 0u;
+inline uint32_t Stub_CpuFrequencyMhz = 240u;
+
+class EspClass {
+public:
+	uint32_t getCycleCount(void) {
+		if (Stub_CycleCountFrozen) {
+			return Stub_CycleCount;
+		}
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint32_t>(static_cast<uint64_t>(now.tv_sec) * 1000000000u + now.tv_nsec);
+	}
+};
+inline EspClass ESP;
+
+inline uint32_t getCpuFrequencyMhz(void) {
+	return Stub_CpuFrequencyMhz;
+}
+
+// PSRAM is off by default; a test can switch it on and let its allocations fail
+inline bool Stub_PsramFound = false;
+inline bool Stub_PsMallocFails = false;
+
+inline bool psramFound(void) {
+	return Stub_PsramFound;
+}
+
+inline void *ps_malloc(const size_t size) {
+	return Stub_PsMallocFails ? nullptr : malloc(size);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// ESP-class of the Arduino-core: part of the Arduino.h-stub
+
+#include <Arduino.h>
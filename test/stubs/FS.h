@@ -0,0 +1,230 @@
+#pragma once
+
+// Minimal stand-in for the file-system of the Arduino-core: the files are kept in memory (Stub_Files), a test creates
+// them directly. Only what the modules under test use is there.
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class String : public std::string {
+public:
+	String() = default;
+	String(const char *str)
+		: std::string(str ? str : "") { }
+	String(const std::string &str)
+		: std::string(str) { }
+
+	explicit operator bool() const {
+		return !empty();
+	}
+
+	bool concat(const char *str) {
+		append(str);
+		return true;
+	}
+	bool concat(const std::string &str) {
+		append(str);
+		return true;
+	}
+
+	String substring(const size_t from, const size_t to = npos) const {
+		return (from < size()) ? String(substr(from, (to == npos || to < from) ? npos : to - from)) : String();
+	}
+
+	int lastIndexOf(const char c) const {
+		return static_cast<int>(rfind(c));
+	}
+	int lastIndexOf(const char c, const int from) const {
+		return (from < 0) ? -1 : static_cast<int>(rfind(c, from));
+	}
+
+	long toInt(void) const {
+		return strtol(c_str(), nullptr, 10);
+	}
+
+	// Print-interface, e.g. for serializeJson()
+	size_t write(const uint8_t c) {
+		push_back(static_cast<char>(c));
+		return 1;
+	}
+	size_t write(const uint8_t *str, const size_t size) {
+		append(reinterpret_cast<const char *>(str), size);
+		return size;
+	}
+};
+
+inline std::map<std::string, std::vector<uint8_t>> Stub_Files;
+
+namespace fs {
+
+class File {
+public:
+	File() = default;
+	File(const std::string &path, const bool write, const bool append = false)
+		: path_(path)
+		, open_(true) {
+		if (write) {
+			Stub_Files[path].clear();
+		}
+		if (append) {
+			pos_ = Stub_Files[path].size();
+		}
+	}
+
+	explicit operator bool() const {
+		return open_;
+	}
+
+	size_t size() const {
+		return open_ ? Stub_Files[path_].size() : 0;
+	}
+
+	bool seek(const uint32_t pos) {
+		if (!open_ || pos > size()) {
+			return false;
+		}
+		pos_ = pos;
+		return true;
+	}
+
+	size_t read(uint8_t *buf, const size_t size) {
+		if (!open_) {
+			return 0;
+		}
+		const std::vector<uint8_t> &data = Stub_Files[path_];
+		const size_t count = std::min(size, data.size() - pos_);
+		memcpy(buf, data.data() + pos_, count);
+		pos_ += count;
+		return count;
+	}
+
+	size_t write(const uint8_t *buf, const size_t size) {
+		if (!open_) {
+			return 0;
+		}
+		std::vector<uint8_t> &data = Stub_Files[path_];
+		data.resize(std::max(data.size(), pos_ + size));
+		memcpy(data.data() + pos_, buf, size);
+		pos_ += size;
+		return size;
+	}
+
+	int available(void) {
+		return open_ ? static_cast<int>(size() - pos_) : 0;
+	}
+
+	String readStringUntil(const char terminator) {
+		String str;
+		uint8_t c;
+		while (read(&c, 1) == 1 && c != terminator) {
+			str.push_back(static_cast<char>(c));
+		}
+		return str;
+	}
+
+	size_t printf(const char *format, ...) {
+		char buf[256];
+		va_list args;
+		va_start(args, format);
+		const int len = vsnprintf(buf, sizeof(buf), format, args);
+		va_end(args);
+		return (len > 0) ? write(reinterpret_cast<const uint8_t *>(buf), std::min<size_t>(len, sizeof(buf) - 1)) : 0;
+	}
+
+	void close(void) {
+		open_ = false;
+	}
+
+	const char *name(void) const {
+		return path_.c_str();
+	}
+
+	const char *path(void) const {
+		return path_.c_str();
+	}
+
+	String getNextFileName(bool *isDir = nullptr) {
+		if (isDir) {
+			*isDir = false;
+		}
+		return String();
+	}
+
+private:
+	std::string path_;
+	size_t pos_ = 0;
+	bool open_ = false;
+};
+
+class FS {
+public:
+	File open(const char *path, const char *mode = FILE_READ, const bool = false) {
+		const bool write = (mode[0] == 'w');
+		const bool append = (mode[0] == 'a');
+		if (!write && !append && !Stub_Files.count(path)) {
+			return File();
+		}
+		return File(path, write, append);
+	}
+	File open(const String &path, const char *mode = FILE_READ, const bool create = false) {
+		return open(path.c_str(), mode, create);
+	}
+
+	bool exists(const char *path) {
+		return Stub_Files.count(path);
+	}
+	bool exists(const String &path) {
+		return exists(path.c_str());
+	}
+
+	bool rename(const char *pathFrom, const char *pathTo) {
+		if (!Stub_Files.count(pathFrom)) {
+			return false;
+		}
+		Stub_Files[pathTo] = Stub_Files[pathFrom];
+		Stub_Files.erase(pathFrom);
+		return true;
+	}
+	bool rename(const String &pathFrom, const String &pathTo) {
+		return rename(pathFrom.c_str(), pathTo.c_str());
+	}
+
+	bool remove(const char *path) {
+		return Stub_Files.erase(path);
+	}
+	bool remove(const String &path) {
+		return remove(path.c_str());
+	}
+
+	bool mkdir(const char *) {
+		return true;
+	}
+	bool mkdir(const String &) {
+		return true;
+	}
+
+	bool rmdir(const char *) {
+		return true;
+	}
+	bool rmdir(const String &) {
+		return true;
+	}
+
+	const char *mountpoint() {
+		return "/";
+	}
+};
+
+} // namespace fs
+
+using fs::File;
@@ -0,0 +1,16 @@
+#pragma once
+
+// Definitions for the logging of the modules under test (src/Log.h): nothing is logged by the host-tests.
+// Include it once per test-program.
+
+#include <Arduino.h>
+
+#include "Log.h"
+
+uint8_t gLogLevel = 0;
+
+void Log_RecordText(const char *, const uint8_t, const bool, const bool) {
+}
+
+void Log_Record(const uint8_t, const char *, ...) {
+}
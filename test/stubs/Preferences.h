@@ -0,0 +1,47 @@
+#pragma once
+
+// NVS of the Arduino-core for the host-tests: the keys are kept in memory, a test can read and preset them directly
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+	int8_t getChar(const char *key, const int8_t defaultValue = 0) {
+		const auto it = values.find(key);
+		return (it != values.end() && it->second.size() == 1) ? static_cast<int8_t>(it->second[0]) : defaultValue;
+	}
+
+	size_t getBytesLength(const char *key) {
+		const auto it = values.find(key);
+		return (it != values.end()) ? it->second.size() : 0;
+	}
+
+	size_t getBytes(const char *key, void *buf, const size_t maxLen) {
+		const auto it = values.find(key);
+		if (it == values.end() || it->second.size() > maxLen) {
+			return 0;
+		}
+		memcpy(buf, it->second.data(), it->second.size());
+		return it->second.size();
+	}
+
+	size_t putBytes(const char *key, const void *value, const size_t len) {
+		const uint8_t *bytes = static_cast<const uint8_t *>(value);
+		values[key].assign(bytes, bytes + len);
+		return len;
+	}
+
+	bool isKey(const char *key) {
+		return values.count(key);
+	}
+
+	bool remove(const char *key) {
+		return values.erase(key);
+	}
+
+	std::map<std::string, std::vector<uint8_t>> values;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+// A single data-partition in RAM that behaves like NOR-flash: erasing sets whole sectors to 0xFF, writing can only
+// clear bits. Stub_PartitionPresent decides whether esp_partition_find_first() finds it; Stub_WriteLimit cuts a
+// write after that many bytes (a reset in the middle of it).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK	 0
+#define ESP_FAIL -1
+
+typedef enum {
+	ESP_PARTITION_TYPE_APP = 0x00,
+	ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+	ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+	esp_partition_type_t type;
+	uint32_t address;
+	uint32_t size;
+	uint32_t erase_size;
+	char label[17];
+} esp_partition_t;
+
+inline esp_partition_t Stub_Partition = {ESP_PARTITION_TYPE_DATA, 0x3b0000u, 0x10000u, 4096u, "ppjournal"};
+inline bool Stub_PartitionPresent = true;
+inline std::vector<uint8_t> Stub_Flash(0x10000u, 0xFF);
+inline size_t Stub_WriteLimit = SIZE_MAX;
+inline uint32_t Stub_Erases = 0u;
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t, const char *label) {
+	if (!Stub_PartitionPresent || type != Stub_Partition.type || (label && strcmp(label, Stub_Partition.label))) {
+		return nullptr;
+	}
+	return &Stub_Partition;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *, size_t offset, void *dst, size_t size) {
+	if (offset + size > Stub_Flash.size()) {
+		return ESP_FAIL;
+	}
+	memcpy(dst, &Stub_Flash[offset], size);
+	return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *, size_t offset, const void *src, size_t size) {
+	if (offset + size > Stub_Flash.size()) {
+		return ESP_FAIL;
+	}
+	const uint8_t *bytes = static_cast<const uint8_t *>(src);
+	for (size_t i = 0; i < size && i < Stub_WriteLimit; i++) {
+		Stub_Flash[offset + i] &= bytes[i];
+	}
+	return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+	if ((offset % partition->erase_size) || (size % partition->erase_size) || offset + size > Stub_Flash.size()) {
+		return ESP_FAIL;
+	}
+	memset(&Stub_Flash[offset], 0xFF, size);
+	Stub_Erases++;
+	return ESP_OK;
+}
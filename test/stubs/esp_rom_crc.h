@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Same result as the ROM-function (CRC-32, reflected, like zlib's crc32())
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, size_t len) {
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (uint8_t i = 0; i < 8; i++) {
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
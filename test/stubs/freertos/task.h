@@ -0,0 +1,31 @@
+#pragma once
+
+// FreeRTOS for the host-tests: there's one thread, so tasks are never started and critical sections are empty
+
+#include <stdint.h>
+
+typedef void *TaskHandle_t;
+typedef unsigned int UBaseType_t;
+typedef struct {
+	int owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) (void) (mux)
+#define portEXIT_CRITICAL(mux) (void) (mux)
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdTRUE 1
+
+inline void vTaskDelay(const uint32_t) {
+}
+
+inline uint32_t ulTaskNotifyTake(const int, const uint32_t) {
+	return 0;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t) {
+}
+
+inline int xTaskCreatePinnedToCore(void (*)(void *), const char *, const uint32_t, void *, const UBaseType_t, TaskHandle_t *, const int) {
+	return 0;
+}
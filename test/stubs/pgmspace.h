@@ -0,0 +1,5 @@
+#pragma once
+
+// Flash is plain memory on the host
+#define PROGMEM
+#define pgm_read_float(addr) (*(const float *) (addr))
@@ -0,0 +1,180 @@
+#include <unity.h>
+
+#include <freertos/task.h>
+
+#include "LogStub.h"
+
+#include "Equalizer.cpp"
+
+#include <vector>
+
+// Equalizer: the fixed-point cascade has to have the response of its design (sines through the filters), boosts of
+// the profile are taken back by the preamp while the plain tone-control keeps its level, and a buffer at another
+// sample-rate gets the preamp at least. The benchmark prints the time per frame of a full cascade.
+
+Preferences gPrefsSettings;
+
+constexpr uint32_t testSampleRate = 44100u;
+constexpr int16_t testBufferFrames = 1152;
+constexpr float testAmplitude = 0.25f;
+
+static std::vector<int32_t> Test_Buffer(2 * testBufferFrames);
+
+static void Test_FillSine(const float hz, uint64_t &frame) {
+	for (int16_t i = 0; i < testBufferFrames; i++, frame++) {
+		const int32_t x = lroundf(testAmplitude * sinf(2.0f * static_cast<float>(M_PI) * hz * frame / testSampleRate) * 2147483647.0f);
+		Test_Buffer[2 * i] = x;
+		Test_Buffer[2 * i + 1] = x;
+	}
+}
+
+// Gain (dB) of the cascade for a sine, measured after the filters have settled
+static float Test_GainDb(const float hz) {
+	uint64_t frame = 0;
+	double energyIn = 0.0, energyOut = 0.0;
+	for (uint16_t buffer = 0; buffer < 40u; buffer++) {
+		Test_FillSine(hz, frame);
+		double in = 0.0;
+		for (int16_t i = 0; i < testBufferFrames; i++) {
+			in += static_cast<double>(Test_Buffer[2 * i]) * Test_Buffer[2 * i];
+		}
+		TEST_ASSERT_TRUE(Equalizer_Process(Test_Buffer.data(), testBufferFrames, testSampleRate));
+		if (buffer >= 20u) {
+			energyIn += in;
+			for (int16_t i = 0; i < testBufferFrames; i++) {
+				TEST_ASSERT_EQUAL_INT32(Test_Buffer[2 * i], Test_Buffer[2 * i + 1]);
+				energyOut += static_cast<double>(Test_Buffer[2 * i]) * Test_Buffer[2 * i];
+			}
+		}
+	}
+	return 10.0f * log10f(energyOut / energyIn);
+}
+
+static void Test_SetBand(const uint16_t freqHz, const int16_t gainCb, const uint16_t q100, const EqualizerBandType type) {
+	const equalizerBand_t band = {freqHz, gainCb, q100, type, 0u};
+	TEST_ASSERT_TRUE(Equalizer_SetBands(EqualizerProfile::Speaker, &band, 1u));
+}
+
+void setUp(void) {
+	Equalizer_SetTone(0, 0, 0);
+	Equalizer_SetBands(EqualizerProfile::Speaker, nullptr, 0u);
+	Equalizer_SetBands(EqualizerProfile::Headphone, nullptr, 0u);
+}
+
+void tearDown(void) {
+}
+
+void test_flat_passes_through(void) {
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	equalizerStats_t stats;
+	Equalizer_GetStats(&stats);
+	TEST_ASSERT_EQUAL_UINT8(0u, stats.stages);
+	uint64_t frame = 0;
+	Test_FillSine(440.0f, frame);
+	const std::vector<int32_t> in = Test_Buffer;
+	TEST_ASSERT_TRUE(Equalizer_Process(Test_Buffer.data(), testBufferFrames, testSampleRate));
+	TEST_ASSERT_EQUAL_INT32_ARRAY(in.data(), Test_Buffer.data(), in.size());
+}
+
+void test_tone_control_has_no_preamp(void) {
+	Equalizer_SetTone(6, 0, -6);
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	equalizerStats_t stats;
+	Equalizer_GetStats(&stats);
+	TEST_ASSERT_EQUAL_UINT8(2u, stats.stages);
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.preampDb);
+	TEST_ASSERT_FLOAT_WITHIN(0.3f, 6.0f, Test_GainDb(60.0f));
+	TEST_ASSERT_FLOAT_WITHIN(0.5f, -6.0f, Test_GainDb(15000.0f));
+}
+
+void test_profile_boost_is_preamped(void) {
+	Test_SetBand(1000u, 60, 100u, EqualizerBandType::Peak);
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	equalizerStats_t stats;
+	Equalizer_GetStats(&stats);
+	TEST_ASSERT_EQUAL_UINT8(1u, stats.stages);
+	TEST_ASSERT_FLOAT_WITHIN(0.05f, -6.0f, stats.preampDb);
+	TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, Test_GainDb(1000.0f));
+	TEST_ASSERT_FLOAT_WITHIN(0.2f, -6.0f, Test_GainDb(60.0f));
+	TEST_ASSERT_FLOAT_WITHIN(0.2f, -6.0f, Test_GainDb(15000.0f));
+}
+
+void test_filters_follow_design(void) {
+	Test_SetBand(1000u, 0, 71u, EqualizerBandType::HighPass);
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	TEST_ASSERT_FLOAT_WITHIN(0.2f, -3.0f, Test_GainDb(1000.0f));
+	TEST_ASSERT_TRUE(Test_GainDb(100.0f) < -35.0f); // 12 dB per octave
+	TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, Test_GainDb(10000.0f));
+
+	Test_SetBand(2000u, -60, 200u, EqualizerBandType::Peak);
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	TEST_ASSERT_FLOAT_WITHIN(0.1f, -6.0f, Test_GainDb(2000.0f));
+	TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, Test_GainDb(200.0f));
+}
+
+void test_other_sample_rate_gets_the_preamp(void) {
+	Test_SetBand(1000u, 60, 100u, EqualizerBandType::Peak);
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	uint64_t frame = 0;
+	Test_FillSine(440.0f, frame);
+	const std::vector<int32_t> in = Test_Buffer;
+	TEST_ASSERT_FALSE(Equalizer_Process(Test_Buffer.data(), testBufferFrames, 48000u));
+	for (size_t i = 0; i < in.size(); i++) {
+		TEST_ASSERT_INT32_WITHIN(1 << 20, lround(in[i] * powf(10.0f, -6.0f / 20.0f)), Test_Buffer[i]);
+	}
+
+	// filtered again with the new coefficients
+	Equalizer_Update(48000u, EqualizerProfile::Speaker);
+	TEST_ASSERT_TRUE(Equalizer_Process(Test_Buffer.data(), testBufferFrames, 48000u));
+}
+
+void test_profiles_are_separate(void) {
+	Test_SetBand(1000u, 60, 100u, EqualizerBandType::Peak);
+	Equalizer_Update(testSampleRate, EqualizerProfile::Headphone);
+	equalizerStats_t stats;
+	Equalizer_GetStats(&stats);
+	TEST_ASSERT_EQUAL_UINT8(0u, stats.stages);
+	TEST_ASSERT_TRUE(stats.profile == EqualizerProfile::Headphone);
+	TEST_ASSERT_EQUAL_UINT32(8u, gPrefsSettings.getBytesLength("eqSpeaker"));
+	TEST_ASSERT_FALSE(gPrefsSettings.isKey("eqHeadphone"));
+}
+
+void test_benchmark_full_cascade(void) {
+	Equalizer_SetTone(3, -2, 4);
+	equalizerBand_t bands[equalizerMaxBands];
+	for (uint8_t i = 0; i < equalizerMaxBands; i++) {
+		bands[i] = {static_cast<uint16_t>(50u << i), static_cast<int16_t>((i % 2u) ? -40 : 50), 140u, EqualizerBandType::Peak, 0u};
+	}
+	TEST_ASSERT_TRUE(Equalizer_SetBands(EqualizerProfile::Speaker, bands, equalizerMaxBands));
+	Equalizer_Update(testSampleRate, EqualizerProfile::Speaker);
+	equalizerStats_t stats;
+	Equalizer_GetStats(&stats);
+	TEST_ASSERT_EQUAL_UINT8(equalizerToneBands + equalizerMaxBands, stats.stages);
+
+	uint64_t frame = 0;
+	uint64_t ns = 0;
+	const uint16_t buffers = 10u * testSampleRate / testBufferFrames;
+	for (uint16_t buffer = 0; buffer < buffers; buffer++) {
+		Test_FillSine(1000.0f, frame);
+		const uint32_t start = ESP.getCycleCount();
+		Equalizer_Process(Test_Buffer.data(), testBufferFrames, testSampleRate);
+		ns += ESP.getCycleCount() - start;
+	}
+	char message[96];
+	snprintf(message, sizeof(message), "%u biquads: %.1f ns per stereo frame (host)", stats.stages, static_cast<double>(ns) / frame);
+	TEST_MESSAGE(message);
+	TEST_ASSERT_TRUE(ns > 0u);
+}
+
+int main(void) {
+	Equalizer_Init();
+	UNITY_BEGIN();
+	RUN_TEST(test_flat_passes_through);
+	RUN_TEST(test_tone_control_has_no_preamp);
+	RUN_TEST(test_profile_boost_is_preamped);
+	RUN_TEST(test_filters_follow_design);
+	RUN_TEST(test_other_sample_rate_gets_the_preamp);
+	RUN_TEST(test_profiles_are_separate);
+	RUN_TEST(test_benchmark_full_cascade);
+	return UNITY_END();
+}
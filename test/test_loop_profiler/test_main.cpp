@@ -0,0 +1,166 @@
+#include <unity.h>
+
+#define LOOP_PROFILER_ENABLE
+
+#include "LogStub.h"
+
+#include <FS.h> // String
+
+#include "LoopProfiler.cpp"
+
+#include <string>
+
+// Loop-profiler: min/avg/p99/max and the log2-histogram have to follow the recorded cycles exactly (the cycle-counter
+// is frozen and set by the test), the worst call is kept, and the MQTT-summary goes out once a minute without the
+// histograms.
+
+const char *Scheduler_GetHandlerName(const LoopHandler id) {
+	return (id == LoopHandler::AudioPlayer) ? "AudioPlayer" : ((id == LoopHandler::Web) ? "Web" : "other");
+}
+
+static std::string Test_MqttTopic;
+static std::string Test_MqttPayload;
+static uint8_t Test_MqttPublished = 0u;
+
+bool publishMqtt(const char *topic, const char *payload, bool) {
+	Test_MqttTopic = topic;
+	Test_MqttPayload = payload;
+	Test_MqttPublished++;
+	return true;
+}
+
+// One call of the handler that takes the given number of cycles
+static void Test_Call(const LoopHandler handler, const uint32_t cycles) {
+	const uint32_t start = Stub_CycleCount;
+	Stub_CycleCount += cycles;
+	LoopProfiler_Record(handler, start);
+}
+
+static JsonObject Test_ToJSON(JsonDocument &doc) {
+	LoopProfiler_ToJSON(doc.to<JsonObject>());
+	return doc.as<JsonObject>();
+}
+
+void setUp(void) {
+	Stub_CycleCountFrozen = true;
+	Stub_CycleCount = 0xFFFFF000u; // wraps while measuring
+	Stub_SetMillis(0u);
+	memset(LoopProfiler_Handlers, 0, sizeof(LoopProfiler_Handlers));
+	memset(&LoopProfiler_Loop, 0, sizeof(LoopProfiler_Loop));
+	LoopProfiler_WorstCycles = 0u;
+	LoopProfiler_WorstHandler = LoopHandler::Count;
+	LoopProfiler_LastMqttTimestamp = 0u;
+	Test_MqttPublished = 0u;
+}
+
+void tearDown(void) {
+}
+
+void test_min_avg_max(void) {
+	Test_Call(LoopHandler::Web, 2400u); // 10 us at 240 MHz
+	Test_Call(LoopHandler::Web, 4800u);
+	Test_Call(LoopHandler::Web, 7200u);
+	const loopProfilerStats_t &stats = LoopProfiler_Handlers[static_cast<uint8_t>(LoopHandler::Web)];
+	TEST_ASSERT_EQUAL_UINT32(3u, stats.count);
+	TEST_ASSERT_EQUAL_UINT32(2400u, stats.minCycles);
+	TEST_ASSERT_EQUAL_UINT32(7200u, stats.maxCycles);
+
+	JsonDocument doc;
+	JsonObject webObj = Test_ToJSON(doc)["handlers"]["Web"];
+	TEST_ASSERT_EQUAL_UINT32(3u, webObj["count"].as<uint32_t>());
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, webObj["minUs"].as<float>());
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, webObj["avgUs"].as<float>());
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f, webObj["maxUs"].as<float>());
+	TEST_ASSERT_TRUE(Test_ToJSON(doc)["handlers"]["AudioPlayer"].isNull()); // never called
+}
+
+void test_histogram_buckets(void) {
+	Test_Call(LoopHandler::AudioPlayer, 0u);
+	Test_Call(LoopHandler::AudioPlayer, 1u);
+	Test_Call(LoopHandler::AudioPlayer, 511u);
+	Test_Call(LoopHandler::AudioPlayer, 512u);
+	Test_Call(LoopHandler::AudioPlayer, 1023u);
+	Test_Call(LoopHandler::AudioPlayer, UINT32_MAX);
+	const loopProfilerStats_t &stats = LoopProfiler_Handlers[static_cast<uint8_t>(LoopHandler::AudioPlayer)];
+	TEST_ASSERT_EQUAL_UINT32(1u, stats.histogram[0]);
+	TEST_ASSERT_EQUAL_UINT32(1u, stats.histogram[1]);
+	TEST_ASSERT_EQUAL_UINT32(1u, stats.histogram[9]);
+	TEST_ASSERT_EQUAL_UINT32(2u, stats.histogram[10]);
+	TEST_ASSERT_EQUAL_UINT32(1u, stats.histogram[loopProfilerBuckets - 1]); // last bucket takes everything above
+
+	// trailing empty buckets are left out
+	Test_Call(LoopHandler::Web, 1000u);
+	JsonDocument doc;
+	JsonArray histogramArr = Test_ToJSON(doc)["handlers"]["Web"]["log2Histogram"];
+	TEST_ASSERT_EQUAL_UINT32(11u, histogramArr.size());
+	TEST_ASSERT_EQUAL_UINT32(1u, histogramArr[10].as<uint32_t>());
+}
+
+void test_p99_ignores_rare_stalls(void) {
+	for (uint8_t i = 0; i < 99u; i++) {
+		Test_Call(LoopHandler::Web, 700u);
+	}
+	Test_Call(LoopHandler::Web, 240000000u); // 1 s
+	const loopProfilerStats_t &stats = LoopProfiler_Handlers[static_cast<uint8_t>(LoopHandler::Web)];
+	const uint32_t p99 = LoopProfiler_P99Cycles(stats);
+	TEST_ASSERT_TRUE(p99 >= 512u && p99 <= 1023u); // within the bucket of the usual calls
+
+	// more than 1 % of stalls: p99 is among them
+	for (uint8_t i = 0; i < 5u; i++) {
+		Test_Call(LoopHandler::Web, 240000000u);
+	}
+	TEST_ASSERT_TRUE(LoopProfiler_P99Cycles(stats) >= (1u << 27));
+	TEST_ASSERT_TRUE(LoopProfiler_P99Cycles(stats) <= stats.maxCycles);
+}
+
+void test_worst_call_is_kept(void) {
+	Stub_SetMillis(1234u);
+	Test_Call(LoopHandler::Web, 5000u);
+	Stub_SetMillis(2000u);
+	Test_Call(LoopHandler::AudioPlayer, 48000000u); // 200 ms, logged
+	Stub_SetMillis(3000u);
+	Test_Call(LoopHandler::Web, 10000u);
+	JsonDocument doc;
+	JsonObject worstObj = Test_ToJSON(doc)["worst"];
+	TEST_ASSERT_EQUAL_STRING("AudioPlayer", worstObj["handler"].as<const char *>());
+	TEST_ASSERT_FLOAT_WITHIN(1.0f, 200000.0f, worstObj["us"].as<float>());
+	TEST_ASSERT_EQUAL_UINT32(2000u, worstObj["uptimeMs"].as<uint32_t>());
+}
+
+void test_loop_pass(void) {
+	const uint32_t start = Stub_CycleCount;
+	Test_Call(LoopHandler::Web, 1000u);
+	Test_Call(LoopHandler::AudioPlayer, 2000u);
+	LoopProfiler_LoopFinished(start);
+	JsonDocument doc;
+	JsonObject loopObj = Test_ToJSON(doc)["loop"];
+	TEST_ASSERT_EQUAL_UINT32(1u, loopObj["count"].as<uint32_t>());
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 12.5f, loopObj["maxUs"].as<float>());
+}
+
+void test_mqtt_summary_once_a_minute(void) {
+	Test_Call(LoopHandler::Web, 1000u);
+	LoopProfiler_Cyclic();
+	TEST_ASSERT_EQUAL_UINT8(0u, Test_MqttPublished);
+	Stub_SetMillis(loopProfilerMqttIntervalMs);
+	LoopProfiler_Cyclic();
+	TEST_ASSERT_EQUAL_UINT8(1u, Test_MqttPublished);
+	Stub_SetMillis(loopProfilerMqttIntervalMs + 1000u);
+	LoopProfiler_Cyclic();
+	TEST_ASSERT_EQUAL_UINT8(1u, Test_MqttPublished);
+
+	TEST_ASSERT_EQUAL_STRING(topicLoopProfile, Test_MqttTopic.c_str());
+	TEST_ASSERT_TRUE(Test_MqttPayload.find("\"handlers\":{\"Web\":{\"count\":1,") != std::string::npos);
+	TEST_ASSERT_TRUE(Test_MqttPayload.find("log2Histogram") == std::string::npos);
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_min_avg_max);
+	RUN_TEST(test_histogram_buckets);
+	RUN_TEST(test_p99_ignores_rare_stalls);
+	RUN_TEST(test_worst_call_is_kept);
+	RUN_TEST(test_loop_pass);
+	RUN_TEST(test_mqtt_summary_once_a_minute);
+	return UNITY_END();
+}
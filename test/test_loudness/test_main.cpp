@@ -0,0 +1,129 @@
+#include <unity.h>
+
+#include "LogStub.h"
+
+#include "Loudness.cpp"
+
+#include <vector>
+
+// Loudness-measurement: a sine of known level has to give its loudness (BS.1770: 1 kHz is weighted with ~0 dB,
+// so a stereo sine of amplitude A has 20 * log10(A) LUFS), whatever the volume and buffer-size is, although only
+// a part of the frames is filtered. Results and peaks are taken over by the cache and ReplayGain-tags.
+
+static fs::FS Test_Card;
+SanitizedFS gFSystem(Test_Card);
+
+constexpr uint32_t testSampleRate = 44100u;
+constexpr const char *testPath = "/music/album/track.mp3";
+
+// 16 bit stereo in the upper half, as delivered by the lib; gainQ15 is the volume the lib has applied
+static void Test_Play(const float amplitude, const float hz, const uint32_t seconds, const int16_t bufferFrames, const uint16_t gainQ15 = 32768u) {
+	std::vector<int32_t> buff(2 * bufferFrames);
+	uint64_t frame = 0;
+	const uint64_t frames = static_cast<uint64_t>(seconds) * testSampleRate;
+	while (frame < frames) {
+		const int16_t n = std::min<uint64_t>(bufferFrames, frames - frame);
+		for (int16_t i = 0; i < n; i++, frame++) {
+			const float x = amplitude * sinf(2.0f * static_cast<float>(M_PI) * hz * frame / testSampleRate) * gainQ15 / 32768.0f;
+			const int32_t sample = lroundf(x * 32767.0f);
+			buff[2 * i] = static_cast<int32_t>(static_cast<uint32_t>(sample) << 16);
+			buff[2 * i + 1] = buff[2 * i];
+		}
+		Loudness_Analyse(buff.data(), n, testSampleRate, gainQ15);
+	}
+}
+
+static void Test_StartMeasuring(void) {
+	Loudness_TrackStarted(testPath, ReplayGainMode::Track);
+	TEST_ASSERT_TRUE(Loudness_Measuring.load());
+}
+
+void setUp(void) {
+	Stub_Files.clear();
+	Stub_Files[testPath] = std::vector<uint8_t>(1024, 0);
+	Loudness_PendingCount = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_sine_has_its_level(void) {
+	for (const float db : {-6.0f, -20.0f, -35.0f}) {
+		Test_StartMeasuring();
+		Test_Play(powf(10.0f, db / 20.0f), 997.0f, 30u, 1152);
+		TEST_ASSERT_FLOAT_WITHIN(0.2f, db, Loudness_GetIntegratedLufs());
+	}
+}
+
+void test_volume_and_buffer_size_dont_matter(void) {
+	Test_StartMeasuring();
+	Test_Play(0.1f, 997.0f, 30u, 1152);
+	const float reference = Loudness_GetIntegratedLufs();
+	const uint32_t blocks = Loudness_Blocks;
+	TEST_ASSERT_EQUAL_UINT32((30000u - loudnessWarmupMs - loudnessBlockMs) / loudnessBlockPeriodMs + 1u, blocks); // one block per period
+
+	const struct {
+		int16_t bufferFrames;
+		uint16_t gainQ15;
+	} variants[] = {{37, 32768u}, {576, 8192u}, {4096, 16384u}};
+	for (const auto &variant : variants) {
+		Test_StartMeasuring();
+		Test_Play(0.1f, 997.0f, 30u, variant.bufferFrames, variant.gainQ15);
+		TEST_ASSERT_FLOAT_WITHIN(0.1f, reference, Loudness_GetIntegratedLufs());
+		TEST_ASSERT_EQUAL_UINT32(blocks, Loudness_Blocks);
+	}
+}
+
+void test_silence_is_gated(void) {
+	Test_StartMeasuring();
+	Test_Play(0.1f, 997.0f, 20u, 1152);
+	const float reference = Loudness_GetIntegratedLufs();
+	Test_Play(0.0f, 997.0f, 20u, 1152);
+	TEST_ASSERT_FLOAT_WITHIN(0.05f, reference, Loudness_GetIntegratedLufs());
+}
+
+void test_measured_result_and_peak_are_cached(void) {
+	Test_StartMeasuring();
+	Test_Play(0.25f, 997.0f, 30u, 1152, 16384u);
+	Loudness_TrackFinished(30u);
+	TEST_ASSERT_FALSE(Loudness_Measuring.load());
+	Loudness_Cyclic(true);
+	TEST_ASSERT_EQUAL_UINT8(0u, Loudness_PendingCount);
+
+	Loudness_TrackStarted(testPath, ReplayGainMode::Track);
+	TEST_ASSERT_FALSE(Loudness_Measuring.load());
+	TEST_ASSERT_FLOAT_WITHIN(0.25f, -18.0f - 20.0f * log10f(0.25f), Loudness_GetGainDb(ReplayGainMode::Track));
+	TEST_ASSERT_FLOAT_WITHIN(0.05f, 20.0f * log10f(0.25f), Loudness_GetPeakDb(ReplayGainMode::Track));
+	TEST_ASSERT_FLOAT_WITHIN(0.05f, 20.0f * log10f(0.25f), Loudness_GetPeakDb(ReplayGainMode::Album));
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, Loudness_GetPeakDb(ReplayGainMode::Off));
+}
+
+void test_too_short_measurement_isnt_cached(void) {
+	Test_StartMeasuring();
+	Test_Play(0.25f, 997.0f, 10u, 1152);
+	Loudness_TrackFinished(60u);
+	TEST_ASSERT_EQUAL_UINT8(0u, Loudness_PendingCount);
+}
+
+void test_peak_tags(void) {
+	Loudness_TrackStarted(nullptr, ReplayGainMode::Track);
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, Loudness_GetPeakDb(ReplayGainMode::Track)); // unknown: no headroom
+	Loudness_ParseTag("REPLAYGAIN_TRACK_PEAK", "0.5");
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, -6.02f, Loudness_GetPeakDb(ReplayGainMode::Track));
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, -6.02f, Loudness_GetPeakDb(ReplayGainMode::Album)); // falls back to the track
+	Loudness_ParseTag("replaygain_album_peak", "0.988553");
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, -0.10f, Loudness_GetPeakDb(ReplayGainMode::Album));
+	Loudness_ParseTag("REPLAYGAIN_TRACK_PEAK", "garbage");
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, Loudness_GetPeakDb(ReplayGainMode::Track));
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_sine_has_its_level);
+	RUN_TEST(test_volume_and_buffer_size_dont_matter);
+	RUN_TEST(test_silence_is_gated);
+	RUN_TEST(test_measured_result_and_peak_are_cached);
+	RUN_TEST(test_too_short_measurement_isnt_cached);
+	RUN_TEST(test_peak_tags);
+	return UNITY_END();
+}
@@ -0,0 +1,204 @@
+#include <unity.h>
+
+#include "LogStub.h"
+
+#include "PlayPosJournal.cpp"
+
+// Play-position journal on both storages. In the "ppjournal" partition (NOR-flash: erase to 0xFF, writes only clear
+// bits) checkpoints have to survive a loss of power, also one in the middle of a write, and the ring has to wrap
+// through all sectors. Without the partition the ring is in RTC-memory, which survives resets only: a reset in the
+// middle of an append leaves some of its bytes written and the others not. In every case the journal has to come
+// up with either the previous or the new checkpoint - never a mix of both and never garbage.
+
+static PlayPosJournalRing Test_Before;
+static PlayPosJournalRing Test_After;
+
+// Reboot; RTC-memory is lost as well if the power was gone
+static void Test_Reboot(const bool powerLoss) {
+	if (powerLoss) {
+		memset(&PlayPosJournal_Ring, 0xA5, sizeof(PlayPosJournal_Ring)); // RTC-memory is random after power-on
+	}
+	Stub_WriteLimit = SIZE_MAX;
+	PlayPosJournal_Init();
+}
+
+static void Test_ExpectPending(const char *tag, const uint32_t position, const uint16_t track) {
+	PlayPosJournalEntry entry;
+	TEST_ASSERT_TRUE(PlayPosJournal_GetPending(&entry));
+	TEST_ASSERT_EQUAL_STRING(tag, entry.rfidTag);
+	TEST_ASSERT_EQUAL_UINT32(position, entry.playPosition);
+	TEST_ASSERT_EQUAL_UINT16(track, entry.trackLastPlayed);
+}
+
+static void Test_UseRtc(void) {
+	Stub_PartitionPresent = false;
+	Test_Reboot(true);
+	TEST_ASSERT_FALSE(PlayPosJournal_IsDurable());
+}
+
+void setUp(void) {
+	Stub_PartitionPresent = true;
+	std::fill(Stub_Flash.begin(), Stub_Flash.end(), 0xFF);
+	Stub_Erases = 0u;
+	Test_Reboot(true);
+}
+
+void tearDown(void) {
+}
+
+void test_cold_start_has_nothing_pending(void) {
+	TEST_ASSERT_TRUE(PlayPosJournal_IsDurable());
+	PlayPosJournalEntry entry;
+	TEST_ASSERT_FALSE(PlayPosJournal_GetPending(&entry));
+	Test_UseRtc();
+	TEST_ASSERT_FALSE(PlayPosJournal_GetPending(&entry));
+}
+
+void test_checkpoint_survives_power_loss(void) {
+	PlayPosJournal_Append("001002003004", 42u, 3u, 7u);
+	Test_Reboot(true);
+	Test_ExpectPending("001002003004", 42u, 7u);
+}
+
+void test_rtc_checkpoint_survives_reset(void) {
+	Test_UseRtc();
+	PlayPosJournal_Append("001002003004", 42u, 3u, 7u);
+	Test_Reboot(false);
+	Test_ExpectPending("001002003004", 42u, 7u);
+}
+
+static void Test_CompactedIsntReplayed(const bool powerLoss) {
+	PlayPosJournal_Append("001002003004", 42u, 3u, 7u);
+	PlayPosJournal_MarkCompacted();
+	Test_Reboot(powerLoss);
+	PlayPosJournalEntry entry;
+	TEST_ASSERT_FALSE(PlayPosJournal_GetPending(&entry));
+
+	PlayPosJournal_Append("001002003004", 47u, 3u, 7u);
+	Test_Reboot(powerLoss);
+	Test_ExpectPending("001002003004", 47u, 7u);
+}
+
+void test_compacted_checkpoint_isnt_replayed(void) {
+	Test_CompactedIsntReplayed(true);
+	Test_UseRtc();
+	Test_CompactedIsntReplayed(false);
+}
+
+// Three times around the partition: every sector is erased once per round, the newest record wins
+void test_flash_ring_wraps_through_all_sectors(void) {
+	const uint32_t slots = Stub_Flash.size() / sizeof(PlayPosJournalRecord);
+	const uint32_t appends = 3u * slots + 5u;
+	for (uint32_t i = 1; i <= appends; i++) {
+		PlayPosJournal_Append("005006007008", i * 5u, 3u, 1u);
+	}
+	TEST_ASSERT_EQUAL_UINT32((appends + playPosJournalSectorSize / sizeof(PlayPosJournalRecord) - 1u) / (playPosJournalSectorSize / sizeof(PlayPosJournalRecord)), Stub_Erases);
+	Test_Reboot(true);
+	Test_ExpectPending("005006007008", appends * 5u, 1u);
+}
+
+void test_rtc_ring_wraps(void) {
+	Test_UseRtc();
+	for (uint32_t i = 1; i <= 3u * playPosJournalRtcSlots + 2u; i++) {
+		PlayPosJournal_Append("005006007008", i * 5u, 3u, 1u);
+	}
+	Test_Reboot(false);
+	Test_ExpectPending("005006007008", (3u * playPosJournalRtcSlots + 2u) * 5u, 1u);
+}
+
+static void Test_ExpectPreviousOrNew(const uint32_t previousAppends) {
+	PlayPosJournalEntry entry;
+	const bool pending = PlayPosJournal_GetPending(&entry);
+	if (pending && !strcmp(entry.rfidTag, "050060070080")) {
+		TEST_ASSERT_EQUAL_UINT32(1000u, entry.playPosition);
+		TEST_ASSERT_EQUAL_UINT8(4u, entry.playMode);
+		TEST_ASSERT_EQUAL_UINT16(9u, entry.trackLastPlayed);
+	} else if (previousAppends) {
+		TEST_ASSERT_TRUE(pending);
+		TEST_ASSERT_EQUAL_STRING("010020030040", entry.rfidTag);
+		TEST_ASSERT_EQUAL_UINT32(previousAppends, entry.playPosition);
+		TEST_ASSERT_EQUAL_UINT16(2u, entry.trackLastPlayed);
+	} else {
+		TEST_ASSERT_FALSE(pending);
+	}
+}
+
+// Cuts the power after every byte of the write of an append. Afterwards the journal has to keep working: the torn
+// slot is skipped and the next checkpoint is the newest one.
+static void Test_PowerLossDuringFlashAppend(const uint32_t previousAppends) {
+	for (size_t cut = 0; cut <= sizeof(PlayPosJournalRecord); cut++) {
+		setUp();
+		for (uint32_t i = 1; i <= previousAppends; i++) {
+			PlayPosJournal_Append("010020030040", i, 3u, 2u);
+		}
+		Stub_WriteLimit = cut;
+		PlayPosJournal_Append("050060070080", 1000u, 4u, 9u);
+		Test_Reboot(true);
+		Test_ExpectPreviousOrNew(previousAppends);
+
+		PlayPosJournal_Append("090100110120", 2000u, 3u, 5u);
+		Test_Reboot(true);
+		Test_ExpectPending("090100110120", 2000u, 5u);
+	}
+}
+
+void test_power_loss_during_first_flash_append(void) {
+	Test_PowerLossDuringFlashAppend(0u);
+}
+
+void test_power_loss_during_flash_append(void) {
+	Test_PowerLossDuringFlashAppend(3u);
+}
+
+void test_power_loss_during_flash_append_at_sector_end(void) {
+	Test_PowerLossDuringFlashAppend(playPosJournalSectorSize / sizeof(PlayPosJournalRecord) - 1u); // the new record opens the next sector
+}
+
+// RTC: resets after every byte of an append, once with the bytes written front to back and once back to front
+static void Test_ResetDuringRtcAppend(const uint32_t previousAppends) {
+	Test_UseRtc();
+	for (uint32_t i = 1; i <= previousAppends; i++) {
+		PlayPosJournal_Append("010020030040", i, 3u, 2u);
+	}
+	memcpy(&Test_Before, &PlayPosJournal_Ring, sizeof(Test_Before));
+	PlayPosJournal_Append("050060070080", 1000u, 4u, 9u);
+	memcpy(&Test_After, &PlayPosJournal_Ring, sizeof(Test_After));
+
+	const uint8_t *before = reinterpret_cast<const uint8_t *>(&Test_Before);
+	const uint8_t *after = reinterpret_cast<const uint8_t *>(&Test_After);
+	uint8_t *ring = reinterpret_cast<uint8_t *>(&PlayPosJournal_Ring);
+	for (uint8_t backwards = 0; backwards < 2; backwards++) {
+		for (size_t cut = 0; cut <= sizeof(PlayPosJournalRing); cut++) {
+			for (size_t i = 0; i < sizeof(PlayPosJournalRing); i++) {
+				const bool written = backwards ? (i >= sizeof(PlayPosJournalRing) - cut) : (i < cut);
+				ring[i] = written ? after[i] : before[i];
+			}
+			Test_Reboot(false);
+			Test_ExpectPreviousOrNew(previousAppends);
+		}
+	}
+}
+
+void test_reset_during_first_rtc_append(void) {
+	Test_ResetDuringRtcAppend(0u);
+}
+
+void test_reset_during_rtc_append_after_wrap(void) {
+	Test_ResetDuringRtcAppend(2u * playPosJournalRtcSlots + 5u);
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_cold_start_has_nothing_pending);
+	RUN_TEST(test_checkpoint_survives_power_loss);
+	RUN_TEST(test_rtc_checkpoint_survives_reset);
+	RUN_TEST(test_compacted_checkpoint_isnt_replayed);
+	RUN_TEST(test_flash_ring_wraps_through_all_sectors);
+	RUN_TEST(test_rtc_ring_wraps);
+	RUN_TEST(test_power_loss_during_first_flash_append);
+	RUN_TEST(test_power_loss_during_flash_append);
+	RUN_TEST(test_power_loss_during_flash_append_at_sector_end);
+	RUN_TEST(test_reset_during_first_rtc_append);
+	RUN_TEST(test_reset_during_rtc_append_after_wrap);
+	return UNITY_END();
+}
@@ -0,0 +1,290 @@
+#include <unity.h>
+
+#include "LogStub.h"
+
+#include "Announcement.cpp"
+#include "PromptPack.cpp"
+
+#include <string>
+#include <vector>
+
+// Voice-prompt pack and sentence-sequencer: the pack is built in memory (the same layout as prompt_pack.py writes),
+// then loaded from the "SD-card" with and without PSRAM. ADPCM is checked against a straightforward IMA-encoder.
+
+static fs::FS Test_Card;
+SanitizedFS gFSystem(Test_Card);
+
+void *x_malloc(uint32_t _allocSize) {
+	return malloc(_allocSize);
+}
+
+constexpr uint32_t testSampleRate = 16000u;
+constexpr uint16_t testGapMs = 10u;
+constexpr uint32_t testGapFrames = testSampleRate * testGapMs / 1000u;
+
+typedef struct {
+	std::string name;
+	std::vector<int16_t> pcm;
+} testPrompt_t;
+
+typedef struct {
+	int16_t predictor;
+	uint8_t stepIndex;
+	std::vector<uint8_t> data;
+	std::vector<int16_t> decoded; // what the encoder expects the decoder to return
+} testAdpcm_t;
+
+// IMA-ADPCM reference: two frames per byte, low nibble first; tracks the decoder-state to know the decoded samples
+static testAdpcm_t Test_AdpcmEncode(const std::vector<int16_t> &pcm) {
+	testAdpcm_t out = {pcm.empty() ? int16_t(0) : pcm[0], 20u, {}, {}};
+	int32_t predictor = out.predictor;
+	int32_t stepIndex = out.stepIndex;
+	for (size_t i = 0; i < pcm.size(); i++) {
+		const int32_t step = PromptPack_AdpcmStepTable[stepIndex];
+		int32_t diff = pcm[i] - predictor;
+		uint8_t nibble = (diff < 0) ? 8u : 0u;
+		diff = abs(diff);
+		int32_t threshold = step;
+		for (uint8_t bit = 4u; bit; bit >>= 1) {
+			if (diff >= threshold) {
+				nibble |= bit;
+				diff -= threshold;
+			}
+			threshold >>= 1;
+		}
+		const int32_t delta = (step >> 3) + ((nibble & 4u) ? step : 0) + ((nibble & 2u) ? step >> 1 : 0) + ((nibble & 1u) ? step >> 2 : 0);
+		predictor = std::clamp<int32_t>((nibble & 8u) ? predictor - delta : predictor + delta, INT16_MIN, INT16_MAX);
+		stepIndex = std::clamp<int32_t>(stepIndex + PromptPack_AdpcmIndexTable[nibble], 0, 88);
+		out.decoded.push_back(static_cast<int16_t>(predictor));
+		if (i & 1u) {
+			out.data.back() |= nibble << 4;
+		} else {
+			out.data.push_back(nibble);
+		}
+	}
+	return out;
+}
+
+template <typename T>
+static void Test_Append(std::vector<uint8_t> &file, const T &value) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+	file.insert(file.end(), bytes, bytes + sizeof(value));
+}
+
+// Writes the pack of the configured language; prompts have to be sorted by name
+static void Test_WritePack(const std::vector<testPrompt_t> &prompts, const PromptCodec codec) {
+	std::vector<uint8_t> file;
+	const promptPackHeader_t header = {{'E', 'P', 'P', 'K'}, promptPackVersion, static_cast<uint8_t>(codec), testGapMs, testSampleRate, static_cast<uint16_t>(prompts.size()), 0u};
+	Test_Append(file, header);
+
+	std::vector<uint8_t> data;
+	uint32_t offset = sizeof(header) + prompts.size() * sizeof(promptPackEntry_t);
+	for (const testPrompt_t &prompt : prompts) {
+		promptPackEntry_t entry = {};
+		strncpy(entry.name, prompt.name.c_str(), sizeof(entry.name));
+		entry.offset = offset + data.size();
+		entry.frames = prompt.pcm.size();
+		if (codec == PromptCodec::ImaAdpcm) {
+			const testAdpcm_t adpcm = Test_AdpcmEncode(prompt.pcm);
+			entry.predictor = adpcm.predictor;
+			entry.stepIndex = adpcm.stepIndex;
+			data.insert(data.end(), adpcm.data.begin(), adpcm.data.end());
+		} else {
+			const uint8_t *bytes = reinterpret_cast<const uint8_t *>(prompt.pcm.data());
+			data.insert(data.end(), bytes, bytes + prompt.pcm.size() * sizeof(int16_t));
+		}
+		Test_Append(file, entry);
+	}
+	file.insert(file.end(), data.begin(), data.end());
+	Stub_Files[promptPackPath] = file;
+}
+
+static std::vector<int16_t> Test_Tone(const size_t frames, const float frequency, const int16_t amplitude) {
+	std::vector<int16_t> pcm(frames);
+	for (size_t i = 0; i < frames; i++) {
+		pcm[i] = static_cast<int16_t>(lroundf(amplitude * sinf(2.0f * static_cast<float>(M_PI) * frequency * i / testSampleRate)));
+	}
+	return pcm;
+}
+
+static std::vector<testPrompt_t> Test_BatteryPrompts(void) {
+	return {
+		{"42", Test_Tone(1200u, 440.0f, 8000)},
+		{"battery", Test_Tone(2001u, 300.0f, 12000)}, // odd number of frames: last ADPCM-byte is half used
+		{"percent", Test_Tone(900u, 660.0f, 20000)},
+	};
+}
+
+static std::vector<int16_t> Test_Expected(const std::vector<testPrompt_t> &prompts, const PromptCodec codec, const std::vector<size_t> &order) {
+	std::vector<int16_t> out;
+	for (size_t i = 0; i < order.size(); i++) {
+		if (i) {
+			out.insert(out.end(), testGapFrames, 0);
+		}
+		const std::vector<int16_t> &pcm = prompts[order[i]].pcm;
+		if (codec == PromptCodec::ImaAdpcm) {
+			const std::vector<int16_t> decoded = Test_AdpcmEncode(pcm).decoded;
+			out.insert(out.end(), decoded.begin(), decoded.end());
+		} else {
+			out.insert(out.end(), pcm.begin(), pcm.end());
+		}
+	}
+	return out;
+}
+
+static void Test_ExpectSentence(const std::vector<int16_t> &expected) {
+	TEST_ASSERT_EQUAL_UINT32(expected.size(), Announcement_SentenceFrames);
+	TEST_ASSERT_EQUAL_UINT32(testSampleRate, Announcement_SampleRate);
+	TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), Announcement_Sentence, expected.size());
+}
+
+void setUp(void) {
+	Stub_Files.clear();
+	Stub_PsramFound = false;
+	Stub_PsMallocFails = false;
+	PromptPack_File.close();
+	free(PromptPack_Data ? (void *) PromptPack_Data : (void *) PromptPack_Index);
+	PromptPack_Data = nullptr;
+	PromptPack_Index = nullptr;
+	Announcement_State = AnnouncementState::Idle;
+	Announcement_SentenceFrames = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_adpcm_nibbles(void) {
+	// worked example: step 7 -> 7 + 3 + 1 + 0 = 11, step-index +8; then step 16 -> -(16 + 8 + 4 + 2)
+	adpcmState_t state = {0, 0};
+	const uint8_t src[] = {0xF7};
+	int16_t dst[2];
+	PromptPack_AdpcmDecode(state, src, dst, 2u);
+	TEST_ASSERT_EQUAL_INT16(11, dst[0]);
+	TEST_ASSERT_EQUAL_INT16(-19, dst[1]);
+	TEST_ASSERT_EQUAL_INT8(16, state.stepIndex);
+}
+
+void test_adpcm_clamps(void) {
+	adpcmState_t state = {32000, 88};
+	TEST_ASSERT_EQUAL_INT16(INT16_MAX, PromptPack_AdpcmDecodeNibble(state, 0x7));
+	TEST_ASSERT_EQUAL_INT8(88, state.stepIndex);
+	state = {-32000, 88};
+	TEST_ASSERT_EQUAL_INT16(INT16_MIN, PromptPack_AdpcmDecodeNibble(state, 0xF));
+	state = {0, 0};
+	PromptPack_AdpcmDecodeNibble(state, 0x0);
+	TEST_ASSERT_EQUAL_INT8(0, state.stepIndex);
+}
+
+void test_adpcm_matches_encoder(void) {
+	const std::vector<int16_t> pcm = Test_Tone(4001u, 523.0f, 25000);
+	const testAdpcm_t adpcm = Test_AdpcmEncode(pcm);
+	std::vector<int16_t> dst(pcm.size());
+	adpcmState_t state = {adpcm.predictor, static_cast<int8_t>(adpcm.stepIndex)};
+	PromptPack_AdpcmDecode(state, adpcm.data.data(), dst.data(), pcm.size());
+	TEST_ASSERT_EQUAL_INT16_ARRAY(adpcm.decoded.data(), dst.data(), pcm.size());
+
+	double signal = 0.0;
+	double noise = 0.0;
+	for (size_t i = 0; i < pcm.size(); i++) {
+		signal += static_cast<double>(pcm[i]) * pcm[i];
+		noise += static_cast<double>(pcm[i] - dst[i]) * (pcm[i] - dst[i]);
+	}
+	TEST_ASSERT_TRUE(10.0 * log10(signal / noise) > 25.0);
+}
+
+void test_find_is_binary_search(void) {
+	Test_WritePack(Test_BatteryPrompts(), PromptCodec::Pcm16);
+	TEST_ASSERT_TRUE(PromptPack_Init());
+	TEST_ASSERT_EQUAL_INT16(0, PromptPack_Find("42"));
+	TEST_ASSERT_EQUAL_INT16(1, PromptPack_Find("battery"));
+	TEST_ASSERT_EQUAL_INT16(2, PromptPack_Find("percent"));
+	TEST_ASSERT_EQUAL_INT16(promptPackInvalid, PromptPack_Find("43"));
+	TEST_ASSERT_EQUAL_UINT32(2001u, PromptPack_GetFrames(1));
+}
+
+static void Test_BatterySentence(const PromptCodec codec) {
+	const std::vector<testPrompt_t> prompts = Test_BatteryPrompts();
+	Test_WritePack(prompts, codec);
+	TEST_ASSERT_TRUE(PromptPack_Init());
+	TEST_ASSERT_TRUE(Announcement_ComposeBatteryLevel(42u));
+	Test_ExpectSentence(Test_Expected(prompts, codec, {1, 0, 2}));
+}
+
+void test_sentence_pcm_from_card(void) {
+	Test_BatterySentence(PromptCodec::Pcm16);
+}
+
+void test_sentence_adpcm_from_card(void) {
+	Test_BatterySentence(PromptCodec::ImaAdpcm);
+}
+
+void test_sentence_pcm_from_psram(void) {
+	Stub_PsramFound = true;
+	Test_BatterySentence(PromptCodec::Pcm16);
+	TEST_ASSERT_NOT_NULL(PromptPack_Data);
+}
+
+void test_sentence_adpcm_from_psram(void) {
+	Stub_PsramFound = true;
+	Test_BatterySentence(PromptCodec::ImaAdpcm);
+	TEST_ASSERT_NOT_NULL(PromptPack_Data);
+}
+
+// No room in PSRAM: the pack is read from the card instead
+void test_psram_allocation_fails(void) {
+	Stub_PsramFound = true;
+	Stub_PsMallocFails = true;
+	Test_BatterySentence(PromptCodec::ImaAdpcm);
+	TEST_ASSERT_NULL(PromptPack_Data);
+}
+
+void test_missing_prompt_isnt_rendered(void) {
+	Test_WritePack(Test_BatteryPrompts(), PromptCodec::Pcm16);
+	TEST_ASSERT_TRUE(PromptPack_Init());
+	TEST_ASSERT_FALSE(Announcement_ComposeBatteryLevel(43u));
+	TEST_ASSERT_FALSE(Announcement_Start());
+}
+
+void test_no_pack(void) {
+	TEST_ASSERT_FALSE(PromptPack_Init());
+	TEST_ASSERT_FALSE(PromptPack_IsAvailable());
+	TEST_ASSERT_FALSE(Announcement_ComposeBatteryLevel(42u));
+}
+
+// offset + size wraps around 32 bit: has to be rejected, not read beyond the pack
+static void Test_RejectsEntry(const uint32_t offset, const uint32_t frames, const bool psram) {
+	setUp();
+	Stub_PsramFound = psram;
+	Test_WritePack(Test_BatteryPrompts(), PromptCodec::Pcm16);
+	std::vector<uint8_t> &file = Stub_Files[promptPackPath];
+	promptPackEntry_t *entry = reinterpret_cast<promptPackEntry_t *>(file.data() + sizeof(promptPackHeader_t) + sizeof(promptPackEntry_t));
+	entry->offset = offset;
+	entry->frames = frames;
+	TEST_ASSERT_FALSE(PromptPack_Init());
+	TEST_ASSERT_FALSE(PromptPack_IsAvailable());
+}
+
+void test_entry_out_of_bounds(void) {
+	for (uint8_t psram = 0; psram < 2; psram++) {
+		Test_RejectsEntry(0xFFFFFFF0u, 16u, psram);
+		Test_RejectsEntry(16u, 0x80000008u, psram);
+		Test_RejectsEntry(0u, 0xFFFFFFFFu, psram);
+	}
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_adpcm_nibbles);
+	RUN_TEST(test_adpcm_clamps);
+	RUN_TEST(test_adpcm_matches_encoder);
+	RUN_TEST(test_find_is_binary_search);
+	RUN_TEST(test_sentence_pcm_from_card);
+	RUN_TEST(test_sentence_adpcm_from_card);
+	RUN_TEST(test_sentence_pcm_from_psram);
+	RUN_TEST(test_sentence_adpcm_from_psram);
+	RUN_TEST(test_psram_allocation_fails);
+	RUN_TEST(test_missing_prompt_isnt_rendered);
+	RUN_TEST(test_no_pack);
+	RUN_TEST(test_entry_out_of_bounds);
+	return UNITY_END();
+}
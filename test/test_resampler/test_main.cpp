@@ -0,0 +1,224 @@
+#include <unity.h>
+
+#include "LogStub.h"
+#include "Resampler.cpp"
+
+#include <vector>
+
+// Checks the polyphase resampler with sine-tones: level in the passband, rejection of what would alias (down)
+// or be imaged (up), the number of output-frames and that splitting the input into blocks doesn't change anything.
+// The sweep prints THD+N (worst over the sine-frequencies) and the time per second of audio for every input-rate.
+
+constexpr int16_t testAmplitude = 16000;
+
+static std::vector<int16_t> Test_In;
+static std::vector<int16_t> Test_Out;
+
+// (Re)starts the resampler for inputRate, even if it had this rate before
+static void Test_Start(const uint32_t inputRate) {
+	Resampler_SetInputRate(inputRate == resamplerOutputRate ? 48000u : resamplerOutputRate);
+	Resampler_SetInputRate(inputRate);
+}
+
+// One second of a sine with freq Hz: left channel sine, right channel inverted
+static void Test_MakeSine(const uint32_t rate, const double freq) {
+	Test_In.resize(rate * 2u);
+	for (uint32_t i = 0; i < rate; i++) {
+		Test_In[i * 2] = static_cast<int16_t>(lround(testAmplitude * sin(2.0 * M_PI * freq * i / rate)));
+		Test_In[i * 2 + 1] = -Test_In[i * 2];
+	}
+}
+
+static size_t Test_Process(void) {
+	Test_Out.assign(2u * resamplerOutputRate + 64u, 0);
+	return Resampler_Process(Test_In.data(), Test_In.size() / 2u, Test_Out.data(), Test_Out.size() / 2u);
+}
+
+// Amplitude of freq Hz in the output (Goertzel), skipping the settling of the filter at the start
+static double Test_Amplitude(const uint8_t channel, const double freq) {
+	const size_t start = 1000u;
+	const size_t frames = resamplerOutputRate - 2000u;
+	const double coeff = 2.0 * cos(2.0 * M_PI * freq / resamplerOutputRate);
+	double s1 = 0.0, s2 = 0.0;
+	for (size_t i = 0; i < frames; i++) {
+		const double s = Test_Out[(start + i) * 2 + channel] + coeff * s1 - s2;
+		s2 = s1;
+		s1 = s;
+	}
+	return sqrt(s1 * s1 + s2 * s2 - coeff * s1 * s2) * 2.0 / frames;
+}
+
+static double Test_LevelDb(const uint8_t channel, const double freq) {
+	return 20.0 * log10(Test_Amplitude(channel, freq) / testAmplitude);
+}
+
+// THD+N of the left channel: everything but the sine of freq Hz (least-squares fit of sine, cosine and DC),
+// relative to the sine
+static double Test_ThdNDb(const double freq) {
+	const size_t start = 1000u;
+	const size_t frames = resamplerOutputRate - 2000u;
+	double ss = 0.0, cc = 0.0, sc = 0.0, s1 = 0.0, c1 = 0.0, ys = 0.0, yc = 0.0, y1 = 0.0;
+	for (size_t i = 0; i < frames; i++) {
+		const double w = 2.0 * M_PI * freq * (start + i) / resamplerOutputRate;
+		const double s = sin(w), c = cos(w), y = Test_Out[(start + i) * 2];
+		ss += s * s;
+		cc += c * c;
+		sc += s * c;
+		s1 += s;
+		c1 += c;
+		ys += y * s;
+		yc += y * c;
+		y1 += y;
+	}
+	// normal equations, solved by Cramer's rule
+	const double n = frames;
+	const double det = ss * (cc * n - c1 * c1) - sc * (sc * n - c1 * s1) + s1 * (sc * c1 - cc * s1);
+	const double a = (ys * (cc * n - c1 * c1) - sc * (yc * n - c1 * y1) + s1 * (yc * c1 - cc * y1)) / det;
+	const double b = (ss * (yc * n - y1 * c1) - ys * (sc * n - c1 * s1) + s1 * (sc * y1 - yc * s1)) / det;
+	const double dc = (ss * (cc * y1 - c1 * yc) - sc * (sc * y1 - c1 * ys) + s1 * (sc * yc - cc * ys)) / det;
+	double residual = 0.0;
+	for (size_t i = 0; i < frames; i++) {
+		const double w = 2.0 * M_PI * freq * (start + i) / resamplerOutputRate;
+		const double e = Test_Out[(start + i) * 2] - (a * sin(w) + b * cos(w) + dc);
+		residual += e * e;
+	}
+	return 10.0 * log10(residual / (frames * (a * a + b * b) / 2.0));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_passthrough_at_output_rate(void) {
+	Test_Start(resamplerOutputRate);
+	TEST_ASSERT_FALSE(Resampler_IsActive());
+	TEST_ASSERT_EQUAL_size_t(512u, Resampler_GetMaxInputFrames(512u));
+	Test_Start(48000u);
+	TEST_ASSERT_TRUE(Resampler_IsActive());
+}
+
+void test_number_of_output_frames(void) {
+	for (const uint32_t rate : {8000u, 22050u, 32000u, 48000u}) {
+		Test_Start(rate);
+		Test_MakeSine(rate, 1000.0);
+		TEST_ASSERT_UINT32_WITHIN(1u, resamplerOutputRate, Test_Process());
+	}
+}
+
+void test_dc_gain_is_one(void) {
+	for (const uint32_t rate : {22050u, 48000u}) {
+		Test_Start(rate);
+		Test_In.assign(rate * 2u, 10000);
+		const size_t frames = Test_Process();
+		for (size_t i = 2u * resamplerTaps; i < frames; i++) {
+			TEST_ASSERT_INT_WITHIN(10, 10000, Test_Out[i * 2]); // 0.1 %: rounding of the Q15-coefficients
+		}
+	}
+}
+
+void test_passband_level(void) {
+	for (const uint32_t rate : {8000u, 22050u, 32000u, 48000u}) {
+		Test_Start(rate);
+		Test_MakeSine(rate, 1000.0);
+		Test_Process();
+		TEST_ASSERT_DOUBLE_WITHIN(0.1, 0.0, Test_LevelDb(0, 1000.0));
+		TEST_ASSERT_DOUBLE_WITHIN(0.1, 0.0, Test_LevelDb(1, 1000.0));
+		for (size_t i = 0; i < resamplerOutputRate; i++) {
+			TEST_ASSERT_INT_WITHIN(1, -Test_Out[i * 2], Test_Out[i * 2 + 1]); // channels don't leak into each other
+		}
+	}
+}
+
+void test_downsampling_rejects_aliases(void) {
+	// 23 kHz can't be represented at 44.1 kHz and would show up at 21.1 kHz
+	Test_Start(48000u);
+	Test_MakeSine(48000u, 23000.0);
+	Test_Process();
+	TEST_ASSERT_LESS_THAN(-50.0, Test_LevelDb(0, resamplerOutputRate - 23000.0));
+}
+
+void test_upsampling_rejects_images(void) {
+	Test_Start(22050u);
+	Test_MakeSine(22050u, 1000.0);
+	Test_Process();
+	TEST_ASSERT_LESS_THAN(-60.0, Test_LevelDb(0, 22050.0 - 1000.0));
+	TEST_ASSERT_LESS_THAN(-60.0, Test_LevelDb(0, 22050.0 + 1000.0));
+}
+
+void test_blocks_give_same_output(void) {
+	Test_Start(48000u);
+	Test_MakeSine(48000u, 997.0);
+	const size_t frames = Test_Process();
+	const std::vector<int16_t> expected(Test_Out.begin(), Test_Out.begin() + frames * 2);
+
+	// as done by the audio-task: blocks of at most GetMaxInputFrames() for a fixed output-buffer
+	Test_Start(48000u);
+	std::vector<int16_t> out;
+	int16_t block[512 * 2];
+	const size_t maxIn = Resampler_GetMaxInputFrames(512u);
+	for (size_t done = 0, chunk = 1; done < Test_In.size() / 2u; done += chunk, chunk = (chunk * 7u) % maxIn + 1u) {
+		chunk = std::min(chunk, Test_In.size() / 2u - done);
+		const size_t produced = Resampler_Process(&Test_In[done * 2], chunk, block, 512u);
+		TEST_ASSERT_TRUE(produced <= 512u);
+		out.insert(out.end(), block, block + produced * 2);
+	}
+	TEST_ASSERT_EQUAL_size_t(expected.size(), out.size());
+	TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), out.data(), expected.size());
+}
+
+void test_max_input_frames_fit_into_output(void) {
+	for (const uint32_t rate : {8000u, 22050u, 32000u, 48000u}) {
+		Test_Start(rate);
+		Test_In.assign(4096u * 2u, 0);
+		int16_t block[512 * 2];
+		for (uint16_t run = 0; run < 500u; run++) {
+			const size_t capacity = 2u + run % 511u;
+			TEST_ASSERT_TRUE(Resampler_Process(Test_In.data(), Resampler_GetMaxInputFrames(capacity), block, capacity) <= capacity);
+		}
+	}
+}
+
+void test_sweep_thd_n_and_time(void) {
+	for (const uint32_t rate : {8000u, 11025u, 16000u, 22050u, 32000u, 48000u}) {
+		double worstDb = -200.0;
+		double worstFreq = 0.0;
+		uint64_t ns = 0;
+		uint8_t sines = 0;
+		for (const double freq : {100.0, 315.0, 1000.0, 3150.0, 6300.0, 10000.0, 16000.0}) {
+			if (freq > 0.4 * std::min(rate, resamplerOutputRate)) {
+				continue;
+			}
+			Test_Start(rate);
+			Test_MakeSine(rate, freq);
+			const uint32_t start = ESP.getCycleCount();
+			Test_Process();
+			ns += ESP.getCycleCount() - start;
+			sines++;
+			const double thdN = Test_ThdNDb(freq);
+			if (thdN > worstDb) {
+				worstDb = thdN;
+				worstFreq = freq;
+			}
+		}
+		char message[112];
+		snprintf(message, sizeof(message), "%u Hz: THD+N %.1f dB (worst, at %.0f Hz), %.2f ms per second of audio (host)", rate, worstDb, worstFreq, static_cast<double>(ns) / sines / 1e6);
+		TEST_MESSAGE(message);
+		TEST_ASSERT_LESS_THAN(-65.0, worstDb); // 16 bit in and out, Q15-coefficients: about -70 dB and better
+	}
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_passthrough_at_output_rate);
+	RUN_TEST(test_number_of_output_frames);
+	RUN_TEST(test_dc_gain_is_one);
+	RUN_TEST(test_passband_level);
+	RUN_TEST(test_downsampling_rejects_aliases);
+	RUN_TEST(test_upsampling_rejects_images);
+	RUN_TEST(test_blocks_give_same_output);
+	RUN_TEST(test_max_input_frames_fit_into_output);
+	RUN_TEST(test_sweep_thd_n_and_time);
+	return UNITY_END();
+}
@@ -0,0 +1,107 @@
+#include <unity.h>
+
+#include "SampleFormat.cpp"
+
+// The word-wise packing has to give the same result as the plain loop it replaced (upper 16 bit of every
+// 32 bit sample, L/R interleaved), for every remainder of the four-frames unrolling. The benchmark prints the time
+// per buffer of 1,024 frames of both.
+
+constexpr int16_t testMaxFrames = 40;
+constexpr int16_t testBenchmarkFrames = 1024;
+constexpr uint16_t testBenchmarkRounds = 2000u;
+
+static int32_t Test_Buffer[2 * testMaxFrames + 2];
+static int16_t Test_Expected[2 * testMaxFrames];
+static int32_t Test_BenchmarkBuffer[2 * testBenchmarkFrames];
+
+static uint32_t Test_Random(void) {
+	static uint32_t state = 0x12345678u;
+	state = state * 1664525u + 1013904223u;
+	return state;
+}
+
+// the conversion as it was done sample by sample before
+static void Test_Reference(const int32_t *in, int16_t *out, const int16_t frames) {
+	for (int16_t i = 0; i < frames * 2; i++) {
+		out[i] = static_cast<int16_t>(in[i] >> 16);
+	}
+}
+
+// the same in place, as the audio-task did it before
+static void Test_ReferenceInPlace(int32_t *buff, const int16_t frames) {
+	int16_t *out = reinterpret_cast<int16_t *>(buff);
+	for (int16_t i = 0; i < frames * 2; i++) {
+		out[i] = static_cast<int16_t>(buff[i] >> 16);
+	}
+}
+
+static uint64_t Test_Benchmark(void (*pack)(int32_t *, int16_t)) {
+	uint64_t ns = 0;
+	for (uint16_t round = 0; round < testBenchmarkRounds; round++) {
+		for (auto &sample : Test_BenchmarkBuffer) {
+			sample = static_cast<int32_t>(Test_Random());
+		}
+		const uint32_t start = ESP.getCycleCount();
+		pack(Test_BenchmarkBuffer, testBenchmarkFrames);
+		ns += ESP.getCycleCount() - start;
+	}
+	return ns / testBenchmarkRounds;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_matches_sample_loop(void) {
+	for (int16_t frames = 0; frames <= testMaxFrames; frames++) {
+		for (auto &sample : Test_Buffer) {
+			sample = static_cast<int32_t>(Test_Random());
+		}
+		Test_Reference(Test_Buffer, Test_Expected, frames);
+		SampleFormat_PackStereo32To16(Test_Buffer, frames);
+		TEST_ASSERT_EQUAL_MEMORY(Test_Expected, Test_Buffer, frames * 2 * sizeof(int16_t));
+	}
+}
+
+void test_leaves_rest_of_buffer_alone(void) {
+	for (auto &sample : Test_Buffer) {
+		sample = -1;
+	}
+	Test_Buffer[2 * 5] = 0x11112222;
+	SampleFormat_PackStereo32To16(Test_Buffer, 5);
+	TEST_ASSERT_EQUAL_INT32(0x11112222, Test_Buffer[2 * 5]); // first sample after the 5 frames
+	TEST_ASSERT_EQUAL_INT32(-1, Test_Buffer[2 * 5 + 1]);
+}
+
+void test_sign_and_extremes(void) {
+	Test_Buffer[0] = INT32_MIN;
+	Test_Buffer[1] = INT32_MAX;
+	Test_Buffer[2] = 0x0000FFFF; // lower half is dropped
+	Test_Buffer[3] = static_cast<int32_t>(0xFFFF0000u);
+	SampleFormat_PackStereo32To16(Test_Buffer, 2);
+	const int16_t *out = reinterpret_cast<const int16_t *>(Test_Buffer);
+	TEST_ASSERT_EQUAL_INT16(INT16_MIN, out[0]);
+	TEST_ASSERT_EQUAL_INT16(INT16_MAX, out[1]);
+	TEST_ASSERT_EQUAL_INT16(0, out[2]);
+	TEST_ASSERT_EQUAL_INT16(-1, out[3]);
+}
+
+void test_benchmark_sample_loop_vs_word_wise(void) {
+	const uint64_t scalarNs = Test_Benchmark(Test_ReferenceInPlace);
+	const uint64_t wordWiseNs = Test_Benchmark(SampleFormat_PackStereo32To16);
+	char message[96];
+	snprintf(message, sizeof(message), "sample loop: %.0f ns, word-wise: %.0f ns per %d frames (host)", static_cast<double>(scalarNs), static_cast<double>(wordWiseNs), testBenchmarkFrames);
+	TEST_MESSAGE(message);
+	TEST_ASSERT_TRUE(scalarNs > 0u && wordWiseNs > 0u);
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_sample_loop);
+	RUN_TEST(test_leaves_rest_of_buffer_alone);
+	RUN_TEST(test_sign_and_extremes);
+	RUN_TEST(test_benchmark_sample_loop_vs_word_wise);
+	return UNITY_END();
+}
@@ -0,0 +1,153 @@
+#include <unity.h>
+
+#include "LogStub.h"
+
+#include "SeekIndex.cpp"
+
+#include <vector>
+
+// Seek-index of a synthetic MP3 (MPEG1 layer III, 128 kbit/s, 44.1 kHz: 417 bytes per frame, 418 with padding):
+// every lookup has to return the exact start and decoded-sample position of the frame that holds the target,
+// with the Xing-frame not counted as audio.
+
+static fs::FS Test_Card;
+SanitizedFS gFSystem(Test_Card);
+
+void *x_malloc(uint32_t _allocSize) {
+	return malloc(_allocSize);
+}
+
+constexpr const char *testPath = "/audiobook/chapter.mp3";
+constexpr uint32_t testSampleRate = 44100u;
+constexpr uint32_t testSamplesPerFrame = 1152u;
+
+static std::vector<uint32_t> Test_FrameStarts; // of the audio-frames
+
+static void Test_AppendFrame(std::vector<uint8_t> &file, const bool padding, const char *tag) {
+	const size_t start = file.size();
+	file.resize(start + 417u + (padding ? 1u : 0u), 0x55);
+	file[start] = 0xFF;
+	file[start + 1] = 0xFB; // MPEG1, layer III, no CRC
+	file[start + 2] = 0x90 | (padding ? 0x02 : 0x00); // 128 kbit/s, 44.1 kHz
+	file[start + 3] = 0x00; // stereo
+	if (tag) {
+		memcpy(&file[start + 4 + 32], tag, 4);
+	}
+}
+
+// ID3v2-tag, Xing-frame (optional), audio-frames with padding in every third one and an ID3v1-tag at the end
+static void Test_WriteMp3(const uint32_t frames, const bool xing, const uint32_t garbageAfter = UINT32_MAX) {
+	std::vector<uint8_t> file = {'I', 'D', '3', 3, 0, 0, 0, 0, 1, 0}; // 128 bytes of tag
+	file.resize(10u + 128u, 0);
+	if (xing) {
+		Test_AppendFrame(file, false, "Xing");
+	}
+	Test_FrameStarts.clear();
+	for (uint32_t i = 0; i < frames; i++) {
+		if (i == garbageAfter) {
+			file.resize(file.size() + 100u, 0x00); // damaged part, has to be skipped
+		}
+		Test_FrameStarts.push_back(file.size());
+		Test_AppendFrame(file, (i % 3u) == 2u, nullptr);
+	}
+	const uint8_t id3v1[128] = {'T', 'A', 'G'};
+	file.insert(file.end(), id3v1, id3v1 + sizeof(id3v1));
+	Stub_Files[testPath] = file;
+}
+
+static void Test_Build(void) {
+	TEST_ASSERT_TRUE(SeekIndex_Build(testPath, SeekIndexType::Mp3, SeekIndex_GetIndexPath(testPath)));
+}
+
+static void Test_ExpectLookup(const uint32_t targetMs) {
+	const uint32_t frame = std::min<uint64_t>(static_cast<uint64_t>(targetMs) * testSampleRate / 1000u / testSamplesPerFrame, Test_FrameStarts.size() - 1u);
+	uint32_t filePos;
+	uint32_t frameSample;
+	TEST_ASSERT_TRUE(SeekIndex_Lookup(testPath, targetMs, &filePos, &frameSample));
+	TEST_ASSERT_EQUAL_UINT32(Test_FrameStarts[frame], filePos);
+	TEST_ASSERT_EQUAL_UINT32(frame * testSamplesPerFrame, frameSample);
+}
+
+void setUp(void) {
+	Stub_Files.clear();
+	if (SeekIndex_LoadedFile) {
+		SeekIndex_LoadedFile.close();
+	}
+}
+
+void tearDown(void) {
+}
+
+void test_index_layout(void) {
+	Test_WriteMp3(1000u, true);
+	Test_Build();
+	seekIndexHeader_t header;
+	TEST_ASSERT_TRUE(SeekIndex_IsValid(SeekIndex_GetIndexPath(testPath).c_str(), Stub_Files[testPath].size(), &header));
+	TEST_ASSERT_EQUAL_UINT16(seekIndexFramesPerEntry, header.framesPerEntry);
+	TEST_ASSERT_EQUAL_UINT32(testSampleRate, header.sampleRate);
+	TEST_ASSERT_EQUAL_UINT32((1000u + seekIndexFramesPerEntry - 1u) / seekIndexFramesPerEntry, header.count);
+}
+
+void test_lookup_hits_exact_frame(void) {
+	Test_WriteMp3(1000u, false);
+	Test_Build();
+	for (uint32_t ms = 0; ms < 27000u; ms += 97u) {
+		Test_ExpectLookup(ms);
+	}
+}
+
+void test_xing_frame_isnt_audio(void) {
+	Test_WriteMp3(1000u, true);
+	Test_Build();
+	Test_ExpectLookup(0u);
+	Test_ExpectLookup(1000u);
+	Test_ExpectLookup(20000u);
+}
+
+void test_damaged_frame_is_skipped(void) {
+	Test_WriteMp3(600u, false, 300u);
+	Test_Build();
+	Test_ExpectLookup(7000u);
+	Test_ExpectLookup(7850u);
+	Test_ExpectLookup(14000u);
+}
+
+void test_target_behind_end(void) {
+	Test_WriteMp3(40u, false);
+	Test_Build();
+	uint32_t filePos;
+	uint32_t frameSample;
+	TEST_ASSERT_TRUE(SeekIndex_Lookup(testPath, 60000u, &filePos, &frameSample));
+	TEST_ASSERT_TRUE(frameSample <= 39u * testSamplesPerFrame);
+	TEST_ASSERT_TRUE(frameSample >= 32u * testSamplesPerFrame);
+}
+
+void test_changed_file_isnt_looked_up(void) {
+	Test_WriteMp3(1000u, false);
+	Test_Build();
+	Test_ExpectLookup(5000u);
+	Test_WriteMp3(1001u, false);
+	uint32_t filePos;
+	uint32_t frameSample;
+	TEST_ASSERT_FALSE(SeekIndex_Lookup(testPath, 5000u, &filePos, &frameSample));
+}
+
+void test_long_file(void) {
+	Test_WriteMp3(40000u, true); // ~17 min
+	Test_Build();
+	for (uint32_t ms = 0; ms < 1040000u; ms += 12345u) {
+		Test_ExpectLookup(ms);
+	}
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_index_layout);
+	RUN_TEST(test_lookup_hits_exact_frame);
+	RUN_TEST(test_xing_frame_isnt_audio);
+	RUN_TEST(test_damaged_frame_is_skipped);
+	RUN_TEST(test_target_behind_end);
+	RUN_TEST(test_changed_file_isnt_looked_up);
+	RUN_TEST(test_long_file);
+	return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <unity.h>
+
+#include "TrackFade.cpp"
+
+// Crossfade: the gain has to reach 0 exactly at the end of the track and unity after the fade-in, follow the position
+// linearly in between and never jump between or inside buffers, whatever the buffer-size is
+
+constexpr uint32_t testSampleRate = 44100u;
+constexpr int16_t testMaxFrames = 1152;
+constexpr int32_t testFullScale = 0x7FFF0000; // 16 bit sample in the upper half, as delivered by the lib
+
+static int32_t Test_Buffer[2 * testMaxFrames];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_fade_is_limited_to_prepare_time(void) {
+	TEST_ASSERT_EQUAL_UINT32(3u * testSampleRate, TrackFade_GetFrames(3000u, testSampleRate));
+	TEST_ASSERT_EQUAL_UINT32(trackFadeMaxMs * testSampleRate / 1000u, TrackFade_GetFrames(10000u, testSampleRate));
+	TEST_ASSERT_EQUAL_UINT32(trackFadeMaxMs * 96u, TrackFade_GetFrames(UINT32_MAX, 96000u));
+}
+
+void test_gain_follows_position(void) {
+	const uint32_t fadeFrames = TrackFade_GetFrames(2000u, testSampleRate);
+	const uint32_t trackFrames = 10u * testSampleRate;
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15, TrackFade_GetGain(trackFrames / 2u, trackFrames, fadeFrames, true, false));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15 / 2, TrackFade_GetGain(trackFrames - fadeFrames / 2u, trackFrames, fadeFrames, true, false));
+	TEST_ASSERT_EQUAL_INT32(0, TrackFade_GetGain(trackFrames, trackFrames, fadeFrames, true, false));
+	TEST_ASSERT_EQUAL_INT32(0, TrackFade_GetGain(trackFrames + 100u, trackFrames, fadeFrames, true, false));
+
+	TEST_ASSERT_EQUAL_INT32(0, TrackFade_GetGain(0u, trackFrames, fadeFrames, false, true));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15 / 4, TrackFade_GetGain(fadeFrames / 4u, trackFrames, fadeFrames, false, true));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15, TrackFade_GetGain(fadeFrames, trackFrames, fadeFrames, false, true));
+
+	// without a next track, unknown length or fade there's nothing to do
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15, TrackFade_GetGain(trackFrames, trackFrames, fadeFrames, false, false));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15, TrackFade_GetGain(trackFrames, 0u, fadeFrames, true, false));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15, TrackFade_GetGain(0u, trackFrames, 0u, true, true));
+}
+
+void test_short_track_fades_in_and_out(void) {
+	const uint32_t fadeFrames = 1000u;
+	const uint32_t trackFrames = 1500u; // shorter than both fades
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15 / 2, TrackFade_GetGain(500u, trackFrames, fadeFrames, true, true));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15 / 4, TrackFade_GetGain(250u, trackFrames, fadeFrames, true, true));
+	TEST_ASSERT_EQUAL_INT32(trackFadeUnityQ15 / 4, TrackFade_GetGain(1250u, trackFrames, fadeFrames, true, true));
+}
+
+// A whole fade-out, buffer by buffer like audio_process_i2s(): the ramp has to be monotonic without steps
+static void Test_FadeOut(const int16_t bufferFrames) {
+	const uint32_t fadeFrames = TrackFade_GetFrames(500u, testSampleRate);
+	const uint32_t trackFrames = 3u * fadeFrames + 17u;
+	int32_t gainQ15 = trackFadeUnityQ15;
+	int32_t previous = testFullScale;
+	const int32_t maxStep = testFullScale / static_cast<int32_t>(fadeFrames) + testFullScale / trackFadeUnityQ15 + 2; // slope + one step of the Q15-gain
+	uint32_t framesOut = 0;
+	while (framesOut < trackFrames) {
+		const int16_t frames = std::min<uint32_t>(bufferFrames, trackFrames - framesOut);
+		for (int16_t i = 0; i < 2 * frames; i++) {
+			Test_Buffer[i] = testFullScale;
+		}
+		framesOut += frames;
+		const int32_t target = TrackFade_GetGain(framesOut, trackFrames, fadeFrames, true, false);
+		TrackFade_Apply(Test_Buffer, frames, gainQ15, target);
+		gainQ15 = target;
+		for (int16_t i = 0; i < frames; i++) {
+			TEST_ASSERT_EQUAL_INT32(Test_Buffer[2 * i], Test_Buffer[2 * i + 1]);
+			TEST_ASSERT_TRUE(Test_Buffer[2 * i] <= previous);
+			TEST_ASSERT_TRUE(previous - Test_Buffer[2 * i] <= maxStep);
+			previous = Test_Buffer[2 * i];
+		}
+	}
+	TEST_ASSERT_EQUAL_INT32(0, gainQ15);
+	TEST_ASSERT_TRUE(previous <= maxStep);
+}
+
+void test_fade_out_has_no_steps(void) {
+	const int16_t bufferFrames[] = {1, 7, 128, 576, 1024, testMaxFrames};
+	for (const int16_t frames : bufferFrames) {
+		Test_FadeOut(frames);
+	}
+}
+
+void test_unity_gain_keeps_samples(void) {
+	const int32_t samples[] = {testFullScale, -testFullScale - 0x10000, 0x12340000, -0x00010000, 0};
+	for (uint8_t i = 0; i < 5u; i++) {
+		Test_Buffer[2 * i] = samples[i];
+		Test_Buffer[2 * i + 1] = samples[i];
+	}
+	TrackFade_Apply(Test_Buffer, 5, trackFadeUnityQ15, trackFadeUnityQ15);
+	for (uint8_t i = 0; i < 5u; i++) {
+		TEST_ASSERT_EQUAL_INT32(samples[i], Test_Buffer[2 * i]);
+		TEST_ASSERT_EQUAL_INT32(samples[i], Test_Buffer[2 * i + 1]);
+	}
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_fade_is_limited_to_prepare_time);
+	RUN_TEST(test_gain_follows_position);
+	RUN_TEST(test_short_track_fades_in_and_out);
+	RUN_TEST(test_fade_out_has_no_steps);
+	RUN_TEST(test_unity_gain_keeps_samples);
+	return UNITY_END();
+}
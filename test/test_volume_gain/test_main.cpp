@@ -0,0 +1,158 @@
+#include <unity.h>
+
+#include "VolumeGain.cpp"
+
+#include "volume_curves_fixture.h"
+
+// The gain-table has to give the same levels as evaluating the volume-curve directly (as done before the table
+// existed): exactly at the volume-steps and within the interpolation-error of the curve in between.
+// Independent of the LUT the firmware uses, the table is checked against volume_curves_fixture.h: the curves of
+// volume_curves.py evaluated analytically at every volume-step (regenerate with "volume_curves.py --test-fixture").
+// The LUT has 32 points with 2 decimals and is interpolated linearly in dB, so the steps may deviate by up to
+// fixtureToleranceDb (0.25 dB measured); for the Q15-gain that's a factor of 10^(0.3/20) = 3.5%, plus 1 LSB of
+// rounding.
+
+constexpr uint8_t testSteps = 21u; // AUDIOPLAYER_VOLUME_MAX
+constexpr float fixtureToleranceDb = 0.3f;
+constexpr float fixtureToleranceGain = 0.035f;
+static_assert(FIXTURE_VOLUME_STEPS == testSteps, "fixture has to be generated for the firmware's volume-steps");
+
+static volumeGain_t Test_Table[testSteps + 1];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_steps_match_curve(void) {
+	for (uint8_t curve = 0; curve < VOL_LUT_CURVES; curve++) {
+		VolumeGain_BuildTable(Test_Table, testSteps, curve, testSteps, 0.0f, 0.0f);
+		for (uint8_t step = 0; step <= testSteps; step++) {
+			const float t = (float) step / testSteps;
+			TEST_ASSERT_EQUAL_FLOAT(VolumeGain_CurveDb(curve, t), Test_Table[step].db);
+			TEST_ASSERT_EQUAL_FLOAT(VolumeGain_CurveDb(curve, t), VolumeGain_Interpolate(Test_Table, testSteps, t));
+		}
+	}
+}
+
+void test_table_matches_fixture(void) {
+	static_assert(VOL_CURVE_SQUARED == 0 && VOL_CURVE_PERCEPTUAL == 1, "order of the curves in the fixture");
+	for (uint8_t curve = 0; curve < VOL_LUT_CURVES; curve++) {
+		VolumeGain_BuildTable(Test_Table, testSteps, curve, testSteps, 0.0f, 0.0f);
+		for (uint8_t step = 0; step <= testSteps; step++) {
+			const VolumeCurveFixture &expected = VOLUME_CURVE_FIXTURE[curve][step];
+			TEST_ASSERT_FLOAT_WITHIN(fixtureToleranceDb, expected.db, Test_Table[step].db);
+			TEST_ASSERT_INT_WITHIN(lroundf(expected.gainQ15 * fixtureToleranceGain) + 1, expected.gainQ15, Test_Table[step].gainQ15);
+		}
+	}
+}
+
+void test_lut_endpoints(void) {
+	for (uint8_t curve = 0; curve < VOL_LUT_CURVES; curve++) {
+		TEST_ASSERT_EQUAL_FLOAT(-60.0f, VolumeGain_CurveDb(curve, 0.0f));
+		TEST_ASSERT_EQUAL_FLOAT(0.0f, VolumeGain_CurveDb(curve, 1.0f));
+		TEST_ASSERT_EQUAL_FLOAT(0.0f, VolumeGain_CurveDb(curve, 1.5f));
+	}
+	// unknown curve falls back to the perceptual one
+	TEST_ASSERT_EQUAL_FLOAT(VolumeGain_CurveDb(VOL_CURVE_PERCEPTUAL, 0.3f), VolumeGain_CurveDb(VOL_LUT_CURVES, 0.3f));
+}
+
+void test_in_between_steps_close_to_curve(void) {
+	for (uint8_t curve = 0; curve < VOL_LUT_CURVES; curve++) {
+		VolumeGain_BuildTable(Test_Table, testSteps, curve, testSteps, 0.0f, 0.0f);
+		for (uint16_t i = 0; i <= 1000u; i++) {
+			const float t = i / 1000.0f;
+			TEST_ASSERT_FLOAT_WITHIN(0.75f, VolumeGain_CurveDb(curve, t), VolumeGain_Interpolate(Test_Table, testSteps, t));
+		}
+	}
+}
+
+void test_monotonic(void) {
+	for (uint8_t curve = 0; curve < VOL_LUT_CURVES; curve++) {
+		VolumeGain_BuildTable(Test_Table, testSteps, curve, testSteps, 0.0f, 0.0f);
+		for (uint8_t step = 1; step <= testSteps; step++) {
+			TEST_ASSERT_TRUE(Test_Table[step].db >= Test_Table[step - 1].db);
+			TEST_ASSERT_TRUE(Test_Table[step].gainQ15 >= Test_Table[step - 1].gainQ15);
+		}
+	}
+}
+
+void test_linear_gain_matches_db(void) {
+	VolumeGain_BuildTable(Test_Table, testSteps, VOL_CURVE_PERCEPTUAL, testSteps, 0.0f, 0.0f);
+	TEST_ASSERT_EQUAL_UINT32(volumeGainUnityQ15, Test_Table[testSteps].gainQ15);
+	TEST_ASSERT_EQUAL_UINT32(33u, Test_Table[0].gainQ15); // -60 dB
+	for (uint8_t step = 0; step <= testSteps; step++) {
+		TEST_ASSERT_INT_WITHIN(1, lround(pow(10.0, Test_Table[step].db / 20.0) * 32768.0), Test_Table[step].gainQ15);
+	}
+}
+
+void test_steps_above_max_volume_are_limited(void) {
+	VolumeGain_BuildTable(Test_Table, testSteps, VOL_CURVE_SQUARED, 15u, 0.0f, 0.0f);
+	for (uint8_t step = 15u; step <= testSteps; step++) {
+		TEST_ASSERT_EQUAL_FLOAT(VolumeGain_CurveDb(VOL_CURVE_SQUARED, 15.0f / testSteps), Test_Table[step].db);
+		TEST_ASSERT_EQUAL_UINT16(Test_Table[15].gainQ15, Test_Table[step].gainQ15);
+	}
+}
+
+void test_offset_is_added(void) {
+	VolumeGain_BuildTable(Test_Table, testSteps, VOL_CURVE_PERCEPTUAL, testSteps, -6.0f, 0.0f);
+	TEST_ASSERT_EQUAL_FLOAT(-6.0f, Test_Table[testSteps].db);
+	TEST_ASSERT_EQUAL_FLOAT(VolumeGain_CurveDb(VOL_CURVE_PERCEPTUAL, 10.0f / testSteps) - 6.0f, Test_Table[10].db);
+}
+
+void test_positive_offset_up_to_peak_limit(void) {
+	// unknown peak: not above full scale
+	VolumeGain_BuildTable(Test_Table, testSteps, VOL_CURVE_PERCEPTUAL, testSteps, 6.0f, 0.0f);
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, Test_Table[testSteps].db);
+	TEST_ASSERT_EQUAL_UINT32(volumeGainUnityQ15, Test_Table[testSteps].gainQ15);
+
+	// 4 dB of headroom: the lib attenuates down to 0 dB, the gain goes up to +4 dB
+	VolumeGain_BuildTable(Test_Table, testSteps, VOL_CURVE_PERCEPTUAL, testSteps, 6.0f, 4.0f);
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, Test_Table[testSteps].db);
+	TEST_ASSERT_INT_WITHIN(1, lround(pow(10.0, 4.0 / 20.0) * 32768.0), Test_Table[testSteps].gainQ15);
+	const float low = VolumeGain_CurveDb(VOL_CURVE_PERCEPTUAL, 5.0f / testSteps) + 6.0f;
+	TEST_ASSERT_TRUE(low < 0.0f);
+	TEST_ASSERT_EQUAL_FLOAT(low, Test_Table[5].db);
+	for (uint8_t step = 1; step <= testSteps; step++) {
+		TEST_ASSERT_TRUE(Test_Table[step].gainQ15 >= Test_Table[step - 1].gainQ15);
+		TEST_ASSERT_TRUE(Test_Table[step].db <= 0.0f);
+	}
+
+	// more headroom than gain
+	VolumeGain_BuildTable(Test_Table, testSteps, VOL_CURVE_PERCEPTUAL, testSteps, 3.0f, 10.0f);
+	TEST_ASSERT_INT_WITHIN(1, lround(pow(10.0, 3.0 / 20.0) * 32768.0), Test_Table[testSteps].gainQ15);
+}
+
+void test_boost_is_applied_above_unity_only(void) {
+	int32_t buff[6] = {0x10000000, -0x10000000, 0x40000000, -0x7FFF0000, 0x12340000, 0};
+	int32_t expected[6];
+	memcpy(expected, buff, sizeof(buff));
+	VolumeGain_ApplyBoost(buff, 3, volumeGainUnityQ15);
+	TEST_ASSERT_EQUAL_INT32_ARRAY(expected, buff, 6);
+	VolumeGain_ApplyBoost(buff, 3, volumeGainUnityQ15 / 2u);
+	TEST_ASSERT_EQUAL_INT32_ARRAY(expected, buff, 6);
+
+	VolumeGain_ApplyBoost(buff, 3, 2u * volumeGainUnityQ15); // +6 dB
+	TEST_ASSERT_EQUAL_INT32(0x20000000, buff[0]);
+	TEST_ASSERT_EQUAL_INT32(-0x20000000, buff[1]);
+	TEST_ASSERT_EQUAL_INT32(INT32_MAX, buff[2]); // saturated
+	TEST_ASSERT_EQUAL_INT32(INT32_MIN, buff[3]);
+	TEST_ASSERT_EQUAL_INT32(0x24680000, buff[4]);
+	TEST_ASSERT_EQUAL_INT32(0, buff[5]);
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_steps_match_curve);
+	RUN_TEST(test_table_matches_fixture);
+	RUN_TEST(test_lut_endpoints);
+	RUN_TEST(test_in_between_steps_close_to_curve);
+	RUN_TEST(test_monotonic);
+	RUN_TEST(test_linear_gain_matches_db);
+	RUN_TEST(test_steps_above_max_volume_are_limited);
+	RUN_TEST(test_offset_is_added);
+	RUN_TEST(test_positive_offset_up_to_peak_limit);
+	RUN_TEST(test_boost_is_applied_above_unity_only);
+	return UNITY_END();
+}
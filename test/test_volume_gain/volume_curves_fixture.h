@@ -0,0 +1,61 @@
+// clang-format off
+/* --- GENERATED BY volume_curves.py --test-fixture, DO NOT EDIT --- */
+#pragma once
+
+static constexpr int FIXTURE_VOLUME_STEPS = 21;
+
+struct VolumeCurveFixture {
+    float db;
+    uint16_t gainQ15;
+};
+
+static const VolumeCurveFixture VOLUME_CURVE_FIXTURE[2][FIXTURE_VOLUME_STEPS + 1] = {
+    { // SQUARED
+        { -60.0000f,    33},
+        { -49.7215f,   107},
+        { -39.9470f,   330},
+        { -33.3967f,   701},
+        { -28.5787f,  1220},
+        { -24.7866f,  1889},
+        { -21.6656f,  2705},
+        { -19.0156f,  3670},
+        { -16.7142f,  4783},
+        { -14.6806f,  6045},
+        { -12.8592f,  7456},
+        { -11.2101f,  9015},
+        {  -9.7036f, 10722},
+        {  -8.3171f, 12578},
+        {  -7.0328f, 14582},
+        {  -5.8368f, 16734},
+        {  -4.7177f, 19036},
+        {  -3.6662f, 21485},
+        {  -2.6747f, 24083},
+        {  -1.7367f, 26830},
+        {  -0.8467f, 29725},
+        {   0.0000f, 32768}
+    },
+    { // PERCEPTUAL
+        { -60.0000f,    33},
+        { -59.1102f,    36},
+        { -54.5959f,    61},
+        { -48.1508f,   128},
+        { -42.0433f,   259},
+        { -36.7823f,   475},
+        { -32.2878f,   796},
+        { -28.4043f,  1245},
+        { -25.0006f,  1843},
+        { -21.9775f,  2610},
+        { -19.2617f,  3568},
+        { -16.7980f,  4738},
+        { -14.5445f,  6141},
+        { -12.4687f,  7799},
+        { -10.5449f,  9732},
+        {  -8.7525f, 11963},
+        {  -7.0750f, 14511},
+        {  -5.4985f, 17399},
+        {  -4.0117f, 20647},
+        {  -2.6049f, 24278},
+        {  -1.2700f, 28311},
+        {   0.0000f, 32768}
+    }
+};
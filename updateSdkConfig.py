@@ -1,10 +1,32 @@
 Import("env")
 from pathlib import Path
 import json
+import os
+import re
 
 default_file = "sdkconfig.defaults"
+heap_profiler_file = "sdkconfig.defaults.heap_profiler"  # heap-hooks, only with HEAP_PROFILER_ENABLE
 build_file = ".pio/lastBuild.json"
 
+
+# HEAP_PROFILER_ENABLE is set in settings.h / settings-override.h or as build-flag
+def heap_profiler_enabled():
+    build_flags = env.GetProjectOption("build_flags", "")
+    if isinstance(build_flags, list):
+        build_flags = " ".join(build_flags)
+    if re.search(r"-D\s*HEAP_PROFILER_ENABLE\b", build_flags):
+        return True
+    for settings_file in ("src/settings.h", "src/settings-override.h"):
+        path = Path(settings_file)
+        if path.is_file() and re.search(r"^\s*#define\s+HEAP_PROFILER_ENABLE\b", path.read_text(errors="ignore"), re.MULTILINE):
+            return True
+    return False
+
+
+heap_profiler = heap_profiler_enabled()
+if heap_profiler:
+    os.environ["SDKCONFIG_DEFAULTS"] = default_file + ";" + heap_profiler_file
+
 # Get last modified timestamp of default file
 default_path = Path(default_file)
 if default_path.is_file():
@@ -22,13 +44,14 @@ else:
     last_timestamp = 0
     build_data = {}  # default value for build_data
 
-if default_time > last_timestamp:
-    # Delete all sdkconfig files except for sdkconfig.default
+if default_time > last_timestamp or heap_profiler != build_data.get("heap_profiler", False):
+    # Delete all generated sdkconfig files (not the defaults)
     for file_path in Path(".").glob("sdkconfig.*"):
-        if file_path.name != default_file:
+        if not file_path.name.startswith(default_file):
             file_path.unlink()
 
-    # Write last known timestamp to lastBuild.json
+    # Write last known timestamp and options to lastBuild.json
     build_data["last_timestamp"] = default_time  # update last_timestamp
+    build_data["heap_profiler"] = heap_profiler
     with open(build_file, "w") as f:
         json.dump(build_data, f)
\ No newline at end of file
@@ -1,4 +1,5 @@
 import os
+import sys
 import numpy as np
 import matplotlib.pyplot as plt
 
@@ -6,6 +7,7 @@ import matplotlib.pyplot as plt
 MIN_DB = -60.0
 MAX_DB = 0.0
 STEPS = 32
+FIXTURE_VOLUME_STEPS = 21 # volume-steps of the firmware (AUDIOPLAYER_VOLUME_MAX), for the test-fixture
 
 def db_to_amp(db):
     return 10**(db / 20.0)
@@ -129,7 +131,44 @@ def generate_header():
     with open(file_path, "w") as f:
         f.write("\n".join(out_file))
 
+def generate_test_fixture():
+    """Reference levels for test/test_volume_gain: the curves evaluated directly (not the LUT) at every volume-step."""
+    base_path = os.path.dirname(os.path.abspath(__file__))
+    file_path = os.path.join(base_path, "test", "test_volume_gain", "volume_curves_fixture.h")
+
+    steps = FIXTURE_VOLUME_STEPS
+    curves = [
+        ("SQUARED", algo_squared),
+        ("PERCEPTUAL", algo_perceptual),
+    ]
+
+    out_file = []
+    out_file.append("// clang-format off")
+    out_file.append("/* --- GENERATED BY volume_curves.py --test-fixture, DO NOT EDIT --- */")
+    out_file.append("#pragma once\n")
+    out_file.append(f"static constexpr int FIXTURE_VOLUME_STEPS = {steps};\n")
+    out_file.append("struct VolumeCurveFixture {")
+    out_file.append("    float db;")
+    out_file.append("    uint16_t gainQ15;")
+    out_file.append("};\n")
+    out_file.append(f"static const VolumeCurveFixture VOLUME_CURVE_FIXTURE[{len(curves)}][FIXTURE_VOLUME_STEPS + 1] = {{")
+    for name, algo in curves:
+        out_file.append(f"    {{ // {name}")
+        for step in range(steps + 1):
+            db = float(algo(step / steps))
+            gain = int(round(db_to_amp(db) * 32768.0))
+            suffix = "," if step != steps else ""
+            out_file.append(f"        {{{db:9.4f}f, {gain:5d}}}{suffix}")
+        out_file.append("    }," if name != curves[-1][0] else "    }")
+    out_file.append("};\n")
+
+    with open(file_path, "w") as f:
+        f.write("\n".join(out_file))
+
 
 if __name__ == "__main__":
-    generate_header()
-    plot_all()
\ No newline at end of file
+    if "--test-fixture" in sys.argv:
+        generate_test_fixture()
+    else:
+        generate_header()
+        plot_all()
\ No newline at end of file